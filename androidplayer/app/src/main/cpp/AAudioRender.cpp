@@ -1,4 +1,5 @@
 #include "AAudioRender.h"
+#include <time.h>
 #include "android/log.h"
 
 #define LOG_TAG "AAudioRender"
@@ -11,17 +12,25 @@ AAudioRender::AAudioRender() {
     this->channel_count = 2;
     this->format = AAUDIO_FORMAT_PCM_I16;
     this->callback = nullptr;
+    this->user_data = nullptr;
 }
 
 AAudioRender::~AAudioRender() {
-    AAudioStream_close(stream);
+    close();
 }
 
-int AAudioRender::start() {
+int AAudioRender::open() {
+    if (stream) {
+        return 0;
+    }
+    if (!this->callback) {
+        LOGE("callback is nullptr");
+        return -1;
+    }
     AAudioStreamBuilder *builder;
     aaudio_result_t result = AAudio_createStreamBuilder(&builder);
     if (result != AAUDIO_OK) {
-        LOGE(LOG_TAG, "createStreamBuilder failed: %s", AAudio_convertResultToText(result));
+        LOGE("createStreamBuilder failed: %s", AAudio_convertResultToText(result));
         return -1;
     }
     AAudioStreamBuilder_setSampleRate(builder, this->sample_rate);
@@ -29,29 +38,64 @@ int AAudioRender::start() {
     AAudioStreamBuilder_setFormat(builder, this->format);
     AAudioStreamBuilder_setPerformanceMode(builder, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY);
     AAudioStreamBuilder_setSharingMode(builder, AAUDIO_SHARING_MODE_SHARED);
-    if (!this->callback) {
-        LOGE(LOG_TAG, "callback is nullptr");
-        return -1;
-    }
     AAudioStreamBuilder_setDataCallback(builder, callback, user_data);
     result = AAudioStreamBuilder_openStream(builder, &stream);
+    AAudioStreamBuilder_delete(builder);
     if (result != AAUDIO_OK) {
-        LOGE(LOG_TAG, "openStream failed: %s", AAudio_convertResultToText(result));
+        LOGE("openStream failed: %s", AAudio_convertResultToText(result));
+        stream = nullptr;
         return -1;
     }
     this->format = AAudioStream_getFormat(stream);
     this->channel_count = AAudioStream_getChannelCount(stream);
     this->sample_rate = AAudioStream_getSampleRate(stream);
-    result = AAudioStream_requestStart(stream);
+    return 0;
+}
+
+int AAudioRender::start() {
+    if (open() < 0) {
+        return -1;
+    }
+    aaudio_result_t result = AAudioStream_requestStart(stream);
     if (result != AAUDIO_OK) {
-        LOGE(LOG_TAG, "requestStart failed: %s", AAudio_convertResultToText(result));
+        LOGE("requestStart failed: %s", AAudio_convertResultToText(result));
         return -1;
     }
-    AAudioStreamBuilder_delete(builder);
+    paused = false;
     return 0;
 }
 
+void AAudioRender::close() {
+    if (!stream) {
+        return;
+    }
+    AAudioStream_requestStop(stream);
+    AAudioStream_close(stream);
+    stream = nullptr;
+}
+
+int64_t AAudioRender::outputLatencyNs() {
+    if (!stream) {
+        return -1;
+    }
+    int64_t presented_frame;
+    int64_t presented_time_ns;
+    if (AAudioStream_getTimestamp(stream, CLOCK_MONOTONIC, &presented_frame, &presented_time_ns) != AAUDIO_OK) {
+        return -1;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now_ns = (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    // 按时间戳外推当前正在播放的帧，已写入但尚未播放的帧数即为输出延迟
+    int64_t playing_frame = presented_frame + (now_ns - presented_time_ns) * sample_rate / 1000000000LL;
+    int64_t pending = AAudioStream_getFramesWritten(stream) - playing_frame;
+    return pending > 0 ? pending * 1000000000LL / sample_rate : 0;
+}
+
 int AAudioRender::flush() {
+    if (!stream) {
+        return -1;
+    }
     const int64_t timeout = 100000000; //100ms
     AAudioStream_requestPause(stream);
     aaudio_result_t result = AAUDIO_OK;
@@ -72,11 +116,15 @@ int AAudioRender::flush() {
                 stream, inputState, &currentState, timeout);
         inputState = currentState;
     }
+    paused = false;
     return result;
 
 }
 
 int AAudioRender::pause(bool p) {
+    if (!stream) {
+        return -1;
+    }
     if (p == paused) {
         return 0;
     }
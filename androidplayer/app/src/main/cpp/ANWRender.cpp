@@ -4,36 +4,90 @@
 #include <android/native_window.h>  // 包含此头文件
 #include <android/native_window_jni.h>
 #define LOG_TAG "ANWDisplay"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__) // 错误日志宏
 
 ANWRender::ANWRender(ANativeWindow* window) {
     native_window = window;
 }
 
-int ANWRender::init(int videoWidth, int videoHeight) {
-    width = videoWidth;
-    height = videoHeight;
-    if (native_window == NULL)
+int ANWRender::init(const LetterboxLayout &pictureLayout, YuvOutput windowOutput, int retainFrames) {
+    layout = pictureLayout;
+    output = windowOutput;
+    bytesPerPixel = output == YuvOutput::Rgb565 ? 2 : 4;
+    ring.clear();
+    writeSlot = shownSlot = -1;
+    if (native_window == NULL || layout.width <= 0 || layout.height <= 0)
         return -1;
-    return ANativeWindow_setBuffersGeometry(native_window, videoWidth,
-                                            videoHeight, WINDOW_FORMAT_RGBA_8888);
+    if (retainFrames > 0) {
+        if (retainFrames < 2) retainFrames = 2; // 转换下一帧时最近显示的一帧不能被覆盖
+        ringStride = (layout.width * bytesPerPixel + 63) & ~63;
+        ring.assign(retainFrames, std::vector<uint8_t>((size_t) ringStride * layout.height));
+    }
+    return 0;
 }
 
-int ANWRender::render(uint8_t* rgba) {
-    if (native_window == NULL || rgba == NULL)
-        return -1;
-
+uint8_t* ANWRender::lockWindow(int* stride) {
     ANativeWindow_Buffer out_buffer;
-    ANativeWindow_lock(native_window, &out_buffer, NULL);
+    if (ANativeWindow_lock(native_window, &out_buffer, NULL) < 0) {
+        LOGE("无法锁定原生窗口");
+        return NULL;
+    }
+    if ((out_buffer.format == WINDOW_FORMAT_RGB_565 ? 2 : 4) != bytesPerPixel) { // 按错误的像素宽度写入会越界
+        LOGE("窗口缓冲区格式 %d 与设置的格式不符", out_buffer.format);
+        ANativeWindow_unlockAndPost(native_window);
+        return NULL;
+    }
+    windowLocked = true;
+    uint8_t* bits = static_cast<uint8_t*>(out_buffer.bits);
+    *stride = out_buffer.stride * bytesPerPixel;
+    letterbox_fill_bars(bits, *stride, layout, output); // 窗口缓冲区轮换使用，每次都重新填充黑边
+    return bits + (long) layout.y * *stride + layout.x * bytesPerPixel;
+}
 
-    int srcLineSize = width * 4;
-    int dstLineSize = out_buffer.stride * 4;
-    uint8_t* dstBuffer = static_cast<uint8_t*>(out_buffer.bits);
+int ANWRender::lock(Target* target) {
+    if (native_window == NULL || target == NULL)
+        return -1;
+    if (ring.empty()) { // 直接模式：转换器写入锁定的窗口缓冲区
+        target->pixels = lockWindow(&target->stride);
+        return target->pixels ? 0 : -1;
+    }
+    writeSlot = (shownSlot + 1) % (int) ring.size();
+    target->pixels = ring[writeSlot].data();
+    target->stride = ringStride;
+    return 0;
+}
 
-    for (int i = 0; i < height; ++i) {
-        memcpy(dstBuffer + i * dstLineSize, rgba + i * srcLineSize, srcLineSize);
+int ANWRender::postSlot(int slot) {
+    int dstLineSize;
+    uint8_t* dstBuffer = lockWindow(&dstLineSize);
+    if (dstBuffer == NULL)
+        return -1;
+    const uint8_t* pixels = ring[slot].data();
+    int lineSize = layout.width * bytesPerPixel;
+    for (int i = 0; i < layout.height; ++i) {
+        memcpy(dstBuffer + (long) i * dstLineSize, pixels + (long) i * ringStride, lineSize);
     }
+    windowLocked = false;
+    return ANativeWindow_unlockAndPost(native_window);
+}
 
-    ANativeWindow_unlockAndPost(native_window);
-    return 0;
+int ANWRender::post() {
+    if (ring.empty()) {
+        if (!windowLocked)
+            return -1;
+        windowLocked = false;
+        return ANativeWindow_unlockAndPost(native_window);
+    }
+    if (writeSlot < 0)
+        return -1;
+    int ret = postSlot(writeSlot);
+    if (ret == 0) shownSlot = writeSlot;
+    writeSlot = -1;
+    return ret;
+}
 
+int ANWRender::redisplay() {
+    if (ring.empty() || shownSlot < 0 || windowLocked)
+        return -1;
+    return postSlot(shownSlot);
 }
@@ -0,0 +1,391 @@
+#include "AudioDecoder.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <unistd.h>
+#include "android/log.h"
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+}
+
+#define LOG_TAG "AudioDecoder"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+
+static const size_t kSampleRingBytes = 64 * 1024; // PCM环形缓冲区大小 (48kHz双声道float约170ms)
+static const size_t kMarkerRingSize = 256;        // 时间标记容量 (每个解码帧一个)
+static const int kProducerWaitUs = 5000;          // 缓冲区满时解码线程的等待间隔
+static const size_t kPacketQueueBytes = 256 * 1024; // 音频包队列的常规上限 (AAC 128kbps约16s)
+static const int kPacketWaitMs = 20;              // 包队列为空时的等待时间，超时后检查终止请求
+static const double kMinSpeed = 0.25;
+static const double kMaxSpeed = 4.0;
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed_ms(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+AudioDecoder::AudioDecoder() : samples_(kSampleRingBytes), markers_(kMarkerRingSize) {
+}
+
+AudioDecoder::~AudioDecoder() {
+    close();
+}
+
+int AudioDecoder::open(const char *path) {
+    std::shared_ptr<Demuxer> demuxer = std::make_shared<Demuxer>();
+    int ret = demuxer->open(path);
+    if (ret < 0) return ret;
+    return open(demuxer);
+}
+
+int AudioDecoder::open(const std::shared_ptr<Demuxer> &demuxer) {
+    close();
+    if (demuxer->audioStream() < 0) {
+        LOGW("%s 中没有音频流", demuxer->path().c_str());
+        return -3;
+    }
+    demuxer_ = demuxer;
+    stream_idx_ = demuxer->audioStream();
+    AVStream *stream = demuxer->formatContext()->streams[stream_idx_];
+    AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) {
+        LOGE("不支持的音频解码器ID: %d", stream->codecpar->codec_id);
+        close();
+        return -4;
+    }
+    codec_ctx_ = avcodec_alloc_context3(codec);
+    if (!codec_ctx_) {
+        LOGE("无法分配音频解码器上下文");
+        close();
+        return -5;
+    }
+    if (avcodec_parameters_to_context(codec_ctx_, stream->codecpar) < 0) {
+        LOGE("无法拷贝音频解码器参数到上下文");
+        close();
+        return -6;
+    }
+    if (avcodec_open2(codec_ctx_, codec, nullptr) < 0) {
+        LOGE("无法打开音频解码器");
+        close();
+        return -7;
+    }
+    time_base_ = stream->time_base;
+    start_pts_ = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    packets_ = demuxer_->enableStream(stream_idx_, kPacketQueueBytes);
+    LOGI("音频解码器 %s 已打开: %d Hz, %d 声道, %s", codec->name, codec_ctx_->sample_rate, codec_ctx_->channels,
+         av_get_sample_fmt_name(codec_ctx_->sample_fmt));
+    return 0;
+}
+
+void AudioDecoder::setOutputFormat(const OutputFormat &format) {
+    output_ = format;
+    bytes_per_frame_ = output_.channels * av_get_bytes_per_sample(output_.sample_fmt);
+    swr_free(&swr_); // 输出参数变化，下次解码时重新创建
+    stretcher_.configure(output_.sample_rate, output_.channels);
+}
+
+int AudioDecoder::start(double start_s) {
+    if (!codec_ctx_) return -1;
+    stop();
+    start_s = std::max(0.0, start_s);
+    return restart(start_s, demuxer_->seek(start_s));
+}
+
+int AudioDecoder::follow(double time_s, int serial) {
+    if (!codec_ctx_) return -1;
+    stop();
+    return restart(std::max(0.0, time_s), serial);
+}
+
+int AudioDecoder::restart(double start_s, int min_serial) {
+    min_serial_ = min_serial; // 之前序号的包全部作废
+    packet_serial_ = -1;
+    avcodec_flush_buffers(codec_ctx_);
+    skip_until_s_ = start_s; // 跳转落在目标之前的关键帧上，丢弃目标之前的采样
+    next_media_s_ = start_s;
+    stretcher_.reset();
+    stretch_started_ = false;
+    resetBuffers();
+    abort_ = false;
+    eof_ = false;
+    decode_thread_ = std::thread(&AudioDecoder::decodeLoop, this);
+    return demuxer_->start();
+}
+
+void AudioDecoder::stop() {
+    abort_ = true;
+    if (decode_thread_.joinable()) decode_thread_.join();
+}
+
+void AudioDecoder::close() {
+    stop();
+    swr_free(&swr_);
+    av_freep(&convert_buffer_);
+    convert_capacity_ = 0;
+    if (codec_ctx_) avcodec_free_context(&codec_ctx_);
+    if (demuxer_) { // 最后一个使用者释放时解复用线程随之停止
+        demuxer_->disableStream(stream_idx_);
+        demuxer_.reset();
+        packets_ = nullptr;
+    }
+    stream_idx_ = -1;
+}
+
+int AudioDecoder::seek(double time_s) {
+    return start(time_s);
+}
+
+void AudioDecoder::setSpeed(double speed) {
+    speed_ = std::max(kMinSpeed, std::min(kMaxSpeed, speed));
+}
+
+void AudioDecoder::resetBuffers() {
+    samples_.reset();
+    markers_.reset();
+    frames_written_ = 0;
+    frames_read_ = 0;
+    has_marker_ = false;
+    position_s_ = -1.0;
+}
+
+double AudioDecoder::durationS() const {
+    if (!demuxer_) return 0.0;
+    AVFormatContext *fmt_ctx = demuxer_->formatContext();
+    AVStream *stream = fmt_ctx->streams[stream_idx_];
+    if (stream->duration != AV_NOPTS_VALUE) return stream->duration * av_q2d(time_base_);
+    return fmt_ctx->duration != AV_NOPTS_VALUE ? fmt_ctx->duration / (double) AV_TIME_BASE : 0.0;
+}
+
+AudioDecoder::Stats AudioDecoder::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats stats = stats_;
+    stats.underruns = underruns_.load();
+    stats.silence_frames = silence_frames_.load();
+    return stats;
+}
+
+void AudioDecoder::decodeLoop() {
+    AVFrame *frame = av_frame_alloc();
+    bool input_done = false;
+    while (!abort_) {
+        Clock::time_point decode_start = Clock::now();
+        int ret = avcodec_receive_frame(codec_ctx_, frame);
+        if (ret == AVERROR(EAGAIN) && !input_done) {
+            PacketQueue::Item item;
+            if (!packets_->pop(item, kPacketWaitMs)) continue;
+            if (item.serial < min_serial_) { // 本次start之前的包，作废
+                packets_->recycle(&item.pkt);
+                continue;
+            }
+            decode_start = Clock::now();
+            if (item.serial != packet_serial_) { // 新的跳转序号：清空解码器内部缓存
+                avcodec_flush_buffers(codec_ctx_);
+                packet_serial_ = item.serial;
+                // 视频发起的跳转 (共用解复用器) 落在目标之前的关键帧上，从已输出的位置继续，不重复播放
+                if (skip_until_s_ < 0) skip_until_s_ = next_media_s_;
+            }
+            if (!item.pkt) { // 文件结束，冲刷解码器中剩余的帧
+                avcodec_send_packet(codec_ctx_, nullptr);
+                input_done = true;
+            } else {
+                if (avcodec_send_packet(codec_ctx_, item.pkt) < 0) LOGW("发送音频包失败，已跳过");
+                packets_->recycle(&item.pkt);
+            }
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.decode_ms += elapsed_ms(decode_start);
+            continue;
+        }
+        if (ret < 0) {
+            if (ret != AVERROR_EOF) LOGE("音频解码失败: %d", ret);
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.decode_ms += elapsed_ms(decode_start);
+            stats_.frames_decoded++;
+        }
+        ret = outputFrame(frame);
+        av_frame_unref(frame);
+        if (ret < 0) break;
+    }
+    if (!abort_ && stretch_started_) { // 取出变速器中剩余的数据
+        stretcher_.flush();
+        drainStretcher();
+    }
+    if (!abort_) {
+        eof_ = true;
+        LOGI("音频解码结束");
+    }
+    av_frame_free(&frame);
+}
+
+// 重采样为输出采样率和声道数的交错float，供变速器处理
+bool AudioDecoder::ensureResampler(const AVFrame *frame) {
+    uint64_t in_layout = frame->channel_layout ? frame->channel_layout
+                                               : (uint64_t) av_get_default_channel_layout(frame->channels);
+    if (swr_ && frame->sample_rate == swr_in_rate_ && frame->format == swr_in_fmt_ && in_layout == swr_in_layout_) {
+        return true;
+    }
+    swr_free(&swr_);
+    swr_ = swr_alloc_set_opts(nullptr, av_get_default_channel_layout(output_.channels), AV_SAMPLE_FMT_FLT,
+                              output_.sample_rate, (int64_t) in_layout, (AVSampleFormat) frame->format,
+                              frame->sample_rate, 0, nullptr);
+    if (!swr_ || swr_init(swr_) < 0) {
+        LOGE("无法创建重采样器: %d Hz -> %d Hz", frame->sample_rate, output_.sample_rate);
+        swr_free(&swr_);
+        return false;
+    }
+    swr_in_rate_ = frame->sample_rate;
+    swr_in_fmt_ = frame->format;
+    swr_in_layout_ = in_layout;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.resampler_inits++;
+    }
+    LOGI("重采样器: %d Hz %s %d声道 -> %d Hz %s %d声道", frame->sample_rate,
+         av_get_sample_fmt_name((AVSampleFormat) frame->format), frame->channels, output_.sample_rate,
+         av_get_sample_fmt_name(output_.sample_fmt), output_.channels);
+    return true;
+}
+
+// 把一个解码帧重采样、变速后写入环形缓冲区 (解码线程)。被终止或出错时返回<0
+int AudioDecoder::outputFrame(AVFrame *frame) {
+    Clock::time_point resample_start = Clock::now();
+    if (!ensureResampler(frame)) return -1;
+    int max_out = swr_get_out_samples(swr_, frame->nb_samples);
+    if (max_out > convert_capacity_) {
+        av_freep(&convert_buffer_);
+        if (av_samples_alloc(&convert_buffer_, nullptr, output_.channels, max_out, AV_SAMPLE_FMT_FLT, 0) < 0) {
+            LOGE("无法分配重采样缓冲区 (%d 采样)", max_out);
+            convert_capacity_ = 0;
+            return -1;
+        }
+        convert_capacity_ = max_out;
+    }
+    int out_frames = swr_convert(swr_, &convert_buffer_, convert_capacity_, (const uint8_t **) frame->extended_data,
+                                 frame->nb_samples);
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.resample_ms += elapsed_ms(resample_start);
+    }
+    if (out_frames <= 0) return out_frames;
+
+    const int rate = output_.sample_rate;
+    int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    double media_s = pts != AV_NOPTS_VALUE ? (pts - start_pts_) * av_q2d(time_base_) : next_media_s_;
+    next_media_s_ = media_s + (double) out_frames / rate;
+    const float *data = (const float *) convert_buffer_;
+    if (skip_until_s_ >= 0) {
+        int skip = (int) lround((skip_until_s_ - media_s) * rate);
+        if (skip >= out_frames) return 0;
+        if (skip > 0) {
+            data += (size_t) skip * output_.channels;
+            out_frames -= skip;
+            media_s += (double) skip / rate;
+        }
+        skip_until_s_ = -1.0;
+    }
+    if (!stretch_started_) {
+        stretch_base_s_ = media_s;
+        stretch_started_ = true;
+    }
+
+    Clock::time_point stretch_start = Clock::now();
+    stretcher_.setSpeed(speed_.load());
+    stretcher_.putInput(data, out_frames);
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.stretch_ms += elapsed_ms(stretch_start);
+    }
+    return drainStretcher();
+}
+
+// 取出变速器的全部输出，转换为输出采样格式后写入环形缓冲区。被终止时返回<0
+int AudioDecoder::drainStretcher() {
+    int frames = stretcher_.pendingOutput();
+    if (frames == 0) return 0;
+    // 标记先于采样写入，消费者读到这些采样时一定能看到对应的标记
+    Marker marker = {frames_written_, stretch_base_s_ + stretcher_.inputPosition() / output_.sample_rate,
+                     stretcher_.speed()};
+    stretch_buffer_.resize((size_t) frames * output_.channels);
+    stretcher_.receiveOutput(stretch_buffer_.data(), frames);
+    const uint8_t *data = (const uint8_t *) stretch_buffer_.data();
+    if (output_.sample_fmt == AV_SAMPLE_FMT_S16) {
+        s16_buffer_.resize(stretch_buffer_.size());
+        for (size_t i = 0; i < stretch_buffer_.size(); i++) {
+            float v = std::max(-1.0f, std::min(1.0f, stretch_buffer_[i]));
+            s16_buffer_[i] = (int16_t) lrintf(v * 32767.0f);
+        }
+        data = (const uint8_t *) s16_buffer_.data();
+    }
+
+    while (!markers_.push(marker)) {
+        if (abort_) return -1;
+        usleep(kProducerWaitUs);
+    }
+    if (!writeAll(data, frames)) return -1;
+    frames_written_ += frames;
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.samples_output += frames;
+    return 0;
+}
+
+// 按整帧写入环形缓冲区，空间不足时等待消费者取走数据。被终止时返回false
+bool AudioDecoder::writeAll(const uint8_t *data, int frames) {
+    while (frames > 0) {
+        if (abort_) return false;
+        int space = (int) (samples_.writeAvailable() / bytes_per_frame_);
+        if (space == 0) {
+            usleep(kProducerWaitUs);
+            continue;
+        }
+        int n = std::min(space, frames);
+        samples_.write(data, (size_t) n * bytes_per_frame_);
+        data += (size_t) n * bytes_per_frame_;
+        frames -= n;
+    }
+    return true;
+}
+
+int AudioDecoder::read(void *out, int frames) {
+    uint8_t *dst = (uint8_t *) out;
+    int available = (int) (samples_.readAvailable() / bytes_per_frame_);
+    int n = std::min(available, frames);
+    samples_.read(dst, (size_t) n * bytes_per_frame_);
+    if (n < frames) { // 静音 (float和s16的零值都是全0字节)
+        memset(dst + (size_t) n * bytes_per_frame_, 0, (size_t) (frames - n) * bytes_per_frame_);
+        if (has_marker_ && !eof_) { // 开始播放前和文件结束后的静音不算欠载
+            underruns_++;
+            silence_frames_ += frames - n;
+        }
+    }
+    frames_read_ += n;
+
+    Marker next;
+    while (markers_.peek(next) && next.frame <= frames_read_) {
+        markers_.pop(current_marker_);
+        has_marker_ = true;
+    }
+    if (has_marker_) {
+        position_s_ = current_marker_.media_s +
+                      (frames_read_ - current_marker_.frame) * current_marker_.speed / output_.sample_rate;
+    }
+    return n;
+}
+
+bool AudioDecoder::position(double *media_time_s) const {
+    double position = position_s_.load();
+    if (position < 0) return false;
+    *media_time_s = position;
+    return true;
+}
+
+bool AudioDecoder::finished() const {
+    return eof_ && samples_.readAvailable() == 0;
+}
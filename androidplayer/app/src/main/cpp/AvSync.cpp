@@ -0,0 +1,99 @@
+#include "AvSync.h"
+#include <math.h>
+#include <algorithm>
+
+static const double kDefaultThresholdMs = 40.0;   // 默认允许的A/V偏差
+static const double kMaxExtrapolateMs = 100.0;    // 音频位置停止变化后最多外推的时长
+static const int64_t kHistoryIntervalMs = 250;    // 偏差采样间隔
+static const size_t kHistoryCapacity = 240;       // 保留最近一分钟的采样
+
+AvSync::AvSync() : threshold_ms_(kDefaultThresholdMs) {
+    history_.reserve(kHistoryCapacity);
+}
+
+void AvSync::setAudioClock(AudioClock clock) {
+    std::lock_guard<std::mutex> lock(clock_mutex_);
+    audio_clock_ = std::move(clock);
+}
+
+void AvSync::setThresholdMs(double threshold_ms) {
+    threshold_ms_ = std::max(1.0, threshold_ms);
+}
+
+bool AvSync::audioTime(double *media_time_s) {
+    double raw_s;
+    {
+        std::lock_guard<std::mutex> lock(clock_mutex_);
+        if (!audio_clock_ || !audio_clock_(&raw_s)) {
+            last_raw_s_ = -1.0;
+            return false;
+        }
+    }
+    int64_t now = PresentationClock::nowNs();
+    if (raw_s != last_raw_s_) {
+        last_raw_s_ = raw_s;
+        last_raw_ns_ = now;
+    }
+    double extrapolated_ms = std::min((now - last_raw_ns_) / 1e6 * speed_, kMaxExtrapolateMs);
+    *media_time_s = raw_s + extrapolated_ms / 1000.0;
+    return true;
+}
+
+bool AvSync::syncVideo(PresentationClock &clock) {
+    if (!clock.running() || clock.paused()) return false;
+    speed_ = clock.speed();
+    double audio_s;
+    if (!audioTime(&audio_s)) return false;
+    double diff_ms = (clock.mediaTime() - audio_s) * 1000.0;
+    if (fabs(diff_ms) > threshold_ms_.load()) {
+        clock.retime(audio_s);
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        if (diff_ms > 0) stats_.corrections_ahead++;
+        else stats_.corrections_behind++;
+    }
+    return true;
+}
+
+void AvSync::framePresented(double frame_time_s) {
+    double audio_s;
+    if (!audioTime(&audio_s)) return;
+    double offset_ms = (frame_time_s - audio_s) * 1000.0;
+    int64_t now = PresentationClock::nowNs();
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats &s = stats_;
+    s.samples++;
+    s.offset_last_ms = offset_ms;
+    s.offset_mean_ms += (offset_ms - s.offset_mean_ms) / s.samples;
+    if (fabs(offset_ms) > fabs(s.offset_max_ms)) s.offset_max_ms = offset_ms;
+    if (now - last_history_ns_ >= kHistoryIntervalMs * 1000000LL) {
+        last_history_ns_ = now;
+        OffsetSample sample = {frame_time_s, offset_ms};
+        if (history_.size() < kHistoryCapacity) history_.push_back(sample);
+        else history_[history_next_] = sample;
+        history_next_ = (history_next_ + 1) % kHistoryCapacity;
+    }
+}
+
+void AvSync::reset() {
+    last_raw_s_ = -1.0;
+    last_history_ns_ = 0;
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_ = Stats();
+    history_.clear();
+    history_next_ = 0;
+}
+
+AvSync::Stats AvSync::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats s = stats_;
+    s.threshold_ms = threshold_ms_.load();
+    return s;
+}
+
+std::vector<AvSync::OffsetSample> AvSync::history() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    if (history_.size() < kHistoryCapacity) return history_;
+    std::vector<OffsetSample> ordered(history_.begin() + history_next_, history_.end());
+    ordered.insert(ordered.end(), history_.begin(), history_.begin() + history_next_);
+    return ordered;
+}
@@ -0,0 +1,1674 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+#include <thread>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#include "android/log.h"
+#include "AudioDecoder.h"
+#include "AvSync.h"
+#include "BoundedQueue.h"
+#include "DecoderConfig.h"
+#include "FrameCacheManager.h"
+#include "FrameNormalizer.h"
+#include "FramePool.h"
+#include "FrameRing.h"
+#include "KeyframeIndex.h"
+#include "PlayerControl.h"
+#include "PresentationClock.h"
+#include "StreamDecoder.h"
+#include "TimeStretcher.h"
+#include "WorkerPool.h"
+#include "YuvConverter.h"
+#include "YuvScaler.h"
+
+extern "C" {
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+#define LOG_TAG "PlayerBenchmark"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+// 稳态分配检查：只在基准测试专用的构建 (CMake选项PLAYER_BENCHMARK_ALLOC_HOOK) 中替换全局operator new/delete，
+// 在检查窗口内 (g_count_heap_allocs) 统计调用次数。普通构建的库不替换，operator new不计入检查。
+// FFmpeg内部的av_malloc不经过这里，由帧缓冲池和包空闲链表各自的分配计数覆盖
+static std::atomic<bool> g_count_heap_allocs(false);
+static std::atomic<long> g_heap_allocs(0);
+
+#ifdef PLAYER_BENCHMARK_ALLOC_HOOK
+static const bool kCountsHeapAllocs = true;
+
+// 单个对象、数组、nothrow和按对齐分配的版本都经过这里。失败时返回nullptr
+static void *counted_alloc(size_t size, size_t align) {
+    if (g_count_heap_allocs.load(std::memory_order_relaxed)) g_heap_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    while (true) {
+        void *p = nullptr;
+        if (align <= alignof(std::max_align_t)) p = malloc(size);
+        else if (posix_memalign(&p, std::max(align, sizeof(void *)), size) != 0) p = nullptr;
+        if (p) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) return nullptr;
+        handler();
+    }
+}
+
+static void *counted_new(size_t size, size_t align) {
+    void *p = counted_alloc(size, align);
+    if (!p) {
+#ifdef __cpp_exceptions
+        throw std::bad_alloc();
+#else
+        abort(); // 库可能以-fno-exceptions构建
+#endif
+    }
+    return p;
+}
+
+static void *counted_new_nothrow(size_t size, size_t align) noexcept {
+#ifdef __cpp_exceptions
+    try {
+        return counted_alloc(size, align);
+    } catch (...) { // new_handler可能抛出bad_alloc
+        return nullptr;
+    }
+#else
+    return counted_alloc(size, align);
+#endif
+}
+
+void *operator new(size_t size) { return counted_new(size, 0); }
+void *operator new[](size_t size) { return counted_new(size, 0); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return counted_new_nothrow(size, 0); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return counted_new_nothrow(size, 0); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { free(p); }
+
+#ifdef __cpp_aligned_new
+void *operator new(size_t size, std::align_val_t align) { return counted_new(size, (size_t) align); }
+void *operator new[](size_t size, std::align_val_t align) { return counted_new(size, (size_t) align); }
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return counted_new_nothrow(size, (size_t) align);
+}
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return counted_new_nothrow(size, (size_t) align);
+}
+void operator delete(void *p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept { free(p); }
+#endif
+#else
+static const bool kCountsHeapAllocs = false;
+#endif
+
+#ifndef PLAYER_ABI
+#define PLAYER_ABI "unknown"
+#endif
+
+static const double kMinBenchSeconds = 0.3; // 每项测试至少运行的时长
+static const int kMinBenchIterations = 3;   // 每项测试至少运行的次数
+static const int kAudioBenchMaxSeconds = 60; // 音频管线测试最多解码的媒体时长
+static const double kMaxPacingDriftMs = 2.0;  // 绝对截止时刻方式允许的平均误差 (绝对值)
+static const double kMaxPacingJitterMs = 3.0; // 绝对截止时刻方式允许的抖动
+
+// 向报告追加一行，并同时输出到logcat
+static void report_line(std::string &report, const char *fmt, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    LOGI("%s", line);
+    report += line;
+    report += '\n';
+}
+
+// 重复执行fn直到达到最短时长和最少次数，返回单次平均耗时 (纳秒)
+template <typename Fn>
+static double time_per_iteration_ns(Fn &&fn) {
+    using clock = std::chrono::steady_clock;
+    int iterations = 0;
+    auto start = clock::now();
+    double elapsed = 0;
+    do {
+        fn();
+        iterations++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < kMinBenchSeconds || iterations < kMinBenchIterations);
+    return elapsed * 1e9 / iterations;
+}
+
+std::string benchmark_yuv_convert(int *failures) {
+    struct Resolution { const char *name; int width; int height; };
+    static const Resolution resolutions[] = {
+            {"360p", 640, 360}, {"720p", 1280, 720}, {"1080p", 1920, 1080}, {"2160p", 3840, 2160},
+    };
+    static const YuvKernel kernels[] = {YuvKernel::Scalar, YuvKernel::Neon, YuvKernel::Sse41, YuvKernel::Avx2};
+
+    std::string report;
+    report_line(report, "== YUV420p->RGBA 转换 (ABI: %s, 自动选择: %s) ==", PLAYER_ABI,
+                YuvConverter::kernelName(YuvConverter::detectBestKernel()));
+    std::mt19937 rng(12345);
+    for (const Resolution &res : resolutions) {
+        int w = res.width, h = res.height, cw = w / 2, ch = h / 2;
+        std::vector<uint8_t> y(w * h), u(cw * ch), v(cw * ch);
+        for (auto &b : y) b = static_cast<uint8_t>(rng());
+        for (auto &b : u) b = static_cast<uint8_t>(rng());
+        for (auto &b : v) b = static_cast<uint8_t>(rng());
+        std::vector<uint8_t> reference(w * h * 4), rgba(w * h * 4);
+        YuvConverter(YuvKernel::Scalar).convert(y.data(), w, u.data(), cw, v.data(), cw, reference.data(), w * 4, w, h);
+
+        for (YuvKernel kernel : kernels) {
+            if (!YuvConverter::isKernelSupported(kernel)) continue;
+            YuvConverter converter(kernel);
+            double ns = time_per_iteration_ns([&] {
+                converter.convert(y.data(), w, u.data(), cw, v.data(), cw, rgba.data(), w * 4, w, h);
+            });
+            bool exact = memcmp(reference.data(), rgba.data(), rgba.size()) == 0;
+            report_line(report, "%-6s %-7s %8.3f ms/帧  %6.3f 像素/ns  %s", res.name,
+                        YuvConverter::kernelName(kernel), ns / 1e6, (double) w * h / ns,
+                        exact ? "逐位一致" : "与标量结果不一致!");
+            if (!exact && failures) ++*failures;
+        }
+    }
+    return report;
+}
+
+std::string benchmark_yuv_convert_parallel(int *failures) {
+    struct Resolution { const char *name; int width; int height; };
+    static const Resolution resolutions[] = {{"1080p", 1920, 1080}, {"2160p", 3840, 2160}};
+    WorkerPool &pool = WorkerPool::shared();
+    YuvConverter converter;
+
+    std::string report;
+    report_line(report, "== YUV420p->RGBA 条带并行转换 (内核: %s, 工作线程: %d, 在线核心: %d) ==",
+                YuvConverter::kernelName(converter.kernel()), pool.threadCount(), decoder_online_cores());
+    std::mt19937 rng(12345);
+    for (const Resolution &res : resolutions) {
+        int w = res.width, h = res.height, cw = w / 2, ch = h / 2;
+        std::vector<uint8_t> y(w * h), u(cw * ch), v(cw * ch);
+        for (auto &b : y) b = static_cast<uint8_t>(rng());
+        for (auto &b : u) b = static_cast<uint8_t>(rng());
+        for (auto &b : v) b = static_cast<uint8_t>(rng());
+        std::vector<uint8_t> reference(w * h * 4), rgba(w * h * 4);
+        converter.convert(y.data(), w, u.data(), cw, v.data(), cw, reference.data(), w * 4, w, h);
+
+        double single_ns = 0.0;
+        for (int stripes : {1, 2, 4, 8}) {
+            std::fill(rgba.begin(), rgba.end(), 0);
+            double ns = time_per_iteration_ns([&] {
+                converter.convert(y.data(), w, u.data(), cw, v.data(), cw, rgba.data(), w * 4, w, h, pool, stripes);
+            });
+            if (stripes == 1) single_ns = ns;
+            bool exact = memcmp(reference.data(), rgba.data(), rgba.size()) == 0;
+            report_line(report, "%-6s %d 路 %8.3f ms/帧  加速 %.2fx  %s", res.name, stripes, ns / 1e6,
+                        single_ns / ns, exact ? "逐位一致" : "与单线程结果不一致!");
+            if (!exact && failures) ++*failures;
+        }
+        report_line(report, "%-6s 渲染循环自动选择 %d 路", res.name,
+                    YuvConverter::autoStripeCount(w, h, pool.threadCount()));
+    }
+    return report;
+}
+
+std::string benchmark_scaled_convert(int *failures) {
+    struct Size { const char *name; int width; int height; };
+    static const Size sources[] = {{"1080p", 1920, 1080}, {"2160p", 3840, 2160}};
+    static const Size windows[] = {{"1080p", 1920, 1080}, {"720p", 1280, 720}, {"360p", 640, 360}};
+    YuvConverter converter;
+    YuvScaler scaler(converter.kernel());
+
+    std::string report;
+    report_line(report, "== 缩放+转换合为一遍: 转换到视频尺寸 vs 转换到窗口尺寸 (内核: %s) ==",
+                YuvConverter::kernelName(converter.kernel()));
+    std::mt19937 rng(12345);
+    for (const Size &src : sources) {
+        int w = src.width, h = src.height, cw = w / 2, ch = h / 2;
+        std::vector<uint8_t> y(w * h), u(cw * ch), v(cw * ch);
+        for (auto &b : y) b = static_cast<uint8_t>(rng());
+        for (auto &b : u) b = static_cast<uint8_t>(rng());
+        for (auto &b : v) b = static_cast<uint8_t>(rng());
+        std::vector<uint8_t> full(w * h * 4), rgba(w * h * 4);
+        double full_ns = time_per_iteration_ns([&] {
+            converter.convert(y.data(), w, u.data(), cw, v.data(), cw, full.data(), w * 4, w, h);
+        });
+        report_line(report, "%-6s -> 视频尺寸 %-6s %8.3f ms/帧  写入 %6.1f MiB/帧", src.name, src.name, full_ns / 1e6,
+                    w * h * 4 / 1048576.0);
+        // 同尺寸时滤波为恒等，结果应与直接转换逐位一致
+        scaler.configure(w, h, w, h);
+        scaler.convert(y.data(), w, u.data(), cw, v.data(), cw, rgba.data(), w * 4);
+        bool identity = memcmp(full.data(), rgba.data(), full.size()) == 0;
+        report_line(report, "%-6s 同尺寸缩放: %s", src.name, identity ? "与直接转换逐位一致" : "与直接转换不一致!");
+        if (!identity && failures) ++*failures;
+
+        for (const Size &win : windows) {
+            if (win.width >= w) continue;
+            LetterboxLayout layout = letterbox_layout(w, h, win.width, win.height);
+            scaler.configure(w, h, layout.width, layout.height);
+            double ns = time_per_iteration_ns([&] {
+                scaler.convert(y.data(), w, u.data(), cw, v.data(), cw, rgba.data(), layout.width * 4);
+            });
+            report_line(report, "%-6s -> 窗口 %-6s %dx%d %8.3f ms/帧  写入 %6.1f MiB/帧  加速 %.2fx", src.name,
+                        win.name, layout.width, layout.height, ns / 1e6,
+                        layout.width * layout.height * 4 / 1048576.0, full_ns / ns);
+        }
+    }
+
+    // 平坦画面缩放后颜色不变 (滤波权重和恰为1)
+    int w = 1920, h = 1080, cw = w / 2, ch = h / 2;
+    std::vector<uint8_t> y(w * h, 140), u(cw * ch, 90), v(cw * ch, 170);
+    std::vector<uint8_t> pixel(4), rgba(1280 * 720 * 4);
+    converter.convert(y.data(), 0, u.data(), 0, v.data(), 0, pixel.data(), 4, 1, 1);
+    scaler.configure(w, h, 1280, 720);
+    scaler.convert(y.data(), w, u.data(), cw, v.data(), cw, rgba.data(), 1280 * 4);
+    bool flat = true;
+    for (size_t i = 0; i < rgba.size(); i++) flat = flat && rgba[i] == pixel[i % 4];
+    report_line(report, "平坦画面 1080p -> 720p: %s", flat ? "颜色不变" : "颜色改变!");
+    if (!flat && failures) ++*failures;
+    return report;
+}
+
+static inline uint8_t clamp_pixel(int v) {
+    return static_cast<uint8_t>(std::max(0, std::min(255, v)));
+}
+
+// 对照实现：系数在运行时读取，色度位置在像素循环内判断 (不特化时的通用写法)，结果应与特化的标量内核逐位一致
+static void convert_frame_runtime(const YuvColorFormat &format, const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                  int width, int height, uint8_t *dst) {
+    const YuvCoefficients k = YuvConverter::coefficients(format.matrix, format.range);
+    int cw = (width + 1) / 2;
+    for (int row = 0; row < height; row++) {
+        const uint8_t *yr = y + (long) row * width;
+        const uint8_t *ur = u + (long) (row / 2) * cw, *vr = v + (long) (row / 2) * cw;
+        uint8_t *d = dst + (long) row * width * 4;
+        for (int x = 0; x < width; x++) {
+            int i = x / 2, cu = ur[i], cv = vr[i];
+            if (format.siting == ChromaSiting::Left && (x & 1) && x + 1 < width) {
+                cu = (ur[i] + ur[i + 1] + 1) >> 1;
+                cv = (vr[i] + vr[i + 1] + 1) >> 1;
+            }
+            int base = k.y * (yr[x] - k.y_offset) + 128;
+            d[x * 4 + 0] = clamp_pixel((base + k.rv * (cv - 128)) >> 8);
+            d[x * 4 + 1] = clamp_pixel((base - k.gu * (cu - 128) - k.gv * (cv - 128)) >> 8);
+            d[x * 4 + 2] = clamp_pixel((base + k.bu * (cu - 128)) >> 8);
+            d[x * 4 + 3] = 255;
+        }
+    }
+}
+
+std::string benchmark_yuv_color_formats(int *failures) {
+    static const YuvMatrix matrices[] = {YuvMatrix::Bt601, YuvMatrix::Bt709, YuvMatrix::Bt2020};
+    static const YuvRange ranges[] = {YuvRange::Limited, YuvRange::Full};
+    static const ChromaSiting sitings[] = {ChromaSiting::Center, ChromaSiting::Left};
+    const int w = 1920, h = 1080, cw = w / 2, ch = h / 2;
+    YuvKernel best = YuvConverter::detectBestKernel();
+
+    std::string report;
+    report_line(report, "== 颜色格式特化内核 (1080p, 内核: %s, 基准: 旧版固定的bt601/limited/center) ==",
+                YuvConverter::kernelName(best));
+    std::mt19937 rng(12345);
+    std::vector<uint8_t> y(w * h), u(cw * ch), v(cw * ch);
+    for (auto &b : y) b = static_cast<uint8_t>(rng());
+    for (auto &b : u) b = static_cast<uint8_t>(rng());
+    for (auto &b : v) b = static_cast<uint8_t>(rng());
+    std::vector<uint8_t> reference(w * h * 4), rgba(w * h * 4), runtime(w * h * 4);
+
+    double baseline_ns = 0.0;
+    for (YuvMatrix matrix : matrices) {
+        for (YuvRange range : ranges) {
+            for (ChromaSiting siting : sitings) {
+                YuvColorFormat format;
+                format.matrix = matrix;
+                format.range = range;
+                format.siting = siting;
+                YuvConverter scalar(format, YuvKernel::Scalar), converter(format, best);
+                double scalar_ns = time_per_iteration_ns([&] {
+                    scalar.convert(y.data(), w, u.data(), cw, v.data(), cw, reference.data(), w * 4, w, h);
+                });
+                double ns = time_per_iteration_ns([&] {
+                    converter.convert(y.data(), w, u.data(), cw, v.data(), cw, rgba.data(), w * 4, w, h);
+                });
+                double runtime_ns = time_per_iteration_ns([&] {
+                    convert_frame_runtime(format, y.data(), u.data(), v.data(), w, h, runtime.data());
+                });
+                if (baseline_ns == 0.0) baseline_ns = ns;
+                bool exact = memcmp(reference.data(), rgba.data(), rgba.size()) == 0 &&
+                             memcmp(reference.data(), runtime.data(), runtime.size()) == 0;
+                report_line(report, "%-26s %7.3f ms/帧 (%+5.1f%%)  标量特化 %7.3f ms  运行时分支 %7.3f ms  %s",
+                            format.name().c_str(), ns / 1e6, (ns / baseline_ns - 1.0) * 100.0, scalar_ns / 1e6,
+                            runtime_ns / 1e6, exact ? "逐位一致" : "结果不一致!");
+                if (!exact && failures) ++*failures;
+            }
+        }
+    }
+    return report;
+}
+
+// RGB565 输出：与 RGBA8888 比较转换耗时、转换加提交 (模拟合成器读取整帧窗口缓冲区) 耗时和每帧写入的字节数
+std::string benchmark_rgb565_output() {
+    static const int sizes[][2] = {{1920, 1080}, {1280, 720}};
+    static const YuvOutput outputs[] = {YuvOutput::Rgba8888, YuvOutput::Rgb565};
+    YuvKernel best = YuvConverter::detectBestKernel();
+
+    std::string report;
+    report_line(report, "== RGB565 窗口输出 (内核: %s, 提交按整帧缓冲区拷贝一次计) ==", YuvConverter::kernelName(best));
+    std::mt19937 rng(2024);
+    for (const auto &size : sizes) {
+        const int w = size[0], h = size[1], cw = w / 2, ch = h / 2;
+        std::vector<uint8_t> y(w * h), u(cw * ch), v(cw * ch);
+        for (auto &b : y) b = static_cast<uint8_t>(rng());
+        for (auto &b : u) b = static_cast<uint8_t>(rng());
+        for (auto &b : v) b = static_cast<uint8_t>(rng());
+
+        double rgba_total_ns = 0.0;
+        for (YuvOutput output : outputs) {
+            YuvColorFormat format;
+            format.output = output;
+            const int bpp = format.bytesPerPixel();
+            std::vector<uint8_t> window(w * h * bpp), composed(w * h * bpp);
+            YuvConverter converter(format, best);
+            double convert_ns = time_per_iteration_ns([&] {
+                converter.convert(y.data(), w, u.data(), cw, v.data(), cw, window.data(), w * bpp, w, h);
+            });
+            double total_ns = time_per_iteration_ns([&] {
+                converter.convert(y.data(), w, u.data(), cw, v.data(), cw, window.data(), w * bpp, w, h);
+                memcpy(composed.data(), window.data(), window.size());
+            });
+            if (output == YuvOutput::Rgba8888) rgba_total_ns = total_ns;
+            report_line(report, "%dx%d %-8s 转换 %7.3f ms  转换+提交 %7.3f ms (%+5.1f%%)  每帧 %5.2f MB",
+                        w, h, output == YuvOutput::Rgb565 ? "rgb565" : "rgba8888", convert_ns / 1e6, total_ns / 1e6,
+                        (total_ns / rgba_total_ns - 1.0) * 100.0, window.size() / 1e6);
+        }
+    }
+    return report;
+}
+
+// 显示阶段：转换器直接写入窗口缓冲区、旧版先转换到中间缓冲再逐行拷贝、重绘缓存 (转换到环形缓冲再拷贝) 的每帧耗时，
+// 以及重绘缓存重新显示一帧 (只拷贝) 的耗时。窗口缓冲区按64像素对齐的行跨度模拟
+std::string benchmark_present_modes() {
+    const int w = 1920, h = 1080, cw = w / 2, ch = h / 2;
+    const int window_stride = ((w + 63) & ~63) * 4;
+    YuvConverter converter;
+    std::string report;
+    report_line(report, "== 显示阶段 (1080p RGBA8888, 内核: %s) ==", YuvConverter::kernelName(converter.kernel()));
+    std::mt19937 rng(99);
+    std::vector<uint8_t> y(w * h), u(cw * ch), v(cw * ch);
+    for (auto &b : y) b = static_cast<uint8_t>(rng());
+    for (auto &b : u) b = static_cast<uint8_t>(rng());
+    for (auto &b : v) b = static_cast<uint8_t>(rng());
+    std::vector<uint8_t> window((size_t) window_stride * h), staging((size_t) w * 4 * h);
+    auto copy_to_window = [&]() {
+        for (int row = 0; row < h; ++row) {
+            memcpy(window.data() + (size_t) row * window_stride, staging.data() + (size_t) row * w * 4, w * 4);
+        }
+    };
+
+    double direct_ns = time_per_iteration_ns([&] {
+        converter.convert(y.data(), w, u.data(), cw, v.data(), cw, window.data(), window_stride, w, h);
+    });
+    double copy_ns = time_per_iteration_ns([&] {
+        converter.convert(y.data(), w, u.data(), cw, v.data(), cw, staging.data(), w * 4, w, h);
+        copy_to_window();
+    });
+    double redisplay_ns = time_per_iteration_ns(copy_to_window);
+    report_line(report, "直接写入窗口缓冲区      %7.3f ms/帧", direct_ns / 1e6);
+    report_line(report, "转换后拷贝 (旧版/重绘缓存) %7.3f ms/帧 (%+5.1f%%)", copy_ns / 1e6, (copy_ns / direct_ns - 1.0) * 100.0);
+    report_line(report, "重绘缓存重新显示一帧    %7.3f ms (不解码、不转换)", redisplay_ns / 1e6);
+    return report;
+}
+
+// 解码测试用的压缩视频：编解码参数 + 内存中的全部视频包 (排除解复用和文件读取的影响)
+struct DecodeClip {
+    std::string name;
+    AVCodecParameters *par = nullptr;
+    std::vector<AVPacket *> packets;
+
+    ~DecodeClip() {
+        for (AVPacket *pkt : packets) av_packet_free(&pkt);
+        avcodec_parameters_free(&par);
+    }
+};
+
+// 读取媒体文件中最多max_packets个视频包
+static bool load_file_clip(const char *path, size_t max_packets, DecodeClip *clip) {
+    AVFormatContext *fmt_ctx = nullptr;
+    if (!path || avformat_open_input(&fmt_ctx, path, nullptr, nullptr) != 0) return false;
+    int stream_idx = -1;
+    if (avformat_find_stream_info(fmt_ctx, nullptr) >= 0) {
+        stream_idx = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    }
+    if (stream_idx >= 0) {
+        clip->par = avcodec_parameters_alloc();
+        avcodec_parameters_copy(clip->par, fmt_ctx->streams[stream_idx]->codecpar);
+        AVPacket *pkt = av_packet_alloc();
+        while (clip->packets.size() < max_packets && av_read_frame(fmt_ctx, pkt) >= 0) {
+            if (pkt->stream_index == stream_idx) {
+                clip->packets.push_back(av_packet_clone(pkt));
+            }
+            av_packet_unref(pkt);
+        }
+        av_packet_free(&pkt);
+    }
+    avformat_close_input(&fmt_ctx);
+    return !clip->packets.empty();
+}
+
+// 编码一段指定分辨率的合成视频 (运动的渐变和纹理)，用于测试比示例视频更大的分辨率
+static bool make_synthetic_clip(int width, int height, int frame_count, DecodeClip *clip) {
+    AVCodec *codec = avcodec_find_encoder_by_name("libx264");
+    if (!codec) codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+    if (!codec) codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    if (!codec) return false;
+    AVCodecContext *enc = avcodec_alloc_context3(codec);
+    if (!enc) return false;
+    enc->width = width;
+    enc->height = height;
+    enc->pix_fmt = AV_PIX_FMT_YUV420P;
+    enc->time_base = {1, 30};
+    enc->framerate = {30, 1};
+    enc->gop_size = 30;
+    enc->max_b_frames = 2;
+    enc->bit_rate = (int64_t) width * height * 3; // 约为1080p 6Mbps
+    if (strcmp(codec->name, "libx264") == 0) av_opt_set(enc->priv_data, "preset", "superfast", 0);
+    AVFrame *frame = av_frame_alloc();
+    AVPacket *pkt = av_packet_alloc();
+    bool ok = avcodec_open2(enc, codec, nullptr) == 0 && frame && pkt;
+    if (ok) {
+        frame->format = enc->pix_fmt;
+        frame->width = width;
+        frame->height = height;
+        ok = av_frame_get_buffer(frame, 32) == 0;
+    }
+    auto drain = [&]() {
+        while (avcodec_receive_packet(enc, pkt) == 0) {
+            clip->packets.push_back(av_packet_clone(pkt));
+            av_packet_unref(pkt);
+        }
+    };
+    for (int f = 0; ok && f < frame_count; f++) {
+        ok = av_frame_make_writable(frame) == 0;
+        for (int y = 0; ok && y < height; y++) {
+            uint8_t *row = frame->data[0] + y * frame->linesize[0];
+            for (int x = 0; x < width; x++) row[x] = (uint8_t) ((x + 2 * y + 4 * f) ^ ((x * y) >> 9));
+        }
+        for (int p = 1; ok && p < 3; p++) {
+            for (int y = 0; y < height / 2; y++) {
+                uint8_t *row = frame->data[p] + y * frame->linesize[p];
+                for (int x = 0; x < width / 2; x++) row[x] = (uint8_t) (128 + ((p == 1 ? x : y) + f) % 64 - 32);
+            }
+        }
+        frame->pts = f;
+        if (ok && avcodec_send_frame(enc, frame) == 0) drain();
+    }
+    if (ok && avcodec_send_frame(enc, nullptr) == 0) drain();
+    if (ok) {
+        clip->par = avcodec_parameters_alloc();
+        avcodec_parameters_from_context(clip->par, enc);
+    }
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    avcodec_free_context(&enc);
+    return ok && !clip->packets.empty();
+}
+
+// 按指定线程配置解码整段视频，返回帧/秒 (失败返回0)。pool非空时解码器从帧缓冲池分配缓冲区
+static double decode_clip_fps(const DecodeClip &clip, const DecoderThreadConfig &config, int *threads_used,
+                              FramePool *pool = nullptr) {
+    AVCodec *codec = avcodec_find_decoder(clip.par->codec_id);
+    AVCodecContext *ctx = codec ? avcodec_alloc_context3(codec) : nullptr;
+    if (!ctx) return 0.0;
+    avcodec_parameters_to_context(ctx, clip.par);
+    decoder_apply_thread_config(ctx, config);
+    if (pool) pool->attach(ctx);
+    if (avcodec_open2(ctx, codec, nullptr) < 0) {
+        avcodec_free_context(&ctx);
+        return 0.0;
+    }
+    *threads_used = ctx->thread_count;
+    AVFrame *frame = av_frame_alloc();
+    long frames = 0;
+    auto receive_all = [&]() {
+        while (avcodec_receive_frame(ctx, frame) == 0) {
+            frames++;
+            av_frame_unref(frame);
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (AVPacket *pkt : clip.packets) {
+        while (avcodec_send_packet(ctx, pkt) == AVERROR(EAGAIN)) receive_all();
+        receive_all();
+    }
+    avcodec_send_packet(ctx, nullptr);
+    receive_all();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+    return seconds > 0 ? frames / seconds : 0.0;
+}
+
+std::string benchmark_decode_threads(const char *input_path) {
+    std::string report;
+    int cores = decoder_online_cores();
+    report_line(report, "== 解码吞吐量 vs 线程数 (在线核心: %d) ==", cores);
+
+    std::vector<std::unique_ptr<DecodeClip>> clips;
+    auto file_clip = std::make_unique<DecodeClip>();
+    file_clip->name = "input";
+    if (load_file_clip(input_path, 600, file_clip.get())) clips.push_back(std::move(file_clip));
+    else report_line(report, "无法读取 %s，跳过", input_path ? input_path : "(null)");
+    struct Synthetic { const char *name; int width; int height; int frames; };
+    static const Synthetic synthetics[] = {{"synthetic-1080p", 1920, 1080, 120}, {"synthetic-2160p", 3840, 2160, 60}};
+    for (const Synthetic &syn : synthetics) {
+        auto clip = std::make_unique<DecodeClip>();
+        clip->name = syn.name;
+        if (make_synthetic_clip(syn.width, syn.height, syn.frames, clip.get())) clips.push_back(std::move(clip));
+        else report_line(report, "没有可用的视频编码器，跳过 %s", syn.name);
+    }
+
+    std::vector<int> thread_counts;
+    for (int n : {1, 2, 3, 4, 6, 8, 12, 16}) {
+        if (n <= cores) thread_counts.push_back(n);
+    }
+    for (const auto &clip : clips) {
+        report_line(report, "%s: %dx%d %s, %zu 包, 自动线程数 %d", clip->name.c_str(), clip->par->width,
+                    clip->par->height, avcodec_get_name(clip->par->codec_id), clip->packets.size(),
+                    decoder_auto_thread_count(clip->par->width, clip->par->height));
+        double single_fps = 0.0;
+        for (int threads : thread_counts) {
+            for (int type : {FF_THREAD_FRAME, FF_THREAD_SLICE}) {
+                if (threads == 1 && type == FF_THREAD_SLICE) continue; // 单线程时两种模式相同
+                DecoderThreadConfig config;
+                config.thread_count = threads;
+                config.thread_type = type;
+                int used = 0;
+                double fps = decode_clip_fps(*clip, config, &used);
+                if (threads == 1) single_fps = fps;
+                report_line(report, "  %2d 线程 %-4s %8.1f 帧/s  加速 %.2fx", used,
+                            threads == 1 ? "-" : type == FF_THREAD_FRAME ? "帧级" : "片级", fps,
+                            single_fps > 0 ? fps / single_fps : 0.0);
+            }
+        }
+    }
+    return report;
+}
+
+// 流式播放一遍：预热后 (含一次跳转) 帧缓冲池、包结构体和operator new (仅在启用PLAYER_BENCHMARK_ALLOC_HOOK的构建中统计)
+// 都不应再有新的分配。有分配时返回非0 (跳过检查时返回0)
+static int check_frame_pool_playback(const char *input_path, std::string *report) {
+    StreamDecoder decoder;
+    if (decoder.open(input_path) < 0 || decoder.start() < 0) {
+        report_line(*report, "无法流式打开 %s，跳过播放检查", input_path);
+        return 0;
+    }
+    static const long kWarmupFrames = 60;
+    static const long kMaxFrames = 900;
+    FramePool::Stats warm;
+    long warm_packets = 0;
+    long frames = 0;
+    bool seeked = false;
+    auto start = std::chrono::steady_clock::now();
+    while (frames < kMaxFrames) {
+        AVFrame *frame = nullptr;
+        int ret = decoder.popFrame(&frame, 1000);
+        if (ret < 0) break;
+        if (ret == 0) continue;
+        frames++;
+        decoder.releaseFrame(&frame);
+        if (frames == kWarmupFrames) {
+            warm = decoder.framePoolStats();
+            warm_packets = decoder.packetAllocations();
+            g_heap_allocs = 0;
+            g_count_heap_allocs = true; // 之后解复用、解码、出队和归还帧的所有线程都计入
+        }
+        if (frames == 2 * kWarmupFrames && !seeked) { // 跳回开头，跳转不应引起分配
+            decoder.seekToFrame(0);
+            seeked = true;
+        }
+    }
+    g_count_heap_allocs = false;
+    long heap = g_heap_allocs.load();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    FramePool::Stats pool = decoder.framePoolStats();
+    long packets = decoder.packetAllocations() - warm_packets;
+    decoder.stop();
+    if (frames <= kWarmupFrames) {
+        report_line(*report, "播放只取得 %ld 帧，不足以检查稳态分配", frames);
+        return 0;
+    }
+    long steady = pool.allocations() - warm.allocations();
+    long steady_frames = frames - kWarmupFrames;
+    bool passed = steady == 0 && packets == 0 && heap == 0;
+    report_line(*report, "流式播放 %ld 帧 (%.1f 帧/s, 含一次跳转): 缓冲区 新分配 %ld (%.1f MiB) / 复用 %ld, "
+                "AVFrame 新分配 %ld / 复用 %ld, 默认分配 %ld", frames, seconds > 0 ? frames / seconds : 0.0,
+                pool.buffer_allocs, pool.allocated_bytes / 1048576.0, pool.buffer_reuses, pool.frame_allocs,
+                pool.frame_reuses, pool.fallback_buffers);
+    if (kCountsHeapAllocs) {
+        report_line(*report, "预热 %ld 帧后的 %ld 帧中: 帧缓冲 %ld 次, AVPacket %ld 次, operator new %ld 次 (每帧 %.3f): %s",
+                    kWarmupFrames, steady_frames, steady, packets, heap,
+                    (double) (steady + packets + heap) / steady_frames, passed ? "通过" : "失败!");
+    } else {
+        report_line(*report, "预热 %ld 帧后的 %ld 帧中: 帧缓冲 %ld 次, AVPacket %ld 次 (每帧 %.3f, operator new未统计，"
+                    "需以PLAYER_BENCHMARK_ALLOC_HOOK构建): %s", kWarmupFrames, steady_frames, steady, packets,
+                    (double) (steady + packets) / steady_frames, passed ? "通过" : "失败!");
+    }
+    return passed ? 0 : 1;
+}
+
+std::string benchmark_frame_pool(const char *input_path, int *failures) {
+    std::string report;
+    report_line(report, "== 帧缓冲池: 解码吞吐量和稳态分配 ==");
+    std::vector<std::unique_ptr<DecodeClip>> clips;
+    auto file_clip = std::make_unique<DecodeClip>();
+    file_clip->name = "input";
+    if (load_file_clip(input_path, 600, file_clip.get())) clips.push_back(std::move(file_clip));
+    auto synthetic = std::make_unique<DecodeClip>();
+    synthetic->name = "synthetic-1080p";
+    if (make_synthetic_clip(1920, 1080, 120, synthetic.get())) clips.push_back(std::move(synthetic));
+
+    for (const auto &clip : clips) {
+        int used = 0;
+        double default_fps = decode_clip_fps(*clip, decoder_default_thread_config(), &used);
+        FramePool pool;
+        double pool_fps = decode_clip_fps(*clip, decoder_default_thread_config(), &used, &pool);
+        FramePool::Stats stats = pool.stats();
+        report_line(report, "%-16s 默认分配 %8.1f 帧/s  帧缓冲池 %8.1f 帧/s (%+.1f%%)  缓冲区 新分配 %ld / 复用 %ld",
+                    clip->name.c_str(), default_fps, pool_fps,
+                    default_fps > 0 ? (pool_fps / default_fps - 1.0) * 100.0 : 0.0, stats.buffer_allocs,
+                    stats.buffer_reuses);
+    }
+
+    if (!input_path || access(input_path, R_OK) != 0) {
+        report_line(report, "无法读取 %s，跳过播放检查", input_path ? input_path : "(null)");
+        return report;
+    }
+    int failed = check_frame_pool_playback(input_path, &report);
+    if (failed && failures) *failures += failed;
+    return report;
+}
+
+static const long kMultiInstanceFrames = 240; // 多实例测试中每个实例解码的帧数
+
+struct MultiInstanceResult {
+    double aggregate_fps = 0.0; // 所有实例合计的帧率
+    double min_fps = 0.0;       // 最慢实例的帧率
+    int decoder_threads = 0;    // 所有实例的解码线程总数
+    size_t allocated_bytes = 0; // 各帧缓冲池新分配的缓冲区总字节数
+    int failed = 0;             // 未能打开的实例数
+};
+
+// 同时流式解码instances路同一文件，每路由各自的线程尽快取帧。shared_pool非空时所有实例共用它，
+// 否则各自使用自己的帧缓冲池。fixed_threads>0时每路固定使用该线程数，否则按实例数平分核心
+static MultiInstanceResult run_multi_instance(const char *input_path, int instances,
+                                              const std::shared_ptr<FramePool> &shared_pool, int fixed_threads) {
+    MultiInstanceResult result;
+    DecoderThreadConfig saved = decoder_default_thread_config();
+    DecoderThreadConfig config = saved;
+    config.thread_count = fixed_threads;
+    decoder_set_default_thread_config(config);
+    std::vector<std::unique_ptr<StreamDecoder>> decoders;
+    for (int i = 0; i < instances; i++) {
+        std::unique_ptr<StreamDecoder> decoder(new StreamDecoder(0, 0, shared_pool));
+        if (decoder->open(input_path) < 0) {
+            result.failed++;
+            continue;
+        }
+        decoders.push_back(std::move(decoder));
+    }
+    // 全部打开后再启动，各路的线程数都按同一个实例数计算
+    for (auto &decoder : decoders) {
+        result.decoder_threads += fixed_threads > 0 ? fixed_threads
+                                                    : decoder_auto_thread_count(decoder->width(), decoder->height());
+    }
+    decoder_set_default_thread_config(saved);
+
+    std::vector<double> fps(decoders.size(), 0.0);
+    std::vector<long> frames(decoders.size(), 0);
+    std::vector<std::thread> consumers;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < decoders.size(); i++) {
+        if (decoders[i]->start() < 0) {
+            result.failed++;
+            continue;
+        }
+        consumers.emplace_back([&, i]() {
+            auto begin = std::chrono::steady_clock::now();
+            while (frames[i] < kMultiInstanceFrames) {
+                AVFrame *frame = nullptr;
+                int ret = decoders[i]->popFrame(&frame, 1000);
+                if (ret < 0) break;
+                if (ret == 0) continue;
+                frames[i]++;
+                decoders[i]->releaseFrame(&frame);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            fps[i] = seconds > 0 ? frames[i] / seconds : 0.0;
+        });
+    }
+    for (std::thread &consumer : consumers) consumer.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long total_frames = 0;
+    for (size_t i = 0; i < decoders.size(); i++) {
+        total_frames += frames[i];
+        result.min_fps = i == 0 ? fps[i] : std::min(result.min_fps, fps[i]);
+        if (!shared_pool) result.allocated_bytes += decoders[i]->framePoolStats().allocated_bytes;
+        decoders[i]->stop();
+    }
+    if (shared_pool) result.allocated_bytes = shared_pool->stats().allocated_bytes;
+    result.aggregate_fps = seconds > 0 ? total_frames / seconds : 0.0;
+    return result;
+}
+
+std::string benchmark_multi_instance(const char *input_path) {
+    std::string report;
+    int cores = decoder_online_cores();
+    report_line(report, "== 多实例同时播放: 独立资源 vs 共用资源 (在线核心: %d) ==", cores);
+    DecodeClip clip;
+    if (!load_file_clip(input_path, 1, &clip)) {
+        report_line(report, "无法读取 %s，跳过", input_path ? input_path : "(null)");
+        return report;
+    }
+    // 独立模式下每个实例都按单独播放时的线程数解码 (与引入线程预算之前相同)
+    int single_threads = std::max(1, decoder_auto_thread_count(clip.par->width, clip.par->height));
+    double source_fps = 0.0;
+    {
+        StreamDecoder probe;
+        if (probe.open(input_path) == 0) source_fps = probe.frameRate();
+    }
+    report_line(report, "%dx%d %s, 源帧率 %.2f, 单实例自动线程数 %d, 每实例 %ld 帧", clip.par->width,
+                clip.par->height, avcodec_get_name(clip.par->codec_id), source_fps, single_threads,
+                kMultiInstanceFrames);
+    for (int instances : {1, 2, 4, 8}) {
+        MultiInstanceResult independent = run_multi_instance(input_path, instances, nullptr, single_threads);
+        MultiInstanceResult shared = run_multi_instance(input_path, instances, std::make_shared<FramePool>(), 0);
+        const MultiInstanceResult *results[] = {&independent, &shared};
+        for (int mode = 0; mode < 2; mode++) {
+            const MultiInstanceResult &r = *results[mode];
+            report_line(report, "%d 实例 %s: 合计 %7.1f 帧/s  最慢 %6.1f 帧/s (%.2fx 实时)  解码线程 %3d  缓冲区 %.1f MiB%s",
+                        instances, mode == 0 ? "独立" : "共用", r.aggregate_fps, r.min_fps,
+                        source_fps > 0 ? r.min_fps / source_fps : 0.0, r.decoder_threads,
+                        r.allocated_bytes / 1048576.0, r.failed ? " (有实例打开失败)" : "");
+        }
+    }
+    return report;
+}
+
+std::string benchmark_cache_build(const char *input_path) {
+    std::string report;
+    report_line(report, "== YUV缓存构建: 顺序解码 vs GOP分段并行解码 (在线核心: %d) ==", decoder_online_cores());
+    FrameCacheSourceKey source;
+    if (!input_path || frame_cache_compute_source_key(input_path, &source) < 0) {
+        report_line(report, "无法读取 %s，跳过", input_path ? input_path : "(null)");
+        return report;
+    }
+    // 测试用的缓存文件放在输入文件所在目录 (应用缓存目录)
+    std::string dir = input_path;
+    size_t slash = dir.find_last_of('/');
+    dir = slash == std::string::npos ? "." : dir.substr(0, slash);
+    std::string cache_path = dir + "/benchmark-cache.apfc";
+
+    FrameCacheStats stats;
+    if (frame_cache_decode(input_path, cache_path.c_str(), source, false, &stats) < 0) {
+        report_line(report, "顺序解码失败，跳过");
+        return report;
+    }
+    double sequential_ms = stats.decode_ms;
+    report_line(report, "顺序     %8.1f ms  %7.1f 帧/s  (%ld 帧 %dx%d)", sequential_ms,
+                stats.frame_count * 1000.0 / sequential_ms, stats.frame_count, stats.width, stats.height);
+    std::vector<int> worker_counts;
+    for (int n = 2; n < decoder_online_cores(); n *= 2) worker_counts.push_back(n);
+    if (decoder_online_cores() > 1) worker_counts.push_back(decoder_online_cores());
+    for (int workers : worker_counts) {
+        FrameCacheStats parallel;
+        int ret = frame_cache_decode_parallel(input_path, cache_path.c_str(), source, workers, &parallel);
+        if (ret == kParallelDecodeUnsupported) {
+            report_line(report, "视频无法分段 (过短或时间戳不可用)，跳过并行测试");
+            break;
+        }
+        if (ret < 0) {
+            report_line(report, "并行 %d  失败: %d", workers, ret);
+            continue;
+        }
+        report_line(report, "并行 %-3d %8.1f ms  %7.1f 帧/s  加速 %.2fx  (实际 %d 段, 扫描 %.1f ms)", workers,
+                    parallel.decode_ms, parallel.frame_count * 1000.0 / parallel.decode_ms,
+                    sequential_ms / parallel.decode_ms, parallel.decode_workers, parallel.scan_ms);
+    }
+    unlink(cache_path.c_str());
+    unlink((cache_path + ".journal").c_str());
+    return report;
+}
+
+// 解码整段视频并归一化，writer非空时同时写入cache_path；direct非空时改为解码器直接解码到cache_path的帧槽
+// (解码器不支持时返回0)。返回帧/秒 (失败返回0)
+static double decode_clip_to_cache(const DecodeClip &clip, FrameCacheWriter *writer, const char *cache_path,
+                                   FrameCacheDirectWriter *direct = nullptr) {
+    AVCodec *codec = avcodec_find_decoder(clip.par->codec_id);
+    AVCodecContext *ctx = codec ? avcodec_alloc_context3(codec) : nullptr;
+    if (!ctx) return 0.0;
+    avcodec_parameters_to_context(ctx, clip.par);
+    DecoderThreadConfig config;
+    config.thread_count = decoder_auto_thread_count(clip.par->width, clip.par->height);
+    decoder_apply_thread_config(ctx, config);
+    if (direct) direct->attach(ctx);
+    if (avcodec_open2(ctx, codec, nullptr) < 0) {
+        avcodec_free_context(&ctx);
+        return 0.0;
+    }
+    FrameCacheFormat format;
+    format.width = clip.par->width;
+    format.height = clip.par->height;
+    format.color_range = AVCOL_RANGE_MPEG;
+    FrameNormalizer normalizer;
+    AVFrame *frame = av_frame_alloc();
+    long frames = 0;
+    bool ok = !writer || writer->open(cache_path, format) == kFrameCacheOk;
+    if (direct) {
+        ok = FrameCacheDirectWriter::supports(ctx) && direct->open(cache_path, format, ctx) == kFrameCacheOk;
+    }
+    auto receive_all = [&]() {
+        while (ok && avcodec_receive_frame(ctx, frame) == 0) {
+            const AVFrame *out = normalizer.normalize(frame);
+            ok = out && (!writer || writer->writeFrame(out) == kFrameCacheOk) &&
+                 (!direct || direct->writeFrame(out) == kFrameCacheOk);
+            frames++;
+            av_frame_unref(frame);
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (AVPacket *pkt : clip.packets) {
+        while (ok && avcodec_send_packet(ctx, pkt) == AVERROR(EAGAIN)) receive_all();
+        receive_all();
+    }
+    avcodec_send_packet(ctx, nullptr);
+    receive_all();
+    if (ok && writer) ok = writer->finish() == kFrameCacheOk;
+    if (ok && direct) ok = direct->finish() == kFrameCacheOk;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+    return ok && seconds > 0 ? frames / seconds : 0.0;
+}
+
+std::string benchmark_cache_write(const char *input_path) {
+    std::string report;
+    report_line(report, "== YUV缓存写入: 仅解码 vs 解码+异步/同步拷贝写入 vs 解码器直接写入 (零拷贝) ==");
+    DecodeClip clip;
+    if (!load_file_clip(input_path, 300, &clip)) {
+        report_line(report, "无法读取 %s，跳过", input_path ? input_path : "(null)");
+        return report;
+    }
+    std::string dir = input_path;
+    size_t slash = dir.find_last_of('/');
+    dir = slash == std::string::npos ? "." : dir.substr(0, slash);
+    std::string cache_path = dir + "/benchmark-write.apfc";
+
+    double decode_fps = decode_clip_to_cache(clip, nullptr, nullptr);
+    report_line(report, "仅解码       %7.1f 帧/s  (%zu 包 %dx%d)", decode_fps, clip.packets.size(), clip.par->width,
+                clip.par->height);
+    for (bool async : {true, false}) {
+        FrameCacheWriter writer(async);
+        double fps = decode_clip_to_cache(clip, &writer, cache_path.c_str());
+        if (fps <= 0) {
+            report_line(report, "%s写入失败", async ? "异步" : "同步");
+            continue;
+        }
+        FrameCacheWriter::Stats stats = writer.stats();
+        report_line(report,
+                    "解码+%s写入 %7.1f 帧/s  为仅解码的 %.0f%%  每帧拷贝 %.0f 字节  (%ld 次写入 %.1f MB, I/O %.1f ms, "
+                    "等待 %.1f ms)",
+                    async ? "异步" : "同步", fps, decode_fps > 0 ? fps * 100.0 / decode_fps : 0.0,
+                    writer.frameCount() > 0 ? (double) stats.bytes_copied / writer.frameCount() : 0.0,
+                    stats.chunks_written, stats.bytes_written / 1048576.0, stats.io_ms, stats.stall_ms);
+    }
+    FrameCacheDirectWriter direct;
+    double direct_fps = decode_clip_to_cache(clip, nullptr, cache_path.c_str(), &direct);
+    if (direct_fps > 0) {
+        FrameCacheDirectWriter::Stats stats = direct.stats();
+        report_line(report, "解码+直接写入 %6.1f 帧/s  为仅解码的 %.0f%%  每帧拷贝 %.0f 字节  (直接 %ld 帧, 拷贝 %ld 帧, %ld 个帧槽)",
+                    direct_fps, decode_fps > 0 ? direct_fps * 100.0 / decode_fps : 0.0,
+                    direct.frameCount() > 0 ? (double) stats.bytes_copied / direct.frameCount() : 0.0,
+                    stats.direct_frames, stats.copied_frames, stats.slots);
+    } else {
+        report_line(report, "解码器不支持直接写入缓存 (非DR1或非YUV420P输出)，跳过零拷贝测试");
+    }
+    unlink(cache_path.c_str());
+    unlink((cache_path + ".journal").c_str());
+    return report;
+}
+
+// 跳转一次并等待目标帧被取出，返回取出帧的帧号 (失败返回-1)
+static long seek_and_wait(StreamDecoder &decoder, long target) {
+    decoder.seekToFrame(target);
+    for (int waited_ms = 0; waited_ms < 5000; waited_ms += 20) {
+        AVFrame *frame = nullptr;
+        int ret = decoder.popFrame(&frame, 20);
+        if (ret < 0) return -1;
+        if (ret == 0) continue;
+        long index = decoder.frameIndexOf(frame);
+        decoder.releaseFrame(&frame);
+        return index;
+    }
+    return -1;
+}
+
+std::string benchmark_seek(const char *input_path) {
+    std::string report;
+    report_line(report, "== 流式跳转耗时: 关键帧索引 vs 按帧率估算 ==");
+    if (!input_path || access(input_path, R_OK) != 0) {
+        report_line(report, "无法读取 %s，跳过", input_path ? input_path : "(null)");
+        return report;
+    }
+    std::string index_path = std::string(input_path) + ".benchmark.kfi";
+    unlink(index_path.c_str());
+    for (bool use_index : {true, false}) {
+        auto open_start = std::chrono::steady_clock::now();
+        StreamDecoder decoder;
+        if (decoder.open(input_path, use_index ? index_path.c_str() : nullptr) < 0 || decoder.start() < 0) {
+            report_line(report, "打开失败，跳过");
+            break;
+        }
+        double open_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - open_start).count();
+        long total = decoder.estimatedTotalFrames();
+        int seeks = 0, exact = 0;
+        for (int i = 0; total > 1 && i < 16; i++) {
+            long target = (long) ((i * 7919L + 13) % total); // 固定的伪随机目标，两种方式相同
+            long landed = seek_and_wait(decoder, target);
+            if (landed < 0) continue;
+            seeks++;
+            if (landed == target) exact++;
+        }
+        StreamDecoder::SeekStats stats = decoder.seekStats();
+        report_line(report, "%-8s 打开 %6.1f ms  %d 次跳转  平均 %6.1f ms  最大 %6.1f ms  准确落点 %d/%d",
+                    use_index ? "关键帧索引" : "按帧率", open_ms, seeks, stats.avg_ms, stats.max_ms, exact, seeks);
+        decoder.stop();
+        if (use_index) { // 再次打开应直接加载已保存的索引
+            KeyframeIndex index;
+            FrameCacheSourceKey source;
+            if (frame_cache_compute_source_key(input_path, &source) == kFrameCacheOk &&
+                index.loadOrBuild(input_path, source, index_path.c_str()) == 0) {
+                report_line(report, "  索引%s %.1f ms (%ld 帧, %zu 个关键帧)", index.loadedFromFile() ? "加载" : "重新扫描",
+                            index.scanMs(), index.frameCount(), index.keyframes().size());
+            }
+        }
+    }
+    unlink(index_path.c_str());
+    return report;
+}
+
+// 模拟渲染循环：每帧先做耗时不定的读取/转换，再按pacing方式等待，返回统计
+// (误差 = 提交时刻 - 按帧号计算的理想时刻，与PresentationClock的定义一致)。
+// 绝对截止时刻与播放时相同，通过PlayerControl::waitFor等待
+static PresentationClock::Stats simulate_pacing(bool absolute_deadline, double fps, int frames, std::mt19937 &rng) {
+    std::uniform_real_distribution<double> work_ms(2.0, 0.6 * 1000.0 / fps);
+    PlayerControl control;
+    PresentationClock clock;
+    PresentationClock reference; // 仅用于统计相对时刻的旧方式
+    for (int i = 0; i < frames; i++) {
+        double media_time_s = i / fps;
+        if (i == 0) {
+            clock.start(media_time_s, 1.0);
+            reference.start(media_time_s, 1.0);
+        }
+        int64_t work_end = PresentationClock::nowNs() + (int64_t) (work_ms(rng) * 1e6);
+        while (PresentationClock::nowNs() < work_end) {
+        } // 模拟读取和YUV转换
+        if (absolute_deadline) {
+            control.waitFor(clock.deadlineNs(media_time_s));
+            clock.framePresented(media_time_s);
+        } else { // 旧方式：提交后固定睡眠一帧间隔
+            reference.framePresented(media_time_s);
+            usleep((useconds_t) (1000000.0 / fps));
+        }
+    }
+    return absolute_deadline ? clock.stats() : reference.stats();
+}
+
+std::string benchmark_presentation_clock(int *failures) {
+    std::string report;
+    const double fps = 60.0;
+    const int frames = 180;
+    report_line(report, "== 显示节奏: 绝对截止时刻 vs 逐帧usleep (%.0f fps, %d 帧, 每帧模拟 2~%.0f ms 转换) ==", fps,
+                frames, 0.6 * 1000.0 / fps);
+    std::mt19937 rng(2024);
+    PresentationClock::Stats results[2];
+    for (bool absolute_deadline : {false, true}) {
+        PresentationClock::Stats &stats = results[absolute_deadline];
+        stats = simulate_pacing(absolute_deadline, fps, frames, rng);
+        report_line(report, "%-12s 误差 平均 %7.2f ms  最大 %7.2f ms  末帧 %7.2f ms  抖动 %5.2f ms",
+                    absolute_deadline ? "绝对截止时刻" : "逐帧usleep", stats.drift_mean_ms, stats.drift_max_ms,
+                    stats.last_drift_ms, stats.jitter_ms);
+    }
+    // 绝对截止时刻：误差和抖动有界，且都小于逐帧usleep
+    const PresentationClock::Stats &sleep = results[0], &deadline = results[1];
+    bool passed = fabs(deadline.drift_mean_ms) <= kMaxPacingDriftMs && deadline.jitter_ms <= kMaxPacingJitterMs &&
+                  fabs(deadline.drift_mean_ms) < fabs(sleep.drift_mean_ms) && deadline.jitter_ms < sleep.jitter_ms;
+    report_line(report, "检查 (平均误差 <= %.1f ms, 抖动 <= %.1f ms, 均小于usleep): %s", kMaxPacingDriftMs,
+                kMaxPacingJitterMs, passed ? "通过" : "失败!");
+    if (!passed && failures) ++*failures;
+    return report;
+}
+
+// 模拟音视频同步：音频时钟比视频快1%、起始超前80ms，位置按20ms步长更新 (与OpenSL ES类似)
+static AvSync::Stats simulate_av_sync(bool sync, double fps, int frames) {
+    int64_t audio_start = PresentationClock::nowNs();
+    AvSync av_sync;
+    av_sync.setAudioClock([audio_start](double *media_time_s) {
+        double elapsed_ms = (PresentationClock::nowNs() - audio_start) / 1e6 * 1.01 + 80.0;
+        *media_time_s = floor(elapsed_ms / 20.0) * 20.0 / 1000.0;
+        return true;
+    });
+    PlayerControl control;
+    PresentationClock clock;
+    for (int i = 0; i < frames; i++) {
+        double media_time_s = i / fps;
+        if (!clock.running()) clock.start(media_time_s, 1.0);
+        if (sync) av_sync.syncVideo(clock);
+        if (clock.shouldDrop(media_time_s)) continue;
+        control.waitFor(clock.deadlineNs(media_time_s));
+        clock.framePresented(media_time_s);
+        av_sync.framePresented(media_time_s);
+    }
+    return av_sync.stats();
+}
+
+std::string benchmark_av_sync(int *failures) {
+    std::string report;
+    const double fps = 60.0;
+    const int frames = 150;
+    const double threshold_ms = AvSync().thresholdMs();
+    report_line(report, "== 音视频同步: 音频主时钟 vs 视频独立计时 (音频快1%%、起始偏差80ms, 阈值 %.0f ms) ==",
+                threshold_ms);
+    AvSync::Stats results[2];
+    for (bool sync : {false, true}) {
+        AvSync::Stats &stats = results[sync];
+        stats = simulate_av_sync(sync, fps, frames);
+        report_line(report, "%-8s A/V偏差 平均 %7.1f ms  最大 %7.1f ms  末帧 %7.1f ms  校正 %ld/%ld 次 (超前/落后)",
+                    sync ? "音频主时钟" : "独立计时", stats.offset_mean_ms, stats.offset_max_ms, stats.offset_last_ms,
+                    stats.corrections_ahead, stats.corrections_behind);
+    }
+    // 音频主时钟：平均和末帧偏差不超过同步阈值，且平均偏差小于独立计时
+    const AvSync::Stats &free_run = results[0], &synced = results[1];
+    bool passed = fabs(synced.offset_mean_ms) <= threshold_ms && fabs(synced.offset_last_ms) <= threshold_ms &&
+                  fabs(synced.offset_mean_ms) < fabs(free_run.offset_mean_ms);
+    report_line(report, "检查 (平均/末帧偏差 <= %.0f ms, 小于独立计时): %s", threshold_ms, passed ? "通过" : "失败!");
+    if (!passed && failures) ++*failures;
+    return report;
+}
+
+// 帧队列测试中传递的元素：入队时刻用于计算交接延迟
+struct QueueProbe {
+    int64_t sent_ns;
+    long seq;
+};
+
+struct QueueBenchResult {
+    double items_per_sec = 0.0;
+    double push_ns = 0.0;   // 平均每次入队调用耗时 (含等待)
+    double pop_ns = 0.0;    // 平均每次出队调用耗时 (含等待)
+    double p50_us = 0.0;    // 入队到出队的交接延迟
+    double p99_us = 0.0;
+    double max_us = 0.0;
+};
+
+static void busy_wait_ns(int64_t ns) {
+    int64_t end = PresentationClock::nowNs() + ns;
+    while (PresentationClock::nowNs() < end) {
+    }
+}
+
+// 生产者线程入队items个元素、当前线程出队，两端每个元素分别模拟producer_work_ns/consumer_work_ns的工作
+template <typename Push, typename Pop>
+static QueueBenchResult run_queue_bench(Push push, Pop pop, int items, int64_t producer_work_ns,
+                                        int64_t consumer_work_ns) {
+    int64_t push_total_ns = 0;
+    std::thread producer([&]() {
+        for (int i = 0; i < items; i++) {
+            if (producer_work_ns > 0) busy_wait_ns(producer_work_ns);
+            int64_t start = PresentationClock::nowNs();
+            push(QueueProbe{start, i});
+            push_total_ns += PresentationClock::nowNs() - start;
+        }
+    });
+    std::vector<int64_t> latencies((size_t) items);
+    int64_t pop_total_ns = 0;
+    int64_t start = PresentationClock::nowNs();
+    for (int i = 0; i < items; i++) {
+        QueueProbe probe;
+        int64_t pop_start = PresentationClock::nowNs();
+        pop(probe);
+        int64_t now = PresentationClock::nowNs();
+        pop_total_ns += now - pop_start;
+        latencies[(size_t) i] = now - probe.sent_ns;
+        if (consumer_work_ns > 0) busy_wait_ns(consumer_work_ns);
+    }
+    double seconds = (PresentationClock::nowNs() - start) / 1e9;
+    producer.join();
+
+    QueueBenchResult result;
+    result.items_per_sec = seconds > 0 ? items / seconds : 0.0;
+    result.push_ns = (double) push_total_ns / items;
+    result.pop_ns = (double) pop_total_ns / items;
+    std::sort(latencies.begin(), latencies.end());
+    result.p50_us = latencies[latencies.size() / 2] / 1e3;
+    result.p99_us = latencies[latencies.size() * 99 / 100] / 1e3;
+    result.max_us = latencies.back() / 1e3;
+    return result;
+}
+
+std::string benchmark_frame_queue() {
+    struct Load { const char *name; int items; int64_t producer_work_ns; int64_t consumer_work_ns; };
+    static const Load loads[] = {
+            {"满载", 200000, 0, 0},             // 两端都不做其他工作，测入队/出队本身的开销
+            {"消费慢", 20000, 0, 20000},        // 队列常满，生产者等待空位
+            {"生产慢", 20000, 20000, 0},        // 队列常空，消费者等待新帧 (futex唤醒延迟)
+    };
+    const size_t depth = 8;
+    std::string report;
+    report_line(report, "== 帧队列: 无锁SPSC环 (futex等待) vs 互斥锁+条件变量 (深度 %zu) ==", depth);
+    for (const Load &load : loads) {
+        BoundedQueue<QueueProbe> locked(depth);
+        QueueBenchResult base = run_queue_bench([&](const QueueProbe &p) { locked.push(p); },
+                                                [&](QueueProbe &p) { locked.pop(p); }, load.items,
+                                                load.producer_work_ns, load.consumer_work_ns);
+        FrameRing<QueueProbe> ring(depth);
+        QueueBenchResult lockfree = run_queue_bench([&](const QueueProbe &p) { ring.push(p, sizeof(p)); },
+                                                    [&](QueueProbe &p) { ring.pop(p); }, load.items,
+                                                    load.producer_work_ns, load.consumer_work_ns);
+        FrameRingStats stats = ring.stats();
+        for (bool is_ring : {false, true}) {
+            const QueueBenchResult &r = is_ring ? lockfree : base;
+            report_line(report,
+                        "%-6s %-6s %9.0f 个/s  入队 %7.0f ns  出队 %7.0f ns  交接延迟 p50 %6.1f / p99 %7.1f / 最大 %8.1f us",
+                        load.name, is_ring ? "无锁环" : "互斥锁", r.items_per_sec, r.push_ns, r.pop_ns, r.p50_us,
+                        r.p99_us, r.max_us);
+        }
+        report_line(report,
+                    "       无锁环: 生产者等待 %ld 次 (%.1f ms)  消费者等待 %ld 次 (%.1f ms)  futex唤醒 %ld 次  平均占用 %.2f",
+                    stats.producer_waits, stats.producer_wait_ms, stats.consumer_waits, stats.consumer_wait_ms,
+                    stats.wakeups, stats.mean_occupancy);
+    }
+    return report;
+}
+
+// 播放控制测试的渲染端：按30fps显示，每帧模拟kControlBenchWorkNs的转换耗时
+static const double kControlBenchFps = 30.0;
+static const int64_t kControlBenchWorkNs = 5000000;
+
+static void add_latency(PlayerControl::Latency *latency, int64_t issued_ns) {
+    double ms = (PresentationClock::nowNs() - issued_ns) / 1e6;
+    latency->count++;
+    latency->last_ms = ms;
+    latency->avg_ms += (ms - latency->avg_ms) / latency->count;
+    latency->max_ms = std::max(latency->max_ms, ms);
+}
+
+// 原先的控制方式：控制端写全局原子变量，渲染线程每帧轮询一次，暂停时每50ms醒来检查
+struct PolledControl {
+    std::atomic<bool> paused{false};
+    std::atomic<bool> abort{false};
+    std::atomic<long> seek_target{-1};
+    std::atomic<int64_t> pause_ns{0}, resume_ns{0}, seek_ns{0}, stop_ns{0}; // 各命令的提交时刻
+};
+
+static PlayerControl::Stats run_polled_render(PolledControl &control) {
+    PlayerControl::Stats stats;
+    PresentationClock clock;
+    long frame = 0;
+    bool was_paused = false;
+    int64_t resume_issued = 0, seek_issued = 0; // 等待下一帧显示时生效
+    while (!control.abort.load()) {
+        long target = control.seek_target.exchange(-1);
+        if (target >= 0) {
+            frame = target;
+            clock.reset();
+            seek_issued = control.seek_ns.load();
+        }
+        if (control.paused.load()) {
+            if (!was_paused) {
+                was_paused = true;
+                clock.pause();
+                add_latency(&stats.pause, control.pause_ns.load());
+            }
+            stats.paused_wakeups++;
+            usleep(50 * 1000);
+            continue;
+        }
+        if (was_paused) {
+            was_paused = false;
+            clock.resume();
+            resume_issued = control.resume_ns.load();
+        }
+        double media_time_s = frame / kControlBenchFps;
+        if (!clock.running()) clock.start(media_time_s, 1.0);
+        busy_wait_ns(kControlBenchWorkNs);
+        clock.waitUntil(media_time_s);
+        frame++;
+        if (resume_issued) add_latency(&stats.resume, resume_issued);
+        if (seek_issued) add_latency(&stats.seek, seek_issued);
+        resume_issued = seek_issued = 0;
+    }
+    add_latency(&stats.stop, control.stop_ns.load());
+    return stats;
+}
+
+// 与native-lib中渲染循环相同的命令处理：帧之间取出命令，暂停时睡眠到下一条命令，等待显示时刻时可被命令唤醒
+static void run_event_render(PlayerControl &control) {
+    PresentationClock clock;
+    long frame = 0;
+    std::vector<PlayerCommand> awaiting_frame;
+    bool show_paused_frame = false;
+    while (true) {
+        PlayerCommand command;
+        bool stop_requested = false;
+        while (control.next(&command)) {
+            PlayerState state = control.apply(command);
+            switch (command.type) {
+                case PlayerCommandType::Stop: stop_requested = true; control.effectDone(command); break;
+                case PlayerCommandType::Pause: clock.pause(); control.effectDone(command); break;
+                case PlayerCommandType::Resume: clock.resume(); awaiting_frame.push_back(command); break;
+                case PlayerCommandType::Redraw: control.effectDone(command); break;
+                case PlayerCommandType::Seek:
+                    frame = command.frame;
+                    clock.reset();
+                    show_paused_frame = state == PlayerState::Paused;
+                    awaiting_frame.push_back(command);
+                    break;
+            }
+        }
+        if (stop_requested) break;
+        bool paused = control.state() == PlayerState::Paused;
+        if (paused && !show_paused_frame) {
+            control.waitWhilePaused();
+            continue;
+        }
+        double media_time_s = frame / kControlBenchFps;
+        if (!paused && !clock.running()) clock.start(media_time_s, 1.0);
+        busy_wait_ns(kControlBenchWorkNs);
+        if (!paused) control.waitFor(clock.deadlineNs(media_time_s));
+        frame++;
+        for (const PlayerCommand &done : awaiting_frame) control.effectDone(done);
+        awaiting_frame.clear();
+        show_paused_frame = false;
+    }
+}
+
+// 控制端的操作序列：每轮在随机的帧相位上 暂停 -> 暂停中跳转 -> 恢复 -> 播放中跳转，最后停止
+template <typename Post>
+static void drive_player_commands(Post post, int rounds) {
+    std::mt19937 rng(4321);
+    auto sleep_ms = [](int64_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); };
+    sleep_ms(200);
+    for (int i = 0; i < rounds; i++) {
+        sleep_ms(100 + rng() % 34);
+        post(PlayerCommandType::Pause, -1);
+        sleep_ms(300);
+        post(PlayerCommandType::Seek, 30L * (i + 1));
+        sleep_ms(300);
+        post(PlayerCommandType::Resume, -1);
+        sleep_ms(100 + rng() % 34);
+        post(PlayerCommandType::Seek, 30L * i);
+    }
+    sleep_ms(100 + rng() % 34);
+    post(PlayerCommandType::Stop, -1);
+}
+
+std::string benchmark_player_control() {
+    const int rounds = 8;
+    std::string report;
+    report_line(report, "== 播放控制: 命令队列+事件唤醒 vs 轮询全局原子变量 (%.0ffps, 每帧转换 %.0f ms, %d 轮) ==",
+                kControlBenchFps, kControlBenchWorkNs / 1e6, rounds);
+
+    PolledControl polled;
+    PlayerControl::Stats polled_stats;
+    std::thread polled_render([&]() { polled_stats = run_polled_render(polled); });
+    drive_player_commands([&](PlayerCommandType type, long frame) {
+        int64_t now = PresentationClock::nowNs();
+        switch (type) {
+            case PlayerCommandType::Pause: polled.pause_ns = now; polled.paused = true; break;
+            case PlayerCommandType::Resume: polled.resume_ns = now; polled.paused = false; break;
+            case PlayerCommandType::Seek: polled.seek_ns = now; polled.seek_target = frame; break;
+            case PlayerCommandType::Stop: polled.stop_ns = now; polled.abort = true; break;
+            case PlayerCommandType::Redraw: break; // 测试中不提交重绘
+        }
+    }, rounds);
+    polled_render.join();
+
+    PlayerControl control;
+    control.begin();
+    std::thread event_render([&]() { run_event_render(control); });
+    drive_player_commands([&](PlayerCommandType type, long frame) { control.post(type, frame); }, rounds);
+    event_render.join();
+    PlayerControl::Stats event_stats = control.stats();
+    control.end();
+
+    for (bool event : {false, true}) {
+        const PlayerControl::Stats &s = event ? event_stats : polled_stats;
+        report_line(report, "%-8s 暂停 平均 %5.1f / 最大 %5.1f ms  恢复 %5.1f / %5.1f ms  跳转 %6.1f / %6.1f ms  停止 %5.1f ms",
+                    event ? "事件唤醒" : "轮询", s.pause.avg_ms, s.pause.max_ms, s.resume.avg_ms, s.resume.max_ms,
+                    s.seek.avg_ms, s.seek.max_ms, s.stop.avg_ms);
+        report_line(report, "         暂停期间唤醒 %ld 次 (共暂停约 %d ms)", s.paused_wakeups, rounds * 600);
+    }
+    return report;
+}
+
+// CPU周期计数器 (perf_event_open)。多数设备在perf_event_paranoid较高时不允许打开，
+// 此时按cpuinfo_max_freq估算周期数 (假设一直运行在最高频率，为下限)
+class CycleCounter {
+public:
+    CycleCounter() {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd_ < 0) {
+            FILE *file = fopen("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", "r");
+            long khz = 0;
+            if (file) {
+                if (fscanf(file, "%ld", &khz) != 1) khz = 0;
+                fclose(file);
+            }
+            max_ghz_ = khz / 1e6;
+        }
+    }
+    ~CycleCounter() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    bool measured() const { return fd_ >= 0; }
+    bool available() const { return fd_ >= 0 || max_ghz_ > 0; }
+
+    void start() {
+        start_ = std::chrono::steady_clock::now();
+        if (fd_ < 0) return;
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    // 返回start以来的周期数，不可用时返回0
+    double stop() {
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_).count();
+        if (fd_ < 0) return ns * max_ghz_;
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        long long cycles = 0;
+        if (read(fd_, &cycles, sizeof(cycles)) != sizeof(cycles)) return 0.0;
+        return (double) cycles;
+    }
+
+private:
+    int fd_ = -1;
+    double max_ghz_ = 0.0;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// 统计第一个声道的上升过零点 (带迟滞，避免噪声造成多次过零)，估算正弦信号的频率 (Hz)
+static double measure_pitch_hz(const std::vector<float> &pcm, int channels, int sample_rate) {
+    size_t frames = pcm.size() / channels;
+    long crossings = 0;
+    size_t first = 0, last = 0;
+    bool armed = false;
+    for (size_t i = 0; i < frames; i++) {
+        float v = pcm[i * channels];
+        if (v < -0.25f) {
+            armed = true;
+        } else if (armed && v >= 0.0f) {
+            if (crossings == 0) first = i;
+            last = i;
+            crossings++;
+            armed = false;
+        }
+    }
+    return crossings > 1 ? (crossings - 1) * (double) sample_rate / (double) (last - first) : 0.0;
+}
+
+// 对整段输入变速，返回输出和耗时 (周期数、纳秒)
+static void run_time_stretch(CorrelationKernel kernel, double speed, const std::vector<float> &input, int sample_rate,
+                             int channels, CycleCounter &counter, std::vector<float> *output, double *cycles,
+                             double *ns) {
+    TimeStretcher stretcher(kernel);
+    stretcher.configure(sample_rate, channels);
+    stretcher.setSpeed(speed);
+    output->assign((size_t) (input.size() / speed) + (size_t) sample_rate * channels, 0.0f);
+    const int block = sample_rate / 100; // 每次送入10ms，与解码帧的粒度相近
+    const int frames = (int) (input.size() / channels);
+    size_t produced = 0;
+    auto start = std::chrono::steady_clock::now();
+    counter.start();
+    for (int pos = 0; pos < frames; pos += block) {
+        stretcher.putInput(&input[(size_t) pos * channels], std::min(block, frames - pos));
+        int max_frames = (int) ((output->size() - produced) / channels);
+        produced += (size_t) stretcher.receiveOutput(output->data() + produced, max_frames) * channels;
+    }
+    stretcher.flush();
+    int max_frames = (int) ((output->size() - produced) / channels);
+    produced += (size_t) stretcher.receiveOutput(output->data() + produced, max_frames) * channels;
+    *cycles = counter.stop();
+    *ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    output->resize(produced);
+}
+
+std::string benchmark_time_stretch() {
+    const int sample_rate = 48000, channels = 2, seconds = 5;
+    const double tone_hz = 440.0;
+    static const CorrelationKernel kernels[] = {CorrelationKernel::Scalar, CorrelationKernel::Neon,
+                                                CorrelationKernel::Sse, CorrelationKernel::Avx};
+    static const double speeds[] = {0.25, 0.5, 1.0, 1.5, 2.0, 4.0};
+
+    // 合成输入：440Hz正弦加少量噪声，双声道
+    std::vector<float> input((size_t) sample_rate * seconds * channels);
+    std::mt19937 rng(440);
+    std::uniform_real_distribution<float> noise(-0.02f, 0.02f);
+    for (size_t i = 0; i < input.size() / channels; i++) {
+        float v = 0.5f * (float) sin(2.0 * M_PI * tone_hz * i / sample_rate);
+        for (int c = 0; c < channels; c++) input[i * channels + c] = v + noise(rng);
+    }
+
+    CycleCounter counter;
+    const char *cycle_source = counter.measured() ? "perf计数" : (counter.available() ? "按最高频率估算" : "不可用，记为0");
+    std::string report;
+    CorrelationKernel best = TimeStretcher::detectBestKernel();
+    report_line(report, "== 保持音调的变速 (WSOLA, %d kHz 双声道 %d s %.0f Hz, 自动选择: %s, 周期: %s) ==",
+                sample_rate / 1000, seconds, tone_hz, TimeStretcher::kernelName(best), cycle_source);
+    std::vector<float> output;
+    double cycles = 0, ns = 0;
+    for (CorrelationKernel kernel : kernels) {
+        if (!TimeStretcher::isKernelSupported(kernel)) continue;
+        run_time_stretch(kernel, 1.5, input, sample_rate, channels, counter, &output, &cycles, &ns);
+        double out_frames = (double) (output.size() / channels);
+        report_line(report, "1.5x  %-7s %7.1f 周期/采样  %6.1f ns/采样", TimeStretcher::kernelName(kernel),
+                    cycles / out_frames, ns / out_frames);
+    }
+    for (double speed : speeds) {
+        run_time_stretch(best, speed, input, sample_rate, channels, counter, &output, &cycles, &ns);
+        double out_frames = (double) (output.size() / channels);
+        double ratio = out_frames * speed / (input.size() / channels);
+        report_line(report, "%4.2fx %-7s %7.1f 周期/采样  %6.1f ns/采样  长度比 %.3f  音高 %.1f Hz",
+                    speed, TimeStretcher::kernelName(best), cycles / out_frames, ns / out_frames, ratio,
+                    measure_pitch_hz(output, channels, sample_rate));
+    }
+    return report;
+}
+
+std::string benchmark_audio_pipeline(const char *input_path) {
+    std::string report;
+    report_line(report, "== 音频解码管线: FFmpeg解码 + swresample + 变速 -> 无锁环形缓冲区 -> 空输出 ==");
+    struct AudioCase {
+        const char *name;
+        int sample_rate;
+        AVSampleFormat sample_fmt;
+        double speed;
+    };
+    const AudioCase cases[] = {
+            {"48kHz float", 48000, AV_SAMPLE_FMT_FLT, 1.0},
+            {"44.1kHz s16", 44100, AV_SAMPLE_FMT_S16, 1.0},
+            {"48kHz float 2x", 48000, AV_SAMPLE_FMT_FLT, 2.0},
+    };
+    for (const AudioCase &c : cases) {
+        AudioDecoder decoder;
+        if (decoder.open(input_path) < 0) {
+            report_line(report, "%s 没有可解码的音频流，跳过", input_path ? input_path : "(null)");
+            break;
+        }
+        AudioDecoder::OutputFormat format;
+        format.sample_rate = c.sample_rate;
+        format.channels = 2;
+        format.sample_fmt = c.sample_fmt;
+        decoder.setOutputFormat(format);
+        decoder.setSpeed(c.speed);
+        // 空输出：像AAudio回调一样每次取4ms的数据，但不等待，尽快取空，测得管线的最大吞吐量
+        const int burst = c.sample_rate / 250;
+        std::vector<uint8_t> buffer((size_t) burst * format.channels * av_get_bytes_per_sample(c.sample_fmt));
+        const uint64_t max_frames = (uint64_t) (c.sample_rate / c.speed) * kAudioBenchMaxSeconds;
+        uint64_t frames = 0;
+        long reads = 0;
+        double read_ns = 0;
+        auto start = std::chrono::steady_clock::now();
+        decoder.start(0.0);
+        while (!decoder.finished() && frames < max_frames) {
+            auto read_start = std::chrono::steady_clock::now();
+            int n = decoder.read(buffer.data(), burst);
+            if (n == 0) { // 解码线程尚未写入，让出CPU
+                std::this_thread::yield();
+                continue;
+            }
+            read_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - read_start).count();
+            reads++;
+            frames += n;
+        }
+        double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        decoder.stop();
+        AudioDecoder::Stats stats = decoder.stats();
+        double media_s = frames * c.speed / c.sample_rate;
+        report_line(report, "%-15s %7.1fx 实时  (%.1f s音频 %.0f ms: 解码 %.1f ms 重采样 %.1f ms 变速 %.1f ms, read %.0f ns/次, 重采样器创建 %ld 次)",
+                    c.name, wall_s > 0 ? media_s / wall_s : 0.0, media_s, wall_s * 1000.0, stats.decode_ms,
+                    stats.resample_ms, stats.stretch_ms, reads > 0 ? read_ns / reads : 0.0, stats.resampler_inits);
+    }
+    return report;
+}
+
+// 用随机数据填充帧 (高位深格式只填充有效位)
+static void fill_random_frame(AVFrame *frame, std::mt19937 &rng) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat) frame->format);
+    int depth = desc->comp[0].depth, shift = desc->comp[0].shift;
+    for (int p = 0; p < 4 && frame->data[p]; p++) {
+        int rows = (p == 1 || p == 2) ? -((-frame->height) >> desc->log2_chroma_h) : frame->height;
+        for (int y = 0; y < rows; y++) {
+            uint8_t *row = frame->data[p] + y * frame->linesize[p];
+            if (depth > 8) {
+                uint16_t *row16 = reinterpret_cast<uint16_t *>(row);
+                for (int x = 0; x < frame->linesize[p] / 2; x++) row16[x] = (uint16_t) ((rng() & ((1 << depth) - 1)) << shift);
+            } else {
+                for (int x = 0; x < frame->linesize[p]; x++) row[x] = (uint8_t) rng();
+            }
+        }
+    }
+}
+
+std::string benchmark_pixel_formats() {
+    static const AVPixelFormat formats[] = {
+            AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_NV12, AV_PIX_FMT_NV21, AV_PIX_FMT_YUV422P,
+            AV_PIX_FMT_YUVJ422P, AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_P010LE,
+    };
+    const int width = 1920, height = 1080;
+    std::string report;
+    report_line(report, "== 像素格式归一化到YUV420P (%dx%d) ==", width, height);
+    std::mt19937 rng(54321);
+    for (AVPixelFormat format : formats) {
+        AVFrame *src = av_frame_alloc();
+        src->format = format;
+        src->width = width;
+        src->height = height;
+        if (av_frame_get_buffer(src, 64) < 0) {
+            av_frame_free(&src);
+            continue;
+        }
+        fill_random_frame(src, rng);
+
+        FrameNormalizer normalizer;
+        const AVFrame *out = nullptr;
+        double ns = time_per_iteration_ns([&] { out = normalizer.normalize(src); });
+
+        // 快速路径与swscale的结果对比 (快速路径只做色度解交错，应逐位一致)
+        int max_diff = 0;
+        FrameNormalizer::Path path = FrameNormalizer::pathFor(format);
+        if (out && path == FrameNormalizer::Path::FastPath) {
+            AVFrame *ref = av_frame_alloc();
+            ref->format = AV_PIX_FMT_YUV420P;
+            ref->width = width;
+            ref->height = height;
+            SwsContext *sws = sws_getContext(width, height, format, width, height, AV_PIX_FMT_YUV420P, SWS_BILINEAR,
+                                             nullptr, nullptr, nullptr);
+            if (sws && av_frame_get_buffer(ref, 64) == 0) {
+                sws_scale(sws, src->data, src->linesize, 0, height, ref->data, ref->linesize);
+                for (int p = 0; p < 3; p++) {
+                    int w = p ? width / 2 : width, h = p ? height / 2 : height;
+                    for (int y = 0; y < h; y++) {
+                        for (int x = 0; x < w; x++) {
+                            int d = abs(out->data[p][y * out->linesize[p] + x] - ref->data[p][y * ref->linesize[p] + x]);
+                            max_diff = std::max(max_diff, d);
+                        }
+                    }
+                }
+            }
+            sws_freeContext(sws);
+            av_frame_free(&ref);
+        }
+        if (path == FrameNormalizer::Path::FastPath) {
+            report_line(report, "%-12s %-10s %7.3f ms/帧  与swscale最大差值 %d", av_get_pix_fmt_name(format),
+                        FrameNormalizer::pathName(path), ns / 1e6, max_diff);
+        } else {
+            report_line(report, "%-12s %-10s %7.3f ms/帧%s", av_get_pix_fmt_name(format),
+                        FrameNormalizer::pathName(path), ns / 1e6, out ? "" : "  (转换失败)");
+        }
+        av_frame_free(&src);
+    }
+    return report;
+}
+
+std::string benchmark_run_all(const char *input_path, int *failures) {
+    std::string report;
+    report += benchmark_yuv_convert(failures);
+    report += benchmark_yuv_convert_parallel(failures);
+    report += benchmark_scaled_convert(failures);
+    report += benchmark_yuv_color_formats(failures);
+    report += benchmark_rgb565_output();
+    report += benchmark_present_modes();
+    report += benchmark_pixel_formats();
+    report += benchmark_presentation_clock(failures);
+    report += benchmark_av_sync(failures);
+    report += benchmark_frame_queue();
+    report += benchmark_player_control();
+    report += benchmark_time_stretch();
+    report += benchmark_decode_threads(input_path);
+    report += benchmark_frame_pool(input_path, failures);
+    report += benchmark_multi_instance(input_path);
+    report += benchmark_audio_pipeline(input_path);
+    report += benchmark_cache_build(input_path);
+    report += benchmark_cache_write(input_path);
+    report += benchmark_seek(input_path);
+    return report;
+}
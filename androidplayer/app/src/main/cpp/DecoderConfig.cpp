@@ -0,0 +1,112 @@
+#include "DecoderConfig.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unistd.h>
+#include "android/log.h"
+
+#define LOG_TAG "DecoderConfig"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+static const int kMaxDecoderThreads = 16; // FFmpeg自动线程数的上限，更多线程对单路解码没有收益
+
+static std::mutex g_config_mutex;
+static DecoderThreadConfig g_default_config;
+static std::atomic<int> g_active_streams(0);
+
+void decoder_set_default_thread_config(const DecoderThreadConfig &config) {
+    std::lock_guard<std::mutex> lock(g_config_mutex);
+    g_default_config = config;
+    LOGI("解码线程配置: thread_count=%d (0为自动), frame=%d, slice=%d", config.thread_count,
+         (config.thread_type & FF_THREAD_FRAME) != 0, (config.thread_type & FF_THREAD_SLICE) != 0);
+}
+
+DecoderThreadConfig decoder_default_thread_config() {
+    std::lock_guard<std::mutex> lock(g_config_mutex);
+    return g_default_config;
+}
+
+int decoder_online_cores() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int) cores : 1;
+}
+
+int decoder_auto_thread_count(int width, int height) {
+    long pixels = (long) width * height;
+    int limit;
+    if (pixels <= 640L * 480) limit = 2;         // 480p及以下
+    else if (pixels <= 1280L * 720) limit = 4;   // 720p
+    else if (pixels <= 1920L * 1088) limit = 6;  // 1080p
+    else limit = kMaxDecoderThreads;             // 2K/4K
+    int cores = decoder_online_cores() / std::max(1, decoder_active_streams()); // 与其他正在解码的视频流平分
+    return std::max(1, std::min(cores, limit));
+}
+
+void decoder_stream_opened() {
+    g_active_streams++;
+}
+
+void decoder_stream_closed() {
+    g_active_streams--;
+}
+
+int decoder_active_streams() {
+    return g_active_streams.load();
+}
+
+void decoder_apply_thread_config(AVCodecContext *codec_ctx, const DecoderThreadConfig &config) {
+    int count = config.thread_count > 0 ? config.thread_count
+                                        : decoder_auto_thread_count(codec_ctx->width, codec_ctx->height);
+    codec_ctx->thread_count = std::min(count, kMaxDecoderThreads);
+    codec_ctx->thread_type = config.thread_type;
+}
+
+int decoder_open_video(const char *path, const DecoderThreadConfig &config,
+                       AVFormatContext **fmt_ctx, AVCodecContext **codec_ctx, int *stream_idx,
+                       const DecoderSetup &setup) {
+    if (avformat_open_input(fmt_ctx, path, nullptr, nullptr) != 0) {
+        LOGE("无法打开输入文件: %s", path);
+        return -1;
+    }
+    if (avformat_find_stream_info(*fmt_ctx, nullptr) < 0) {
+        LOGE("无法找到 %s 的流信息", path);
+        return -2;
+    }
+    return decoder_open_video_stream(*fmt_ctx, config, codec_ctx, stream_idx, setup);
+}
+
+int decoder_open_video_stream(AVFormatContext *fmt_ctx, const DecoderThreadConfig &config,
+                              AVCodecContext **codec_ctx, int *stream_idx, const DecoderSetup &setup) {
+    *stream_idx = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (*stream_idx < 0) {
+        LOGE("%s 中没有视频流", fmt_ctx->url ? fmt_ctx->url : "输入");
+        return -3;
+    }
+    AVCodecParameters *par = fmt_ctx->streams[*stream_idx]->codecpar;
+    AVCodec *codec = avcodec_find_decoder(par->codec_id);
+    if (!codec) {
+        LOGE("不支持的解码器ID: %d", par->codec_id);
+        return -4;
+    }
+    *codec_ctx = avcodec_alloc_context3(codec);
+    if (!*codec_ctx) {
+        LOGE("无法分配解码器上下文");
+        return -5;
+    }
+    if (avcodec_parameters_to_context(*codec_ctx, par) < 0) {
+        LOGE("无法拷贝解码器参数到上下文");
+        return -6;
+    }
+    decoder_apply_thread_config(*codec_ctx, config);
+    if (setup) setup(*codec_ctx);
+    if (avcodec_open2(*codec_ctx, codec, nullptr) < 0) {
+        LOGE("无法打开解码器");
+        return -7;
+    }
+    LOGI("解码器 %s 已打开: %dx%d, %d 线程, 模式: %s", codec->name, (*codec_ctx)->width, (*codec_ctx)->height,
+         (*codec_ctx)->thread_count,
+         (*codec_ctx)->active_thread_type == FF_THREAD_FRAME ? "帧级" :
+         (*codec_ctx)->active_thread_type == FF_THREAD_SLICE ? "片级" : "单线程");
+    return 0;
+}
@@ -0,0 +1,217 @@
+#include "Demuxer.h"
+#include <chrono>
+#include <cmath>
+#include "android/log.h"
+
+#define LOG_TAG "Demuxer"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+
+static const size_t kOverflowFactor = 2; // 其他流饿死时，队列最多可超出常规上限的倍数
+static const int kQueueWaitMs = 10;      // 队列满时的等待时间，超时后重新检查终止/跳转请求和其他流的状态
+
+using Clock = std::chrono::steady_clock;
+
+Demuxer::Demuxer() {
+}
+
+Demuxer::~Demuxer() {
+    stop();
+    if (fmt_ctx_) avformat_close_input(&fmt_ctx_);
+}
+
+int Demuxer::open(const char *path) {
+    if (avformat_open_input(&fmt_ctx_, path, nullptr, nullptr) != 0) {
+        LOGE("无法打开输入文件: %s", path);
+        return -1;
+    }
+    if (avformat_find_stream_info(fmt_ctx_, nullptr) < 0) {
+        LOGE("无法找到 %s 的流信息", path);
+        avformat_close_input(&fmt_ctx_);
+        return -2;
+    }
+    path_ = path;
+    video_idx_ = av_find_best_stream(fmt_ctx_, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    audio_idx_ = av_find_best_stream(fmt_ctx_, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (video_idx_ < 0) video_idx_ = -1;
+    if (audio_idx_ < 0) audio_idx_ = -1;
+    queues_.resize(fmt_ctx_->nb_streams);
+    enabled_.assign(fmt_ctx_->nb_streams, false);
+    LOGI("解复用器已打开: %s (视频流 %d, 音频流 %d)", path, video_idx_, audio_idx_);
+    return 0;
+}
+
+PacketQueue *Demuxer::enableStream(int stream_index, size_t max_bytes) {
+    if (stream_index < 0 || stream_index >= (int) queues_.size()) return nullptr;
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    if (!queues_[stream_index]) queues_[stream_index].reset(new PacketQueue(max_bytes, &packet_pool_));
+    PacketQueue *queue = queues_[stream_index].get();
+    queue->clear();
+    queue->reset();
+    enabled_[stream_index] = true;
+    return queue;
+}
+
+void Demuxer::disableStream(int stream_index) {
+    if (stream_index < 0 || stream_index >= (int) queues_.size()) return;
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    enabled_[stream_index] = false;
+    if (queues_[stream_index]) {
+        queues_[stream_index]->abort();
+        queues_[stream_index]->clear();
+    }
+}
+
+PacketQueue *Demuxer::enabledQueue(int stream_index) {
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    if (stream_index < 0 || stream_index >= (int) queues_.size() || !enabled_[stream_index]) return nullptr;
+    return queues_[stream_index].get();
+}
+
+// 除stream_index之外是否有启用的流的队列已空
+bool Demuxer::otherStreamStarving(int stream_index) {
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    for (size_t i = 0; i < queues_.size(); i++) {
+        if ((int) i != stream_index && enabled_[i] && queues_[i]->empty()) return true;
+    }
+    return false;
+}
+
+void Demuxer::clearQueues() {
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    for (auto &queue : queues_) {
+        if (queue) queue->clear();
+    }
+}
+
+int Demuxer::start() {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (!fmt_ctx_) return -1;
+    if (thread_.joinable()) return 0;
+    abort_ = false;
+    thread_ = std::thread(&Demuxer::demuxLoop, this);
+    running_ = true;
+    return 0;
+}
+
+void Demuxer::stop() {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (!thread_.joinable()) return;
+    abort_ = true;
+    thread_.join();
+    running_ = false;
+    clearQueues();
+    Stats stats = this->stats();
+    LOGI("解复用线程结束: %ld 个包, 丢弃 %ld, 超出上限 %ld, 跳转 %ld 次, 队列满等待 %.1f ms", stats.packets,
+         stats.dropped_packets, stats.overflow_packets, stats.seeks, stats.blocked_ms);
+}
+
+int Demuxer::seek(double time_s, int64_t video_ts, int64_t byte_pos) {
+    std::lock_guard<std::mutex> lock(seek_mutex_);
+    seek_request_ = {++next_serial_, time_s, video_ts, byte_pos};
+    seek_pending_ = true;
+    return next_serial_;
+}
+
+int Demuxer::lastSerial() const {
+    std::lock_guard<std::mutex> lock(seek_mutex_);
+    return next_serial_;
+}
+
+bool Demuxer::seekTime(int serial, double *time_s) const {
+    std::lock_guard<std::mutex> lock(seek_mutex_);
+    if (serial != seek_request_.serial) return false;
+    *time_s = seek_request_.time_s;
+    return true;
+}
+
+Demuxer::Stats Demuxer::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
+
+void Demuxer::performSeek(const SeekRequest &request) {
+    bool by_video = enabledQueue(video_idx_) != nullptr;
+    int stream = by_video ? video_idx_ : (enabledQueue(audio_idx_) ? audio_idx_ : -1);
+    int ret;
+    if (by_video && request.video_ts != AV_NOPTS_VALUE) { // 索引中的关键帧，失败时按字节偏移定位
+        ret = av_seek_frame(fmt_ctx_, video_idx_, request.video_ts, AVSEEK_FLAG_BACKWARD);
+        if (ret < 0 && request.byte_pos >= 0) ret = av_seek_frame(fmt_ctx_, video_idx_, request.byte_pos, AVSEEK_FLAG_BYTE);
+    } else if (stream >= 0) {
+        AVStream *st = fmt_ctx_->streams[stream];
+        int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+        ret = av_seek_frame(fmt_ctx_, stream, start + (int64_t) llround(request.time_s / av_q2d(st->time_base)),
+                            AVSEEK_FLAG_BACKWARD);
+    } else {
+        ret = av_seek_frame(fmt_ctx_, -1, (int64_t) llround(request.time_s * AV_TIME_BASE), AVSEEK_FLAG_BACKWARD);
+    }
+    if (ret < 0) LOGW("跳转到 %.3f s失败，从当前位置继续读取", request.time_s);
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.seeks++;
+}
+
+void Demuxer::demuxLoop() {
+    LOGI("解复用线程启动.");
+    AVPacket *pending = nullptr; // 因队列满而尚未入队的包
+    bool eof_sent = false;
+    int serial = 0;
+
+    while (!abort_) {
+        SeekRequest request;
+        bool has_seek;
+        {
+            std::lock_guard<std::mutex> lock(seek_mutex_);
+            has_seek = seek_pending_;
+            request = seek_request_;
+            seek_pending_ = false;
+        }
+        if (has_seek) { // 定位后作废所有队列中旧的包
+            performSeek(request);
+            packet_pool_.release(&pending);
+            clearQueues();
+            serial = request.serial;
+            eof_sent = false;
+        }
+
+        if (!pending) {
+            if (eof_sent) { // 已到文件末尾，等待可能的跳转请求
+                std::this_thread::sleep_for(std::chrono::milliseconds(kQueueWaitMs));
+                continue;
+            }
+            pending = packet_pool_.acquire();
+            if (av_read_frame(fmt_ctx_, pending) < 0) { // 文件结束：向每个启用的流发送结束标记 (不占字节数)
+                packet_pool_.release(&pending);
+                for (size_t i = 0; i < queues_.size(); i++) {
+                    PacketQueue *queue = enabledQueue((int) i);
+                    if (queue) queue->push({nullptr, serial}, SIZE_MAX, kQueueWaitMs);
+                }
+                eof_sent = true;
+                continue;
+            }
+        }
+
+        PacketQueue *queue = enabledQueue(pending->stream_index);
+        if (!queue) { // 没有消费者的流
+            packet_pool_.release(&pending);
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.dropped_packets++;
+            continue;
+        }
+        size_t limit = queue->maxBytes();
+        bool overflow = otherStreamStarving(pending->stream_index);
+        if (overflow) limit *= kOverflowFactor;
+        Clock::time_point wait_start = Clock::now();
+        if (queue->push({pending, serial}, limit, kQueueWaitMs)) {
+            pending = nullptr;
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.packets++;
+            if (overflow && queue->bytes() > queue->maxBytes()) stats_.overflow_packets++;
+        } else {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.blocked_ms += std::chrono::duration<double, std::milli>(Clock::now() - wait_start).count();
+        }
+    }
+    packet_pool_.release(&pending);
+    LOGI("解复用线程退出.");
+}
@@ -0,0 +1,985 @@
+#include "FrameCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FrameNormalizer.h"
+#include "android/log.h"
+
+extern "C" {
+#include <libavutil/hash.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#define LOG_TAG "FrameCache"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+
+static const int kHashSampleCount = 16;               // 内容哈希的采样块数
+static const size_t kHashSampleBytes = 64 * 1024;     // 每个采样块的大小
+
+static std::string journal_path(const std::string &path) {
+    return path + ".journal";
+}
+
+std::string FrameCacheSourceKey::hex() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (uint8_t b : hash) {
+        out += digits[b >> 4];
+        out += digits[b & 0xf];
+    }
+    return out;
+}
+
+bool FrameCacheSourceKey::sameContent(const FrameCacheHeader &header) const {
+    return header.source_size == size && memcmp(header.source_hash, hash, sizeof(hash)) == 0;
+}
+
+int frame_cache_compute_source_key(const char *path, FrameCacheSourceKey *key) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("打开源文件失败: %s (%s)", path, strerror(errno));
+        return kFrameCacheIoError;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return kFrameCacheIoError;
+    }
+    key->size = (uint64_t) st.st_size;
+    key->mtime_ns = (int64_t) st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+
+    AVHashContext *hash = nullptr;
+    if (av_hash_alloc(&hash, "murmur3") < 0) {
+        ::close(fd);
+        return kFrameCacheIoError;
+    }
+    av_hash_init(hash);
+    av_hash_update(hash, reinterpret_cast<const uint8_t *>(&key->size), sizeof(key->size));
+
+    // 小文件整体参与哈希；大文件只读取首尾及均匀分布的采样块，耗时与文件大小无关
+    std::vector<uint8_t> buffer(kHashSampleBytes);
+    bool ok = true;
+    auto hash_range = [&](uint64_t offset, uint64_t length) {
+        while (ok && length > 0) {
+            size_t chunk = (size_t) std::min<uint64_t>(length, buffer.size());
+            ssize_t n = pread(fd, buffer.data(), chunk, (off_t) offset);
+            if (n <= 0) { ok = false; break; }
+            av_hash_update(hash, buffer.data(), (int) n);
+            offset += (uint64_t) n;
+            length -= (uint64_t) n;
+        }
+    };
+    if (key->size <= (uint64_t) kHashSampleCount * kHashSampleBytes) {
+        hash_range(0, key->size);
+    } else {
+        uint64_t span = key->size - kHashSampleBytes;
+        for (int i = 0; i < kHashSampleCount && ok; i++) {
+            hash_range(span * i / (kHashSampleCount - 1), kHashSampleBytes);
+        }
+    }
+    ::close(fd);
+    av_hash_final(hash, key->hash);
+    av_hash_freep(&hash);
+    if (!ok) {
+        LOGE("读取源文件失败: %s", path);
+        return kFrameCacheIoError;
+    }
+    return kFrameCacheOk;
+}
+
+FrameCacheFormat FrameCacheFormat::fromStream(const AVStream *stream, const AVCodecContext *codec_ctx,
+                                              const FrameCacheSourceKey &source) {
+    FrameCacheFormat format;
+    format.width = codec_ctx->width;
+    format.height = codec_ctx->height;
+    format.pix_fmt = AV_PIX_FMT_YUV420P;       // 写入前由FrameNormalizer统一转换
+    format.color_space = codec_ctx->colorspace;
+    format.color_range = FrameNormalizer::outputRange(codec_ctx->pix_fmt, codec_ctx->color_range);
+    format.color_primaries = codec_ctx->color_primaries;
+    format.color_trc = codec_ctx->color_trc;
+    format.chroma_location = codec_ctx->chroma_sample_location;
+    format.time_base = stream->time_base;
+    if (stream->avg_frame_rate.num != 0 && stream->avg_frame_rate.den != 0) format.frame_rate = stream->avg_frame_rate;
+    else if (stream->r_frame_rate.num != 0 && stream->r_frame_rate.den != 0) format.frame_rate = stream->r_frame_rate;
+    format.source = source;
+    return format;
+}
+
+// 按流描述填充 (未完成状态的) 文件头
+static void fill_header(FrameCacheHeader &header, const FrameCacheFormat &format) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format.pix_fmt);
+    header = {};
+    memcpy(header.magic, kFrameCacheMagic, sizeof(header.magic));
+    header.version = kFrameCacheVersion;
+    header.header_size = kFrameCacheHeaderSize;
+    header.width = format.width;
+    header.height = format.height;
+    header.pix_fmt = format.pix_fmt;
+    header.color_space = format.color_space;
+    header.color_range = format.color_range;
+    header.color_primaries = format.color_primaries;
+    header.color_trc = format.color_trc;
+    header.chroma_location = format.chroma_location;
+    header.time_base_num = format.time_base.num;
+    header.time_base_den = format.time_base.den;
+    header.frame_rate_num = format.frame_rate.num;
+    header.frame_rate_den = format.frame_rate.den;
+    header.source_size = format.source.size;
+    header.source_mtime_ns = format.source.mtime_ns;
+    memcpy(header.source_hash, format.source.hash, sizeof(header.source_hash));
+
+    // 各平面紧密排列 (行跨度等于可见宽度)
+    int linesizes[4] = {0};
+    av_image_fill_linesizes(linesizes, format.pix_fmt, format.width);
+    header.plane_count = av_pix_fmt_count_planes(format.pix_fmt);
+    uint64_t offset = 0;
+    for (int p = 0; p < header.plane_count; p++) {
+        bool chroma = (p == 1 || p == 2);
+        header.strides[p] = linesizes[p];
+        header.plane_heights[p] = chroma ? -((-format.height) >> desc->log2_chroma_h) : format.height;
+        header.plane_offsets[p] = offset;
+        offset += (uint64_t) header.strides[p] * header.plane_heights[p];
+    }
+    header.frame_size = offset;
+}
+
+// 由完整的索引生成文件尾 (时长按PTS范围加一帧计算)
+static FrameCacheFooter make_footer(const FrameCacheHeader &header, const std::vector<FrameCacheIndexEntry> &index,
+                                    uint64_t index_offset) {
+    FrameCacheFooter footer = {};
+    footer.index_offset = index_offset;
+    footer.frame_count = index.size();
+    memcpy(footer.magic, kFrameCacheFooterMagic, sizeof(footer.magic));
+    if (!index.empty()) {
+        AVRational tb = {header.time_base_num, header.time_base_den};
+        AVRational frame_duration = av_inv_q({header.frame_rate_num, header.frame_rate_den});
+        int64_t first = index.front().pts, last = index.back().pts;
+        for (const auto &entry : index) {
+            first = std::min(first, entry.pts);
+            last = std::max(last, entry.pts);
+        }
+        footer.first_pts = first;
+        footer.duration = last - first + av_rescale_q(1, frame_duration, tb);
+    }
+    return footer;
+}
+
+// 帧的PTS和关键帧标志
+static void fill_index_entry(FrameCacheIndexEntry &entry, const AVFrame *frame, uint64_t offset) {
+    entry = {};
+    entry.offset = offset;
+    entry.pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    entry.flags = (frame->key_frame || frame->pict_type == AV_PICTURE_TYPE_I) ? kFrameCacheFrameKey : 0;
+}
+
+static bool frame_matches_header(const AVFrame *frame, const FrameCacheHeader &header) {
+    if (frame->format == header.pix_fmt && frame->width == header.width && frame->height == header.height) return true;
+    LOGW("帧格式与缓存不一致: %dx%d %s", frame->width, frame->height,
+         av_get_pix_fmt_name((AVPixelFormat) frame->format));
+    return false;
+}
+
+// 写满len字节 (pwrite可能只写入一部分)
+static bool pwrite_all(int fd, const uint8_t *data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, (off_t) offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t) n;
+        offset += (uint64_t) n;
+    }
+    return true;
+}
+
+// 按文件头的行跨度把帧的各平面紧密排列到dst
+static void pack_frame(uint8_t *dst, const AVFrame *frame, const FrameCacheHeader &header) {
+    for (int p = 0; p < header.plane_count; p++) {
+        uint8_t *plane = dst + header.plane_offsets[p];
+        for (int row = 0; row < header.plane_heights[p]; row++) {
+            memcpy(plane + (size_t) row * header.strides[p], frame->data[p] + (size_t) row * frame->linesize[p],
+                   header.strides[p]);
+        }
+    }
+}
+
+// --- FrameCacheWriter ---
+
+static const int kWriterChunkCount = 3;                    // 缓冲区数量 (至少双缓冲)
+static const size_t kWriterChunkBytes = 8 * 1024 * 1024;   // 每个缓冲区的目标大小
+static const size_t kWriterChunkAlign = 4096;
+
+// 写合并缓冲区：若干连续帧的数据及其索引项，整体一次写入文件
+struct FrameCacheWriter::Chunk {
+    uint8_t *data = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    uint64_t file_offset = 0;
+    std::vector<FrameCacheIndexEntry> entries;
+
+    ~Chunk() { free(data); }
+};
+
+FrameCacheWriter::FrameCacheWriter(bool async)
+        : async_(async), free_chunks_(kWriterChunkCount), pending_chunks_(kWriterChunkCount + 1) {}
+
+FrameCacheWriter::~FrameCacheWriter() {
+    close();
+}
+
+int FrameCacheWriter::open(const char *path, const FrameCacheFormat &format) {
+    close();
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format.pix_fmt);
+    if (!desc || format.width <= 0 || format.height <= 0) {
+        LOGE("无效的缓存格式: %dx%d pix_fmt=%d", format.width, format.height, format.pix_fmt);
+        return kFrameCacheBadFormat;
+    }
+    fill_header(header_, format);
+    if (header_.frame_size == 0) return kFrameCacheBadFormat;
+
+    path_ = path;
+    fd_ = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    journal_ = fopen(journal_path(path_).c_str(), "wb");
+    if (fd_ < 0 || !journal_) {
+        LOGE("无法创建缓存文件: %s (%s)", path, strerror(errno));
+        close();
+        return kFrameCacheIoError;
+    }
+    // 先写入未完成状态的文件头，并填充到kFrameCacheHeaderSize
+    std::vector<uint8_t> header_block(kFrameCacheHeaderSize, 0);
+    memcpy(header_block.data(), &header_, sizeof(header_));
+    if (!pwrite_all(fd_, header_block.data(), header_block.size(), 0)) {
+        close();
+        return kFrameCacheIoError;
+    }
+    next_offset_ = kFrameCacheHeaderSize;
+    index_.clear();
+    return startIo();
+}
+
+int FrameCacheWriter::resume(const char *path, const FrameCacheFormat &format) {
+    close();
+    if (!av_pix_fmt_desc_get(format.pix_fmt) || format.width <= 0 || format.height <= 0) return kFrameCacheBadFormat;
+    fill_header(header_, format);
+
+    path_ = path;
+    fd_ = ::open(path, O_RDWR | O_CLOEXEC);
+    if (fd_ < 0) return kFrameCacheIoError;
+    FrameCacheHeader existing = {};
+    if (pread(fd_, &existing, sizeof(existing), 0) != (ssize_t) sizeof(existing) ||
+        memcmp(existing.magic, kFrameCacheMagic, sizeof(existing.magic)) != 0 ||
+        existing.version != kFrameCacheVersion || (existing.flags & kFrameCacheFlagComplete) ||
+        existing.width != header_.width || existing.height != header_.height ||
+        existing.pix_fmt != header_.pix_fmt || existing.color_range != header_.color_range || // 旧版按limited写入的不续写
+        existing.frame_size != header_.frame_size || !format.source.sameContent(existing)) {
+        close();
+        return kFrameCacheBadFormat;
+    }
+
+    // 已写入的帧数取日志项数与完整帧数的较小值 (日志只在数据写入后追加，但中断时文件长度可能超前)
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        close();
+        return kFrameCacheIoError;
+    }
+    uint64_t data_bytes = (uint64_t) st.st_size > kFrameCacheHeaderSize ? (uint64_t) st.st_size - kFrameCacheHeaderSize : 0;
+    uint64_t frames_on_disk = data_bytes / header_.frame_size;
+    index_.clear();
+    if (FILE *journal = fopen(journal_path(path_).c_str(), "rb")) {
+        FrameCacheIndexEntry entry;
+        while (index_.size() < frames_on_disk && fread(&entry, sizeof(entry), 1, journal) == 1) {
+            if (entry.offset != kFrameCacheHeaderSize + index_.size() * header_.frame_size ||
+                entry.pts == AV_NOPTS_VALUE) {
+                break; // 日志损坏或无法按PTS续接，之后的帧重新解码
+            }
+            index_.push_back(entry);
+        }
+        fclose(journal);
+    }
+    if (index_.empty()) {
+        close();
+        return kFrameCacheIncomplete;
+    }
+
+    // 截断到最后一个完整帧，之后从此处继续追加
+    next_offset_ = kFrameCacheHeaderSize + index_.size() * header_.frame_size;
+    journal_ = fopen(journal_path(path_).c_str(), "wb");
+    if (!journal_ || ftruncate(fd_, (off_t) next_offset_) != 0 ||
+        fwrite(index_.data(), sizeof(FrameCacheIndexEntry), index_.size(), journal_) != index_.size()) {
+        close();
+        return kFrameCacheIoError;
+    }
+    LOGI("续写缓存文件: 已有 %zu 帧, %s", index_.size(), path);
+    return startIo();
+}
+
+int FrameCacheWriter::startIo() {
+    // 每个缓冲区容纳整数帧，超大帧时每块一帧
+    size_t frames_per_chunk = std::max<size_t>(1, kWriterChunkBytes / header_.frame_size);
+    size_t capacity = frames_per_chunk * header_.frame_size;
+    if (chunks_.empty() || chunks_.front()->capacity != capacity) {
+        chunks_.clear();
+        for (int i = 0; i < kWriterChunkCount; i++) {
+            std::unique_ptr<Chunk> chunk(new Chunk());
+            void *data = nullptr;
+            if (posix_memalign(&data, kWriterChunkAlign, capacity) != 0) {
+                LOGE("分配写入缓冲区失败: %zu 字节", capacity);
+                chunks_.clear();
+                close();
+                return kFrameCacheIoError;
+            }
+            chunk->data = static_cast<uint8_t *>(data);
+            chunk->capacity = capacity;
+            chunk->entries.reserve(frames_per_chunk);
+            chunks_.push_back(std::move(chunk));
+        }
+    }
+    free_chunks_.clear([](Chunk *&) {});
+    pending_chunks_.clear([](Chunk *&) {});
+    for (auto &chunk : chunks_) free_chunks_.push(chunk.get());
+    current_ = nullptr;
+    io_error_ = false;
+    bytes_written_ = 0;
+    chunks_written_ = 0;
+    io_ns_ = 0;
+    stall_ms_ = 0.0;
+    bytes_packed_ = 0;
+    if (async_) io_thread_ = std::thread(&FrameCacheWriter::ioLoop, this);
+    return kFrameCacheOk;
+}
+
+void FrameCacheWriter::stopIo() {
+    submitChunk(); // 已打包的帧也写入文件，便于之后续写
+    if (io_thread_.joinable()) {
+        pending_chunks_.push(nullptr);
+        io_thread_.join();
+    }
+}
+
+void FrameCacheWriter::ioLoop() {
+    Chunk *chunk = nullptr;
+    while (pending_chunks_.pop(chunk) && chunk) {
+        writeChunk(chunk);
+        free_chunks_.push(chunk);
+    }
+}
+
+void FrameCacheWriter::submitChunk() {
+    if (!current_) return;
+    Chunk *chunk = current_;
+    current_ = nullptr;
+    if (chunk->used == 0) {
+        free_chunks_.push(chunk);
+    } else if (io_thread_.joinable()) {
+        pending_chunks_.push(chunk);
+    } else {
+        writeChunk(chunk);
+        free_chunks_.push(chunk);
+    }
+}
+
+// 一次写入整个缓冲区，成功后再把其中各帧的索引项追加到日志
+void FrameCacheWriter::writeChunk(Chunk *chunk) {
+    if (io_error_) return; // 前面的缓冲区已失败，之后的数据不再写入，避免文件中出现空洞
+    auto start_time = std::chrono::steady_clock::now();
+    if (!pwrite_all(fd_, chunk->data, chunk->used, chunk->file_offset)) {
+        LOGE("写入缓存数据失败: %s", strerror(errno));
+        io_error_ = true;
+        return;
+    }
+    if (journal_) {
+        fwrite(chunk->entries.data(), sizeof(FrameCacheIndexEntry), chunk->entries.size(), journal_);
+        fflush(journal_);
+    }
+    bytes_written_ += chunk->used;
+    chunks_written_++;
+    io_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+int FrameCacheWriter::writeFrame(const AVFrame *frame) {
+    if (fd_ < 0) return kFrameCacheIoError;
+    if (io_error_) return kFrameCacheIoError;
+    if (!frame_matches_header(frame, header_)) return kFrameCacheBadFormat;
+    if (!current_) {
+        auto start_time = std::chrono::steady_clock::now();
+        if (!free_chunks_.pop(current_)) return kFrameCacheIoError;
+        stall_ms_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+        current_->used = 0;
+        current_->file_offset = next_offset_;
+        current_->entries.clear();
+    }
+    pack_frame(current_->data + current_->used, frame, header_);
+    current_->used += header_.frame_size;
+    bytes_packed_ += header_.frame_size;
+
+    FrameCacheIndexEntry entry;
+    fill_index_entry(entry, frame, next_offset_);
+    index_.push_back(entry);
+    current_->entries.push_back(entry);
+    next_offset_ += header_.frame_size;
+    if (current_->used + header_.frame_size > current_->capacity) submitChunk();
+    return kFrameCacheOk;
+}
+
+int FrameCacheWriter::finish() {
+    if (fd_ < 0) return kFrameCacheIoError;
+    stopIo();
+    if (io_error_) {
+        close();
+        return kFrameCacheIoError;
+    }
+    FrameCacheFooter footer = make_footer(header_, index_, next_offset_);
+    size_t index_bytes = index_.size() * sizeof(FrameCacheIndexEntry);
+    bool ok = pwrite_all(fd_, reinterpret_cast<const uint8_t *>(index_.data()), index_bytes, next_offset_) &&
+              pwrite_all(fd_, reinterpret_cast<const uint8_t *>(&footer), sizeof(footer), next_offset_ + index_bytes);
+    // 最后更新文件头：只有索引和文件尾完整写入后才标记为完成
+    header_.frame_count = footer.frame_count;
+    header_.index_offset = footer.index_offset;
+    header_.flags |= kFrameCacheFlagComplete;
+    ok = ok && pwrite_all(fd_, reinterpret_cast<const uint8_t *>(&header_), sizeof(header_), 0);
+    if (::close(fd_) != 0) ok = false;
+    fd_ = -1;
+    if (!ok) {
+        LOGE("写入缓存索引失败");
+        close();
+        return kFrameCacheIoError;
+    }
+    if (journal_) {
+        fclose(journal_);
+        journal_ = nullptr;
+    }
+    unlink(journal_path(path_).c_str()); // 缓存已完整，不再需要续写日志
+    Stats s = stats();
+    LOGI("缓存文件已完成: %zu 帧, %ld 次写入, I/O %.1f ms, 等待缓冲区 %.1f ms", index_.size(), s.chunks_written,
+         s.io_ms, s.stall_ms);
+    return kFrameCacheOk;
+}
+
+void FrameCacheWriter::close() {
+    if (fd_ >= 0) stopIo();
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (journal_) {
+        fclose(journal_);
+        journal_ = nullptr;
+    }
+}
+
+FrameCacheWriter::Stats FrameCacheWriter::stats() const {
+    Stats s;
+    s.bytes_written = bytes_written_.load();
+    s.bytes_copied = bytes_packed_ + s.bytes_written;
+    s.chunks_written = chunks_written_.load();
+    s.io_ms = io_ns_.load() / 1e6;
+    s.stall_ms = stall_ms_;
+    return s;
+}
+
+// --- FrameCacheSlotWriter ---
+
+FrameCacheSlotWriter::~FrameCacheSlotWriter() {
+    close();
+}
+
+int FrameCacheSlotWriter::open(const char *path, const FrameCacheFormat &format, long frame_count) {
+    close();
+    if (!av_pix_fmt_desc_get(format.pix_fmt) || format.width <= 0 || format.height <= 0 || frame_count <= 0) {
+        return kFrameCacheBadFormat;
+    }
+    fill_header(header_, format);
+    fd_ = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        LOGE("无法创建缓存文件: %s (%s)", path, strerror(errno));
+        return kFrameCacheIoError;
+    }
+    unlink(journal_path(path).c_str()); // 随机写入不支持续写，删除可能残留的日志
+    std::vector<uint8_t> header_block(kFrameCacheHeaderSize, 0);
+    memcpy(header_block.data(), &header_, sizeof(header_));
+    uint64_t data_end = kFrameCacheHeaderSize + (uint64_t) frame_count * header_.frame_size;
+    if (!pwrite_all(fd_, header_block.data(), header_block.size(), 0) || ftruncate(fd_, (off_t) data_end) != 0) {
+        close();
+        return kFrameCacheIoError;
+    }
+    index_.assign(frame_count, FrameCacheIndexEntry());
+    written_.assign(frame_count, 0);
+    frames_written_ = 0;
+    bytes_copied_ = 0;
+    return kFrameCacheOk;
+}
+
+int FrameCacheSlotWriter::writeFrameAt(long index, const AVFrame *frame) {
+    if (fd_ < 0 || index < 0 || index >= (long) index_.size()) return kFrameCacheIoError;
+    if (!frame_matches_header(frame, header_)) return kFrameCacheBadFormat;
+    // 先在线程本地缓冲区中紧密排列各平面，再一次pwrite写入整帧
+    thread_local std::vector<uint8_t> packed;
+    packed.resize(header_.frame_size);
+    pack_frame(packed.data(), frame, header_);
+    uint64_t offset = kFrameCacheHeaderSize + (uint64_t) index * header_.frame_size;
+    if (!pwrite_all(fd_, packed.data(), packed.size(), offset)) return kFrameCacheIoError;
+    bytes_copied_ += 2 * packed.size();
+    fill_index_entry(index_[index], frame, offset);
+    if (!written_[index]) {
+        written_[index] = 1;
+        frames_written_++;
+    }
+    return kFrameCacheOk;
+}
+
+int FrameCacheSlotWriter::finish() {
+    if (fd_ < 0) return kFrameCacheIoError;
+    if (frames_written_.load() != (long) index_.size()) {
+        LOGW("缓存文件缺少 %ld 帧", (long) index_.size() - frames_written_.load());
+        return kFrameCacheIncomplete;
+    }
+    uint64_t index_offset = kFrameCacheHeaderSize + index_.size() * header_.frame_size;
+    FrameCacheFooter footer = make_footer(header_, index_, index_offset);
+    header_.frame_count = footer.frame_count;
+    header_.index_offset = footer.index_offset;
+    header_.flags |= kFrameCacheFlagComplete;
+    size_t index_bytes = index_.size() * sizeof(FrameCacheIndexEntry);
+    bool ok = pwrite_all(fd_, reinterpret_cast<const uint8_t *>(index_.data()), index_bytes, index_offset) &&
+              pwrite_all(fd_, reinterpret_cast<const uint8_t *>(&footer), sizeof(footer), index_offset + index_bytes) &&
+              pwrite_all(fd_, reinterpret_cast<const uint8_t *>(&header_), sizeof(header_), 0);
+    if (::close(fd_) != 0) ok = false;
+    fd_ = -1;
+    if (!ok) {
+        LOGE("写入缓存索引失败");
+        return kFrameCacheIoError;
+    }
+    LOGI("缓存文件已完成: %zu 帧 (随机写入)", index_.size());
+    return kFrameCacheOk;
+}
+
+void FrameCacheSlotWriter::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+// --- FrameCacheDirectWriter ---
+
+static const long kDirectGrowSlots = 16;     // 文件每次扩展的帧槽数 (访问映射中超出文件末尾的页会触发SIGBUS)
+static const size_t kDirectTailPadding = 64 + 16; // 帧槽末尾的额外空间：解码器的SIMD代码可能越过最后一行读写
+static const size_t kDirectSlotAlign = 4096;  // 帧槽大小按页对齐 (与文件头大小一致)
+
+// 一个已映射的帧槽，由帧缓冲区的引用计数持有
+struct FrameCacheDirectWriter::Slot {
+    uint8_t *map_base;
+    size_t map_length;
+    uint64_t offset;               // 帧槽在文件中的偏移
+    uint8_t *data;                 // 帧槽起始地址 (映射按页对齐，帧槽相对映射起点可能有偏移)
+};
+
+FrameCacheDirectWriter::FrameCacheDirectWriter() {
+    long page = sysconf(_SC_PAGESIZE);
+    if (page > 0) page_size_ = (size_t) page;
+}
+
+FrameCacheDirectWriter::~FrameCacheDirectWriter() {
+    close();
+}
+
+bool FrameCacheDirectWriter::supports(const AVCodecContext *codec_ctx) {
+    return codec_ctx->codec && (codec_ctx->codec->capabilities & AV_CODEC_CAP_DR1) && !codec_ctx->hw_frames_ctx &&
+           codec_ctx->pix_fmt == AV_PIX_FMT_YUV420P; // 任意范围 (范围记录在文件头中)
+}
+
+void FrameCacheDirectWriter::attach(AVCodecContext *codec_ctx) {
+    codec_ctx->opaque = this;
+    codec_ctx->get_buffer2 = &FrameCacheDirectWriter::getBuffer2;
+#if FF_API_THREAD_SAFE_CALLBACKS
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    codec_ctx->thread_safe_callbacks = 1; // 回调内部已加锁，帧线程可直接调用
+#pragma GCC diagnostic pop
+#endif
+}
+
+int FrameCacheDirectWriter::open(const char *path, const FrameCacheFormat &format, const AVCodecContext *codec_ctx,
+                                 long frame_count) {
+    close();
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format.pix_fmt);
+    if (!desc || format.width <= 0 || format.height <= 0 || format.pix_fmt != codec_ctx->pix_fmt) {
+        return kFrameCacheBadFormat;
+    }
+    fill_header(header_, format);
+
+    // 帧槽按解码器对齐后的尺寸布局：行跨度按64字节对齐，行数包含解码器需要的额外行
+    int width = std::max(format.width, codec_ctx->coded_width);
+    int height = std::max(format.height, codec_ctx->coded_height);
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(const_cast<AVCodecContext *>(codec_ctx), &width, &height, linesize_align);
+    int linesizes[4] = {0};
+    if (av_image_fill_linesizes(linesizes, format.pix_fmt, width) < 0) return kFrameCacheBadFormat;
+    uint64_t offset = 0;
+    for (int p = 0; p < header_.plane_count; p++) {
+        bool chroma = (p == 1 || p == 2);
+        header_.strides[p] = FFALIGN(linesizes[p], 64);
+        header_.plane_heights[p] = chroma ? -((-height) >> desc->log2_chroma_h) : height;
+        header_.plane_offsets[p] = offset;
+        offset += (uint64_t) header_.strides[p] * header_.plane_heights[p];
+    }
+    header_.frame_size = FFALIGN(offset + kDirectTailPadding, kDirectSlotAlign);
+
+    fd_ = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        LOGE("无法创建缓存文件: %s (%s)", path, strerror(errno));
+        return kFrameCacheIoError;
+    }
+    path_ = path;
+    unlink(journal_path(path).c_str()); // 直接写入不支持续写，删除可能残留的日志
+    std::vector<uint8_t> header_block(kFrameCacheHeaderSize, 0);
+    memcpy(header_block.data(), &header_, sizeof(header_));
+    if (!pwrite_all(fd_, header_block.data(), header_block.size(), 0)) {
+        close();
+        return kFrameCacheIoError;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    by_index_ = frame_count > 0;
+    index_.assign(by_index_ ? frame_count : 0, FrameCacheIndexEntry());
+    written_.assign(index_.size(), 0);
+    frames_written_ = 0;
+    next_slot_ = 0;
+    file_size_ = kFrameCacheHeaderSize;
+    stats_ = Stats();
+    LOGI("零拷贝缓存: 帧槽 %dx%d (可见 %dx%d), 每帧 %llu 字节", header_.strides[0], header_.plane_heights[0],
+         format.width, format.height, (unsigned long long) header_.frame_size);
+    return kFrameCacheOk;
+}
+
+// 分配并映射下一个帧槽，需持有mutex_
+FrameCacheDirectWriter::Slot *FrameCacheDirectWriter::mapSlot() {
+    uint64_t offset = kFrameCacheHeaderSize + (uint64_t) next_slot_ * header_.frame_size;
+    uint64_t end = offset + header_.frame_size;
+    if (end > file_size_) {
+        uint64_t size = offset + kDirectGrowSlots * header_.frame_size;
+        if (ftruncate(fd_, (off_t) size) != 0) {
+            LOGE("扩展缓存文件失败: %s", strerror(errno));
+            return nullptr;
+        }
+        file_size_ = size;
+    }
+    uint64_t map_offset = offset & ~(uint64_t) (page_size_ - 1); // 页大小可能大于文件头
+    size_t length = (size_t) (end - map_offset);
+    void *addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, (off_t) map_offset);
+    if (addr == MAP_FAILED) {
+        LOGE("映射帧槽失败: %s", strerror(errno));
+        return nullptr;
+    }
+    next_slot_++;
+    stats_.slots++;
+    uint8_t *base = static_cast<uint8_t *>(addr);
+    return new Slot{base, length, offset, base + (offset - map_offset)};
+}
+
+void FrameCacheDirectWriter::releaseSlot(void *opaque, uint8_t *) {
+    Slot *slot = static_cast<Slot *>(opaque);
+    munmap(slot->map_base, slot->map_length); // 已写入的数据留在页缓存中，由内核写回文件
+    delete slot;
+}
+
+int FrameCacheDirectWriter::getBuffer2(AVCodecContext *codec_ctx, AVFrame *frame, int flags) {
+    FrameCacheDirectWriter *self = static_cast<FrameCacheDirectWriter *>(codec_ctx->opaque);
+    int width = frame->width, height = frame->height;
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(codec_ctx, &width, &height, linesize_align);
+    int linesizes[4] = {0};
+    bool fits = supports(codec_ctx) && frame->format == codec_ctx->pix_fmt &&
+                av_image_fill_linesizes(linesizes, (AVPixelFormat) frame->format, width) >= 0;
+
+    Slot *slot = nullptr;
+    FrameCacheHeader header;
+    {
+        std::lock_guard<std::mutex> lock(self->mutex_);
+        header = self->header_;
+        fits = fits && self->fd_ >= 0 && frame->format == header.pix_fmt && height <= header.plane_heights[0];
+        for (int p = 0; fits && p < header.plane_count; p++) fits = linesizes[p] <= header.strides[p];
+        if (fits) slot = self->mapSlot();
+    }
+    if (!slot) return avcodec_default_get_buffer2(codec_ctx, frame, flags); // 尺寸超出帧槽等情况，输出时再拷贝
+
+    frame->buf[0] = av_buffer_create(slot->data, (int) header.frame_size, &FrameCacheDirectWriter::releaseSlot, slot, 0);
+    if (!frame->buf[0]) {
+        releaseSlot(slot, nullptr);
+        return AVERROR(ENOMEM);
+    }
+    for (int p = 0; p < header.plane_count; p++) {
+        frame->data[p] = slot->data + header.plane_offsets[p];
+        frame->linesize[p] = header.strides[p];
+    }
+    frame->extended_data = frame->data;
+    frame->opaque = slot; // 输出时据此确认帧数据就在帧槽中
+    return 0;
+}
+
+// 确定帧在文件中的位置：解码在帧槽中的帧直接使用该槽，否则拷贝可见部分到新的帧槽
+int FrameCacheDirectWriter::placeFrame(const AVFrame *frame, uint64_t *offset) {
+    if (!frame_matches_header(frame, header_)) return kFrameCacheBadFormat;
+    const Slot *slot = static_cast<const Slot *>(frame->opaque);
+    bool direct = slot && frame->buf[0] && av_buffer_get_opaque(frame->buf[0]) == slot;
+    for (int p = 0; direct && p < header_.plane_count; p++) {
+        direct = frame->data[p] == slot->data + header_.plane_offsets[p] && frame->linesize[p] == header_.strides[p];
+    }
+    if (direct) {
+        *offset = slot->offset;
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.direct_frames++;
+        return kFrameCacheOk;
+    }
+
+    Slot *copy;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        copy = fd_ >= 0 ? mapSlot() : nullptr;
+    }
+    if (!copy) return kFrameCacheIoError;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat) header_.pix_fmt);
+    int visible[4] = {0};
+    av_image_fill_linesizes(visible, (AVPixelFormat) header_.pix_fmt, header_.width);
+    uint64_t copied = 0;
+    for (int p = 0; p < header_.plane_count; p++) {
+        bool chroma = (p == 1 || p == 2);
+        int rows = chroma ? -((-header_.height) >> desc->log2_chroma_h) : header_.height;
+        av_image_copy_plane(copy->data + header_.plane_offsets[p], header_.strides[p], frame->data[p],
+                            frame->linesize[p], visible[p], rows);
+        copied += (uint64_t) visible[p] * rows;
+    }
+    *offset = copy->offset;
+    releaseSlot(copy, nullptr);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.copied_frames++;
+    stats_.bytes_copied += copied;
+    return kFrameCacheOk;
+}
+
+int FrameCacheDirectWriter::writeFrame(const AVFrame *frame) {
+    if (fd_ < 0 || by_index_) return kFrameCacheIoError;
+    uint64_t offset = 0;
+    int ret = placeFrame(frame, &offset);
+    if (ret != kFrameCacheOk) return ret;
+    FrameCacheIndexEntry entry;
+    fill_index_entry(entry, frame, offset);
+    index_.push_back(entry);
+    return kFrameCacheOk;
+}
+
+int FrameCacheDirectWriter::writeFrameAt(long index, const AVFrame *frame) {
+    if (fd_ < 0 || !by_index_ || index < 0 || index >= (long) index_.size()) return kFrameCacheIoError;
+    uint64_t offset = 0;
+    int ret = placeFrame(frame, &offset);
+    if (ret != kFrameCacheOk) return ret;
+    fill_index_entry(index_[index], frame, offset);
+    if (!written_[index]) {
+        written_[index] = 1;
+        frames_written_++;
+    }
+    return kFrameCacheOk;
+}
+
+int FrameCacheDirectWriter::finish() {
+    if (fd_ < 0) return kFrameCacheIoError;
+    if (by_index_ && frames_written_.load() != (long) index_.size()) {
+        LOGW("缓存文件缺少 %ld 帧", (long) index_.size() - frames_written_.load());
+        return kFrameCacheIncomplete;
+    }
+    int fd;
+    uint64_t index_offset;
+    {
+        // 之后解码器的缓冲区申请改用默认分配，索引紧跟在最后一个已分配的帧槽之后
+        std::lock_guard<std::mutex> lock(mutex_);
+        fd = fd_;
+        fd_ = -1;
+        index_offset = kFrameCacheHeaderSize + (uint64_t) next_slot_ * header_.frame_size;
+    }
+    FrameCacheFooter footer = make_footer(header_, index_, index_offset);
+    header_.frame_count = footer.frame_count;
+    header_.index_offset = footer.index_offset;
+    header_.flags |= kFrameCacheFlagComplete;
+    size_t index_bytes = index_.size() * sizeof(FrameCacheIndexEntry);
+    bool ok = ftruncate(fd, (off_t) (index_offset + index_bytes + sizeof(footer))) == 0 && // 去掉预先扩展的部分
+              pwrite_all(fd, reinterpret_cast<const uint8_t *>(index_.data()), index_bytes, index_offset) &&
+              pwrite_all(fd, reinterpret_cast<const uint8_t *>(&footer), sizeof(footer), index_offset + index_bytes) &&
+              pwrite_all(fd, reinterpret_cast<const uint8_t *>(&header_), sizeof(header_), 0);
+    if (::close(fd) != 0) ok = false;
+    if (!ok) {
+        LOGE("写入缓存索引失败");
+        return kFrameCacheIoError;
+    }
+    Stats s = stats();
+    LOGI("缓存文件已完成: %zu 帧 (零拷贝 %ld 帧, 拷贝 %ld 帧, 帧槽 %ld 个)", index_.size(), s.direct_frames,
+         s.copied_frames, s.slots);
+    return kFrameCacheOk;
+}
+
+void FrameCacheDirectWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ >= 0) { // 已映射的帧槽在缓冲区释放时解除映射，不依赖文件描述符
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+FrameCacheDirectWriter::Stats FrameCacheDirectWriter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// --- FrameCacheReader ---
+
+FrameCacheReader::FrameCacheReader() {
+    long page = sysconf(_SC_PAGESIZE);
+    if (page > 0) page_size_ = (size_t) page;
+}
+
+FrameCacheReader::~FrameCacheReader() {
+    close();
+}
+
+int FrameCacheReader::open(const char *path, const FrameCacheSourceKey *source) {
+    close();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("打开缓存文件失败: %s (%s)", path, strerror(errno));
+        return kFrameCacheIoError;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) (kFrameCacheHeaderSize + sizeof(FrameCacheFooter))) {
+        ::close(fd);
+        LOGW("缓存文件过小或不是缓存格式: %s", path);
+        return kFrameCacheBadFormat;
+    }
+    length_ = (size_t) st.st_size;
+    // 播放基本是顺序读取，提示内核加大预读窗口
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    void *addr = mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // 映射建立后即可关闭文件描述符
+    if (addr == MAP_FAILED) {
+        LOGE("mmap缓存文件失败: %s (%s)", path, strerror(errno));
+        length_ = 0;
+        return kFrameCacheIoError;
+    }
+    base_ = static_cast<uint8_t *>(addr);
+
+    memcpy(&header_, base_, sizeof(header_));
+    if (memcmp(header_.magic, kFrameCacheMagic, sizeof(header_.magic)) != 0 ||
+        header_.version != kFrameCacheVersion || header_.header_size != kFrameCacheHeaderSize ||
+        header_.width <= 0 || header_.height <= 0 || header_.frame_size == 0) {
+        LOGW("缓存文件格式或版本不兼容: %s", path);
+        close();
+        return kFrameCacheBadFormat;
+    }
+    if (!(header_.flags & kFrameCacheFlagComplete)) {
+        LOGW("缓存文件未完成 (解码被中断): %s", path);
+        close();
+        return kFrameCacheIncomplete;
+    }
+    footer_ = reinterpret_cast<const FrameCacheFooter *>(base_ + length_ - sizeof(FrameCacheFooter));
+    uint64_t index_bytes = footer_->frame_count * sizeof(FrameCacheIndexEntry);
+    if (memcmp(footer_->magic, kFrameCacheFooterMagic, sizeof(footer_->magic)) != 0 ||
+        footer_->frame_count != header_.frame_count || footer_->index_offset != header_.index_offset ||
+        footer_->index_offset + index_bytes + sizeof(FrameCacheFooter) != length_) {
+        LOGW("缓存文件索引损坏: %s", path);
+        close();
+        return kFrameCacheBadFormat;
+    }
+    index_ = reinterpret_cast<const FrameCacheIndexEntry *>(base_ + footer_->index_offset);
+    frame_count_ = (long) footer_->frame_count;
+    for (long i = 0; i < frame_count_; i++) {
+        if (index_[i].offset < kFrameCacheHeaderSize || index_[i].offset + header_.frame_size > footer_->index_offset) {
+            LOGW("缓存文件帧 %ld 偏移越界: %s", i, path);
+            close();
+            return kFrameCacheBadFormat;
+        }
+    }
+
+    if (source) { // 源文件内容变化即视为过期；仅修改时间变化 (如重新拷贝) 时缓存仍可用
+        if (!source->sameContent(header_)) {
+            LOGW("缓存文件已过期 (源文件已变化): %s", path);
+            close();
+            return kFrameCacheStale;
+        }
+        if (source->mtime_ns != header_.source_mtime_ns) {
+            LOGI("源文件修改时间已变化但内容一致，继续使用缓存: %s", path);
+        }
+    }
+    LOGI("缓存文件已映射: %dx%d %s, %ld 帧, %.1f ms", header_.width, header_.height,
+         av_get_pix_fmt_name((AVPixelFormat) header_.pix_fmt), frame_count_, durationMs());
+    return kFrameCacheOk;
+}
+
+void FrameCacheReader::close() {
+    if (base_) {
+        munmap(base_, length_);
+        base_ = nullptr;
+    }
+    length_ = 0;
+    index_ = nullptr;
+    footer_ = nullptr;
+    frame_count_ = 0;
+}
+
+double FrameCacheReader::frameRate() const {
+    if (header_.frame_rate_num <= 0 || header_.frame_rate_den <= 0) return 25.0;
+    return (double) header_.frame_rate_num / header_.frame_rate_den;
+}
+
+const uint8_t *FrameCacheReader::plane(long index, int plane) const {
+    if (!base_ || index < 0 || index >= frame_count_ || plane < 0 || plane >= header_.plane_count) return nullptr;
+    return base_ + index_[index].offset + header_.plane_offsets[plane];
+}
+
+int64_t FrameCacheReader::framePts(long index) const {
+    if (!index_ || index < 0 || index >= frame_count_) return AV_NOPTS_VALUE;
+    return index_[index].pts;
+}
+
+bool FrameCacheReader::isKeyframe(long index) const {
+    if (!index_ || index < 0 || index >= frame_count_) return false;
+    return (index_[index].flags & kFrameCacheFrameKey) != 0;
+}
+
+double FrameCacheReader::frameTimeMs(long index) const {
+    int64_t pts = framePts(index);
+    if (pts == AV_NOPTS_VALUE || !footer_ || header_.time_base_den == 0) return index * 1000.0 / frameRate();
+    return (pts - footer_->first_pts) * 1000.0 * header_.time_base_num / header_.time_base_den;
+}
+
+double FrameCacheReader::durationMs() const {
+    if (!footer_ || header_.time_base_den == 0) return 0.0;
+    return footer_->duration * 1000.0 * header_.time_base_num / header_.time_base_den;
+}
+
+long FrameCacheReader::frameForTimeMs(double time_ms) const {
+    if (frame_count_ <= 0) return 0;
+    long index = (long) llround(time_ms / 1000.0 * frameRate());
+    return std::max(0L, std::min(index, frame_count_ - 1));
+}
+
+void FrameCacheReader::prefetch(long index, int count) const {
+    if (!base_ || index < 0 || index >= frame_count_ || count <= 0) return;
+    long last = std::min<long>(index + count, frame_count_) - 1;
+    size_t begin = index_[index].offset;
+    size_t end = index_[last].offset + header_.frame_size;
+    if (end > begin && end - begin == (size_t) (last - index + 1) * header_.frame_size) { // 连续存放时一次预读
+        begin &= ~(page_size_ - 1); // madvise要求起始地址按页对齐
+        madvise(base_ + begin, end - begin, MADV_WILLNEED);
+        return;
+    }
+    for (long i = index; i <= last; i++) { // 帧在文件中按解码顺序存放 (零拷贝写入) 时逐帧预读
+        size_t frame_begin = index_[i].offset & ~(page_size_ - 1);
+        madvise(base_ + frame_begin, index_[i].offset + header_.frame_size - frame_begin, MADV_WILLNEED);
+    }
+}
@@ -0,0 +1,129 @@
+#include "FrameNormalizer.h"
+#include <string.h>
+#include <utility>
+#include "FramePool.h"
+#include "android/log.h"
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+#define LOG_TAG "FrameNormalizer"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+static const AVPixelFormat kTargetFormat = AV_PIX_FMT_YUV420P;
+
+static bool is_full_range(AVPixelFormat format, AVColorRange range) {
+    return range == AVCOL_RANGE_JPEG || format == AV_PIX_FMT_YUVJ420P || format == AV_PIX_FMT_YUVJ422P ||
+           format == AV_PIX_FMT_YUVJ444P || format == AV_PIX_FMT_YUVJ440P || format == AV_PIX_FMT_YUVJ411P;
+}
+
+// 拷贝一个平面
+static void copy_plane(uint8_t *dst, int dst_stride, const uint8_t *src, int src_stride, int width, int height) {
+    for (int y = 0; y < height; y++) {
+        memcpy(dst + (size_t) y * dst_stride, src + (size_t) y * src_stride, width);
+    }
+}
+
+// NV12/NV21的交错色度平面拆分为U、V两个平面 (循环可被编译器自动向量化)
+static void deinterleave_uv(const uint8_t *src, int src_stride, uint8_t *u, int u_stride, uint8_t *v, int v_stride,
+                            int width, int height) {
+    for (int y = 0; y < height; y++) {
+        const uint8_t *s = src + (size_t) y * src_stride;
+        uint8_t *du = u + (size_t) y * u_stride;
+        uint8_t *dv = v + (size_t) y * v_stride;
+        for (int x = 0; x < width; x++) {
+            du[x] = s[2 * x];
+            dv[x] = s[2 * x + 1];
+        }
+    }
+}
+
+FrameNormalizer::FrameNormalizer() = default;
+
+FrameNormalizer::~FrameNormalizer() {
+    if (sws_) sws_freeContext(sws_);
+    av_frame_free(&out_);
+}
+
+bool FrameNormalizer::isNative(const AVFrame *frame) {
+    return pathFor((AVPixelFormat) frame->format) == Path::Passthrough;
+}
+
+FrameNormalizer::Path FrameNormalizer::pathFor(AVPixelFormat format) {
+    if (format == kTargetFormat || format == AV_PIX_FMT_YUVJ420P) return Path::Passthrough;
+    if (format == AV_PIX_FMT_NV12 || format == AV_PIX_FMT_NV21) return Path::FastPath;
+    return Path::Swscale;
+}
+
+AVColorRange FrameNormalizer::outputRange(AVPixelFormat format, AVColorRange range) {
+    if (pathFor(format) == Path::Swscale) return AVCOL_RANGE_MPEG;
+    return is_full_range(format, range) ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+}
+
+const char *FrameNormalizer::pathName(Path path) {
+    switch (path) {
+        case Path::Passthrough: return "直通";
+        case Path::FastPath: return "快速路径";
+        case Path::Swscale: return "swscale";
+    }
+    return "unknown";
+}
+
+const AVFrame *FrameNormalizer::normalize(const AVFrame *src) {
+    if (isNative(src)) return src;
+    if (!out_) out_ = av_frame_alloc();
+    if (!out_) return nullptr;
+    if (out_->width != src->width || out_->height != src->height || !out_->data[0]) { // 尺寸变化时重新分配
+        av_frame_unref(out_);
+        out_->format = kTargetFormat;
+        out_->width = src->width;
+        out_->height = src->height;
+        if (av_frame_get_buffer(out_, 64) < 0) return nullptr;
+    }
+    return convertInto(src, out_) == 0 ? out_ : nullptr;
+}
+
+int FrameNormalizer::convert(const AVFrame *src, AVFrame *dst, FramePool *pool) {
+    dst->format = isNative(src) ? src->format : kTargetFormat; // yuvj420p原样拷贝 (av_frame_copy要求格式相同)
+    dst->width = src->width;
+    dst->height = src->height;
+    if ((pool ? pool->getBuffer(dst) : av_frame_get_buffer(dst, 64)) < 0) return -1;
+    if (isNative(src)) return av_frame_copy(dst, src) < 0 || av_frame_copy_props(dst, src) < 0 ? -1 : 0;
+    return convertInto(src, dst);
+}
+
+int FrameNormalizer::convertInto(const AVFrame *src, AVFrame *dst) {
+    AVPixelFormat format = (AVPixelFormat) src->format;
+    int width = src->width, height = src->height;
+    int chroma_width = (width + 1) / 2, chroma_height = (height + 1) / 2;
+
+    if (pathFor(format) == Path::FastPath) { // 保持源范围，由转换器按范围选择系数
+        copy_plane(dst->data[0], dst->linesize[0], src->data[0], src->linesize[0], width, height);
+        uint8_t *u = dst->data[1], *v = dst->data[2];
+        if (format == AV_PIX_FMT_NV21) std::swap(u, v);
+        deinterleave_uv(src->data[1], src->linesize[1], u, dst->linesize[1], v, dst->linesize[2],
+                        chroma_width, chroma_height);
+    } else {
+        bool full = is_full_range(format, src->color_range);
+        sws_ = sws_getCachedContext(sws_, width, height, format, width, height, kTargetFormat, SWS_BILINEAR,
+                                    nullptr, nullptr, nullptr);
+        if (!sws_) {
+            LOGE("不支持的像素格式: %s", av_get_pix_fmt_name(format));
+            return -1;
+        }
+        // 输入范围取决于帧的标记，输出固定为limited range
+        int *inv_table = nullptr, *table = nullptr;
+        int src_range = 0, dst_range = 0, brightness = 0, contrast = 0, saturation = 0;
+        if (sws_getColorspaceDetails(sws_, &inv_table, &src_range, &table, &dst_range, &brightness, &contrast,
+                                     &saturation) >= 0 && (src_range != (int) full || dst_range != 0)) {
+            sws_setColorspaceDetails(sws_, inv_table, full, table, 0, brightness, contrast, saturation);
+        }
+        sws_scale(sws_, src->data, src->linesize, 0, height, dst->data, dst->linesize);
+    }
+    av_frame_copy_props(dst, src);
+    dst->color_range = outputRange(format, src->color_range);
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "FramePool.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "android/log.h"
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#define LOG_TAG "FramePool"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+static const int kAlignment = 64;          // 缓冲区起始地址和行跨度的对齐字节数 (一条缓存行，满足所有SIMD宽度)
+static const size_t kTailPadding = 64 + 16; // 末尾额外空间：解码器和SIMD转换可能越过最后一行读写
+static const size_t kMaxEntries = 4;       // 同时保留的格式/尺寸组数 (解码输出和格式转换输出各占一组)
+static const size_t kMaxFreeFrames = 32;   // 最多缓存的空闲AVFrame数 (帧队列 + 渲染中的帧)
+
+FramePool::FramePool() {
+    entries_.reserve(kMaxEntries);
+    free_frames_.reserve(kMaxFreeFrames);
+}
+
+FramePool::~FramePool() {
+    for (Entry &entry : entries_) av_buffer_pool_uninit(&entry.pool); // 在外的缓冲区归还时直接释放
+    for (AVFrame *frame : free_frames_) av_frame_free(&frame);
+}
+
+void FramePool::attach(AVCodecContext *codec_ctx) {
+    codec_ctx->opaque = this;
+    codec_ctx->get_buffer2 = &FramePool::getBuffer2;
+#if FF_API_THREAD_SAFE_CALLBACKS
+    // FFmpeg 4.x中自定义回调默认被认为不可重入，帧线程的每次分配都要转交给用户线程执行；回调内部已加锁
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    codec_ctx->thread_safe_callbacks = 1;
+#pragma GCC diagnostic pop
+#endif
+}
+
+int FramePool::getBuffer2(AVCodecContext *codec_ctx, AVFrame *frame, int flags) {
+    FramePool *self = (FramePool *) codec_ctx->opaque;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat) frame->format);
+    bool supported = self && desc && codec_ctx->codec_type == AVMEDIA_TYPE_VIDEO && !codec_ctx->hw_frames_ctx &&
+                     (codec_ctx->codec->capabilities & AV_CODEC_CAP_DR1) &&
+                     !(desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM));
+    if (!supported) {
+        if (self) {
+            std::lock_guard<std::mutex> lock(self->mutex_);
+            self->stats_.fallback_buffers++;
+        }
+        return avcodec_default_get_buffer2(codec_ctx, frame, flags);
+    }
+    // 按解码器的要求对齐宽高 (宏块边界和运动补偿越界读取所需的额外行)
+    int width = frame->width, height = frame->height;
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(codec_ctx, &width, &height, linesize_align);
+    return self->fillFrame(frame, width, height);
+}
+
+int FramePool::getBuffer(AVFrame *frame) {
+    if (frame->width <= 0 || frame->height <= 0) return AVERROR(EINVAL);
+    return fillFrame(frame, frame->width, frame->height);
+}
+
+#if FF_API_BUFFER_SIZE_T
+AVBufferRef *FramePool::allocBuffer(void *opaque, int size) {
+#else
+AVBufferRef *FramePool::allocBuffer(void *opaque, size_t size) {
+#endif
+    void *data = nullptr;
+    if (posix_memalign(&data, kAlignment, size) != 0) return nullptr;
+    AVBufferRef *buf = av_buffer_create((uint8_t *) data, size, [](void *, uint8_t *ptr) { free(ptr); }, nullptr, 0);
+    if (!buf) {
+        free(data);
+        return nullptr;
+    }
+    // 只在fillFrame持有mutex_时由av_buffer_pool_get同步调用
+    FramePool *self = (FramePool *) opaque;
+    self->stats_.buffer_allocs++;
+    self->stats_.allocated_bytes += size;
+    return buf;
+}
+
+FramePool::Entry *FramePool::findOrCreate(int format, int width, int height) {
+    for (size_t i = 0; i < entries_.size(); i++) {
+        Entry &entry = entries_[i];
+        if (entry.format == format && entry.width == width && entry.height == height) {
+            std::rotate(entries_.begin(), entries_.begin() + i, entries_.begin() + i + 1);
+            return &entries_[0];
+        }
+    }
+
+    Entry entry = {format, width, height, {0, 0, 0, 0}, {0, 0, 0, 0}, 0, nullptr};
+    if (av_image_fill_linesizes(entry.linesize, (AVPixelFormat) format, width) < 0) return nullptr;
+    ptrdiff_t linesizes[4];
+    for (int i = 0; i < 4; i++) {
+        entry.linesize[i] = FFALIGN(entry.linesize[i], kAlignment);
+        linesizes[i] = entry.linesize[i];
+    }
+    size_t plane_sizes[4];
+    if (av_image_fill_plane_sizes(plane_sizes, (AVPixelFormat) format, height, linesizes) < 0) return nullptr;
+    for (int i = 0; i < 4; i++) { // 行跨度是64的倍数，各平面的起始偏移也都对齐
+        entry.offset[i] = entry.size;
+        entry.size += plane_sizes[i];
+    }
+    entry.size += kTailPadding;
+    if (entry.size > (size_t) INT_MAX) return nullptr;
+    entry.pool = av_buffer_pool_init2(entry.size, this, &FramePool::allocBuffer, nullptr);
+    if (!entry.pool) return nullptr;
+
+    if (entries_.size() >= kMaxEntries) { // 淘汰最久未用的一组，其在外的缓冲区归还时释放
+        av_buffer_pool_uninit(&entries_.back().pool);
+        entries_.pop_back();
+    }
+    entries_.insert(entries_.begin(), entry);
+    LOGI("新的缓冲区组: %s %dx%d, 每帧 %zu 字节", av_get_pix_fmt_name((AVPixelFormat) format), width, height,
+         entry.size);
+    return &entries_[0];
+}
+
+int FramePool::fillFrame(AVFrame *frame, int width, int height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry *entry = findOrCreate(frame->format, width, height);
+    if (!entry) {
+        LOGE("不支持的帧格式: %d %dx%d", frame->format, width, height);
+        return AVERROR(EINVAL);
+    }
+    long allocs = stats_.buffer_allocs;
+    AVBufferRef *buf = av_buffer_pool_get(entry->pool);
+    if (!buf) return AVERROR(ENOMEM);
+    if (stats_.buffer_allocs == allocs) stats_.buffer_reuses++;
+
+    frame->buf[0] = buf;
+    for (int i = 0; i < 4; i++) {
+        frame->data[i] = entry->linesize[i] ? buf->data + entry->offset[i] : nullptr;
+        frame->linesize[i] = entry->linesize[i];
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+AVFrame *FramePool::acquireFrame() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_frames_.empty()) {
+            AVFrame *frame = free_frames_.back();
+            free_frames_.pop_back();
+            stats_.frame_reuses++;
+            return frame;
+        }
+        stats_.frame_allocs++;
+    }
+    return av_frame_alloc();
+}
+
+void FramePool::releaseFrame(AVFrame **frame) {
+    if (!frame || !*frame) return;
+    av_frame_unref(*frame); // 缓冲区引用计数减一，最后一个引用释放时回到池中
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_frames_.size() < kMaxFreeFrames) {
+            free_frames_.push_back(*frame);
+            *frame = nullptr;
+            return;
+        }
+    }
+    av_frame_free(frame);
+}
+
+FramePool::Stats FramePool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
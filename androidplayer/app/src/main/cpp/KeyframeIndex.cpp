@@ -0,0 +1,196 @@
+#include "KeyframeIndex.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "android/log.h"
+
+#define LOG_TAG "KeyframeIndex"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+
+static const char kIndexMagic[4] = {'A', 'P', 'K', 'I'};
+static const uint32_t kIndexVersion = 1;
+
+// 索引文件头，之后是packet_count个IndexFileEntry (解码顺序)
+struct IndexFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_size;
+    uint8_t source_hash[16];
+    int32_t time_base_num;
+    int32_t time_base_den;
+    int64_t packet_count;
+};
+
+struct IndexFileEntry {
+    int64_t pts;
+    int64_t dts;
+    int64_t pos;
+    uint32_t key;
+    uint32_t reserved;
+};
+
+int KeyframeIndex::build(const char *path) {
+    auto start_time = std::chrono::steady_clock::now();
+    packets_.clear();
+    keyframes_.clear();
+    sorted_pts_.clear();
+    unique_pts_ = false;
+    loaded_ = false;
+
+    AVFormatContext *fmt_ctx = nullptr;
+    if (avformat_open_input(&fmt_ctx, path, nullptr, nullptr) != 0) {
+        LOGE("无法打开输入文件: %s", path);
+        return -1;
+    }
+    if (avformat_find_stream_info(fmt_ctx, nullptr) < 0) {
+        LOGE("无法找到 %s 的流信息", path);
+        avformat_close_input(&fmt_ctx);
+        return -2;
+    }
+    int stream_idx = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (stream_idx < 0) {
+        LOGE("%s 中没有视频流", path);
+        avformat_close_input(&fmt_ctx);
+        return -3;
+    }
+    // 只需要视频包，丢弃其余流可省去它们的读取和拷贝
+    for (unsigned int i = 0; i < fmt_ctx->nb_streams; i++) {
+        if ((int) i != stream_idx) fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+    }
+    time_base_ = fmt_ctx->streams[stream_idx]->time_base;
+
+    AVPacket *pkt = av_packet_alloc();
+    while (av_read_frame(fmt_ctx, pkt) >= 0) {
+        if (pkt->stream_index == stream_idx) {
+            packets_.push_back({pkt->pts, pkt->dts, pkt->pos, (pkt->flags & AV_PKT_FLAG_KEY) != 0});
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    avformat_close_input(&fmt_ctx);
+
+    finalize();
+    scan_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    LOGI("包扫描完成: %zu 帧, %zu 个关键帧, 耗时 %.1f ms", packets_.size(), keyframes_.size(), scan_ms_);
+    return packets_.empty() ? -4 : 0;
+}
+
+void KeyframeIndex::finalize() {
+    keyframes_.clear();
+    sorted_pts_.clear();
+    bool all_pts = true;
+    for (size_t i = 0; i < packets_.size(); i++) {
+        if (packets_[i].key) keyframes_.push_back((long) i);
+        if (packets_[i].pts == AV_NOPTS_VALUE) all_pts = false;
+        else sorted_pts_.push_back(packets_[i].pts);
+    }
+    std::sort(sorted_pts_.begin(), sorted_pts_.end());
+    unique_pts_ = all_pts && std::adjacent_find(sorted_pts_.begin(), sorted_pts_.end()) == sorted_pts_.end();
+}
+
+int KeyframeIndex::save(const char *index_path, const FrameCacheSourceKey &source) const {
+    IndexFileHeader header = {};
+    memcpy(header.magic, kIndexMagic, sizeof(header.magic));
+    header.version = kIndexVersion;
+    header.source_size = source.size;
+    memcpy(header.source_hash, source.hash, sizeof(header.source_hash));
+    header.time_base_num = time_base_.num;
+    header.time_base_den = time_base_.den;
+    header.packet_count = (int64_t) packets_.size();
+    std::vector<IndexFileEntry> entries(packets_.size());
+    for (size_t i = 0; i < packets_.size(); i++) {
+        const VideoPacketInfo &info = packets_[i];
+        entries[i] = {info.pts, info.dts, info.pos, info.key ? 1u : 0u, 0};
+    }
+
+    // 先写临时文件再改名，避免中断时留下不完整的索引
+    std::string tmp_path = std::string(index_path) + ".tmp";
+    FILE *file = fopen(tmp_path.c_str(), "wb");
+    if (!file) return kFrameCacheIoError;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(entries.data(), sizeof(IndexFileEntry), entries.size(), file) == entries.size();
+    if (fclose(file) != 0) ok = false;
+    if (!ok || rename(tmp_path.c_str(), index_path) != 0) {
+        remove(tmp_path.c_str());
+        LOGW("保存关键帧索引失败: %s", index_path);
+        return kFrameCacheIoError;
+    }
+    return kFrameCacheOk;
+}
+
+int KeyframeIndex::load(const char *index_path, const FrameCacheSourceKey &source) {
+    FILE *file = fopen(index_path, "rb");
+    if (!file) return kFrameCacheIoError;
+    IndexFileHeader header = {};
+    int ret = kFrameCacheOk;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, kIndexMagic, sizeof(header.magic)) != 0 ||
+        header.version != kIndexVersion || header.packet_count <= 0 || header.time_base_den <= 0) {
+        ret = kFrameCacheBadFormat;
+    } else if (header.source_size != source.size ||
+               memcmp(header.source_hash, source.hash, sizeof(header.source_hash)) != 0) {
+        ret = kFrameCacheStale;
+    }
+    std::vector<IndexFileEntry> entries;
+    if (ret == kFrameCacheOk) {
+        entries.resize((size_t) header.packet_count);
+        if (fread(entries.data(), sizeof(IndexFileEntry), entries.size(), file) != entries.size()) {
+            ret = kFrameCacheIncomplete;
+        }
+    }
+    fclose(file);
+    if (ret != kFrameCacheOk) return ret;
+
+    packets_.clear();
+    packets_.reserve(entries.size());
+    for (const IndexFileEntry &entry : entries) packets_.push_back({entry.pts, entry.dts, entry.pos, entry.key != 0});
+    time_base_ = {header.time_base_num, header.time_base_den};
+    finalize();
+    loaded_ = true;
+    return kFrameCacheOk;
+}
+
+int KeyframeIndex::loadOrBuild(const char *media_path, const FrameCacheSourceKey &source, const char *index_path) {
+    auto start_time = std::chrono::steady_clock::now();
+    int ret = load(index_path, source);
+    if (ret == kFrameCacheOk) {
+        scan_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+        LOGI("已加载关键帧索引: %zu 帧, %zu 个关键帧, 耗时 %.1f ms", packets_.size(), keyframes_.size(), scan_ms_);
+        return 0;
+    }
+    if (ret != kFrameCacheIoError) LOGW("关键帧索引无效 (%d)，重新扫描: %s", ret, index_path);
+    ret = build(media_path);
+    if (ret < 0) return ret;
+    save(index_path, source); // 保存失败不影响本次使用
+    return 0;
+}
+
+long KeyframeIndex::displayIndexOf(int64_t pts) const {
+    auto it = std::lower_bound(sorted_pts_.begin(), sorted_pts_.end(), pts);
+    if (it == sorted_pts_.end() || *it != pts) return -1;
+    return (long) (it - sorted_pts_.begin());
+}
+
+long KeyframeIndex::countPtsInRange(int64_t begin, int64_t end) const {
+    auto first = std::lower_bound(sorted_pts_.begin(), sorted_pts_.end(), begin);
+    auto last = std::lower_bound(sorted_pts_.begin(), sorted_pts_.end(), end);
+    return (long) (last - first);
+}
+
+int64_t KeyframeIndex::ptsOfDisplayIndex(long display_index) const {
+    if (display_index < 0 || display_index >= (long) sorted_pts_.size()) return AV_NOPTS_VALUE;
+    return sorted_pts_[display_index];
+}
+
+long KeyframeIndex::keyframeBefore(int64_t target_pts) const {
+    long best = -1;
+    for (long k : keyframes_) {
+        int64_t pts = packets_[k].pts;
+        if (pts == AV_NOPTS_VALUE) continue;
+        if (pts <= target_pts && (best < 0 || pts > packets_[best].pts)) best = k;
+    }
+    return best >= 0 || keyframes_.empty() ? best : keyframes_.front();
+}
@@ -0,0 +1,1118 @@
+#include "Player.h"
+#include <algorithm>
+#include <cmath>
+#include <unistd.h>
+#include <vector>
+#include <SLES/OpenSLES_Android.h>
+#include <android/log.h>
+#include "AAudioRender.h"
+#include "ANWRender.h"
+#include "DecoderConfig.h"
+#include "FrameCache.h"
+#include "WorkerPool.h"
+#include "YuvConverter.h"
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#define LOG_TAG "MyPlayerCPP"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__) // 错误日志宏
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__) // 信息日志宏
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__) // 警告日志宏
+
+static const int kYuvPrefetchFrames = 3; // 缓存模式下预读播放位置之后的帧数
+static const long kPacingStatsInterval = 30; // 每显示多少帧更新一次显示节奏统计
+static const int kRetainedFrames = 2; // 重绘缓存保留的帧数 (正在转换的一帧 + 最近显示的一帧)
+static const long kFramePoolWarmupFrames = 60; // 帧缓冲池的预热帧数 (解码器参考帧 + 帧队列填满)，之后不应再有分配
+
+// --- 进程共用的资源 ---
+static std::atomic<int> g_live_players(0);            // 当前存在的Player实例数
+static std::mutex g_frame_pool_mutex;                 // 保护g_shared_frame_pool
+static std::weak_ptr<FramePool> g_shared_frame_pool;  // 流式播放的实例共用的帧缓冲池
+
+// OpenSL ES引擎和输出混音器每个进程只创建一个，各实例的播放器都挂在同一个输出混音器上
+static std::mutex g_engine_mutex;
+static SLObjectItf g_engine_object = nullptr;
+static SLEngineItf g_engine = nullptr;
+static SLObjectItf g_output_mix_object = nullptr;
+
+// 原生音频 (FFmpeg解码 + swresample + AAudio回调)
+struct NativeAudioPlayer {
+    std::string path;
+    AudioDecoder decoder;                             // 解码线程 -> 无锁环形缓冲区
+    AAudioRender render;                              // 回调从环形缓冲区取数据
+    std::atomic<bool> paused{false};
+};
+
+// AAudio数据回调：从解码管线的环形缓冲区取出PCM，不加锁，数据不足时输出静音
+static int native_audio_callback(AAudioStream * /*stream*/, void *user_data, void *audio_data, int32_t num_frames) {
+    static_cast<AudioDecoder *>(user_data)->read(audio_data, num_frames);
+    return AAUDIO_CALLBACK_RESULT_CONTINUE;
+}
+
+Player::Player() {
+    int live = ++g_live_players;
+    LOGI("播放器实例已创建 (当前 %d 个)", live);
+}
+
+Player::~Player() {
+    stopVideo();
+    stopAudio();
+    int live = --g_live_players;
+    LOGI("播放器实例已释放 (剩余 %d 个)", live);
+}
+
+int Player::liveInstances() {
+    return g_live_players.load();
+}
+
+std::shared_ptr<FramePool> Player::sharedFramePool() {
+    std::lock_guard<std::mutex> lock(g_frame_pool_mutex);
+    std::shared_ptr<FramePool> pool = g_shared_frame_pool.lock();
+    if (!pool) {
+        pool = std::make_shared<FramePool>();
+        g_shared_frame_pool = pool;
+    }
+    return pool;
+}
+
+// 销毁OpenSL ES音频播放器。与渲染线程读取音频位置互斥，避免读取已销毁的接口
+void Player::destroyAudioPlayer() {
+    std::lock_guard<std::mutex> lock(audio_player_mutex_);
+    if (sl_player_ != nullptr) (*sl_player_)->Destroy(sl_player_);
+    sl_player_ = nullptr;
+    sl_play_ = nullptr;
+    sl_seek_ = nullptr;
+    sl_rate_ = nullptr;
+}
+
+// 销毁原生音频播放器：先关闭AAudio流使回调停止，再停止解码线程
+void Player::destroyNativeAudio() {
+    std::shared_ptr<NativeAudioPlayer> player;
+    {
+        std::lock_guard<std::mutex> lock(audio_player_mutex_);
+        player = std::move(native_audio_);
+    }
+    if (!player) return;
+    player->render.close();
+    player->decoder.stop();
+    std::lock_guard<std::mutex> lock(audio_stats_mutex_);
+    last_audio_stats_ = player->decoder.stats();
+}
+
+// 在锁内复制原生音频播放器的引用，之后可在锁外操作，不阻塞渲染线程读取音频位置
+std::shared_ptr<NativeAudioPlayer> Player::nativeAudio() const {
+    std::lock_guard<std::mutex> lock(audio_player_mutex_);
+    return native_audio_;
+}
+
+// 取得本实例的解复用器：流式视频或原生音频已打开同一文件时复用，否则新建并打开。失败返回nullptr
+std::shared_ptr<Demuxer> Player::acquireDemuxer(const char *path) {
+    std::lock_guard<std::mutex> lock(demuxer_mutex_);
+    std::shared_ptr<Demuxer> demuxer = demuxer_.lock();
+    if (demuxer && demuxer->path() == path) return demuxer;
+    demuxer = std::make_shared<Demuxer>();
+    if (demuxer->open(path) < 0) return nullptr;
+    demuxer_ = demuxer;
+    return demuxer;
+}
+
+// 以原生音频路径从start_offset_ms开始播放：AAudio按设备原生采样率和格式打开，解码输出随之转换。
+// 文件没有音频流或AAudio不可用时返回false
+bool Player::startNativeAudio(const char *path, long start_offset_ms) {
+    std::unique_ptr<NativeAudioPlayer> player(new NativeAudioPlayer());
+    player->path = path;
+    std::shared_ptr<Demuxer> demuxer = acquireDemuxer(path);
+    if (!demuxer || player->decoder.open(demuxer) < 0) return false;
+    player->render.configure(AAUDIO_UNSPECIFIED, 2, AAUDIO_FORMAT_PCM_FLOAT);
+    player->render.setCallback(native_audio_callback, &player->decoder);
+    if (player->render.open() < 0) return false;
+    AudioDecoder::OutputFormat format;
+    format.sample_rate = player->render.getSampleRate();
+    format.channels = player->render.getChannelCount();
+    if (player->render.getFormat() == AAUDIO_FORMAT_PCM_FLOAT) format.sample_fmt = AV_SAMPLE_FMT_FLT;
+    else if (player->render.getFormat() == AAUDIO_FORMAT_PCM_I16) format.sample_fmt = AV_SAMPLE_FMT_S16;
+    else {
+        LOGW("AAudio输出格式不受支持: %d", player->render.getFormat());
+        return false;
+    }
+    player->decoder.setOutputFormat(format);
+    player->decoder.setSpeed(playback_speed_.load());
+    if (player->decoder.start(start_offset_ms > 0 ? start_offset_ms / 1000.0 : 0.0) < 0 ||
+        player->render.start() < 0) {
+        return false;
+    }
+    LOGI("原生音频已开始: %d Hz %d 声道 -> AAudio %d Hz %d 声道 %s, 起点 %ld ms", player->decoder.sourceSampleRate(),
+         player->decoder.sourceChannels(), format.sample_rate, format.channels,
+         av_get_sample_fmt_name(format.sample_fmt), std::max(0L, start_offset_ms));
+    std::lock_guard<std::mutex> lock(audio_player_mutex_);
+    native_audio_ = std::move(player);
+    return true;
+}
+
+// 音视频同步的音频时钟：当前播放出来的音频位置 (渲染线程调用)，未在播放时返回false。
+// 原生音频为已交给AAudio的数据位置减去输出延迟，OpenSL ES为播放器报告的播放位置
+bool Player::audioOutputPosition(double *media_time_s) {
+    std::lock_guard<std::mutex> lock(audio_player_mutex_);
+    if (native_audio_) {
+        double position;
+        if (native_audio_->paused || !native_audio_->decoder.position(&position)) return false;
+        int64_t latency_ns = native_audio_->render.outputLatencyNs();
+        if (latency_ns > 0) position -= latency_ns / 1e9 * playback_speed_.load();
+        *media_time_s = std::max(0.0, position);
+        return true;
+    }
+    if (sl_play_ == nullptr) return false;
+    SLuint32 state;
+    SLmillisecond position;
+    if ((*sl_play_)->GetPlayState(sl_play_, &state) != SL_RESULT_SUCCESS || state != SL_PLAYSTATE_PLAYING ||
+        (*sl_play_)->GetPosition(sl_play_, &position) != SL_RESULT_SUCCESS) {
+        return false;
+    }
+    *media_time_s = position / 1000.0;
+    return true;
+}
+
+// 记录首帧耗时 (仅在本次播放的第一帧显示后调用一次)
+void Player::recordTimeToFirstFrame(bool streaming) {
+    double elapsed_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - playback_start_time_).count();
+    if (streaming) {
+        time_to_first_frame_ms_ = elapsed_ms;
+        LOGI("首帧耗时 (流式模式): %.1f ms", elapsed_ms);
+    } else {
+        // 缓存模式下首帧之前必须先完成整段预解码，因此计入预解码耗时
+        double cache_ms = cache_decode_ms_.load();
+        time_to_first_frame_ms_ = cache_ms + elapsed_ms;
+        LOGI("首帧耗时 (YUV缓存模式): %.1f ms (预解码 %.1f ms + 读取显示 %.1f ms)",
+             cache_ms + elapsed_ms, cache_ms, elapsed_ms);
+    }
+}
+
+// 更新可由JNI读取的显示节奏统计
+void Player::publishPacingStats(const PresentationClock::Stats &stats) {
+    std::lock_guard<std::mutex> lock(pacing_stats_mutex_);
+    pacing_stats_ = stats;
+}
+
+// 视频渲染线程函数。initial_seek_frame为开始播放前设置的起始帧 (-1表示从头播放)
+void Player::renderLoop(long initial_seek_frame) {
+    LOGI("视频渲染线程启动.");
+    if (!window_) {
+        LOGE("渲染循环: Native window为空!");
+        video_playing_ = false;
+        return;
+    }
+    if (video_width_ <= 0 || video_height_ <= 0) {
+        LOGE("渲染循环: 视频尺寸无效 (%dx%d)", video_width_, video_height_);
+        video_playing_ = false;
+        return;
+    }
+
+    const bool streaming = streaming_;
+    if (streaming && !stream_decoder_) {
+        LOGE("渲染循环: 流式解码器为空!");
+        video_playing_ = false;
+        return;
+    }
+
+    FrameCacheReader yuv_file;                                 // 内存映射的YUV缓存文件 (仅缓存模式使用)
+
+    WorkerPool &convert_pool = WorkerPool::shared();           // 按水平条带并行转换大帧 (与其他实例共用)
+    const LetterboxLayout layout = layout_;                    // 画面在窗口缓冲区中的位置和尺寸
+
+    PresentationClock clock;                                   // 按帧时间戳和速度计算每帧的绝对显示时刻
+    av_sync_.reset();
+    av_sync_.setAudioClock([this](double *media_time_s) { return audioOutputPosition(media_time_s); });
+    long current_file_frame_pos = 0;                           // 下一个要读取的帧号
+    FramePool::Stats pool_warm;                                // 预热结束时的帧缓冲池统计 (仅流式模式)
+    long streamed_frames = 0;                                  // 流式模式下已取出的帧数
+    int64_t convert_ns = 0, post_ns = 0;                       // 累计的转换和提交耗时
+    long timed_frames = 0;
+    bool first_frame_shown = false;                            // 本次播放是否已显示首帧
+
+    if (!streaming) {
+        int open_ret = yuv_file.open(yuv_path_.c_str()); // 只读映射并校验YUV缓存文件
+        if (open_ret < 0) {
+            LOGE("渲染循环: 打开YUV缓存文件失败: %s (%d)", yuv_path_.c_str(), open_ret);
+            video_playing_ = false;
+            return;
+        }
+        AVPixelFormat cache_fmt = (AVPixelFormat) yuv_file.header().pix_fmt;
+        if (cache_fmt != AV_PIX_FMT_YUV420P && cache_fmt != AV_PIX_FMT_YUVJ420P) {
+            LOGW("渲染循环: 缓存不是YUV420P格式: %s.", av_get_pix_fmt_name(cache_fmt));
+        }
+    }
+
+    // 颜色矩阵、范围和色度位置按流选择一次，之后每帧使用同一组特化内核
+    YuvColorFormat color_format;
+    if (streaming) {
+        color_format = YuvColorFormat::forStream(stream_decoder_->colorSpace(), stream_decoder_->colorRange(),
+                                                 stream_decoder_->chromaLocation(), video_width_, video_height_);
+    } else {
+        const FrameCacheHeader &header = yuv_file.header();
+        color_format = YuvColorFormat::forStream((AVColorSpace) header.color_space, (AVColorRange) header.color_range,
+                                                 (AVChromaLocation) header.chroma_location, header.width,
+                                                 header.height);
+    }
+    color_format.output = window_output_;                      // 窗口缓冲区格式 (attachWindow时确定)
+    YuvConverter yuv_converter(color_format);                  // 按运行时CPU特性、流的颜色格式和窗口格式选择的转换内核
+    YuvScaler scaler(color_format, yuv_converter.kernel());    // 画面小于视频时缩放与转换合为一遍
+    LOGI("渲染循环: YUV转换内核 %s (%s), 并行转换线程 %d", YuvConverter::kernelName(yuv_converter.kernel()),
+         color_format.name().c_str(), convert_pool.threadCount());
+    ANWRender present(window_);                                // 把窗口缓冲区 (或保留模式下环形缓冲的下一帧) 借给转换器
+    if (present.init(layout, color_format.output, redraw_cache_ ? kRetainedFrames : 0) < 0) {
+        LOGE("渲染循环: 初始化显示阶段失败");
+        video_playing_ = false;
+        return;
+    }
+
+    video_playing_ = true; // 标记视频开始播放
+
+    if (streaming) {
+        // 流式模式的初始跳转已在启动解码器时处理
+        current_rendered_frame_ = initial_seek_frame != -1 ? initial_seek_frame : 0;
+        StreamDecoder *decoder = stream_decoder_.get();
+        control_.setWakeHook([decoder]() { decoder->interruptPop(); }); // 等待帧队列时也能及时响应命令
+    } else if (initial_seek_frame != -1) {
+        if (initial_seek_frame < yuv_file.frameCount()) { // 跳转即索引查找
+            current_file_frame_pos = initial_seek_frame;
+            current_rendered_frame_ = initial_seek_frame;
+            LOGI("渲染循环: 初始跳转到帧 %ld 成功", initial_seek_frame);
+        } else {
+            LOGE("渲染循环: 初始跳转帧 %ld 超出范围. 将从头开始.", initial_seek_frame);
+            current_file_frame_pos = 0;
+            current_rendered_frame_ = 0;
+        }
+    } else { // 没有初始跳转请求，从头开始
+        current_rendered_frame_ = 0;
+        current_file_frame_pos = 0;
+    }
+
+    std::vector<PlayerCommand> awaiting_frame;                 // 在下一帧显示时生效的命令 (恢复、跳转)
+    bool show_paused_frame = false;                            // 暂停中跳转：显示一帧目标画面后继续暂停
+    auto seek_to = [&](long frame, bool decoder_seeked) {
+        clock.reset(); // 跳转后以目标帧重新开始计时 (随后按音频位置校正)
+        if (streaming) { // 流式模式：交给解码器定位到关键帧后向前解码 (控制端已提交时不再重复)
+            if (!decoder_seeked) stream_decoder_->seekToFrame(frame);
+            current_file_frame_pos = frame;
+            current_rendered_frame_ = frame;
+            LOGI("渲染循环: 流式跳转到帧 %ld", frame);
+        } else if (frame < yuv_file.frameCount()) {
+            current_file_frame_pos = frame;
+            current_rendered_frame_ = frame;
+            LOGI("渲染循环: 跳转到帧 %ld 成功", frame);
+        } else {
+            LOGE("渲染循环: 跳转帧 %ld 超出范围 (共 %ld 帧)", frame, yuv_file.frameCount());
+        }
+    };
+    while (true) {
+        // 在帧之间执行全部待处理的命令
+        PlayerCommand command;
+        bool stop_requested = false;
+        while (control_.next(&command)) {
+            PlayerState state = control_.apply(command);
+            switch (command.type) {
+                case PlayerCommandType::Stop:
+                    stop_requested = true;
+                    control_.effectDone(command);
+                    break;
+                case PlayerCommandType::Pause:
+                    clock.pause(); // 暂停期间媒体时间不前进
+                    control_.effectDone(command);
+                    break;
+                case PlayerCommandType::Resume:
+                    clock.resume();
+                    awaiting_frame.push_back(command);
+                    break;
+                case PlayerCommandType::Seek:
+                    seek_to(command.frame, command.decoder_seeked);
+                    show_paused_frame = state == PlayerState::Paused;
+                    awaiting_frame.push_back(command);
+                    break;
+                case PlayerCommandType::Redraw:
+                    // 播放中下一帧很快会显示；暂停时重新提交保留的画面，没有保留时重新解码并转换当前帧
+                    if (state != PlayerState::Paused || !first_frame_shown || present.redisplay() == 0) {
+                        control_.effectDone(command);
+                    } else {
+                        seek_to(current_rendered_frame_.load(), false);
+                        show_paused_frame = true;
+                        awaiting_frame.push_back(command);
+                    }
+                    break;
+            }
+        }
+        if (stop_requested) break;
+
+        const bool paused = control_.state() == PlayerState::Paused;
+        if (paused && !show_paused_frame) { // 暂停：睡眠到下一条命令，不占用CPU
+            control_.waitWhilePaused();
+            continue;
+        }
+        float current_speed = playback_speed_.load();
+        clock.setSpeed(current_speed > 0.01f ? current_speed : 0.01f);
+
+        // 当前帧的YUV420p分量指针与行跨度
+        const uint8_t *src_y, *src_u, *src_v;
+        int stride_y, stride_u, stride_v;
+        int frame_width = video_width_, frame_height = video_height_;
+        AVFrame *stream_frame = nullptr;
+        double media_time_s = 0.0;                             // 帧的显示时间 (相对起点的秒数)
+
+        if (streaming) {
+            int pop_ret = stream_decoder_->popFrame(&stream_frame, 100);
+            if (pop_ret == 0) continue; // 暂无可用帧 (解码中或正在跳转) 或有新命令，继续检查控制命令
+            if (pop_ret < 0) {
+                LOGI("渲染循环: 流式解码到达末尾.");
+                break;
+            }
+            if (++streamed_frames == kFramePoolWarmupFrames) pool_warm = stream_decoder_->framePoolStats();
+            if (stream_frame->format != AV_PIX_FMT_YUV420P && stream_frame->format != AV_PIX_FMT_YUVJ420P) {
+                LOGW("渲染循环: 帧不是YUV420P格式: %s.", av_get_pix_fmt_name((AVPixelFormat) stream_frame->format));
+            }
+            long frame_index = stream_decoder_->frameIndexOf(stream_frame);
+            current_rendered_frame_ = frame_index >= 0 ? frame_index : current_file_frame_pos;
+            current_file_frame_pos = current_rendered_frame_ + 1;
+            media_time_s = stream_decoder_->frameTimeMs(stream_frame) / 1000.0;
+
+            src_y = stream_frame->data[0]; stride_y = stream_frame->linesize[0];
+            src_u = stream_frame->data[1]; stride_u = stream_frame->linesize[1];
+            src_v = stream_frame->data[2]; stride_v = stream_frame->linesize[2];
+            frame_width = std::min(frame_width, stream_frame->width);
+            frame_height = std::min(frame_height, stream_frame->height);
+        } else {
+            if (current_file_frame_pos >= yuv_file.frameCount()) {
+                LOGI("渲染循环: 到达YUV文件末尾.");
+                break;
+            }
+            long frame_idx = current_file_frame_pos;
+            yuv_file.prefetch(frame_idx + 1, kYuvPrefetchFrames); // 预读播放位置之后的若干帧
+            current_rendered_frame_ = frame_idx; // 更新当前渲染的帧号
+            current_file_frame_pos++; // 文件帧位置前进
+            media_time_s = yuv_file.frameTimeMs(frame_idx) / 1000.0;
+
+            // 各平面直接指向页缓存中的帧数据，行跨度取自缓存文件头
+            src_y = yuv_file.plane(frame_idx, 0); stride_y = yuv_file.stride(0);
+            src_u = yuv_file.plane(frame_idx, 1); stride_u = yuv_file.stride(1);
+            src_v = yuv_file.plane(frame_idx, 2); stride_v = yuv_file.stride(2);
+            frame_width = std::min(frame_width, yuv_file.width());
+            frame_height = std::min(frame_height, yuv_file.height());
+        }
+
+        if (!paused) { // 暂停中显示跳转目标时不计时
+            if (!clock.running()) clock.start(media_time_s, current_speed);
+            av_sync_.syncVideo(clock); // 音频在播放时以其位置为准校正视频时钟
+        }
+        if (!paused && clock.shouldDrop(media_time_s)) { // 已落后超过阈值，跳过转换和显示
+            if (stream_frame) stream_decoder_->releaseFrame(&stream_frame);
+            continue;
+        }
+
+        ANWRender::Target target;                              // 画面区域 (锁定的窗口缓冲区或保留模式的环形缓冲)
+        if (present.lock(&target) < 0) {
+            LOGE("渲染循环: 无法获取窗口缓冲区");
+            if (stream_frame) stream_decoder_->releaseFrame(&stream_frame);
+            break;
+        }
+
+        int64_t convert_start_ns = PresentationClock::nowNs();
+        uint8_t *dst_picture = target.pixels;
+        int dst_stride_bytes = target.stride;
+        int stripes = YuvConverter::autoStripeCount(frame_width, frame_height, convert_pool.threadCount());
+
+        // YUV420p 转 RGBA8888/RGB565，大帧按条带分给工作线程，原地写入借出的画面区域
+        if (frame_width == layout.width && frame_height == layout.height) {
+            yuv_converter.convert(src_y, stride_y, src_u, stride_u, src_v, stride_v,
+                                  dst_picture, dst_stride_bytes, frame_width, frame_height, convert_pool, stripes);
+        } else { // 画面小于视频 (或帧尺寸与探测结果不同)：缩放到画面尺寸的同时转换
+            scaler.configure(frame_width, frame_height, layout.width, layout.height, convert_pool.threadCount());
+            scaler.convert(src_y, stride_y, src_u, stride_u, src_v, stride_v, dst_picture, dst_stride_bytes,
+                           &convert_pool, stripes);
+        }
+        convert_ns += PresentationClock::nowNs() - convert_start_ns;
+        // 转换完成后等到该帧的绝对显示时刻再提交，转换耗时不累积；等待中有新命令时立即提交，随后执行命令
+        bool interrupted = !paused && control_.waitFor(clock.deadlineNs(media_time_s));
+        int64_t post_start_ns = PresentationClock::nowNs();
+        present.post(); // 提交显示 (保留模式下此时才锁定窗口并拷贝)
+        post_ns += PresentationClock::nowNs() - post_start_ns;
+        timed_frames++;
+        if (!paused && !interrupted) {
+            clock.framePresented(media_time_s);
+            av_sync_.framePresented(media_time_s);
+        }
+        if (stream_frame) stream_decoder_->releaseFrame(&stream_frame);
+        for (const PlayerCommand &done : awaiting_frame) control_.effectDone(done);
+        awaiting_frame.clear();
+        show_paused_frame = false;
+
+        if (!first_frame_shown) {
+            first_frame_shown = true;
+            recordTimeToFirstFrame(streaming);
+        }
+        if (clock.stats().presented % kPacingStatsInterval == 0) publishPacingStats(clock.stats());
+    }
+
+    publishPacingStats(clock.stats());
+    PresentationClock::Stats pacing = clock.stats();
+    LOGI("渲染循环: 显示 %ld 帧, 丢弃 %ld 帧, 重新对齐 %ld 次, 显示误差 平均 %.2f ms / 最大 %.2f ms, 抖动 %.2f ms",
+         pacing.presented, pacing.dropped, pacing.resyncs, pacing.drift_mean_ms, pacing.drift_max_ms, pacing.jitter_ms);
+    if (timed_frames > 0) { // RGB565 与 RGBA8888 的转换和提交开销对比
+        LOGI("渲染循环: %s 输出, 每帧转换 %.2f ms, 提交 %.2f ms", color_format.name().c_str(),
+             convert_ns / 1e6 / timed_frames, post_ns / 1e6 / timed_frames);
+    }
+    if (streaming && streamed_frames > kFramePoolWarmupFrames) { // 预热后每帧的缓冲区和AVFrame都应来自池
+        FramePool::Stats pool = stream_decoder_->framePoolStats();
+        long steady_allocs = pool.allocations() - pool_warm.allocations();
+        if (steady_allocs > 0 && decoder_active_streams() == 1) { // 池与其他实例共用时其他实例的启动和跳转也会分配
+            LOGW("渲染循环: 预热后的 %ld 帧中发生了 %ld 次帧缓冲分配", streamed_frames - kFramePoolWarmupFrames,
+                 steady_allocs);
+        }
+        LOGI("渲染循环: 帧缓冲池 新分配 %ld 个缓冲区 (%.1f MiB) / 复用 %ld 次, AVFrame 新分配 %ld / 复用 %ld, 默认分配 %ld",
+             pool.buffer_allocs, pool.allocated_bytes / 1048576.0, pool.buffer_reuses, pool.frame_allocs,
+             pool.frame_reuses, pool.fallback_buffers);
+    }
+    if (streaming) {
+        FrameRingStats queue = stream_decoder_->frameQueueStats();
+        LOGI("渲染循环: 帧队列 平均占用 %.1f / 最大 %zu 帧 (%.1f MiB), 解码线程等待 %ld 次 (%.1f ms, 其中内存预算 %ld 次), "
+             "渲染线程等待 %ld 次 (%.1f ms), futex唤醒 %ld 次",
+             queue.mean_occupancy, queue.max_occupancy, queue.max_bytes / 1048576.0, queue.producer_waits,
+             queue.producer_wait_ms, queue.budget_waits, queue.consumer_waits, queue.consumer_wait_ms, queue.wakeups);
+    }
+    PlayerControl::Stats control = control_.stats();
+    LOGI("渲染循环: 命令生效延迟 暂停 平均 %.1f / 最大 %.1f ms, 恢复 %.1f / %.1f ms, 跳转 %.1f / %.1f ms, 暂停期间唤醒 %ld 次",
+         control.pause.avg_ms, control.pause.max_ms, control.resume.avg_ms, control.resume.max_ms, control.seek.avg_ms,
+         control.seek.max_ms, control.paused_wakeups);
+    control_.setWakeHook(nullptr); // 流式解码器在渲染线程结束后才释放
+    yuv_file.close(); // 清理资源
+    LOGI("视频渲染线程结束.");
+    video_playing_ = false; // 标记视频播放结束
+}
+
+// 记录缓存准备结果：更新视频参数和缓存帧数
+void Player::applyCacheStats(const FrameCacheStats &stats) {
+    video_width_ = stats.width;
+    video_height_ = stats.height;
+    avg_frame_rate_ = stats.frame_rate > 0 ? stats.frame_rate : 25.0;
+    {
+        std::lock_guard<std::mutex> lock(cache_info_mutex_);
+        cache_info_path_ = stats.cache_path;
+        cache_info_frames_ = stats.frame_count;
+    }
+    std::lock_guard<std::mutex> lock(startup_stats_mutex_);
+    startup_stats_ = stats;
+}
+
+int Player::decodeToFile(const char *input_path, const char *output_path) {
+    FrameCacheSourceKey source;
+    FrameCacheStats stats;
+    stats.cache_path = output_path;
+    int ret = frame_cache_compute_source_key(input_path, &source);
+    if (ret == 0) ret = frame_cache_decode(input_path, output_path, source, false, &stats);
+    if (ret == 0) {
+        stats.total_ms = stats.decode_ms;
+        applyCacheStats(stats);
+        cache_decode_ms_ = stats.decode_ms;
+    }
+    return ret;
+}
+
+std::string Player::prepareFrameCache(const char *input_path, const char *cache_dir, int decode_workers,
+                                      bool zero_copy) {
+    FrameCacheManager manager(cache_dir);
+    manager.setDecodeWorkers(std::max(0, decode_workers));
+    manager.setZeroCopy(zero_copy);
+    FrameCacheStats stats;
+    int ret = manager.prepare(input_path, &stats);
+    if (ret < 0) {
+        LOGE("准备YUV缓存失败: %d", ret);
+        return std::string();
+    }
+    applyCacheStats(stats);
+    cache_decode_ms_ = stats.total_ms; // 首帧耗时中计入本次缓存准备耗时
+    return stats.cache_path;
+}
+
+long Player::cacheFrameCount(const char *yuv_path) {
+    std::lock_guard<std::mutex> lock(cache_info_mutex_);
+    if (cache_info_path_ != yuv_path) { // 帧数记录在缓存文件尾部索引中，每个文件只需读取一次
+        FrameCacheReader reader;
+        int open_ret = reader.open(yuv_path);
+        if (open_ret < 0) { LOGE("无法打开YUV缓存文件 '%s' 以获取总帧数: %d", yuv_path, open_ret); return 0; }
+        cache_info_path_ = yuv_path;
+        cache_info_frames_ = reader.frameCount();
+    }
+    return cache_info_frames_;
+}
+
+long Player::probe(const char *input_path, const char *cache_dir) {
+    FrameCacheSourceKey source;
+    keyframe_index_path_.clear();
+    if (frame_cache_compute_source_key(input_path, &source) == kFrameCacheOk) {
+        keyframe_index_path_ = FrameCacheManager(cache_dir).indexPathFor(source);
+    }
+    StreamDecoder probe;
+    int ret = probe.open(input_path, keyframe_index_path_.empty() ? nullptr : keyframe_index_path_.c_str());
+    if (ret < 0) return ret;
+    if (!probe.hasIndex()) keyframe_index_path_.clear();
+    video_width_ = probe.width();
+    video_height_ = probe.height();
+    avg_frame_rate_ = probe.frameRate();
+    LOGI("视频探测: %dx%d @ %f fps, 约 %ld 帧", video_width_, video_height_, avg_frame_rate_.load(),
+         probe.estimatedTotalFrames());
+    return probe.estimatedTotalFrames();
+}
+
+bool Player::attachWindow(ANativeWindow *window) {
+    if (window_) ANativeWindow_release(window_); // 释放旧的原生窗口（如果存在）
+    window_ = window;
+    if (!window_) { LOGE("获取原生窗口失败."); return false; }
+    if (video_width_ <= 0 || video_height_ <= 0) {
+        LOGE("视频尺寸无效: %dx%d.", video_width_, video_height_);
+        ANativeWindow_release(window_); window_ = nullptr; return false;
+    }
+    window_output_ = rgb565_output_.load() ? YuvOutput::Rgb565 : YuvOutput::Rgba8888;
+    int window_format = window_output_ == YuvOutput::Rgb565 ? WINDOW_FORMAT_RGB_565 : WINDOW_FORMAT_RGBA_8888;
+    // 先恢复窗口的默认缓冲区尺寸 (同一Surface上次播放设置的尺寸不代表窗口大小)，再读取窗口实际尺寸
+    ANativeWindow_setBuffersGeometry(window_, 0, 0, window_format);
+    int window_width = ANativeWindow_getWidth(window_);
+    int window_height = ANativeWindow_getHeight(window_);
+    layout_ = letterbox_layout(video_width_, video_height_, window_width, window_height);
+    // 缓冲区按窗口大小 (不超过视频分辨率) 分配，画面缩放到实际显示的大小并居中
+    if (ANativeWindow_setBuffersGeometry(window_, layout_.buffer_width, layout_.buffer_height, window_format) < 0) {
+        LOGE("设置原生窗口缓冲区几何属性失败.");
+        ANativeWindow_release(window_); window_ = nullptr; return false;
+    }
+    LOGI("原生窗口缓冲区几何属性已设置: 窗口 %dx%d, 缓冲区 %dx%d (%s), 视频 %dx%d -> 画面 %dx%d @ (%d,%d)",
+         window_width, window_height, layout_.buffer_width, layout_.buffer_height,
+         window_output_ == YuvOutput::Rgb565 ? "RGB565" : "RGBA8888", video_width_, video_height_, layout_.width,
+         layout_.height, layout_.x, layout_.y);
+    return true;
+}
+
+void Player::stopVideo() {
+    LOGI("请求停止本地视频播放.");
+    control_.stop(); // 渲染线程在暂停或等待中也会立即被唤醒
+    if (render_thread_.joinable()) { // 如果渲染线程可加入
+        render_thread_.join();       // 等待渲染线程结束
+        LOGI("视频渲染线程已加入.");
+    }
+    video_playing_ = false; // 标记视频播放结束
+    if (stream_decoder_) {  // 停止流式解码线程
+        last_seek_stats_ = stream_decoder_->seekStats();
+        stream_decoder_->stop();
+        stream_decoder_.reset();
+        LOGI("流式解码器已停止.");
+    }
+    if (window_) {          // 释放原生窗口
+        ANativeWindow_release(window_);
+        window_ = nullptr;
+        LOGI("原生窗口已释放.");
+    }
+    current_rendered_frame_ = 0; // 重置当前渲染帧
+    control_.end();              // 丢弃未执行的命令 (含跳转目标)
+    LOGI("本地视频播放已停止.");
+}
+
+void Player::startCachePlayback(const char *yuv_path, ANativeWindow *window) {
+    if (video_playing_.load()) { // 如果视频已在播放，先停止旧的
+        LOGW("视频播放已在运行. 正在停止上一个.");
+        stopVideo();
+    }
+    playback_start_time_ = std::chrono::steady_clock::now(); // 首帧耗时计时起点
+    time_to_first_frame_ms_ = -1.0;
+    streaming_ = false;
+    yuv_path_ = yuv_path;
+    if (!attachWindow(window)) return;
+
+    long initial_seek_frame = control_.begin(); // 取出开始前设置的跳转目标，丢弃残留的命令
+    if (render_thread_.joinable()) render_thread_.join(); // 等待旧线程结束（如果存在）
+    render_thread_ = std::thread(&Player::renderLoop, this, initial_seek_frame); // 创建并启动新的渲染线程
+    LOGI("本地视频播放线程已启动.");
+}
+
+void Player::startStreamingPlayback(const char *input_path, ANativeWindow *window) {
+    if (video_playing_.load() || stream_decoder_) { // 如果视频已在播放，先停止旧的
+        LOGW("视频播放已在运行. 正在停止上一个.");
+        stopVideo();
+    }
+    playback_start_time_ = std::chrono::steady_clock::now(); // 首帧耗时计时起点
+    time_to_first_frame_ms_ = -1.0;
+    streaming_ = true;
+
+    // 帧缓冲池与其他正在流式播放的实例共用
+    std::unique_ptr<StreamDecoder> decoder(new StreamDecoder(0, 0, sharedFramePool()));
+    std::shared_ptr<Demuxer> demuxer = acquireDemuxer(input_path); // 与原生音频共用，文件只读取一次
+    int open_ret = demuxer ? decoder->open(demuxer, keyframe_index_path_.empty() ? nullptr : keyframe_index_path_.c_str())
+                           : -1;
+    if (open_ret < 0) {
+        LOGE("流式解码器打开失败: %d", open_ret);
+        if (window) ANativeWindow_release(window);
+        streaming_ = false;
+        return;
+    }
+    video_width_ = decoder->width();
+    video_height_ = decoder->height();
+    avg_frame_rate_ = decoder->frameRate();
+    if (!attachWindow(window)) { streaming_ = false; return; }
+
+    long initial_seek_frame = control_.begin(); // 初始跳转在解码线程启动前提交
+    if (initial_seek_frame > 0) decoder->seekToFrame(initial_seek_frame);
+    if (decoder->start() < 0) {
+        LOGE("流式解码线程启动失败.");
+        control_.end();
+        decoder->stop(); // 停用解码器的流并释放对解复用器的引用 (原生音频未使用时解复用器随之释放)
+        demuxer.reset();
+        ANativeWindow_release(window_);
+        window_ = nullptr;
+        streaming_ = false;
+        return;
+    }
+    stream_decoder_ = std::move(decoder);
+
+    if (render_thread_.joinable()) render_thread_.join(); // 等待旧线程结束（如果存在）
+    render_thread_ = std::thread(&Player::renderLoop, this, initial_seek_frame); // 创建并启动新的渲染线程
+    LOGI("流式视频播放线程已启动 (当前 %d 路视频流).", decoder_active_streams());
+}
+
+void Player::pauseVideo() {
+    control_.pause(); // 渲染线程在当前帧之后停止显示并睡眠
+    LOGI("本地视频已暂停.");
+}
+
+void Player::resumeVideo() {
+    control_.resume(); // 唤醒暂停中的渲染线程
+    LOGI("本地视频已恢复.");
+}
+
+void Player::redrawVideo() {
+    control_.redraw(); // 渲染线程在帧之间重新显示当前画面
+}
+
+void Player::setSpeed(float speed) {
+    if (speed > 0.0f) { // 速度必须大于0
+        playback_speed_ = speed; // 设置播放速度
+        LOGI("本地视频帧速度因子已设置为: %f", speed);
+        // 注意：此速度也用于 setAudioRate
+    } else {
+        LOGW("无效的视频速度因子: %f.", speed);
+    }
+}
+
+void Player::seekToFrame(long frame) {
+    if (frame >= 0) { // 帧号必须非负
+        if (stream_decoder_ && control_.state() != PlayerState::Stopped) {
+            // 流式播放中立即在共用的解复用器上跳转，随后的seekAudio跟随这一次跳转，不再发起第二次
+            video_seek_serial_ = stream_decoder_->seekToFrame(frame);
+            control_.post(PlayerCommandType::Seek, frame, true);
+        } else {
+            control_.seek(frame); // 播放中在下一帧之前执行，未播放时作为下次播放的起始位置
+        }
+        LOGI("本地视频跳转到帧: %ld", frame);
+    } else {
+        LOGW("无效的跳转帧: %ld", frame);
+    }
+}
+
+std::string Player::startupMetrics() const {
+    std::lock_guard<std::mutex> lock(startup_stats_mutex_);
+    char text[320];
+    snprintf(text, sizeof(text),
+             "startup=%s prepare=%.1fms hash=%.1fms decode=%.1fms (workers=%d, scan=%.1fms) frames=%ld resumed_frames=%ld"
+             " write=%s copy_per_frame=%.0fB",
+             frame_cache_startup_name(startup_stats_.startup), startup_stats_.total_ms, startup_stats_.hash_ms,
+             startup_stats_.decode_ms, startup_stats_.decode_workers, startup_stats_.scan_ms,
+             startup_stats_.frame_count, startup_stats_.resumed_frames, startup_stats_.zero_copy ? "direct" : "copy",
+             startup_stats_.copiedBytesPerFrame());
+    return text;
+}
+
+std::string Player::seekMetrics() const {
+    StreamDecoder::SeekStats stats = stream_decoder_ ? stream_decoder_->seekStats() : last_seek_stats_;
+    char text[192];
+    snprintf(text, sizeof(text), "seeks=%ld last=%.1fms avg=%.1fms max=%.1fms decoded_forward=%ld index=%s",
+             stats.count, stats.last_ms, stats.avg_ms, stats.max_ms, stats.last_decoded_forward,
+             keyframe_index_path_.empty() ? "none" : "keyframe");
+    return text;
+}
+
+std::string Player::controlMetrics() const {
+    PlayerControl::Stats stats = control_.stats();
+    char text[384];
+    snprintf(text, sizeof(text),
+             "state=%s pause=%ld avg=%.1fms max=%.1fms resume=%ld avg=%.1fms max=%.1fms seek=%ld avg=%.1fms max=%.1fms "
+             "stop=%ld avg=%.1fms redraw=%ld avg=%.1fms max=%.1fms coalesced_seeks=%ld paused_wakeups=%ld",
+             player_state_name(control_.state()), stats.pause.count, stats.pause.avg_ms, stats.pause.max_ms,
+             stats.resume.count, stats.resume.avg_ms, stats.resume.max_ms, stats.seek.count, stats.seek.avg_ms,
+             stats.seek.max_ms, stats.stop.count, stats.stop.avg_ms, stats.redraw.count, stats.redraw.avg_ms,
+             stats.redraw.max_ms, stats.coalesced_seeks, stats.paused_wakeups);
+    return text;
+}
+
+std::string Player::pacingMetrics() const {
+    std::lock_guard<std::mutex> lock(pacing_stats_mutex_);
+    char text[192];
+    snprintf(text, sizeof(text), "presented=%ld dropped=%ld resyncs=%ld drift_mean=%.2fms drift_max=%.2fms jitter=%.2fms",
+             pacing_stats_.presented, pacing_stats_.dropped, pacing_stats_.resyncs, pacing_stats_.drift_mean_ms,
+             pacing_stats_.drift_max_ms, pacing_stats_.jitter_ms);
+    return text;
+}
+
+std::string Player::avSyncMetrics() const {
+    AvSync::Stats stats = av_sync_.stats();
+    std::string text;
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "threshold=%.0fms samples=%ld offset_last=%.1fms offset_mean=%.1fms offset_max=%.1fms "
+             "corrections_ahead=%ld corrections_behind=%ld history=",
+             stats.threshold_ms, stats.samples, stats.offset_last_ms, stats.offset_mean_ms, stats.offset_max_ms,
+             stats.corrections_ahead, stats.corrections_behind);
+    text = buf;
+    for (const AvSync::OffsetSample &sample : av_sync_.history()) {
+        snprintf(buf, sizeof(buf), "%.2f:%.1f,", sample.media_time_s, sample.offset_ms);
+        text += buf;
+    }
+    if (text.back() == ',') text.pop_back();
+    return text;
+}
+
+std::string Player::audioMetrics() const {
+    AudioDecoder::Stats stats;
+    int64_t latency_ns = -1;
+    {
+        std::lock_guard<std::mutex> lock(audio_player_mutex_);
+        if (native_audio_) {
+            stats = native_audio_->decoder.stats();
+            latency_ns = native_audio_->render.outputLatencyNs();
+        } else {
+            std::lock_guard<std::mutex> stats_lock(audio_stats_mutex_);
+            stats = last_audio_stats_;
+        }
+    }
+    char text[256];
+    snprintf(text, sizeof(text),
+             "frames_decoded=%ld samples_output=%llu underruns=%ld silence_frames=%llu resampler_inits=%ld "
+             "decode=%.1fms resample=%.1fms stretch=%.1fms output_latency=%.1fms",
+             stats.frames_decoded, (unsigned long long) stats.samples_output, stats.underruns,
+             (unsigned long long) stats.silence_frames, stats.resampler_inits, stats.decode_ms, stats.resample_ms,
+             stats.stretch_ms, latency_ns >= 0 ? latency_ns / 1e6 : -1.0);
+    return text;
+}
+
+// --- 音频部分 ---
+int Player::initAudioEngine() {
+    std::lock_guard<std::mutex> lock(g_engine_mutex);
+    if (g_engine) return 0; // 已由其他实例创建
+    SLresult result;
+    // 创建引擎对象
+    result = slCreateEngine(&g_engine_object, 0, nullptr, 0, nullptr, nullptr);
+    if (result!=SL_RESULT_SUCCESS) {LOGE("slCreateEngine失败: %u",result); return -1;}
+    // 实现引擎对象
+    result = (*g_engine_object)->Realize(g_engine_object, SL_BOOLEAN_FALSE);
+    if (result!=SL_RESULT_SUCCESS) {LOGE("引擎Realize失败: %u",result); (*g_engine_object)->Destroy(g_engine_object); g_engine_object=nullptr; return -1;}
+    // 获取引擎接口
+    SLEngineItf engine = nullptr;
+    result = (*g_engine_object)->GetInterface(g_engine_object, SL_IID_ENGINE, &engine);
+    if (result!=SL_RESULT_SUCCESS) {LOGE("引擎GetInterface失败: %u",result); (*g_engine_object)->Destroy(g_engine_object); g_engine_object=nullptr; return -1;}
+    // 创建输出混音器对象
+    result = (*engine)->CreateOutputMix(engine, &g_output_mix_object, 0, nullptr, nullptr);
+    if (result!=SL_RESULT_SUCCESS) {LOGE("CreateOutputMix失败: %u",result); (*g_engine_object)->Destroy(g_engine_object); g_engine_object=nullptr; return -1;}
+    // 实现输出混音器对象
+    result = (*g_output_mix_object)->Realize(g_output_mix_object, SL_BOOLEAN_FALSE);
+    if (result!=SL_RESULT_SUCCESS) {LOGE("输出混音器Realize失败: %u",result); (*g_output_mix_object)->Destroy(g_output_mix_object); g_output_mix_object=nullptr; (*g_engine_object)->Destroy(g_engine_object); g_engine_object=nullptr; return -1;}
+    g_engine = engine;
+    LOGI("OpenSL ES音频引擎已初始化.");
+    return 0;
+}
+
+void Player::setAudioRate(float rate_factor) {
+    if (std::shared_ptr<NativeAudioPlayer> player = nativeAudio()) { // 原生音频在解码线程变速 (保持音调)，之后解码的数据生效
+        player->decoder.setSpeed(rate_factor);
+        LOGI("原生音频播放速度已设置为 %.2fx", rate_factor);
+        return;
+    }
+    if (sl_rate_ != nullptr) { // 检查播放速率接口是否有效
+        // 将浮点速率因子 (例如 1.0, 1.5) 转换为 SLpermille (千分之几，如 1000, 1500)
+        SLpermille ratePermille = static_cast<SLpermille>(roundf(rate_factor * 1000.0f)); // 使用 roundf 处理浮点数
+
+        SLpermille minRate, maxRate, stepSize;
+        SLuint32 capabilities;
+        // 获取支持的速率范围
+        SLresult result = (*sl_rate_)->GetRateRange(sl_rate_, 0, &minRate, &maxRate, &stepSize, &capabilities);
+
+        if (result == SL_RESULT_SUCCESS) { // 成功获取范围
+            if (ratePermille < minRate) { // 检查是否低于最小速率
+                LOGW("请求速率 %d permille 低于最小速率 %d. 将限制到最小速率.", ratePermille, minRate);
+                ratePermille = minRate;
+            } else if (ratePermille > maxRate) { // 检查是否高于最大速率
+                LOGW("请求速率 %d permille 高于最大速率 %d. 将限制到最大速率.", ratePermille, maxRate);
+                ratePermille = maxRate;
+            }
+        } else {
+            LOGW("获取速率范围失败 (错误: %u). 将继续使用请求速率 %d permille.", result, ratePermille);
+        }
+
+        // 尝试设置速率
+        result = (*sl_rate_)->SetRate(sl_rate_, ratePermille);
+        if (result == SL_RESULT_SUCCESS) {
+            LOGI("音频播放速率已设置为 %d permille (%.2fx)", ratePermille, rate_factor);
+        } else {
+            LOGE("设置音频播放速率到 %d permille 失败. 错误: %u", ratePermille, result);
+        }
+    } else {
+        LOGW("音频播放器速率接口 (sl_rate_) 为空. 无法设置播放速率.");
+    }
+}
+
+void Player::startAudio(const char *path, long start_offset_ms) {
+    destroyNativeAudio(); // 清理旧的原生音频播放器 (如果存在)
+    if (use_native_audio_) {
+        long offset = (start_offset_ms >= 0) ? start_offset_ms : audio_start_offset_ms_.load();
+        if (startNativeAudio(path, offset)) {
+            destroyAudioPlayer();
+            audio_start_offset_ms_ = -1;
+            return;
+        }
+        LOGW("原生音频 (FFmpeg + AAudio) 不可用，改用OpenSL ES播放");
+    }
+    SLEngineItf engine;
+    SLObjectItf output_mix;
+    {
+        std::lock_guard<std::mutex> lock(g_engine_mutex);
+        engine = g_engine;
+        output_mix = g_output_mix_object;
+    }
+    if (!engine) { LOGE("音频引擎未初始化!"); return; } // 检查引擎是否初始化
+    SLresult result;
+
+    destroyAudioPlayer(); // 清理旧的播放器相关对象 (如果存在)
+
+    // 配置数据源 (URI)
+    SLDataLocator_URI loc_uri = {SL_DATALOCATOR_URI, (SLchar *) path};
+    SLDataFormat_MIME format_mime = {SL_DATAFORMAT_MIME, nullptr, SL_CONTAINERTYPE_UNSPECIFIED};
+    SLDataSource audioSrc = {&loc_uri, &format_mime};
+
+    // 配置数据接收器 (进程共用的输出混音器)
+    SLDataLocator_OutputMix loc_outmix = {SL_DATALOCATOR_OUTPUTMIX, output_mix};
+    SLDataSink audioSnk = {&loc_outmix, nullptr};
+
+    // 请求播放、跳转和速率控制接口
+    const SLInterfaceID ids[3] = {SL_IID_PLAY, SL_IID_SEEK, SL_IID_PLAYBACKRATE};
+    const SLboolean req[3] = {SL_BOOLEAN_TRUE, SL_BOOLEAN_TRUE, SL_BOOLEAN_TRUE};
+    int numInterfaces = 3;
+
+    // 创建音频播放器对象
+    result = (*engine)->CreateAudioPlayer(engine, &sl_player_, &audioSrc, &audioSnk, numInterfaces, ids, req);
+    if (result != SL_RESULT_SUCCESS) { LOGE("创建音频播放器失败: %u", result); sl_player_ = nullptr; return; }
+
+    // 实现音频播放器对象
+    result = (*sl_player_)->Realize(sl_player_, SL_BOOLEAN_FALSE);
+    if (result != SL_RESULT_SUCCESS) { LOGE("实现音频播放器失败: %u", result); destroyAudioPlayer(); return; }
+
+    // 获取播放接口 (渲染线程通过它读取音频位置，在锁内发布)
+    SLPlayItf play_itf = nullptr;
+    result = (*sl_player_)->GetInterface(sl_player_, SL_IID_PLAY, &play_itf);
+    if (result != SL_RESULT_SUCCESS) { LOGE("获取播放接口失败: %u", result); destroyAudioPlayer(); return; }
+    {
+        std::lock_guard<std::mutex> lock(audio_player_mutex_);
+        sl_play_ = play_itf;
+    }
+
+    // 获取跳转接口
+    result = (*sl_player_)->GetInterface(sl_player_, SL_IID_SEEK, &sl_seek_);
+    if (result != SL_RESULT_SUCCESS) {
+        LOGW("获取跳转接口失败: %u. 音频跳转将不可用.", result);
+        sl_seek_ = nullptr; // 标记跳转接口不可用
+    }
+
+    // 获取速率控制接口
+    result = (*sl_player_)->GetInterface(sl_player_, SL_IID_PLAYBACKRATE, &sl_rate_);
+    if (result != SL_RESULT_SUCCESS) {
+        LOGW("获取播放速率接口失败: %u. 音频速度控制将不可用.", result);
+        sl_rate_ = nullptr; // 标记速率控制接口不可用
+    } else {
+        // (可选) 查询并打印支持的速率范围和能力
+        SLpermille minRateVal, maxRateVal, stepSizeVal;
+        SLuint32 capabilitiesVal;
+        (*sl_rate_)->GetRateRange(sl_rate_, 0, &minRateVal, &maxRateVal, &stepSizeVal, &capabilitiesVal);
+        LOGI("音频播放速率范围: min=%d, max=%d, step=%d, capabilities=0x%X", minRateVal, maxRateVal, stepSizeVal, capabilitiesVal);
+    }
+
+    // 确定实际的开始偏移量
+    long actualStartOffset = (start_offset_ms >= 0) ? start_offset_ms : audio_start_offset_ms_.exchange(-1);
+
+    if (actualStartOffset >= 0 && sl_seek_ != nullptr) { // 如果需要跳转且跳转接口可用
+        LOGI("音频播放前跳转到 %ld ms.", actualStartOffset);
+        result = (*sl_play_)->SetPlayState(sl_play_, SL_PLAYSTATE_PAUSED); // 先暂停播放器
+        if (result == SL_RESULT_SUCCESS) {
+            result = (*sl_seek_)->SetLoop(sl_seek_, SL_BOOLEAN_FALSE, 0, SL_TIME_UNKNOWN); // 设置不循环
+            if (result != SL_RESULT_SUCCESS) LOGW("跳转前设置循环为false失败: %u", result);
+
+            result = (*sl_seek_)->SetPosition(sl_seek_, (SLmillisecond)actualStartOffset, SL_SEEKMODE_ACCURATE); // 执行跳转
+            if (result != SL_RESULT_SUCCESS) {
+                LOGE("音频跳转到 %ld ms失败, 错误: %u. 将从头播放.", actualStartOffset, result);
+            } else {
+                LOGI("音频跳转到 %ld ms成功.", actualStartOffset);
+            }
+        } else {
+            LOGE("跳转前设置音频为PAUSED失败, 错误: %u.", result);
+        }
+    } else if (actualStartOffset >= 0) { // 需要跳转但接口不可用
+        LOGW("请求音频跳转到 %ld ms, 但跳转接口不可用或偏移无效.", actualStartOffset);
+    }
+
+    // 在开始播放前应用当前的播放速度到音频 (也用于视频帧延迟)
+    setAudioRate(playback_speed_.load());
+
+    // 设置播放状态为播放中
+    result = (*sl_play_)->SetPlayState(sl_play_, SL_PLAYSTATE_PLAYING);
+    if (result != SL_RESULT_SUCCESS) {
+        LOGE("设置播放状态为playing失败: %u", result);
+        destroyAudioPlayer(); // 清理播放器对象
+        return;
+    }
+
+    LOGI("音频播放已从文件开始: %s", path);
+}
+
+void Player::stopAudio() {
+    if (nativeAudio()) {
+        destroyNativeAudio();
+        LOGI("原生音频播放器已停止并销毁.");
+    }
+    if (sl_player_ != nullptr) { // 检查播放器对象是否存在
+        if (sl_play_ != nullptr) { // 检查播放接口是否存在
+            SLuint32 state;
+            (*sl_play_)->GetPlayState(sl_play_, &state); // 获取当前播放状态
+            if (state != SL_PLAYSTATE_STOPPED) { // 如果不是已停止状态
+                (*sl_play_)->SetPlayState(sl_play_, SL_PLAYSTATE_STOPPED); // 设置为停止状态
+            }
+        }
+        destroyAudioPlayer(); // 销毁播放器对象
+        LOGI("音频播放器已停止并销毁.");
+    }
+    audio_start_offset_ms_ = -1; // 重置音频开始偏移
+}
+
+void Player::pauseAudio(bool do_pause) {
+    if (std::shared_ptr<NativeAudioPlayer> player = nativeAudio()) { // AAudio状态切换较慢，在锁外进行
+        if (do_pause) player->paused = true; // 暂停期间不再作为视频的主时钟
+        int result = player->render.pause(do_pause);
+        if (!do_pause) player->paused = false;
+        if (result == AAUDIO_OK) LOGI("原生音频已%s", do_pause ? "暂停" : "恢复");
+        else LOGE("原生音频%s失败: %d", do_pause ? "暂停" : "恢复", result);
+        return;
+    }
+    if (sl_play_ != nullptr) { // 检查播放接口是否存在
+        SLuint32 targetState = do_pause ? SL_PLAYSTATE_PAUSED : SL_PLAYSTATE_PLAYING; // 确定目标状态
+        SLuint32 currentState;
+        SLresult result_getState = (*sl_play_)->GetPlayState(sl_play_,&currentState); // 获取当前状态
+
+        if (result_getState == SL_RESULT_SUCCESS) { // 获取状态成功
+            if (currentState != targetState) { // 如果当前状态不是目标状态
+                SLresult result_setState = (*sl_play_)->SetPlayState(sl_play_, targetState); // 设置目标状态
+                if (result_setState == SL_RESULT_SUCCESS) {
+                    LOGI("音频播放状态已设置为 %s", do_pause ? "PAUSED" : "PLAYING");
+                } else {
+                    LOGE("设置音频播放状态为 %s 失败, 错误: %u", do_pause ? "PAUSED" : "PLAYING", result_setState);
+                }
+            } else { // 已处于目标状态
+                LOGI("音频已处于期望状态: %s", do_pause ? "PAUSED" : "PLAYING");
+            }
+        } else { // 获取状态失败
+            LOGE("在pauseAudio中获取当前音频播放状态失败, 错误: %u", result_getState);
+        }
+    } else { // 播放器未初始化
+        LOGE("音频播放器未初始化, 无法 %s.", do_pause ? "暂停" : "恢复");
+    }
+}
+
+// 原生音频的解码管线跳转到time_s。视频刚在共用的解复用器上跳转 (seekToFrame) 时跟随那一次跳转，
+// 文件只定位一次，视频解码器也不会把音频的跳转当作别的消费者发起的跳转
+void Player::seekAudioDecoder(AudioDecoder *decoder, double time_s) {
+    int serial = video_seek_serial_.exchange(-1);
+    Demuxer *demuxer = decoder->demuxer();
+    if (serial >= 0 && stream_decoder_ && stream_decoder_->demuxer() == demuxer && demuxer->lastSerial() == serial) {
+        decoder->follow(time_s, serial);
+    } else {
+        decoder->seek(time_s);
+    }
+}
+
+void Player::seekAudio(long time_ms) {
+    if (time_ms < 0) { // 时间戳必须非负
+        LOGW("无效的音频跳转时间戳: %ld ms. 已忽略.", time_ms);
+        return;
+    }
+
+    // 锁内只复制播放器的引用；暂停AAudio、重启解码线程和清空AAudio都较慢，在锁外进行，
+    // 渲染线程读取音频位置时不会被阻塞 (paused期间音频不作为主时钟)
+    if (std::shared_ptr<NativeAudioPlayer> player = nativeAudio()) {
+        bool was_playing = !player->paused.exchange(true);
+        // 回调停止后才能清空解码管线的环形缓冲区；无法暂停时重建播放器
+        if (player->render.pause(true) == AAUDIO_OK) {
+            seekAudioDecoder(&player->decoder, time_ms / 1000.0);
+            if (was_playing) { // 丢弃AAudio中跳转前的数据并恢复播放
+                player->render.flush();
+                player->paused = false;
+            }
+            LOGI("原生音频已跳转到 %ld ms.", time_ms);
+            return;
+        }
+        LOGW("原生音频暂停失败，重新创建播放器以跳转到 %ld ms", time_ms);
+        std::string path = player->path;
+        player.reset(); // 由destroyNativeAudio释放
+        destroyNativeAudio();
+        if (!startNativeAudio(path.c_str(), time_ms)) {
+            LOGE("原生音频重新创建失败");
+        } else if (!was_playing && (player = nativeAudio())) {
+            player->paused = true;
+            player->render.pause(true);
+        }
+        return;
+    }
+
+    if (sl_play_ != nullptr && sl_seek_ != nullptr) { // 检查播放和跳转接口是否有效
+        SLuint32 currentState;
+        SLresult result_getState = (*sl_play_)->GetPlayState(sl_play_,&currentState); // 获取当前状态
+        if (result_getState != SL_RESULT_SUCCESS) {
+            LOGE("在seekAudio中获取跳转前当前音频状态失败: %u.", result_getState);
+        }
+
+        bool was_playing = (result_getState == SL_RESULT_SUCCESS && currentState == SL_PLAYSTATE_PLAYING); // 判断跳转前是否在播放
+        SLresult result;
+
+        if (was_playing) { // 如果在播放，先暂停
+            result = (*sl_play_)->SetPlayState(sl_play_, SL_PLAYSTATE_PAUSED);
+            if (result != SL_RESULT_SUCCESS) {
+                LOGW("跳转前暂停音频失败: %u. 跳转可能不太准确.", result);
+            }
+        }
+
+        result = (*sl_seek_)->SetLoop(sl_seek_, SL_BOOLEAN_FALSE, 0, SL_TIME_UNKNOWN); // 设置不循环
+        if (result != SL_RESULT_SUCCESS) LOGW("跳转时设置循环为false失败: %u", result);
+
+        result = (*sl_seek_)->SetPosition(sl_seek_, (SLmillisecond)time_ms, SL_SEEKMODE_ACCURATE); // 执行跳转
+        if (result == SL_RESULT_SUCCESS) {
+            LOGI("音频已跳转到 %ld ms.", time_ms);
+        } else {
+            LOGE("音频跳转到 %ld ms失败, 错误: %u", time_ms, result);
+        }
+
+        if (was_playing) { // 如果跳转前在播放，则恢复播放
+            result = (*sl_play_)->SetPlayState(sl_play_, SL_PLAYSTATE_PLAYING);
+            if (result != SL_RESULT_SUCCESS) {
+                LOGE("跳转后恢复音频播放失败: %u.", result);
+            }
+        }
+        // 如果音频原本是停止状态，跳转后不自动播放，而是记录偏移供下次startAudio使用
+        if (result_getState == SL_RESULT_SUCCESS && currentState == SL_PLAYSTATE_STOPPED) {
+            audio_start_offset_ms_ = time_ms; // 记录跳转位置
+            LOGI("音频已停止. 播放器跳转到 %ld ms, 下次启动时将从该位置播放.", time_ms);
+        }
+
+    } else { // 播放器未准备好或跳转接口不可用
+        audio_start_offset_ms_ = time_ms; // 存储目标时间戳供下次播放时使用
+        LOGW("音频播放器未准备好跳转 (或跳转接口不可用). 已存储目标 %ld ms 供下次播放.", time_ms);
+    }
+}
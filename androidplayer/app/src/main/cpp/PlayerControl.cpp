@@ -0,0 +1,131 @@
+#include "PlayerControl.h"
+#include <algorithm>
+#include <chrono>
+#include "PresentationClock.h"
+
+const char *player_state_name(PlayerState state) {
+    switch (state) {
+        case PlayerState::Playing: return "playing";
+        case PlayerState::Paused: return "paused";
+        default: return "stopped";
+    }
+}
+
+void PlayerControl::post(PlayerCommandType type, long frame, bool decoder_seeked) {
+    PlayerCommand command;
+    command.type = type;
+    command.frame = frame;
+    command.decoder_seeked = decoder_seeked;
+    command.issued_ns = PresentationClock::nowNs();
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.commands++;
+    // 队尾的跳转尚未执行时直接替换：拖动进度条产生的连续跳转只执行最后一个
+    if (type == PlayerCommandType::Seek && !commands_.empty() && commands_.back().type == PlayerCommandType::Seek) {
+        commands_.back() = command;
+        stats_.coalesced_seeks++;
+    } else {
+        commands_.push_back(command);
+    }
+    cv_.notify_all();
+    if (wake_hook_) wake_hook_();
+}
+
+long PlayerControl::begin() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    long frame = -1;
+    for (const PlayerCommand &command : commands_) {
+        if (command.type == PlayerCommandType::Seek) frame = command.frame;
+    }
+    commands_.clear();
+    stats_ = Stats();
+    state_ = PlayerState::Playing;
+    return frame;
+}
+
+void PlayerControl::end() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    commands_.clear();
+    wake_hook_ = nullptr;
+    state_ = PlayerState::Stopped;
+}
+
+void PlayerControl::setWakeHook(std::function<void()> hook) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_hook_ = std::move(hook);
+}
+
+PlayerState PlayerControl::state() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return state_;
+}
+
+bool PlayerControl::next(PlayerCommand *command) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (commands_.empty()) return false;
+    *command = commands_.front();
+    commands_.pop_front();
+    return true;
+}
+
+bool PlayerControl::waitFor(int64_t deadline_ns) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (deadline_ns < 0) {
+        cv_.wait(lock, [this]() { return !commands_.empty(); });
+        return true;
+    }
+    // steady_clock即CLOCK_MONOTONIC (与PresentationClock::nowNs同一时钟)，按绝对时刻等待，唤醒延迟不会累积到截止时刻上
+    std::chrono::steady_clock::time_point deadline{std::chrono::nanoseconds(deadline_ns)};
+    return cv_.wait_until(lock, deadline, [this]() { return !commands_.empty(); });
+}
+
+void PlayerControl::waitWhilePaused() {
+    waitFor(-1);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.paused_wakeups++;
+}
+
+PlayerState PlayerControl::apply(const PlayerCommand &command) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    switch (command.type) {
+        case PlayerCommandType::Pause:
+            if (state_ == PlayerState::Playing) state_ = PlayerState::Paused;
+            break;
+        case PlayerCommandType::Resume:
+            if (state_ == PlayerState::Paused) state_ = PlayerState::Playing;
+            break;
+        case PlayerCommandType::Stop:
+            state_ = PlayerState::Stopped;
+            break;
+        case PlayerCommandType::Seek:
+        case PlayerCommandType::Redraw:
+            break;
+    }
+    return state_;
+}
+
+void PlayerControl::effectDone(const PlayerCommand &command) {
+    double ms = (PresentationClock::nowNs() - command.issued_ns) / 1e6;
+    std::lock_guard<std::mutex> lock(mutex_);
+    Latency *latency = &stats_.pause;
+    switch (command.type) {
+        case PlayerCommandType::Pause: latency = &stats_.pause; break;
+        case PlayerCommandType::Resume: latency = &stats_.resume; break;
+        case PlayerCommandType::Seek: latency = &stats_.seek; break;
+        case PlayerCommandType::Stop: latency = &stats_.stop; break;
+        case PlayerCommandType::Redraw: latency = &stats_.redraw; break;
+    }
+    latency->count++;
+    latency->last_ms = ms;
+    latency->avg_ms += (ms - latency->avg_ms) / latency->count;
+    latency->max_ms = std::max(latency->max_ms, ms);
+}
+
+PlayerControl::Stats PlayerControl::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void PlayerControl::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = Stats();
+}
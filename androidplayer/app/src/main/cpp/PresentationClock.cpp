@@ -0,0 +1,129 @@
+#include "PresentationClock.h"
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+int64_t PresentationClock::nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void PresentationClock::sleepUntilNs(int64_t deadline_ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t) (deadline_ns / 1000000000LL);
+    ts.tv_nsec = (long) (deadline_ns % 1000000000LL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+void PresentationClock::anchor(double media_time_s, int64_t now_ns) {
+    anchor_media_s_ = media_time_s;
+    anchor_ns_ = now_ns;
+}
+
+void PresentationClock::start(double media_time_s, double speed) {
+    speed_ = speed > 0.01 ? speed : 0.01;
+    anchor(media_time_s, nowNs());
+    running_ = true;
+    paused_ = false;
+    consecutive_drops_ = 0;
+}
+
+void PresentationClock::reset() {
+    running_ = false;
+    paused_ = false;
+    consecutive_drops_ = 0;
+}
+
+void PresentationClock::pause() {
+    if (!running_ || paused_) return;
+    paused_media_s_ = mediaTime();
+    paused_ = true;
+}
+
+void PresentationClock::resume() {
+    if (!paused_) return;
+    anchor(paused_media_s_, nowNs());
+    paused_ = false;
+}
+
+void PresentationClock::setSpeed(double speed) {
+    if (speed <= 0.01) speed = 0.01;
+    if (speed == speed_) return;
+    if (running_ && !paused_) {
+        int64_t now = nowNs();
+        double media = anchor_media_s_ + (now - anchor_ns_) / 1e9 * speed_;
+        anchor(media, now);
+    }
+    speed_ = speed;
+}
+
+void PresentationClock::retime(double media_time_s) {
+    if (!running_) return;
+    if (paused_) paused_media_s_ = media_time_s;
+    else anchor(media_time_s, nowNs());
+    consecutive_drops_ = 0;
+}
+
+double PresentationClock::mediaTime() const {
+    if (!running_) return 0.0;
+    if (paused_) return paused_media_s_;
+    return anchor_media_s_ + (nowNs() - anchor_ns_) / 1e9 * speed_;
+}
+
+int64_t PresentationClock::deadlineNs(double media_time_s) const {
+    return anchor_ns_ + (int64_t) llround((media_time_s - anchor_media_s_) / speed_ * 1e9);
+}
+
+bool PresentationClock::shouldDrop(double media_time_s) {
+    if (!running_ || paused_) return false;
+    int64_t now = nowNs();
+    double late_ms = (now - deadlineNs(media_time_s)) / 1e6;
+    if (late_ms > config_.resync_threshold_ms) { // 严重落后：以此帧重新对齐，不再追赶
+        anchor(media_time_s, now);
+        consecutive_drops_ = 0;
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.resyncs++;
+        return false;
+    }
+    if (late_ms > config_.drop_threshold_ms && consecutive_drops_ < config_.max_consecutive_drops) {
+        consecutive_drops_++;
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.dropped++;
+        return true;
+    }
+    consecutive_drops_ = 0;
+    return false;
+}
+
+void PresentationClock::waitUntil(double media_time_s) const {
+    if (!running_ || paused_) return;
+    int64_t deadline = deadlineNs(media_time_s);
+    if (deadline > nowNs()) sleepUntilNs(deadline);
+}
+
+void PresentationClock::framePresented(double media_time_s) {
+    if (!running_ || paused_) return;
+    double drift_ms = (nowNs() - deadlineNs(media_time_s)) / 1e6;
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats &s = stats_;
+    s.presented++;
+    s.last_drift_ms = drift_ms;
+    double delta = drift_ms - s.drift_mean_ms;
+    s.drift_mean_ms += delta / s.presented;
+    drift_m2_ += delta * (drift_ms - s.drift_mean_ms);
+    s.jitter_ms = s.presented > 1 ? sqrt(drift_m2_ / (s.presented - 1)) : 0.0;
+    if (fabs(drift_ms) > fabs(s.drift_max_ms)) s.drift_max_ms = drift_ms;
+}
+
+PresentationClock::Stats PresentationClock::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
+
+void PresentationClock::resetStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_ = Stats();
+    drift_m2_ = 0.0;
+}
@@ -0,0 +1,301 @@
+#include "StreamDecoder.h"
+#include <algorithm>
+#include <cmath>
+#include "DecoderConfig.h"
+#include "FrameNormalizer.h"
+#include "android/log.h"
+
+#define LOG_TAG "StreamDecoder"
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+
+static const size_t kPacketQueueBytes = 4 * 1024 * 1024; // 视频包队列的常规上限 (1080p 4Mbps约8s)
+static const size_t kFrameQueueDepth = 8;      // 帧队列容量（已解码帧占内存较大，保持较小）
+static const size_t kFrameQueueBytes = 64 * 1024 * 1024; // 帧队列的内存预算 (2160p时约5帧，更低分辨率受容量限制)
+static const int kQueueWaitMs = 20;            // 队列阻塞等待时间，超时后检查终止/跳转请求
+
+// 帧持有的缓冲区总字节数 (计入帧队列的内存预算)
+static size_t frame_bytes(const AVFrame *frame) {
+    size_t bytes = 0;
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++) bytes += frame->buf[i]->size;
+    return bytes;
+}
+
+StreamDecoder::StreamDecoder(size_t frame_queue_depth, size_t frame_queue_bytes, std::shared_ptr<FramePool> frame_pool)
+    : frame_pool_(frame_pool ? std::move(frame_pool) : std::make_shared<FramePool>()),
+      frame_queue_(frame_queue_depth > 0 ? frame_queue_depth : kFrameQueueDepth,
+                   frame_queue_bytes > 0 ? frame_queue_bytes : kFrameQueueBytes) {
+}
+
+StreamDecoder::~StreamDecoder() {
+    stop();
+}
+
+int StreamDecoder::open(const char *path, const char *index_path) {
+    std::shared_ptr<Demuxer> demuxer = std::make_shared<Demuxer>();
+    int ret = demuxer->open(path);
+    if (ret < 0) return ret;
+    return open(demuxer, index_path);
+}
+
+int StreamDecoder::open(const std::shared_ptr<Demuxer> &demuxer, const char *index_path) {
+    AVFormatContext *fmt_ctx = demuxer->formatContext();
+    if (!stream_counted_) { // 先登记再打开，自动线程数已计入本路
+        decoder_stream_opened();
+        stream_counted_ = true;
+    }
+    int ret = decoder_open_video_stream(fmt_ctx, decoder_default_thread_config(), &codec_ctx_, &stream_idx_,
+                                        [this](AVCodecContext *ctx) { frame_pool_->attach(ctx); });
+    if (ret < 0) {
+        if (codec_ctx_) avcodec_free_context(&codec_ctx_);
+        stream_idx_ = -1;
+        decoder_stream_closed();
+        stream_counted_ = false;
+        return ret;
+    }
+    demuxer_ = demuxer;
+    const char *path = demuxer->path().c_str();
+
+    // 只读取包不解码的扫描，结果保存后下次打开直接加载
+    FrameCacheSourceKey source;
+    use_index_ = index_path && frame_cache_compute_source_key(path, &source) == kFrameCacheOk &&
+                 index_.loadOrBuild(path, source, index_path) == 0 && index_.hasUniquePts();
+    if (index_path && !use_index_) LOGW("关键帧索引不可用，按帧率估算跳转位置");
+
+    AVStream *stream = fmt_ctx->streams[stream_idx_];
+    AVCodecParameters *par = stream->codecpar;
+    width_ = par->width;
+    height_ = par->height;
+    color_space_ = codec_ctx_->colorspace;
+    color_range_ = FrameNormalizer::outputRange(codec_ctx_->pix_fmt, codec_ctx_->color_range);
+    chroma_location_ = codec_ctx_->chroma_sample_location;
+    time_base_ = stream->time_base;
+    start_pts_ = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    if (stream->avg_frame_rate.num != 0 && stream->avg_frame_rate.den != 0) frame_rate_q_ = stream->avg_frame_rate;
+    else if (stream->r_frame_rate.num != 0 && stream->r_frame_rate.den != 0) frame_rate_q_ = stream->r_frame_rate;
+    else frame_rate_q_ = {25, 1};
+    frame_rate_ = av_q2d(frame_rate_q_);
+
+    // 总帧数：有索引时为精确值，否则优先使用容器记录的帧数，再由时长推算
+    if (use_index_) {
+        total_frames_ = index_.frameCount();
+    } else if (stream->nb_frames > 0) {
+        total_frames_ = (long) stream->nb_frames;
+    } else if (stream->duration != AV_NOPTS_VALUE) {
+        total_frames_ = (long) llround(stream->duration * av_q2d(time_base_) * frame_rate_);
+    } else if (fmt_ctx->duration != AV_NOPTS_VALUE) {
+        total_frames_ = (long) llround(fmt_ctx->duration / (double) AV_TIME_BASE * frame_rate_);
+    }
+    packet_queue_ = demuxer_->enableStream(stream_idx_, kPacketQueueBytes);
+    LOGI("流式解码器已打开: %dx%d @ %f fps, 约 %ld 帧", width_, height_, frame_rate_, total_frames_);
+    return 0;
+}
+
+int StreamDecoder::start() {
+    if (!codec_ctx_) return -1;
+    abort_ = false;
+    frame_queue_.reset();
+    bool seek_pending;
+    {
+        std::lock_guard<std::mutex> lock(seek_mutex_);
+        seek_pending = seek_target_serial_ >= 0;
+    }
+    // 加入已在运行的共用解复用器时读取位置在文件中间 (不一定是关键帧)，先定位到起点
+    if (demuxer_->running() && !seek_pending) seekToFrame(0);
+    decode_thread_ = std::thread(&StreamDecoder::decodeLoop, this);
+    return demuxer_->start();
+}
+
+void StreamDecoder::stop() {
+    abort_ = true;
+    frame_queue_.abort();
+    if (decode_thread_.joinable()) decode_thread_.join();
+    releaseQueues();
+    if (demuxer_) { // 最后一个使用者释放时解复用线程随之停止
+        demuxer_->disableStream(stream_idx_);
+        demuxer_.reset();
+        packet_queue_ = nullptr;
+    }
+    if (codec_ctx_) avcodec_free_context(&codec_ctx_);
+    stream_idx_ = -1;
+    if (stream_counted_) {
+        decoder_stream_closed();
+        stream_counted_ = false;
+    }
+}
+
+// 解码线程已结束，可代替消费者清空帧队列
+void StreamDecoder::releaseQueues() {
+    frame_queue_.clear([this](FrameItem &item) { frame_pool_->releaseFrame(&item.frame); });
+}
+
+int StreamDecoder::seekToFrame(long frameNum) {
+    if (frameNum < 0 || !demuxer_) return -1;
+    int64_t target_pts = frameToPts(frameNum);
+    int64_t key_ts = target_pts, key_pos = -1; // 没有索引时按目标时间戳向前定位到关键帧
+    long key = use_index_ ? index_.keyframeBefore(target_pts) : -1;
+    if (key >= 0) { // 直接定位到索引中的关键帧 (按其解码时间戳，与容器索引一致)，失败时按字节偏移定位
+        const VideoPacketInfo &info = index_.packets()[key];
+        key_ts = info.dts != AV_NOPTS_VALUE ? info.dts : info.pts;
+        key_pos = info.pos;
+    }
+    // 在锁内提交，解码线程看到新序号的包时一定能取得对应的目标
+    std::lock_guard<std::mutex> lock(seek_mutex_);
+    seek_requested_at_ = std::chrono::steady_clock::now();
+    int serial = demuxer_->seek((target_pts - start_pts_) * av_q2d(time_base_), key_ts, key_pos);
+    seek_target_serial_ = serial;
+    seek_target_pts_ = target_pts;
+    measure_target_ = frameNum;
+    measure_serial_ = serial;
+    serial_ = serial; // 此后popFrame丢弃更早序号的帧
+    return serial;
+}
+
+int64_t StreamDecoder::frameToPts(long frameNum) const {
+    if (use_index_) { // 按显示顺序取得目标帧的准确时间戳
+        int64_t pts = index_.ptsOfDisplayIndex(std::min(frameNum, index_.frameCount() - 1));
+        if (pts != AV_NOPTS_VALUE) return pts;
+    }
+    return start_pts_ + av_rescale_q(frameNum, av_inv_q(frame_rate_q_), time_base_);
+}
+
+long StreamDecoder::frameIndexOf(const AVFrame *frame) const {
+    int64_t pts = frame->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE) pts = frame->pts;
+    if (pts == AV_NOPTS_VALUE) return -1;
+    if (use_index_) {
+        long index = index_.displayIndexOf(pts);
+        if (index >= 0) return index;
+    }
+    return (long) llround((pts - start_pts_) * av_q2d(time_base_) * frame_rate_);
+}
+
+double StreamDecoder::frameTimeMs(const AVFrame *frame) const {
+    int64_t pts = frame->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE) pts = frame->pts;
+    if (pts == AV_NOPTS_VALUE) return std::max(0L, frameIndexOf(frame)) * 1000.0 / frame_rate_;
+    return (pts - start_pts_) * av_q2d(time_base_) * 1000.0;
+}
+
+StreamDecoder::SeekStats StreamDecoder::seekStats() const {
+    std::lock_guard<std::mutex> lock(seek_mutex_);
+    return seek_stats_;
+}
+
+// 跳转后的第一帧被取出时调用 (渲染线程)
+void StreamDecoder::recordSeekLatency() {
+    std::lock_guard<std::mutex> lock(seek_mutex_);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - seek_requested_at_).count();
+    SeekStats &stats = seek_stats_;
+    stats.count++;
+    stats.last_ms = ms;
+    stats.avg_ms += (ms - stats.avg_ms) / stats.count;
+    stats.max_ms = std::max(stats.max_ms, ms);
+    stats.last_decoded_forward = dropped_since_seek_.load();
+    measure_serial_ = -1;
+    LOGI("跳转到帧 %ld: 向前解码 %ld 帧, 耗时 %.1f ms", measure_target_, stats.last_decoded_forward, ms);
+}
+
+void StreamDecoder::decodeLoop() {
+    LOGI("解码线程启动.");
+    AVFrame *frame = av_frame_alloc();
+    int current_serial = serial_.load();
+    int64_t drop_before = AV_NOPTS_VALUE;
+    int64_t last_pts = AV_NOPTS_VALUE; // 最近送出的帧的时间戳
+    FrameNormalizer normalizer;
+
+    // 将解码出的帧送入帧队列，队列满时阻塞；跳转发生时丢弃
+    auto deliver = [&](AVFrame *decoded) {
+        int64_t pts = decoded->best_effort_timestamp;
+        if (drop_before != AV_NOPTS_VALUE && pts != AV_NOPTS_VALUE && pts < drop_before) {
+            av_frame_unref(decoded); // 跳转后早于目标的帧，仅用于解码参考，不输出
+            dropped_since_seek_++;
+            return;
+        }
+        if (pts != AV_NOPTS_VALUE) last_pts = pts;
+        AVFrame *out = frame_pool_->acquireFrame();
+        if (!out) {
+            av_frame_unref(decoded);
+            return;
+        }
+        if (FrameNormalizer::isNative(decoded)) { // 只转移缓冲区引用，解码器从池中分配的缓冲区直接交给渲染线程
+            av_frame_move_ref(out, decoded);
+        } else { // 渲染只处理YUV420P，在解码线程中完成格式转换
+            if (normalizer.convert(decoded, out, frame_pool_.get()) < 0) av_frame_unref(out);
+            av_frame_unref(decoded);
+            if (!out->data[0]) {
+                frame_pool_->releaseFrame(&out);
+                return;
+            }
+        }
+        size_t bytes = frame_bytes(out);
+        while (!abort_ && current_serial >= serial_.load()) {
+            if (frame_queue_.push({out, current_serial}, bytes, kQueueWaitMs)) return;
+        }
+        frame_pool_->releaseFrame(&out);
+    };
+
+    while (!abort_) {
+        PacketQueue::Item item;
+        if (!packet_queue_->pop(item, kQueueWaitMs)) continue;
+        if (item.serial < serial_.load()) { // 自己最近一次跳转之前的包，作废
+            packet_queue_->recycle(&item.pkt);
+            continue;
+        }
+
+        if (item.serial != current_serial) { // 跳转后的第一个包：清空解码器内部缓存
+            avcodec_flush_buffers(codec_ctx_);
+            current_serial = item.serial;
+            std::lock_guard<std::mutex> lock(seek_mutex_);
+            if (seek_target_serial_ >= 0 && item.serial >= seek_target_serial_) { // 自己发起的跳转 (可能与之后的合并)
+                drop_before = seek_target_pts_;
+                last_pts = AV_NOPTS_VALUE; // 跳转前送出的位置不再有意义
+                seek_target_serial_ = -1;
+                dropped_since_seek_ = 0;
+                // 帧队列只能由渲染线程出队：队列中跳转前的旧帧由popFrame按序号丢弃
+            } else if (last_pts != AV_NOPTS_VALUE) { // 音频发起的跳转
+                // 目标在已送出的帧之后时从其后继续，不重复显示；向后跳转时从目标开始，不能丢弃到原来的位置
+                double time_s;
+                int64_t target = demuxer_->seekTime(item.serial, &time_s)
+                                 ? start_pts_ + (int64_t) llround(time_s / av_q2d(time_base_)) : AV_NOPTS_VALUE;
+                drop_before = target != AV_NOPTS_VALUE && target <= last_pts ? target : last_pts + 1;
+                last_pts = AV_NOPTS_VALUE;
+            }
+        }
+
+        if (!item.pkt) { // 流结束：冲洗解码器中剩余的帧
+            avcodec_send_packet(codec_ctx_, nullptr);
+            while (avcodec_receive_frame(codec_ctx_, frame) == 0) deliver(frame);
+            avcodec_flush_buffers(codec_ctx_);
+            while (!abort_ && current_serial >= serial_.load()) {
+                if (frame_queue_.push({nullptr, current_serial}, 0, kQueueWaitMs)) break;
+            }
+            continue;
+        }
+
+        if (avcodec_send_packet(codec_ctx_, item.pkt) == 0) {
+            while (avcodec_receive_frame(codec_ctx_, frame) == 0) deliver(frame);
+        }
+        packet_queue_->recycle(&item.pkt); // 放回空闲链表，解复用线程复用
+    }
+    av_frame_free(&frame);
+    LOGI("解码线程结束.");
+}
+
+int StreamDecoder::popFrame(AVFrame **frame, int timeoutMs) {
+    FrameItem item;
+    while (true) {
+        if (abort_) return -1;
+        if (!frame_queue_.pop(item, timeoutMs)) return abort_ ? -1 : 0;
+        if (item.serial < serial_.load()) { // 跳转前的旧帧，丢弃
+            frame_pool_->releaseFrame(&item.frame);
+            continue;
+        }
+        int measure_serial = measure_serial_.load();
+        if (measure_serial >= 0 && item.serial >= measure_serial) recordSeekLatency();
+        if (!item.frame) return -1;
+        *frame = item.frame;
+        return 1;
+    }
+}
@@ -0,0 +1,316 @@
+#include "TimeStretcher.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__aarch64__) || (defined(__arm__) && defined(__ARM_NEON))
+#define STRETCH_HAVE_NEON 1
+#include <arm_neon.h>
+#if defined(__arm__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+#define STRETCH_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+static const int kHopMs = 10;         // 输出hop，窗长为其两倍
+static const int kSearchMs = 6;       // 在理想位置前后的搜索范围
+static const int kCoarseStep = 4;     // 粗搜索步长，之后在最优点附近逐采样细搜索
+static const int kCompactFrames = 16384; // 已消费的输入超过此帧数时整理缓冲区
+
+static void correlate_scalar(const float *a, const float *b, int n, float *corr, float *energy) {
+    float c = 0.0f, e = 0.0f;
+    for (int i = 0; i < n; i++) {
+        c += a[i] * b[i];
+        e += b[i] * b[i];
+    }
+    *corr = c;
+    *energy = e;
+}
+
+#if STRETCH_HAVE_NEON
+static void correlate_neon(const float *a, const float *b, int n, float *corr, float *energy) {
+    float32x4_t c0 = vdupq_n_f32(0.0f), c1 = vdupq_n_f32(0.0f);
+    float32x4_t e0 = vdupq_n_f32(0.0f), e1 = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t a0 = vld1q_f32(a + i), a1 = vld1q_f32(a + i + 4);
+        float32x4_t b0 = vld1q_f32(b + i), b1 = vld1q_f32(b + i + 4);
+        c0 = vmlaq_f32(c0, a0, b0);
+        c1 = vmlaq_f32(c1, a1, b1);
+        e0 = vmlaq_f32(e0, b0, b0);
+        e1 = vmlaq_f32(e1, b1, b1);
+    }
+    float32x4_t cs = vaddq_f32(c0, c1), es = vaddq_f32(e0, e1);
+    float c = vgetq_lane_f32(cs, 0) + vgetq_lane_f32(cs, 1) + vgetq_lane_f32(cs, 2) + vgetq_lane_f32(cs, 3);
+    float e = vgetq_lane_f32(es, 0) + vgetq_lane_f32(es, 1) + vgetq_lane_f32(es, 2) + vgetq_lane_f32(es, 3);
+    for (; i < n; i++) {
+        c += a[i] * b[i];
+        e += b[i] * b[i];
+    }
+    *corr = c;
+    *energy = e;
+}
+#endif
+
+#if STRETCH_HAVE_X86
+__attribute__((target("sse")))
+static float sse_sum(__m128 v) {
+    float lanes[4];
+    _mm_storeu_ps(lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("sse")))
+static void correlate_sse(const float *a, const float *b, int n, float *corr, float *energy) {
+    __m128 c0 = _mm_setzero_ps(), c1 = _mm_setzero_ps();
+    __m128 e0 = _mm_setzero_ps(), e1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 a0 = _mm_loadu_ps(a + i), a1 = _mm_loadu_ps(a + i + 4);
+        __m128 b0 = _mm_loadu_ps(b + i), b1 = _mm_loadu_ps(b + i + 4);
+        c0 = _mm_add_ps(c0, _mm_mul_ps(a0, b0));
+        c1 = _mm_add_ps(c1, _mm_mul_ps(a1, b1));
+        e0 = _mm_add_ps(e0, _mm_mul_ps(b0, b0));
+        e1 = _mm_add_ps(e1, _mm_mul_ps(b1, b1));
+    }
+    float c = sse_sum(_mm_add_ps(c0, c1));
+    float e = sse_sum(_mm_add_ps(e0, e1));
+    for (; i < n; i++) {
+        c += a[i] * b[i];
+        e += b[i] * b[i];
+    }
+    *corr = c;
+    *energy = e;
+}
+
+__attribute__((target("avx")))
+static void correlate_avx(const float *a, const float *b, int n, float *corr, float *energy) {
+    __m256 c0 = _mm256_setzero_ps(), c1 = _mm256_setzero_ps();
+    __m256 e0 = _mm256_setzero_ps(), e1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 a0 = _mm256_loadu_ps(a + i), a1 = _mm256_loadu_ps(a + i + 8);
+        __m256 b0 = _mm256_loadu_ps(b + i), b1 = _mm256_loadu_ps(b + i + 8);
+        c0 = _mm256_add_ps(c0, _mm256_mul_ps(a0, b0));
+        c1 = _mm256_add_ps(c1, _mm256_mul_ps(a1, b1));
+        e0 = _mm256_add_ps(e0, _mm256_mul_ps(b0, b0));
+        e1 = _mm256_add_ps(e1, _mm256_mul_ps(b1, b1));
+    }
+    __m256 cs = _mm256_add_ps(c0, c1), es = _mm256_add_ps(e0, e1);
+    float lanes[8];
+    _mm256_storeu_ps(lanes, cs);
+    float c = lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    _mm256_storeu_ps(lanes, es);
+    float e = lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    for (; i < n; i++) {
+        c += a[i] * b[i];
+        e += b[i] * b[i];
+    }
+    *corr = c;
+    *energy = e;
+}
+#endif
+
+bool TimeStretcher::isKernelSupported(CorrelationKernel kernel) {
+    switch (kernel) {
+        case CorrelationKernel::Scalar:
+            return true;
+        case CorrelationKernel::Neon:
+#if STRETCH_HAVE_NEON && defined(__aarch64__)
+            return true;
+#elif STRETCH_HAVE_NEON
+            return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+            return false;
+#endif
+        case CorrelationKernel::Sse:
+#if STRETCH_HAVE_X86
+            return __builtin_cpu_supports("sse");
+#else
+            return false;
+#endif
+        case CorrelationKernel::Avx:
+#if STRETCH_HAVE_X86
+            return __builtin_cpu_supports("avx");
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+CorrelationKernel TimeStretcher::detectBestKernel() {
+    static const CorrelationKernel preference[] = {CorrelationKernel::Avx, CorrelationKernel::Sse,
+                                                   CorrelationKernel::Neon};
+    for (CorrelationKernel kernel : preference) {
+        if (isKernelSupported(kernel)) return kernel;
+    }
+    return CorrelationKernel::Scalar;
+}
+
+const char *TimeStretcher::kernelName(CorrelationKernel kernel) {
+    switch (kernel) {
+        case CorrelationKernel::Scalar: return "scalar";
+        case CorrelationKernel::Neon: return "neon";
+        case CorrelationKernel::Sse: return "sse";
+        case CorrelationKernel::Avx: return "avx";
+    }
+    return "unknown";
+}
+
+TimeStretcher::TimeStretcher() : TimeStretcher(detectBestKernel()) {
+}
+
+TimeStretcher::TimeStretcher(CorrelationKernel kernel)
+        : kernel_(CorrelationKernel::Scalar), corr_func_(correlate_scalar) {
+    if (isKernelSupported(kernel)) { // 不支持的内核回退到标量实现
+        kernel_ = kernel;
+        switch (kernel) {
+#if STRETCH_HAVE_NEON
+            case CorrelationKernel::Neon: corr_func_ = correlate_neon; break;
+#endif
+#if STRETCH_HAVE_X86
+            case CorrelationKernel::Sse: corr_func_ = correlate_sse; break;
+            case CorrelationKernel::Avx: corr_func_ = correlate_avx; break;
+#endif
+            default: corr_func_ = correlate_scalar; break;
+        }
+    }
+    configure(sample_rate_, channels_);
+}
+
+void TimeStretcher::configure(int sample_rate, int channels) {
+    sample_rate_ = std::max(1, sample_rate);
+    channels_ = std::max(1, channels);
+    hop_ = std::max(16, sample_rate_ * kHopMs / 1000);
+    search_ = sample_rate_ * kSearchMs / 1000;
+    fade_in_.resize(hop_);
+    for (int i = 0; i < hop_; i++) fade_in_[i] = (float) (0.5 - 0.5 * cos(M_PI * (i + 0.5) / hop_));
+    tail_.assign((size_t) hop_ * channels_, 0.0f);
+    tail_mono_.assign(hop_, 0.0f);
+    reset();
+}
+
+void TimeStretcher::setSpeed(double speed) {
+    speed_ = std::max(kMinSpeed, std::min(kMaxSpeed, speed));
+}
+
+void TimeStretcher::reset() {
+    input_.clear();
+    mono_.clear();
+    output_.clear();
+    output_read_ = 0;
+    input_base_ = 0;
+    ideal_pos_ = 0.0;
+    started_ = false;
+}
+
+void TimeStretcher::putInput(const float *in, int frames) {
+    input_.insert(input_.end(), in, in + (size_t) frames * channels_);
+    const float scale = 1.0f / channels_;
+    for (int f = 0; f < frames; f++) {
+        float sum = 0.0f;
+        for (int c = 0; c < channels_; c++) sum += in[(size_t) f * channels_ + c];
+        mono_.push_back(sum * scale);
+    }
+    process();
+}
+
+void TimeStretcher::flush() {
+    std::vector<float> silence((size_t) (search_ + 2 * hop_) * channels_, 0.0f);
+    putInput(silence.data(), search_ + 2 * hop_);
+}
+
+int TimeStretcher::pendingOutput() const {
+    return (int) (output_.size() / channels_ - output_read_);
+}
+
+int TimeStretcher::receiveOutput(float *out, int max_frames) {
+    int n = std::min(max_frames, pendingOutput());
+    if (n <= 0) return 0; // 没有待输出的数据时output_可能为空 (data()为空指针)
+    memcpy(out, output_.data() + output_read_ * channels_, (size_t) n * channels_ * sizeof(float));
+    output_read_ += n;
+    if (output_read_ * channels_ == output_.size()) {
+        output_.clear();
+        output_read_ = 0;
+    }
+    return n;
+}
+
+double TimeStretcher::inputPosition() const {
+    return ideal_pos_ - pendingOutput() * speed_;
+}
+
+// 在[lo, hi]中找与模板 (上一段的自然延续) 最相似的候选起点：先按kCoarseStep粗搜索，再在最优点附近逐采样细搜索。
+// 相似度为归一化互相关 corr / sqrt(energy)
+int64_t TimeStretcher::search(int64_t lo, int64_t hi) const {
+    const float *mono = mono_.data() - input_base_;
+    auto score = [&](int64_t pos) {
+        float corr, energy;
+        corr_func_(tail_mono_.data(), mono + pos, hop_, &corr, &energy);
+        return corr / sqrtf(energy + 1e-9f);
+    };
+    int64_t best = lo;
+    float best_score = -INFINITY;
+    for (int64_t pos = lo; pos <= hi; pos += kCoarseStep) {
+        float s = score(pos);
+        if (s > best_score) { best_score = s; best = pos; }
+    }
+    int64_t center = best;
+    for (int64_t pos = std::max(lo, center - kCoarseStep + 1); pos <= std::min(hi, center + kCoarseStep - 1); pos++) {
+        if (pos == center) continue;
+        float s = score(pos);
+        if (s > best_score) { best_score = s; best = pos; }
+    }
+    return best;
+}
+
+void TimeStretcher::process() {
+    int64_t input_end = input_base_ + (int64_t) mono_.size();
+    if (!started_) { // 第一段的模板就是输入开头，速度为1时输出与输入完全一致
+        if (input_end - input_base_ < hop_) return;
+        memcpy(tail_.data(), input_.data(), tail_.size() * sizeof(float));
+        memcpy(tail_mono_.data(), mono_.data(), hop_ * sizeof(float));
+        started_ = true;
+    }
+    while (true) {
+        int64_t ideal = (int64_t) llround(ideal_pos_);
+        int64_t lo = std::max(input_base_, ideal - search_);
+        int64_t hi = ideal + search_;
+        if (speed_ == 1.0) lo = hi = std::max(input_base_, ideal); // 原速不需要搜索
+        if (hi + 2 * hop_ > input_end) break; // 候选段及其后的自然延续需要2个hop的输入
+        int64_t best = lo == hi ? lo : search(lo, hi);
+
+        // 上一段的延续淡出、候选段淡入
+        const float *cand = input_.data() + (size_t) (best - input_base_) * channels_;
+        size_t out_pos = output_.size();
+        output_.resize(out_pos + (size_t) hop_ * channels_);
+        float *out = output_.data() + out_pos;
+        for (int i = 0; i < hop_; i++) {
+            float w = fade_in_[i];
+            for (int c = 0; c < channels_; c++) {
+                size_t k = (size_t) i * channels_ + c;
+                out[k] = tail_[k] + (cand[k] - tail_[k]) * w;
+            }
+        }
+        memcpy(tail_.data(), cand + (size_t) hop_ * channels_, tail_.size() * sizeof(float));
+        memcpy(tail_mono_.data(), mono_.data() + (best - input_base_ + hop_), hop_ * sizeof(float));
+        ideal_pos_ += hop_ * speed_;
+    }
+
+    // 丢弃之后的搜索不会再用到的输入
+    int64_t keep_from = std::min((int64_t) llround(ideal_pos_) - search_, input_end);
+    int64_t drop = keep_from - input_base_;
+    if (drop >= kCompactFrames) {
+        input_.erase(input_.begin(), input_.begin() + (size_t) drop * channels_);
+        mono_.erase(mono_.begin(), mono_.begin() + drop);
+        input_base_ = keep_from;
+    }
+}
@@ -0,0 +1,65 @@
+#include "WorkerPool.h"
+#include <algorithm>
+#include <unistd.h>
+
+WorkerPool::WorkerPool(int threads) {
+    if (threads <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? (int) cores : 1;
+    }
+    for (int i = 0; i < threads; i++) threads_.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (std::thread &t : threads_) t.join();
+}
+
+WorkerPool &WorkerPool::shared() {
+    static WorkerPool pool;
+    return pool;
+}
+
+bool WorkerPool::runOne(Batch *batch, std::unique_lock<std::mutex> &lock) {
+    if (batch->next >= batch->count) return false;
+    int index = batch->next++;
+    if (batch->next >= batch->count) { // 最后一个任务已被领取，从队列中移除
+        batches_.erase(std::find(batches_.begin(), batches_.end(), batch));
+    }
+    lock.unlock();
+    (*batch->fn)(index);
+    lock.lock();
+    if (++batch->done == batch->count) done_cv_.notify_all();
+    return true;
+}
+
+void WorkerPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock, [this] { return stop_ || !batches_.empty(); });
+        if (stop_) return;
+        runOne(batches_.front(), lock);
+    }
+}
+
+void WorkerPool::run(int count, const std::function<void(int)> &fn) {
+    if (count <= 0) return;
+    if (count == 1 || threads_.empty()) {
+        for (int i = 0; i < count; i++) fn(i);
+        return;
+    }
+    Batch batch;
+    batch.fn = &fn;
+    batch.count = count;
+    std::unique_lock<std::mutex> lock(mutex_);
+    batches_.push_back(&batch);
+    int wake = std::min(count - 1, (int) threads_.size()); // 调用线程自己也执行任务
+    for (int i = 0; i < wake; i++) work_cv_.notify_one();
+    while (runOne(&batch, lock)) {
+    }
+    done_cv_.wait(lock, [&batch] { return batch.done == batch.count; });
+}
@@ -0,0 +1,664 @@
+#include "YuvConverter.h"
+#include <algorithm>
+#include <string.h>
+#include "WorkerPool.h"
+
+#if defined(__aarch64__) || (defined(__arm__) && defined(__ARM_NEON))
+#define YUV_HAVE_NEON 1
+#include <arm_neon.h>
+#if defined(__arm__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+#define YUV_HAVE_X86 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+static const int kMinStripePixels = 256 * 1024; // 每个并行条带至少转换的像素数 (约为1080p的1/8)
+
+// 各矩阵的Kr/Kb
+struct MatrixWeights {
+    double kr;
+    double kb;
+};
+
+static constexpr MatrixWeights kMatrixWeights[] = {
+        {0.299, 0.114},     // BT.601
+        {0.2126, 0.0722},   // BT.709
+        {0.2627, 0.0593},   // BT.2020
+};
+
+static constexpr int q8(double v) {
+    return static_cast<int>(v * 256.0 + 0.5);
+}
+
+// limited range下亮度按255/219、色度按255/224放大；full range只减去色度偏移
+static constexpr YuvCoefficients make_coefficients(MatrixWeights m, bool full) {
+    return {full ? 0 : 16,
+            q8(full ? 1.0 : 255.0 / 219.0),
+            q8(2.0 * (1.0 - m.kr) * (full ? 1.0 : 255.0 / 224.0)),
+            q8(2.0 * m.kb * (1.0 - m.kb) / (1.0 - m.kr - m.kb) * (full ? 1.0 : 255.0 / 224.0)),
+            q8(2.0 * m.kr * (1.0 - m.kr) / (1.0 - m.kr - m.kb) * (full ? 1.0 : 255.0 / 224.0)),
+            q8(2.0 * (1.0 - m.kb) * (full ? 1.0 : 255.0 / 224.0))};
+}
+
+// 按 [YuvMatrix][YuvRange] 索引的系数表，全部在编译期求值
+static constexpr YuvCoefficients kCoefficients[3][2] = {
+        {make_coefficients(kMatrixWeights[0], false), make_coefficients(kMatrixWeights[0], true)},
+        {make_coefficients(kMatrixWeights[1], false), make_coefficients(kMatrixWeights[1], true)},
+        {make_coefficients(kMatrixWeights[2], false), make_coefficients(kMatrixWeights[2], true)},
+};
+
+// 与旧版手写的BT.601 limited range系数一致，默认格式的输出逐位不变
+static_assert(kCoefficients[0][0].y == 298 && kCoefficients[0][0].rv == 409 && kCoefficients[0][0].gu == 100 &&
+              kCoefficients[0][0].gv == 208 && kCoefficients[0][0].bu == 516, "BT.601 limited range系数");
+
+// 一组内核特化的编译期参数：系数以立即数形式进入内核，色度位置和输出格式的判断在编译期消除。
+// 所有SIMD内核均使用32位中间结果，与同一特化的标量实现逐位一致
+template <YuvMatrix M, YuvRange R, ChromaSiting S, YuvOutput O>
+struct YuvSpec {
+    static constexpr YuvCoefficients kCoeffs = kCoefficients[static_cast<int>(M)][static_cast<int>(R)];
+    static constexpr int y_offset = kCoeffs.y_offset;
+    static constexpr int y = kCoeffs.y;
+    static constexpr int rv = kCoeffs.rv;
+    static constexpr int gu = kCoeffs.gu;
+    static constexpr int gv = kCoeffs.gv;
+    static constexpr int bu = kCoeffs.bu;
+    static constexpr ChromaSiting siting = S;
+    static constexpr YuvOutput output = O;
+    static constexpr int bytes_per_pixel = O == YuvOutput::Rgb565 ? 2 : 4;
+};
+
+// RGB565的4x4有序抖动 (Bayer矩阵)：量化前5位分量 (步长8) 加bayer/2，6位分量 (步长4) 加bayer/4，
+// 平滑渐变不会出现色带，且每帧图案固定、不会闪烁
+static constexpr uint8_t kBayer4[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+// 一行的4个抖动值打包为32位 (小端，第0字节对应x%4==0)，广播后即为SIMD一组像素的抖动向量
+static constexpr uint32_t dither_word(int row, int shift) {
+    return static_cast<uint32_t>(kBayer4[row][0] >> shift) | static_cast<uint32_t>(kBayer4[row][1] >> shift) << 8 |
+           static_cast<uint32_t>(kBayer4[row][2] >> shift) << 16 | static_cast<uint32_t>(kBayer4[row][3] >> shift) << 24;
+}
+
+static constexpr uint32_t kDither5[4] = {dither_word(0, 1), dither_word(1, 1), dither_word(2, 1), dither_word(3, 1)};
+static constexpr uint32_t kDither6[4] = {dither_word(0, 2), dither_word(1, 2), dither_word(2, 2), dither_word(3, 2)};
+
+static inline uint8_t clamp_u8(int v) {
+    return static_cast<uint8_t>(std::max(0, std::min(255, v)));
+}
+
+// 第x个像素，c/d/e为已减去偏移的Y/U/V，row为行号 (RGB565的抖动相位)
+template <class Spec>
+static inline void store_pixel(uint8_t *dst, int x, int row, int c, int d, int e) {
+    int base = Spec::y * c + 128;
+    int r = clamp_u8((base + Spec::rv * e) >> 8);
+    int g = clamp_u8((base - Spec::gu * d - Spec::gv * e) >> 8);
+    int b = clamp_u8((base + Spec::bu * d) >> 8);
+    if (Spec::output == YuvOutput::Rgb565) {
+        int bayer = kBayer4[row & 3][x & 3];
+        r = std::min(255, r + (bayer >> 1));
+        g = std::min(255, g + (bayer >> 2));
+        b = std::min(255, b + (bayer >> 1));
+        uint16_t pixel = static_cast<uint16_t>((r >> 3) << 11 | (g >> 2) << 5 | b >> 3);
+        memcpy(dst + x * 2, &pixel, sizeof(pixel));
+    } else {
+        uint8_t *p = dst + x * 4;
+        p[0] = static_cast<uint8_t>(r);
+        p[1] = static_cast<uint8_t>(g);
+        p[2] = static_cast<uint8_t>(b);
+        p[3] = 255;  // Alpha
+    }
+}
+
+// 按像素对处理：偶数列取色度样本本身；Left时奇数列位于两个样本中间，取二者的平均 (向上取整，与SIMD的平均指令一致)，
+// 行末没有下一个样本时复用当前样本
+template <class Spec>
+static void convert_row_scalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width,
+                               int row) {
+    int x = 0;
+    for (; x + 1 < width; x += 2) {
+        int i = x / 2;
+        int d0 = u[i] - 128, e0 = v[i] - 128;
+        int d1 = d0, e1 = e0;
+        if (Spec::siting == ChromaSiting::Left) {
+            int next = x + 2 < width ? i + 1 : i;
+            d1 = ((u[i] + u[next] + 1) >> 1) - 128;
+            e1 = ((v[i] + v[next] + 1) >> 1) - 128;
+        }
+        store_pixel<Spec>(dst, x, row, y[x] - Spec::y_offset, d0, e0);
+        store_pixel<Spec>(dst, x + 1, row, y[x + 1] - Spec::y_offset, d1, e1);
+    }
+    if (x < width) store_pixel<Spec>(dst, x, row, y[x] - Spec::y_offset, u[x / 2] - 128, v[x / 2] - 128);
+}
+
+#if YUV_HAVE_NEON
+// 8个像素的一半：c/d/e为已减去偏移的16位分量，输出8个饱和到[0,255]的结果
+static inline uint8x8_t neon_channel(int32x4_t lo, int32x4_t hi) {
+    return vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 8)), vqmovn_s32(vshrq_n_s32(hi, 8))));
+}
+
+template <class Spec>
+static inline void neon_convert8(int16x8_t c, int16x8_t d, int16x8_t e,
+                                 uint8x8_t *r, uint8x8_t *g, uint8x8_t *b) {
+    const int32x4_t round = vdupq_n_s32(128);
+    int32x4_t base_lo = vmlal_n_s16(round, vget_low_s16(c), Spec::y);
+    int32x4_t base_hi = vmlal_n_s16(round, vget_high_s16(c), Spec::y);
+
+    *r = neon_channel(vmlal_n_s16(base_lo, vget_low_s16(e), Spec::rv),
+                      vmlal_n_s16(base_hi, vget_high_s16(e), Spec::rv));
+    *g = neon_channel(vmlsl_n_s16(vmlsl_n_s16(base_lo, vget_low_s16(d), Spec::gu), vget_low_s16(e), Spec::gv),
+                      vmlsl_n_s16(vmlsl_n_s16(base_hi, vget_high_s16(d), Spec::gu), vget_high_s16(e), Spec::gv));
+    *b = neon_channel(vmlal_n_s16(base_lo, vget_low_s16(d), Spec::bu),
+                      vmlal_n_s16(base_hi, vget_high_s16(d), Spec::bu));
+}
+
+// 16个像素叠加抖动后打包为RGB565：vsri依次插入G、B的高位
+static inline void neon_store_rgb565(uint8x16_t r, uint8x16_t g, uint8x16_t b, uint8x16_t dither5,
+                                     uint8x16_t dither6, uint8_t *dst) {
+    r = vqaddq_u8(r, dither5);
+    g = vqaddq_u8(g, dither6);
+    b = vqaddq_u8(b, dither5);
+    uint16x8_t lo = vshll_n_u8(vget_low_u8(r), 8);
+    lo = vsriq_n_u16(lo, vshll_n_u8(vget_low_u8(g), 8), 5);
+    lo = vsriq_n_u16(lo, vshll_n_u8(vget_low_u8(b), 8), 11);
+    uint16x8_t hi = vshll_n_u8(vget_high_u8(r), 8);
+    hi = vsriq_n_u16(hi, vshll_n_u8(vget_high_u8(g), 8), 5);
+    hi = vsriq_n_u16(hi, vshll_n_u8(vget_high_u8(b), 8), 11);
+    vst1q_u8(dst, vreinterpretq_u8_u16(lo));
+    vst1q_u8(dst + 16, vreinterpretq_u8_u16(hi));
+}
+
+template <class Spec>
+static void convert_row_neon(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width,
+                             int row) {
+    const uint8x8_t y_off = vdup_n_u8(Spec::y_offset);
+    const uint8x8_t uv_off = vdup_n_u8(128);
+    const uint8x16_t dither5 = vreinterpretq_u8_u32(vdupq_n_u32(kDither5[row & 3]));
+    const uint8x16_t dither6 = vreinterpretq_u8_u32(vdupq_n_u32(kDither6[row & 3]));
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t y16 = vld1q_u8(y + x);
+        uint8x8_t u8 = vld1_u8(u + x / 2);
+        uint8x8_t v8 = vld1_u8(v + x / 2);
+        // 奇数列的色度：Center复用同一样本，Left取与下一个样本的平均。
+        // 行末一组之后没有样本，改为组内左移一个样本并复用最后一个 (与标量实现的边界处理相同)
+        uint8x8_t u_odd = u8, v_odd = v8;
+        if (Spec::siting == ChromaSiting::Left) {
+            bool last = x + 16 >= width;
+            uint8x8_t u_next = last ? vext_u8(u8, vdup_lane_u8(u8, 7), 1) : vld1_u8(u + x / 2 + 1);
+            uint8x8_t v_next = last ? vext_u8(v8, vdup_lane_u8(v8, 7), 1) : vld1_u8(v + x / 2 + 1);
+            u_odd = vrhadd_u8(u8, u_next);
+            v_odd = vrhadd_u8(v8, v_next);
+        }
+
+        // 无符号减法回绕后按有符号解释，即得到正确的负值
+        int16x8_t c_lo = vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(y16), y_off));
+        int16x8_t c_hi = vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(y16), y_off));
+        int16x8_t d = vreinterpretq_s16_u16(vsubl_u8(u8, uv_off));
+        int16x8_t e = vreinterpretq_s16_u16(vsubl_u8(v8, uv_off));
+        int16x8_t d_odd = vreinterpretq_s16_u16(vsubl_u8(u_odd, uv_off));
+        int16x8_t e_odd = vreinterpretq_s16_u16(vsubl_u8(v_odd, uv_off));
+        // 每个色度样本水平方向展开为两个像素
+        int16x8x2_t d2 = vzipq_s16(d, d_odd);
+        int16x8x2_t e2 = vzipq_s16(e, e_odd);
+
+        uint8x8_t r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+        neon_convert8<Spec>(c_lo, d2.val[0], e2.val[0], &r_lo, &g_lo, &b_lo);
+        neon_convert8<Spec>(c_hi, d2.val[1], e2.val[1], &r_hi, &g_hi, &b_hi);
+
+        if (Spec::output == YuvOutput::Rgb565) {
+            neon_store_rgb565(vcombine_u8(r_lo, r_hi), vcombine_u8(g_lo, g_hi), vcombine_u8(b_lo, b_hi), dither5,
+                              dither6, dst + x * 2);
+            continue;
+        }
+        uint8x16x4_t rgba;
+        rgba.val[0] = vcombine_u8(r_lo, r_hi);
+        rgba.val[1] = vcombine_u8(g_lo, g_hi);
+        rgba.val[2] = vcombine_u8(b_lo, b_hi);
+        rgba.val[3] = vdupq_n_u8(255);
+        vst4q_u8(dst + x * 4, rgba);
+    }
+    if (x < width) convert_row_scalar<Spec>(y + x, u + x / 2, v + x / 2, dst + x * Spec::bytes_per_pixel, width - x, row);
+}
+#endif
+
+#if YUV_HAVE_X86
+// 将两个16位系数打包为一个32位值，低16位作用于madd的偶数元素，高16位作用于奇数元素
+static constexpr int32_t coeff_pair(int16_t lo, int16_t hi) {
+    return static_cast<int32_t>((static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16) | static_cast<uint16_t>(lo));
+}
+
+// 右移8位并饱和打包为16位
+__attribute__((target("sse4.1")))
+static inline __m128i sse_pack_channel(__m128i a, __m128i b) {
+    return _mm_packs_epi32(_mm_srai_epi32(a, 8), _mm_srai_epi32(b, 8));
+}
+
+// 8个像素的R/G/B，结果为8个有符号16位值 (尚未饱和到u8)
+template <class Spec>
+__attribute__((target("sse4.1")))
+static inline void sse_convert8(__m128i c, __m128i d, __m128i e, __m128i *r, __m128i *g, __m128i *b) {
+    const __m128i k_r = _mm_set1_epi32(coeff_pair(Spec::y, Spec::rv));     // (y, rv) 作用于 (C, E)
+    const __m128i k_gb = _mm_set1_epi32(coeff_pair(Spec::y, -Spec::gu));   // (y, -gu) 作用于 (C, D)
+    const __m128i k_g_e = _mm_set1_epi32(coeff_pair(-Spec::gv, 128));      // (-gv, 128) 作用于 (E, 1)
+    const __m128i k_b = _mm_set1_epi32(coeff_pair(Spec::y, Spec::bu));     // (y, bu) 作用于 (C, D)
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i one = _mm_set1_epi16(1);
+
+    __m128i ce_lo = _mm_unpacklo_epi16(c, e), ce_hi = _mm_unpackhi_epi16(c, e);
+    __m128i cd_lo = _mm_unpacklo_epi16(c, d), cd_hi = _mm_unpackhi_epi16(c, d);
+    __m128i e1_lo = _mm_unpacklo_epi16(e, one), e1_hi = _mm_unpackhi_epi16(e, one);
+
+    *r = sse_pack_channel(_mm_add_epi32(_mm_madd_epi16(ce_lo, k_r), round),
+                          _mm_add_epi32(_mm_madd_epi16(ce_hi, k_r), round));
+    *g = sse_pack_channel(_mm_add_epi32(_mm_madd_epi16(cd_lo, k_gb), _mm_madd_epi16(e1_lo, k_g_e)),
+                          _mm_add_epi32(_mm_madd_epi16(cd_hi, k_gb), _mm_madd_epi16(e1_hi, k_g_e)));
+    *b = sse_pack_channel(_mm_add_epi32(_mm_madd_epi16(cd_lo, k_b), round),
+                          _mm_add_epi32(_mm_madd_epi16(cd_hi, k_b), round));
+}
+
+// RGB565的高低字节：高字节RRRRRGGG，低字节GGGBBBBB。8位元素没有移位指令，用16位移位后按字节掩码取出
+__attribute__((target("sse4.1")))
+static inline void sse_rgb565_bytes(__m128i r, __m128i g, __m128i b, __m128i *lo, __m128i *hi) {
+    *hi = _mm_or_si128(_mm_and_si128(r, _mm_set1_epi8((char) 0xF8)),
+                       _mm_and_si128(_mm_srli_epi16(g, 5), _mm_set1_epi8(0x07)));
+    *lo = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(g, 3), _mm_set1_epi8((char) 0xE0)),
+                       _mm_and_si128(_mm_srli_epi16(b, 3), _mm_set1_epi8(0x1F)));
+}
+
+template <class Spec>
+__attribute__((target("sse4.1")))
+static void convert_row_sse41(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width,
+                              int row) {
+    const __m128i dither5 = _mm_set1_epi32((int) kDither5[row & 3]);
+    const __m128i dither6 = _mm_set1_epi32((int) kDither6[row & 3]);
+    const __m128i y_off = _mm_set1_epi16(Spec::y_offset);
+    const __m128i uv_off = _mm_set1_epi16(128);
+    const __m128i alpha = _mm_set1_epi8((char) 0xFF);
+    const __m128i shift_last = _mm_setr_epi8(1, 2, 3, 4, 5, 6, 7, 7, 8, 8, 8, 8, 8, 8, 8, 8);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i y16 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+        __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2));
+        __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2));
+        __m128i u_odd = u8, v_odd = v8;
+        if (Spec::siting == ChromaSiting::Left) { // 同NEON：行末一组在组内左移并复用最后一个样本
+            bool last = x + 16 >= width;
+            __m128i u_next = last ? _mm_shuffle_epi8(u8, shift_last)
+                                  : _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2 + 1));
+            __m128i v_next = last ? _mm_shuffle_epi8(v8, shift_last)
+                                  : _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2 + 1));
+            u_odd = _mm_avg_epu8(u8, u_next);
+            v_odd = _mm_avg_epu8(v8, v_next);
+        }
+
+        __m128i c_lo = _mm_sub_epi16(_mm_cvtepu8_epi16(y16), y_off);
+        __m128i c_hi = _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(y16, 8)), y_off);
+        __m128i d = _mm_sub_epi16(_mm_cvtepu8_epi16(u8), uv_off);
+        __m128i e = _mm_sub_epi16(_mm_cvtepu8_epi16(v8), uv_off);
+        __m128i d_odd = _mm_sub_epi16(_mm_cvtepu8_epi16(u_odd), uv_off);
+        __m128i e_odd = _mm_sub_epi16(_mm_cvtepu8_epi16(v_odd), uv_off);
+
+        __m128i r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+        sse_convert8<Spec>(c_lo, _mm_unpacklo_epi16(d, d_odd), _mm_unpacklo_epi16(e, e_odd), &r_lo, &g_lo, &b_lo);
+        sse_convert8<Spec>(c_hi, _mm_unpackhi_epi16(d, d_odd), _mm_unpackhi_epi16(e, e_odd), &r_hi, &g_hi, &b_hi);
+
+        __m128i r = _mm_packus_epi16(r_lo, r_hi);
+        __m128i g = _mm_packus_epi16(g_lo, g_hi);
+        __m128i b = _mm_packus_epi16(b_lo, b_hi);
+
+        if (Spec::output == YuvOutput::Rgb565) { // 叠加抖动 (饱和加) 后按小端交错高低字节
+            __m128i lo, hi;
+            sse_rgb565_bytes(_mm_adds_epu8(r, dither5), _mm_adds_epu8(g, dither6), _mm_adds_epu8(b, dither5), &lo, &hi);
+            __m128i *out = reinterpret_cast<__m128i *>(dst + x * 2);
+            _mm_storeu_si128(out + 0, _mm_unpacklo_epi8(lo, hi));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(lo, hi));
+            continue;
+        }
+
+        // 交错为RGBA
+        __m128i rg_lo = _mm_unpacklo_epi8(r, g), rg_hi = _mm_unpackhi_epi8(r, g);
+        __m128i ba_lo = _mm_unpacklo_epi8(b, alpha), ba_hi = _mm_unpackhi_epi8(b, alpha);
+        __m128i *out = reinterpret_cast<__m128i *>(dst + x * 4);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(rg_lo, ba_lo));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rg_lo, ba_lo));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rg_hi, ba_hi));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rg_hi, ba_hi));
+    }
+    if (x < width) convert_row_scalar<Spec>(y + x, u + x / 2, v + x / 2, dst + x * Spec::bytes_per_pixel, width - x, row);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_pack_channel(__m256i a, __m256i b) {
+    return _mm256_packs_epi32(_mm256_srai_epi32(a, 8), _mm256_srai_epi32(b, 8));
+}
+
+// 16个像素的R/G/B (16位)。unpack/madd在128位通道内进行，packs后像素顺序恢复为0..15
+template <class Spec>
+__attribute__((target("avx2")))
+static inline void avx2_convert16(__m256i c, __m256i d, __m256i e, __m256i *r, __m256i *g, __m256i *b) {
+    const __m256i k_r = _mm256_set1_epi32(coeff_pair(Spec::y, Spec::rv));
+    const __m256i k_gb = _mm256_set1_epi32(coeff_pair(Spec::y, -Spec::gu));
+    const __m256i k_g_e = _mm256_set1_epi32(coeff_pair(-Spec::gv, 128));
+    const __m256i k_b = _mm256_set1_epi32(coeff_pair(Spec::y, Spec::bu));
+    const __m256i round = _mm256_set1_epi32(128);
+    const __m256i one = _mm256_set1_epi16(1);
+
+    __m256i ce_lo = _mm256_unpacklo_epi16(c, e), ce_hi = _mm256_unpackhi_epi16(c, e);
+    __m256i cd_lo = _mm256_unpacklo_epi16(c, d), cd_hi = _mm256_unpackhi_epi16(c, d);
+    __m256i e1_lo = _mm256_unpacklo_epi16(e, one), e1_hi = _mm256_unpackhi_epi16(e, one);
+
+    *r = avx2_pack_channel(_mm256_add_epi32(_mm256_madd_epi16(ce_lo, k_r), round),
+                           _mm256_add_epi32(_mm256_madd_epi16(ce_hi, k_r), round));
+    *g = avx2_pack_channel(_mm256_add_epi32(_mm256_madd_epi16(cd_lo, k_gb), _mm256_madd_epi16(e1_lo, k_g_e)),
+                           _mm256_add_epi32(_mm256_madd_epi16(cd_hi, k_gb), _mm256_madd_epi16(e1_hi, k_g_e)));
+    *b = avx2_pack_channel(_mm256_add_epi32(_mm256_madd_epi16(cd_lo, k_b), round),
+                           _mm256_add_epi32(_mm256_madd_epi16(cd_hi, k_b), round));
+}
+
+__attribute__((target("avx2")))
+static inline void avx2_rgb565_bytes(__m256i r, __m256i g, __m256i b, __m256i *lo, __m256i *hi) {
+    *hi = _mm256_or_si256(_mm256_and_si256(r, _mm256_set1_epi8((char) 0xF8)),
+                          _mm256_and_si256(_mm256_srli_epi16(g, 5), _mm256_set1_epi8(0x07)));
+    *lo = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi16(g, 3), _mm256_set1_epi8((char) 0xE0)),
+                          _mm256_and_si256(_mm256_srli_epi16(b, 3), _mm256_set1_epi8(0x1F)));
+}
+
+template <class Spec>
+__attribute__((target("avx2")))
+static void convert_row_avx2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width,
+                             int row) {
+    const __m256i dither5 = _mm256_set1_epi32((int) kDither5[row & 3]);
+    const __m256i dither6 = _mm256_set1_epi32((int) kDither6[row & 3]);
+    const __m256i y_off = _mm256_set1_epi16(Spec::y_offset);
+    const __m256i uv_off = _mm256_set1_epi16(128);
+    const __m256i alpha = _mm256_set1_epi8((char) 0xFF);
+    const __m128i shift_last = _mm_setr_epi8(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 15);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m128i u16 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x / 2));
+        __m128i v16 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + x / 2));
+        __m128i u_odd = u16, v_odd = v16;
+        if (Spec::siting == ChromaSiting::Left) { // 同NEON：行末一组在组内左移并复用最后一个样本
+            bool last = x + 32 >= width;
+            __m128i u_next = last ? _mm_shuffle_epi8(u16, shift_last)
+                                  : _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x / 2 + 1));
+            __m128i v_next = last ? _mm_shuffle_epi8(v16, shift_last)
+                                  : _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + x / 2 + 1));
+            u_odd = _mm_avg_epu8(u16, u_next);
+            v_odd = _mm_avg_epu8(v16, v_next);
+        }
+        // 在8位域内先将色度展开为每像素一个
+        __m128i u_dup_lo = _mm_unpacklo_epi8(u16, u_odd), u_dup_hi = _mm_unpackhi_epi8(u16, u_odd);
+        __m128i v_dup_lo = _mm_unpacklo_epi8(v16, v_odd), v_dup_hi = _mm_unpackhi_epi8(v16, v_odd);
+
+        __m256i c0 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x))), y_off);
+        __m256i c1 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x + 16))), y_off);
+        __m256i d0 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(u_dup_lo), uv_off);
+        __m256i d1 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(u_dup_hi), uv_off);
+        __m256i e0 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(v_dup_lo), uv_off);
+        __m256i e1 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(v_dup_hi), uv_off);
+
+        __m256i r0, g0, b0, r1, g1, b1;
+        avx2_convert16<Spec>(c0, d0, e0, &r0, &g0, &b0);
+        avx2_convert16<Spec>(c1, d1, e1, &r1, &g1, &b1);
+
+        // packus在通道内进行：lane0 = 像素0-7,16-23；lane1 = 像素8-15,24-31
+        __m256i r = _mm256_packus_epi16(r0, r1);
+        __m256i g = _mm256_packus_epi16(g0, g1);
+        __m256i b = _mm256_packus_epi16(b0, b1);
+
+        // 抖动图案以4像素为周期，通道内的像素顺序不影响叠加；
+        // unpack后 lo = 像素0-7 | 8-15, hi = 像素16-23 | 24-31，恰好恢复顺序
+        if (Spec::output == YuvOutput::Rgb565) {
+            __m256i lo, hi;
+            avx2_rgb565_bytes(_mm256_adds_epu8(r, dither5), _mm256_adds_epu8(g, dither6), _mm256_adds_epu8(b, dither5),
+                              &lo, &hi);
+            __m256i *out = reinterpret_cast<__m256i *>(dst + x * 2);
+            _mm256_storeu_si256(out + 0, _mm256_unpacklo_epi8(lo, hi));
+            _mm256_storeu_si256(out + 1, _mm256_unpackhi_epi8(lo, hi));
+            continue;
+        }
+
+        // unpacklo: lane0 = 像素0-7, lane1 = 像素8-15；unpackhi: lane0 = 16-23, lane1 = 24-31
+        __m256i rg_lo = _mm256_unpacklo_epi8(r, g), rg_hi = _mm256_unpackhi_epi8(r, g);
+        __m256i ba_lo = _mm256_unpacklo_epi8(b, alpha), ba_hi = _mm256_unpackhi_epi8(b, alpha);
+        __m256i p0 = _mm256_unpacklo_epi16(rg_lo, ba_lo); // 像素0-3 | 8-11
+        __m256i p1 = _mm256_unpackhi_epi16(rg_lo, ba_lo); // 像素4-7 | 12-15
+        __m256i p2 = _mm256_unpacklo_epi16(rg_hi, ba_hi); // 像素16-19 | 24-27
+        __m256i p3 = _mm256_unpackhi_epi16(rg_hi, ba_hi); // 像素20-23 | 28-31
+
+        __m256i *out = reinterpret_cast<__m256i *>(dst + x * 4);
+        _mm256_storeu_si256(out + 0, _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+    if (x < width) convert_row_sse41<Spec>(y + x, u + x / 2, v + x / 2, dst + x * Spec::bytes_per_pixel, width - x, row);
+}
+
+// AVX需要操作系统保存YMM寄存器状态 (OSXSAVE + XCR0)
+static bool x86_os_supports_avx() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) return false;
+    unsigned int xcr0_lo, xcr0_hi;
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    return (xcr0_lo & 0x6) == 0x6;
+}
+#endif
+
+bool YuvConverter::isKernelSupported(YuvKernel kernel) {
+    switch (kernel) {
+        case YuvKernel::Scalar:
+            return true;
+        case YuvKernel::Neon:
+#if YUV_HAVE_NEON && defined(__aarch64__)
+            return true; // arm64-v8a 必然支持NEON
+#elif YUV_HAVE_NEON
+            return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+            return false;
+#endif
+        case YuvKernel::Sse41: {
+#if YUV_HAVE_X86
+            unsigned int eax, ebx, ecx, edx;
+            return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1);
+#else
+            return false;
+#endif
+        }
+        case YuvKernel::Avx2: {
+#if YUV_HAVE_X86
+            unsigned int eax, ebx, ecx, edx;
+            return x86_os_supports_avx() && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_AVX2);
+#else
+            return false;
+#endif
+        }
+    }
+    return false;
+}
+
+YuvKernel YuvConverter::detectBestKernel() {
+    static const YuvKernel preference[] = {YuvKernel::Avx2, YuvKernel::Sse41, YuvKernel::Neon};
+    for (YuvKernel kernel : preference) {
+        if (isKernelSupported(kernel)) return kernel;
+    }
+    return YuvKernel::Scalar;
+}
+
+const char *YuvConverter::kernelName(YuvKernel kernel) {
+    switch (kernel) {
+        case YuvKernel::Scalar: return "scalar";
+        case YuvKernel::Neon: return "neon";
+        case YuvKernel::Sse41: return "sse4.1";
+        case YuvKernel::Avx2: return "avx2";
+    }
+    return "unknown";
+}
+
+// 特化内核的选择：按颜色格式逐级展开为模板参数，每个流只在构造转换器时执行一次
+template <class Spec>
+static YuvRowFunc row_func_for(YuvKernel kernel) {
+    switch (kernel) {
+#if YUV_HAVE_NEON
+        case YuvKernel::Neon: return convert_row_neon<Spec>;
+#endif
+#if YUV_HAVE_X86
+        case YuvKernel::Sse41: return convert_row_sse41<Spec>;
+        case YuvKernel::Avx2: return convert_row_avx2<Spec>;
+#endif
+        default: return convert_row_scalar<Spec>;
+    }
+}
+
+template <YuvMatrix M, YuvRange R, ChromaSiting S>
+static YuvRowFunc select_output(YuvOutput output, YuvKernel kernel) {
+    return output == YuvOutput::Rgb565 ? row_func_for<YuvSpec<M, R, S, YuvOutput::Rgb565>>(kernel)
+                                       : row_func_for<YuvSpec<M, R, S, YuvOutput::Rgba8888>>(kernel);
+}
+
+template <YuvMatrix M, YuvRange R>
+static YuvRowFunc select_siting(const YuvColorFormat &format, YuvKernel kernel) {
+    return format.siting == ChromaSiting::Left ? select_output<M, R, ChromaSiting::Left>(format.output, kernel)
+                                               : select_output<M, R, ChromaSiting::Center>(format.output, kernel);
+}
+
+template <YuvMatrix M>
+static YuvRowFunc select_range(const YuvColorFormat &format, YuvKernel kernel) {
+    return format.range == YuvRange::Full ? select_siting<M, YuvRange::Full>(format, kernel)
+                                          : select_siting<M, YuvRange::Limited>(format, kernel);
+}
+
+static YuvRowFunc select_row_func(const YuvColorFormat &format, YuvKernel kernel) {
+    switch (format.matrix) {
+        case YuvMatrix::Bt709: return select_range<YuvMatrix::Bt709>(format, kernel);
+        case YuvMatrix::Bt2020: return select_range<YuvMatrix::Bt2020>(format, kernel);
+        default: return select_range<YuvMatrix::Bt601>(format, kernel);
+    }
+}
+
+YuvColorFormat YuvColorFormat::forStream(AVColorSpace space, AVColorRange range, AVChromaLocation location,
+                                         int width, int height) {
+    YuvColorFormat format;
+    switch (space) {
+        case AVCOL_SPC_BT470BG:
+        case AVCOL_SPC_SMPTE170M:
+        case AVCOL_SPC_FCC:
+            format.matrix = YuvMatrix::Bt601;
+            break;
+        case AVCOL_SPC_BT709:
+        case AVCOL_SPC_SMPTE240M:
+            format.matrix = YuvMatrix::Bt709;
+            break;
+        case AVCOL_SPC_BT2020_NCL:
+        case AVCOL_SPC_BT2020_CL: // 恒定亮度按非恒定亮度的矩阵近似
+            format.matrix = YuvMatrix::Bt2020;
+            break;
+        default: // 未标记或不支持的矩阵
+            format.matrix = width >= 1280 || height >= 720 ? YuvMatrix::Bt709 : YuvMatrix::Bt601;
+            break;
+    }
+    format.range = range == AVCOL_RANGE_JPEG ? YuvRange::Full : YuvRange::Limited;
+    switch (location) {
+        case AVCHROMA_LOC_CENTER:
+        case AVCHROMA_LOC_TOP:
+        case AVCHROMA_LOC_BOTTOM:
+            format.siting = ChromaSiting::Center;
+            break;
+        case AVCHROMA_LOC_LEFT:
+        case AVCHROMA_LOC_TOPLEFT:
+        case AVCHROMA_LOC_BOTTOMLEFT:
+            format.siting = ChromaSiting::Left;
+            break;
+        default:
+            format.siting = format.range == YuvRange::Full ? ChromaSiting::Center : ChromaSiting::Left;
+            break;
+    }
+    return format;
+}
+
+std::string YuvColorFormat::name() const {
+    static const char *const matrices[] = {"bt601", "bt709", "bt2020"};
+    std::string name = matrices[static_cast<int>(matrix)];
+    name += range == YuvRange::Full ? "/full" : "/limited";
+    name += siting == ChromaSiting::Left ? "/left" : "/center";
+    name += output == YuvOutput::Rgb565 ? "/rgb565" : "/rgba";
+    return name;
+}
+
+YuvCoefficients YuvConverter::coefficients(YuvMatrix matrix, YuvRange range) {
+    return kCoefficients[static_cast<int>(matrix)][static_cast<int>(range)];
+}
+
+YuvConverter::YuvConverter() : YuvConverter(YuvColorFormat(), detectBestKernel()) {
+}
+
+YuvConverter::YuvConverter(YuvKernel kernel) : YuvConverter(YuvColorFormat(), kernel) {
+}
+
+YuvConverter::YuvConverter(const YuvColorFormat &format) : YuvConverter(format, detectBestKernel()) {
+}
+
+YuvConverter::YuvConverter(const YuvColorFormat &format, YuvKernel kernel)
+        : format_(format), kernel_(isKernelSupported(kernel) ? kernel : YuvKernel::Scalar) { // 不支持的内核回退到标量实现
+    row_func_ = select_row_func(format_, kernel_);
+}
+
+void YuvConverter::convert(const uint8_t *src_y, int stride_y,
+                           const uint8_t *src_u, int stride_u,
+                           const uint8_t *src_v, int stride_v,
+                           uint8_t *dst, int dst_stride, int width, int height) const {
+    convertRows(src_y, stride_y, src_u, stride_u, src_v, stride_v, dst, dst_stride, width, 0, height);
+}
+
+void YuvConverter::convertRows(const uint8_t *src_y, int stride_y,
+                               const uint8_t *src_u, int stride_u,
+                               const uint8_t *src_v, int stride_v,
+                               uint8_t *dst, int dst_stride, int width, int first_row, int last_row) const {
+    for (int row = first_row; row < last_row; row++) {
+        row_func_(src_y + (long) row * stride_y,
+                  src_u + (long) (row / 2) * stride_u,
+                  src_v + (long) (row / 2) * stride_v,
+                  dst + (long) row * dst_stride, width, row);
+    }
+}
+
+void YuvConverter::convert(const uint8_t *src_y, int stride_y,
+                           const uint8_t *src_u, int stride_u,
+                           const uint8_t *src_v, int stride_v,
+                           uint8_t *dst, int dst_stride, int width, int height,
+                           WorkerPool &pool, int stripes) const {
+    int row_pairs = (height + 1) / 2;
+    stripes = std::min(stripes, row_pairs);
+    if (stripes <= 1) {
+        convert(src_y, stride_y, src_u, stride_u, src_v, stride_v, dst, dst_stride, width, height);
+        return;
+    }
+    // 以色度行 (两行亮度) 为单位均分，条带内的行与单线程转换时完全相同 (包括RGB565的抖动相位)。
+    // 参数放在栈上的结构体中，lambda只捕获两个指针，std::function不需要为每帧分配堆内存
+    struct Job {
+        const uint8_t *y, *u, *v;
+        int stride_y, stride_u, stride_v;
+        uint8_t *dst;
+        int dst_stride, width, height, row_pairs, stripes;
+    } job = {src_y, src_u, src_v, stride_y, stride_u, stride_v, dst, dst_stride, width, height, row_pairs, stripes};
+    const Job *j = &job;
+    pool.run(stripes, [this, j](int stripe) {
+        int first = (int) ((long) j->row_pairs * stripe / j->stripes) * 2;
+        int last = std::min(j->height, (int) ((long) j->row_pairs * (stripe + 1) / j->stripes) * 2);
+        convertRows(j->y, j->stride_y, j->u, j->stride_u, j->v, j->stride_v, j->dst, j->dst_stride, j->width,
+                    first, last);
+    });
+}
+
+int YuvConverter::autoStripeCount(int width, int height, int workers) {
+    long pixels = (long) width * height;
+    return (int) std::max(1L, std::min((long) workers, pixels / kMinStripePixels));
+}
@@ -0,0 +1,324 @@
+#include "YuvScaler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "WorkerPool.h"
+
+static const uint32_t kOpaqueBlack = 0xFF000000u; // 小端RGBA字节序下 R=G=B=0, A=255
+
+LetterboxLayout letterbox_layout(int video_width, int video_height, int window_width, int window_height) {
+    LetterboxLayout layout;
+    if (video_width <= 0 || video_height <= 0) return layout;
+    layout.width = layout.buffer_width = video_width;
+    layout.height = layout.buffer_height = video_height;
+    if (window_width <= 0 || window_height <= 0) return layout;
+
+    double fit = std::min((double) window_width / video_width, (double) window_height / video_height);
+    if (fit >= 1.0) {
+        // 窗口比视频大：画面保持视频分辨率，缓冲区按窗口宽高比扩展出黑边，由合成器整体放大
+        layout.buffer_width = std::max(video_width, (int) std::lround(window_width / fit));
+        layout.buffer_height = std::max(video_height, (int) std::lround(window_height / fit));
+    } else {
+        layout.buffer_width = window_width;
+        layout.buffer_height = window_height;
+        layout.width = std::max(2, std::min(window_width, (int) std::lround(video_width * fit)) & ~1);
+        layout.height = std::max(2, std::min(window_height, (int) std::lround(video_height * fit)) & ~1);
+    }
+    layout.x = (layout.buffer_width - layout.width) / 2;
+    layout.y = (layout.buffer_height - layout.height) / 2;
+    return layout;
+}
+
+void letterbox_fill_bars(uint8_t *dst, int dst_stride, const LetterboxLayout &layout, YuvOutput output) {
+    auto fill = [&](int row, int x, int count) {
+        if (count <= 0) return;
+        uint8_t *line = dst + (long) row * dst_stride;
+        if (output == YuvOutput::Rgb565) { // RGB565的黑色为0
+            memset(line + (long) x * 2, 0, (size_t) count * 2);
+            return;
+        }
+        uint32_t *pixels = reinterpret_cast<uint32_t *>(line) + x;
+        std::fill(pixels, pixels + count, kOpaqueBlack);
+    };
+    int right = layout.x + layout.width;
+    for (int row = 0; row < layout.buffer_height; row++) {
+        if (row < layout.y || row >= layout.y + layout.height) {
+            fill(row, 0, layout.buffer_width);
+        } else {
+            fill(row, 0, layout.x);
+            fill(row, right, layout.buffer_width - right);
+        }
+    }
+}
+
+YuvScaler::YuvScaler() = default;
+
+YuvScaler::YuvScaler(YuvKernel kernel) : converter_(kernel) {
+}
+
+YuvScaler::YuvScaler(const YuvColorFormat &format, YuvKernel kernel) : converter_(format, kernel) {
+}
+
+// 输出位置i覆盖源区间 [(i+0.5)*scale - f/2, (i+0.5)*scale + f/2)，f = max(scale, 1)。
+// 权重为各源像素与该区间的重叠长度：缩小时即面积平均，放大时 (f = 1) 即双线性插值。
+// 超出边缘的部分并入边缘像素，权重为0的首尾项去掉后各输出位置的源像素连续，只需记录起点
+void YuvScaler::buildTaps(int src, int dst, Taps *taps, int one) {
+    double scale = (double) src / dst;
+    double footprint = std::max(scale, 1.0);
+    int span = (int) std::ceil(footprint) + 1;
+    std::vector<std::vector<double>> overlaps(dst);
+    std::vector<int> firsts(dst);
+    int count = 1;
+    for (int i = 0; i < dst; i++) {
+        double center = (i + 0.5) * scale;
+        double lo = center - footprint / 2, hi = center + footprint / 2;
+        int base = std::max(0, std::min(src - 1, (int) std::floor(lo)));
+        std::vector<double> overlap(span, 0.0);           // 下标相对base，边缘外的像素并入边缘后不超出span
+        int first = src, last = -1;
+        for (int k = 0; k < span; k++) {
+            int s = (int) std::floor(lo) + k;
+            double w = std::min(hi, s + 1.0) - std::max(lo, (double) s);
+            if (w <= 1e-9) continue;
+            int clamped = std::max(0, std::min(src - 1, s));
+            overlap[clamped - base] += w;
+            first = std::min(first, clamped);
+            last = std::max(last, clamped);
+        }
+        firsts[i] = first;
+        overlaps[i].assign(overlap.begin() + (first - base), overlap.begin() + (last - base) + 1);
+        count = std::max(count, last - first + 1);
+    }
+    taps->taps = count;
+    taps->start.assign(dst, 0);
+    taps->weight.assign((size_t) dst * count, 0);
+    for (int i = 0; i < dst; i++) {
+        int start = std::min(firsts[i], src - count);
+        int offset = firsts[i] - start;
+        double total = 0.0;
+        for (double w : overlaps[i]) total += w;
+        // 量化为定点，舍入误差补到权重最大的一项上，保证权重和恰为one (平坦区域缩放后数值不变)
+        uint16_t *weight = &taps->weight[(size_t) i * count];
+        int sum = 0, largest = offset;
+        for (size_t k = 0; k < overlaps[i].size(); k++) {
+            weight[offset + k] = (uint16_t) std::lround(overlaps[i][k] / total * one);
+            sum += weight[offset + k];
+            if (overlaps[i][k] > overlaps[i][largest - offset]) largest = offset + (int) k;
+        }
+        weight[largest] = (uint16_t) (weight[largest] + one - sum);
+        taps->start[i] = start;
+    }
+}
+
+void YuvScaler::buildHorizontalTaps(int src, int dst, Taps *taps) {
+    int halvings = 0;
+    while (src / 2 >= dst) {
+        src = (src + 1) / 2;
+        halvings++;
+    }
+    buildTaps(src, dst, taps);
+    taps->halvings = halvings;
+    taps->identity = src == dst;
+}
+
+// 水平方向：按起点取acc中连续的Taps个源位置加权求和，Q16舍入回8位。常见的抽头数展开为定长循环
+template <int Taps>
+static void horizontal_pass(const uint16_t *acc, const int *start, const uint16_t *weight, int taps,
+                            int dst_width, uint8_t *dst) {
+    const int n = Taps > 0 ? Taps : taps;
+    for (int i = 0; i < dst_width; i++) {
+        const uint16_t *a = acc + start[i];
+        const uint16_t *w = weight + (size_t) i * n;
+        uint32_t sum = 1u << 15;
+        for (int k = 0; k < n; k++) sum += (uint32_t) a[k] * w[k];
+        dst[i] = (uint8_t) (sum >> 16);
+    }
+}
+
+// 垂直方向的累加：acc = Σ w * 源行 (Q8，最大 255*256 不溢出16位)。
+// 用编译器的向量扩展每次处理8个像素 (arm上为NEON，x86上为SSE2)，不依赖自动向量化
+typedef uint16_t u16x8 __attribute__((vector_size(16)));
+typedef uint8_t u8x8 __attribute__((vector_size(8)));
+
+static inline u16x8 load_u8x8(const uint8_t *p) {
+    u8x8 v;
+    memcpy(&v, p, sizeof(v));
+    return __builtin_convertvector(v, u16x8);
+}
+
+static void vertical_pass(const uint8_t *rows, int stride, const uint16_t *weight, int taps, int width,
+                          uint16_t *acc) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        u16x8 sum = load_u8x8(rows + x) * weight[0];
+        for (int k = 1; k < taps; k++) sum += load_u8x8(rows + (long) k * stride + x) * weight[k];
+        memcpy(acc + x, &sum, sizeof(sum));
+    }
+    for (; x < width; x++) {
+        uint16_t sum = (uint16_t) (rows[x] * weight[0]);
+        for (int k = 1; k < taps; k++) sum = (uint16_t) (sum + rows[(long) k * stride + x] * weight[k]);
+        acc[x] = sum;
+    }
+}
+
+// 垂直累加同时做第一次水平2:1预缩小：把8位源行按u16读取，高低字节相加即得相邻两像素之和 (最大510)，
+// 权重用Q7 (和为128)，acc = Σ w * (a + b) 与不预缩小时的Q8结果同一量级，仍不溢出16位
+static inline u16x8 load_pair_sums(const uint8_t *p) {
+    u16x8 v;
+    memcpy(&v, p, sizeof(v));
+    return (v & 0xFF) + (v >> 8);
+}
+
+static int vertical_pass_pairs(const uint8_t *rows, int stride, const uint16_t *weight, int taps, int width,
+                               uint16_t *acc) {
+    int pairs = width / 2;
+    int i = 0;
+    for (; i + 8 <= pairs; i += 8) {
+        u16x8 sum = load_pair_sums(rows + 2 * i) * weight[0];
+        for (int k = 1; k < taps; k++) sum += load_pair_sums(rows + (long) k * stride + 2 * i) * weight[k];
+        memcpy(acc + i, &sum, sizeof(sum));
+    }
+    for (; i < (width + 1) / 2; i++) {
+        int a = 2 * i, b = std::min(2 * i + 1, width - 1); // 奇数宽度时最后一个像素与自身配对
+        uint16_t sum = 0;
+        for (int k = 0; k < taps; k++) {
+            const uint8_t *row = rows + (long) k * stride;
+            sum = (uint16_t) (sum + (row[a] + row[b]) * weight[k]);
+        }
+        acc[i] = sum;
+    }
+    return (width + 1) / 2;
+}
+
+// 水平方向的2:1预缩小：相邻两个位置取平均 (四舍五入)，宽度减半 (奇数时最后一个与自身平均)，返回新宽度。
+// 每两个u16看作一个u32，在向量中分出高低半再相加，不需要编译器相关的shuffle。
+// 原地进行：每次迭代先读后写，写入位置总在读取位置之前
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+typedef uint16_t u16x4 __attribute__((vector_size(8)));
+
+static int halve_pass(uint16_t *acc, int width) {
+    if (width & 1) acc[width] = acc[width - 1];
+    int half = (width + 1) / 2;
+    int i = 0;
+    for (; i + 4 <= half; i += 4) {
+        u32x4 pairs;
+        memcpy(&pairs, acc + 2 * i, sizeof(pairs));
+        u16x4 avg = __builtin_convertvector(((pairs & 0xFFFF) + (pairs >> 16) + 1) >> 1, u16x4);
+        memcpy(acc + i, &avg, sizeof(avg));
+    }
+    for (; i < half; i++) acc[i] = (uint16_t) ((acc[2 * i] + acc[2 * i + 1] + 1) >> 1);
+    return half;
+}
+
+// Q8的acc舍入为8位
+static void narrow_pass(const uint16_t *acc, int width, uint8_t *dst) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        u16x8 v;
+        memcpy(&v, acc + x, sizeof(v));
+        u8x8 out = __builtin_convertvector((v + 128) >> 8, u8x8);
+        memcpy(dst + x, &out, sizeof(out));
+    }
+    for (; x < width; x++) dst[x] = (uint8_t) ((acc[x] + 128) >> 8);
+}
+
+void YuvScaler::scaleRow(const uint8_t *src, int stride, int src_width, const Taps &vertical, int out_row,
+                         const Taps &horizontal, int dst_width, uint16_t *acc, uint8_t *dst) {
+    // 缩小2倍以上时先用向量化的2:1平均缩小 (第一次与垂直累加合并)，剩下不到2倍的部分再查表，每个输出只需2~3个抽头
+    const uint8_t *rows = src + (long) vertical.start[out_row] * stride;
+    const uint16_t *v_weight = &vertical.weight[(size_t) out_row * vertical.taps];
+    if (horizontal.halvings > 0) {
+        int width = vertical_pass_pairs(rows, stride, v_weight, vertical.taps, src_width, acc);
+        for (int h = 1; h < horizontal.halvings; h++) width = halve_pass(acc, width);
+    } else {
+        vertical_pass(rows, stride, v_weight, vertical.taps, src_width, acc);
+    }
+    if (horizontal.identity) { // 整数倍缩小时预缩小后已是目标宽度，只需舍入回8位
+        narrow_pass(acc, dst_width, dst);
+        return;
+    }
+    const int *start = horizontal.start.data();
+    const uint16_t *weight = horizontal.weight.data();
+    switch (horizontal.taps) {
+        case 1: horizontal_pass<1>(acc, start, weight, 1, dst_width, dst); break;
+        case 2: horizontal_pass<2>(acc, start, weight, 2, dst_width, dst); break;
+        case 3: horizontal_pass<3>(acc, start, weight, 3, dst_width, dst); break;
+        case 4: horizontal_pass<4>(acc, start, weight, 4, dst_width, dst); break;
+        default: horizontal_pass<0>(acc, start, weight, horizontal.taps, dst_width, dst); break;
+    }
+}
+
+void YuvScaler::configure(int src_width, int src_height, int dst_width, int dst_height, int max_stripes) {
+    max_stripes = std::max(1, max_stripes);
+    if (src_width == src_width_ && src_height == src_height_ && dst_width == dst_width_ &&
+        dst_height == dst_height_ && (int) scratch_.size() >= max_stripes) {
+        return;
+    }
+    src_width_ = src_width;
+    src_height_ = src_height;
+    dst_width_ = dst_width;
+    dst_height_ = dst_height;
+    // 水平方向需要预缩小时垂直权重用Q7 (见vertical_pass_pairs)
+    buildHorizontalTaps(src_width, dst_width, &luma_x_);
+    buildTaps(src_height, dst_height, &luma_y_, luma_x_.halvings > 0 ? 128 : 256);
+    buildHorizontalTaps((src_width + 1) / 2, (dst_width + 1) / 2, &chroma_x_);
+    buildTaps((src_height + 1) / 2, (dst_height + 1) / 2, &chroma_y_, chroma_x_.halvings > 0 ? 128 : 256);
+    scratch_.resize(max_stripes);
+    for (Scratch &scratch : scratch_) {
+        scratch.acc.resize(src_width + 1); // 2:1预缩小奇数宽度时补一个位置
+        scratch.y.resize((size_t) dst_width * 2);
+        scratch.u.resize((dst_width + 1) / 2);
+        scratch.v.resize((dst_width + 1) / 2);
+    }
+}
+
+// 输出行对 [first_pair, last_pair)：每对两行亮度共用一行色度，缩放后交给转换内核
+void YuvScaler::convertRows(const uint8_t *src_y, int stride_y, const uint8_t *src_u, int stride_u,
+                            const uint8_t *src_v, int stride_v, uint8_t *dst, int dst_stride,
+                            int first_pair, int last_pair, Scratch *scratch) const {
+    int src_chroma_width = (src_width_ + 1) / 2;
+    int dst_chroma_width = (dst_width_ + 1) / 2;
+    for (int pair = first_pair; pair < last_pair; pair++) {
+        int row = pair * 2;
+        int rows = std::min(2, dst_height_ - row);
+        for (int r = 0; r < rows; r++) {
+            scaleRow(src_y, stride_y, src_width_, luma_y_, row + r, luma_x_, dst_width_, scratch->acc.data(),
+                     scratch->y.data() + (size_t) r * dst_width_);
+        }
+        scaleRow(src_u, stride_u, src_chroma_width, chroma_y_, pair, chroma_x_, dst_chroma_width,
+                 scratch->acc.data(), scratch->u.data());
+        scaleRow(src_v, stride_v, src_chroma_width, chroma_y_, pair, chroma_x_, dst_chroma_width,
+                 scratch->acc.data(), scratch->v.data());
+        // 两行亮度使用同一行色度，行号取输出画面中的行号 (RGB565抖动相位与不缩放时一致)
+        for (int r = 0; r < rows; r++) {
+            converter_.convertRow(scratch->y.data() + (size_t) r * dst_width_, scratch->u.data(), scratch->v.data(),
+                                  dst + (long) (row + r) * dst_stride, dst_width_, row + r);
+        }
+    }
+}
+
+void YuvScaler::convert(const uint8_t *src_y, int stride_y,
+                        const uint8_t *src_u, int stride_u,
+                        const uint8_t *src_v, int stride_v,
+                        uint8_t *dst, int dst_stride, WorkerPool *pool, int stripes) const {
+    if (scratch_.empty() || dst_width_ <= 0 || dst_height_ <= 0) return;
+    int pairs = (dst_height_ + 1) / 2;
+    stripes = std::min({stripes, pairs, (int) scratch_.size()});
+    if (!pool || stripes <= 1) {
+        convertRows(src_y, stride_y, src_u, stride_u, src_v, stride_v, dst, dst_stride, 0, pairs, &scratch_[0]);
+        return;
+    }
+    // 与YuvConverter的条带并行相同：参数放在栈上的结构体中，避免std::function每帧分配
+    struct Job {
+        const uint8_t *y, *u, *v;
+        int stride_y, stride_u, stride_v;
+        uint8_t *dst;
+        int dst_stride, pairs, stripes;
+    } job = {src_y, src_u, src_v, stride_y, stride_u, stride_v, dst, dst_stride, pairs, stripes};
+    const Job *j = &job;
+    pool->run(stripes, [this, j](int stripe) {
+        int first = (int) ((long) j->pairs * stripe / j->stripes);
+        int last = (int) ((long) j->pairs * (stripe + 1) / j->stripes);
+        convertRows(j->y, j->stride_y, j->u, j->stride_u, j->v, j->stride_v, j->dst, j->dst_stride, first, last,
+                    &scratch_[stripe]);
+    });
+}
@@ -1,3 +1,6 @@
+#ifndef AAUDIORENDER_H_
+#define AAUDIORENDER_H_
+
 #include <aaudio/AAudio.h>
 
 // AAudio使用的回调函数定义。第一个参数为当前的音频流，第二个参数是用户设置的数据指针，
@@ -7,7 +10,7 @@
 using AAudioCallback = int(*)(AAudioStream*, void*, void*, int32_t);
 
 class AAudioRender{
-    AAudioStream* stream;
+    AAudioStream* stream = nullptr;
     int32_t channel_count;
     int32_t sample_rate;
     bool paused;
@@ -20,18 +23,33 @@ public:
 
     AAudioRender();
 
-    // 指定采样率，通道数和数据格式，否则使用默认
+    // 指定采样率，通道数和数据格式，否则使用默认。采样率或格式为AAUDIO_UNSPECIFIED时使用设备原生值
     void configure(int32_t sampleRate, int32_t channelCnt, aaudio_format_t fmt);
 
     // 设置AAudio的回调，指定user_data为你需要的数据指针，user_data会传递给callback的第二个参数
     void setCallback(AAudioCallback cb, void* data);
 
-    // AAudioStream开始工作，成功返回0，失败返回<0
+    // 打开AAudioStream但不开始工作，之后可通过getSampleRate等获取设备实际使用的参数。成功返回0，失败返回<0
+    int open();
+
+    // AAudioStream开始工作 (尚未open时先open)，成功返回0，失败返回<0
     int start();
 
+    // 停止并关闭AAudioStream，返回后回调不会再被调用
+    void close();
+
     // 刷新AAudio的内部缓冲区
     int flush();
 
     // 参数p为true时表示暂停，为false时表示取消暂停
     int pause(bool p);
-};
\ No newline at end of file
+
+    int32_t getSampleRate() const { return sample_rate; }
+    int32_t getChannelCount() const { return channel_count; }
+    aaudio_format_t getFormat() const { return format; }
+
+    // 输出延迟：已写入AAudio但尚未被播放出来的数据时长 (纳秒)，由时间戳估算，不可用时返回-1。不能在回调中调用
+    int64_t outputLatencyNs();
+};
+
+#endif
@@ -9,18 +9,50 @@
 #define ANWDISPLAY_H_
 
 #include <stdint.h>
+#include <vector>
 #include <android/native_window.h>
 #include <android/native_window_jni.h>
+#include "YuvScaler.h"
 
+// 视频显示阶段：把画面区域的写入位置 (像素指针 + 行跨度) 借给转换器，转换器原地生成画面后提交显示。
+// 直接模式下借出的是锁定的窗口缓冲区 (黑边已填充)，每帧只写一遍；
+// 保留模式下借出的是一个小环形缓冲中的下一帧，提交时锁定窗口并拷贝，最近显示的一帧一直保留，
+// 窗口重绘 (expose、尺寸变化) 时由redisplay直接重新提交，不需要重新解码和转换。
+// 不持有窗口的引用，缓冲区几何属性由调用方设置；只在渲染线程上使用
 class ANWRender{
 public:
-    ANWRender(ANativeWindow *window);
-    int init(int videoWidth, int videoHeight);
-    int render(uint8_t* rgba);
+    // 借出的画面区域 (layout.width x layout.height)
+    struct Target {
+        uint8_t *pixels = nullptr;
+        int stride = 0;             // 每行字节数
+    };
+
+    explicit ANWRender(ANativeWindow *window);
+    // layout为窗口缓冲区中的画面布局，output为缓冲区格式 (RGBA8888或RGB565)；
+    // retainFrames>0时使用保留模式 (至少2帧：正在转换的一帧 + 最近显示的一帧)，成功返回0
+    int init(const LetterboxLayout &layout, YuvOutput output, int retainFrames = 0);
+    // 借出下一帧的画面区域，失败 (锁定失败或窗口格式与init时不符) 返回<0
+    int lock(Target *target);
+    // 显示lock借出的一帧
+    int post();
+    // 重新显示最近一次post的帧，保留模式以外或还没有显示过的帧时返回<0
+    int redisplay();
+    bool retaining() const { return !ring.empty(); }
 
 private:
+    // 锁定窗口缓冲区、检查格式并填充黑边，返回画面左上角
+    uint8_t *lockWindow(int *stride);
+    // 把环形缓冲中的一帧拷贝到窗口缓冲区并提交
+    int postSlot(int slot);
+
     ANativeWindow *native_window;
-    int width;
-    int height;
+    LetterboxLayout layout;
+    YuvOutput output = YuvOutput::Rgba8888;
+    int bytesPerPixel = 4;
+    bool windowLocked = false;
+    std::vector<std::vector<uint8_t>> ring;   // 保留模式的环形缓冲，每帧为紧密排列的画面
+    int ringStride = 0;
+    int writeSlot = -1;                        // lock借出的一帧
+    int shownSlot = -1;                        // 最近显示的一帧
 };
 #endif
@@ -0,0 +1,147 @@
+#ifndef AUDIODECODER_H_
+#define AUDIODECODER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Demuxer.h"
+#include "SpscRing.h"
+#include "TimeStretcher.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
+}
+
+// 音频解码管线：解码线程从Demuxer的音频包队列取包 (解复用器可与视频共用，文件只读取一次)，用libavcodec解码，经swresample转换为输出设备的采样率和声道数 (float)，
+// 由TimeStretcher按播放速度变速 (保持音调)，再转换为输出采样格式写入无锁环形缓冲区；
+// 音频回调 (AAudio) 通过read()取出交错排列的PCM。回调一侧不加锁、不分配内存、不做变速计算，
+// 缓冲区不足时输出静音并计为欠载。SwrContext按输入格式缓存，只有输入格式或输出参数变化时才重新创建。
+// 不依赖具体的音频输出，read()也可由任意线程调用 (如基准测试中的空输出)。
+class AudioDecoder {
+public:
+    struct OutputFormat {
+        int sample_rate = 48000;
+        int channels = 2;
+        AVSampleFormat sample_fmt = AV_SAMPLE_FMT_FLT;  // 交错格式：AV_SAMPLE_FMT_FLT或AV_SAMPLE_FMT_S16
+    };
+
+    struct Stats {
+        long frames_decoded = 0;       // 解码的音频帧 (AVFrame) 数
+        uint64_t samples_output = 0;   // 写入环形缓冲区的采样帧数 (每声道一个采样)
+        long underruns = 0;            // read()时缓冲区数据不足的次数
+        uint64_t silence_frames = 0;   // 因欠载补的静音采样帧数
+        long resampler_inits = 0;      // SwrContext创建次数
+        double decode_ms = 0.0;        // 解复用和解码耗时
+        double resample_ms = 0.0;      // 重采样耗时
+        double stretch_ms = 0.0;       // 变速耗时
+    };
+
+    AudioDecoder();
+    ~AudioDecoder();
+
+    // 打开输入文件并初始化最佳音频流的解码器，成功返回0，文件中没有音频流等失败返回<0
+    int open(const char *path);
+    // 在 (可能与视频共用的) 解复用器上初始化音频解码器
+    int open(const std::shared_ptr<Demuxer> &demuxer);
+    // 设置输出格式，必须在start之前调用
+    void setOutputFormat(const OutputFormat &format);
+    // 从start_s (秒) 处开始解码，启动解码线程 (解复用线程尚未运行时一并启动)，成功返回0。
+    // 共用的解复用器上视频也随之跳转
+    int start(double start_s);
+    // 停止解码线程 (文件保持打开，可再次start)
+    void stop();
+    // 停止并释放全部资源
+    void close();
+
+    // 跳转到time_s。会清空环形缓冲区，调用期间消费者不能调用read() (音频流应先暂停)
+    int seek(double time_s);
+    // 跟随共用的解复用器上别的消费者 (视频) 已发起的序号为serial的跳转，从time_s处开始输出，不再次跳转。
+    // 调用条件与seek相同
+    int follow(double time_s, int serial);
+    Demuxer *demuxer() const { return demuxer_.get(); }
+    // 播放速度 (0.25~4.0)，之后解码的数据按新速度变速
+    void setSpeed(double speed);
+
+    // 消费者：取出frames个采样帧到out (交错格式)，数据不足的部分填充静音。返回实际取出的采样帧数
+    int read(void *out, int frames);
+    // 下一个被read()取出的采样对应的媒体时间 (秒)，start后尚未解码出数据时返回false
+    bool position(double *media_time_s) const;
+    // 解码已到文件末尾且缓冲区已取空
+    bool finished() const;
+
+    const OutputFormat &outputFormat() const { return output_; }
+    int sourceSampleRate() const { return codec_ctx_ ? codec_ctx_->sample_rate : 0; }
+    int sourceChannels() const { return codec_ctx_ ? codec_ctx_->channels : 0; }
+    double durationS() const;
+    Stats stats() const;
+
+private:
+    // 时间标记：环形缓冲区中第frame个采样帧起对应的媒体时间和速度，用于计算播放位置
+    struct Marker {
+        uint64_t frame;
+        double media_s;
+        double speed;
+    };
+
+    // 解码线程已停止：从start_s处开始，只解码序号不早于min_serial的包
+    int restart(double start_s, int min_serial);
+    void decodeLoop();
+    int outputFrame(AVFrame *frame);
+    int drainStretcher();
+    bool ensureResampler(const AVFrame *frame);
+    bool writeAll(const uint8_t *data, int frames);
+    void resetBuffers();
+
+    std::shared_ptr<Demuxer> demuxer_;
+    PacketQueue *packets_ = nullptr;  // 由demuxer_持有
+    AVCodecContext *codec_ctx_ = nullptr;
+    int stream_idx_ = -1;
+    AVRational time_base_ = {1, 1000};
+    int64_t start_pts_ = 0;
+
+    OutputFormat output_;
+    int bytes_per_frame_ = 8;
+
+    // 解码线程独占
+    SwrContext *swr_ = nullptr;
+    int swr_in_rate_ = 0;
+    int swr_in_fmt_ = -1;
+    uint64_t swr_in_layout_ = 0;
+    uint8_t *convert_buffer_ = nullptr;
+    int convert_capacity_ = 0;        // convert_buffer_可容纳的采样帧数
+    TimeStretcher stretcher_;
+    bool stretch_started_ = false;
+    double stretch_base_s_ = 0.0;     // 变速器输入第0帧的媒体时间
+    std::vector<float> stretch_buffer_;
+    std::vector<int16_t> s16_buffer_;
+    int min_serial_ = 0;              // 本次start的跳转序号，更早的包作废
+    int packet_serial_ = -1;          // 当前解码的包的跳转序号
+    uint64_t frames_written_ = 0;
+    double skip_until_s_ = -1.0;      // 跳转后丢弃早于此时间的采样
+    double next_media_s_ = 0.0;       // 下一帧的预期媒体时间 (帧没有时间戳时使用)
+
+    SpscRing<uint8_t> samples_;
+    SpscRing<Marker> markers_;
+    std::thread decode_thread_;
+    std::atomic<bool> abort_{false};
+    std::atomic<bool> eof_{false};
+    std::atomic<double> speed_{1.0};
+
+    // 消费者 (音频回调) 独占
+    uint64_t frames_read_ = 0;
+    Marker current_marker_ = {0, 0.0, 1.0};
+    bool has_marker_ = false;
+    std::atomic<double> position_s_{-1.0};
+    std::atomic<long> underruns_{0};
+    std::atomic<uint64_t> silence_frames_{0};
+
+    mutable std::mutex stats_mutex_;   // 保护stats_中解码线程更新的部分
+    Stats stats_;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef AVSYNC_H_
+#define AVSYNC_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "PresentationClock.h"
+
+// 以音频为主时钟的音视频同步：音频输出位置 (OpenSL ES的GetPosition或AAudio的时间戳) 决定视频时钟。
+// 每帧显示前比较视频时钟与音频位置，偏差超过阈值时把视频时钟校正到音频位置：
+// 视频落后时之后的帧因超过截止时刻被PresentationClock丢弃，视频超前时当前画面保持到音频追上 (相当于重复帧)。
+// 没有音频 (未播放或不可用) 时视频按自己的时钟播放。除setAudioClock/setThresholdMs/stats/history外只应由渲染线程调用。
+class AvSync {
+public:
+    // 音频时钟：返回当前音频输出位置 (媒体时间，秒)，音频未在播放时返回false
+    using AudioClock = std::function<bool(double *media_time_s)>;
+
+    // 某一时刻的A/V偏差 (视频帧时间 - 音频位置，正值表示视频超前)
+    struct OffsetSample {
+        double media_time_s;
+        double offset_ms;
+    };
+
+    struct Stats {
+        long samples = 0;               // 有音频时显示的帧数
+        long corrections_ahead = 0;     // 视频超前而校正 (等待音频，画面重复) 的次数
+        long corrections_behind = 0;    // 视频落后而校正 (之后丢帧追赶) 的次数
+        double offset_last_ms = 0.0;
+        double offset_mean_ms = 0.0;
+        double offset_max_ms = 0.0;     // 绝对值最大的偏差
+        double threshold_ms = 0.0;
+    };
+
+    AvSync();
+
+    void setAudioClock(AudioClock clock);
+    // 允许的最大A/V偏差，超过时校正视频时钟
+    void setThresholdMs(double threshold_ms);
+    double thresholdMs() const { return threshold_ms_.load(); }
+
+    // 显示一帧前调用：按音频位置校正clock，返回是否有可用的音频时钟
+    bool syncVideo(PresentationClock &clock);
+    // 帧显示后调用：记录该帧相对音频的偏差
+    void framePresented(double frame_time_s);
+    // 跳转或重新开始播放时清除音频位置的平滑状态和统计
+    void reset();
+
+    Stats stats() const;
+    // 按时间顺序返回最近一分钟的偏差采样 (每250毫秒一个)
+    std::vector<OffsetSample> history() const;
+
+private:
+    // 平滑后的音频位置：OpenSL ES的位置按数十毫秒的步长更新，两次变化之间按播放速度外推
+    bool audioTime(double *media_time_s);
+
+    std::atomic<double> threshold_ms_;
+    std::mutex clock_mutex_;            // 保护audio_clock_
+    AudioClock audio_clock_;
+
+    double speed_ = 1.0;                // 外推使用的播放速度 (取自视频时钟)
+    double last_raw_s_ = -1.0;          // 上次读到的原始位置
+    int64_t last_raw_ns_ = 0;           // 原始位置变化的时刻
+    int64_t last_history_ns_ = 0;
+
+    mutable std::mutex stats_mutex_;
+    Stats stats_;
+    std::vector<OffsetSample> history_; // 环形缓冲区
+    size_t history_next_ = 0;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <string>
+
+// 播放器各阶段的性能基准测试。每个函数返回可读的文本报告，同时输出到logcat。
+
+// YUV420p->RGBA转换：各可用内核在不同分辨率下的吞吐量 (像素/纳秒)，并校验与标量实现逐位一致 (不一致时*failures加1)
+std::string benchmark_yuv_convert(int *failures = nullptr);
+
+// 条带并行YUV->RGBA转换：1080p/2160p在1/2/4/8路条带 (共用工作线程池) 下的单帧转换耗时和加速比，
+// 并校验与单线程结果逐位一致 (不一致时*failures加1)
+std::string benchmark_yuv_convert_parallel(int *failures = nullptr);
+
+// 缩放+转换：1080p/2160p转换到视频尺寸与缩放到1080p/720p/360p窗口 (含黑边布局) 的单帧耗时和写入量，
+// 并校验同尺寸缩放与直接转换逐位一致、平坦画面缩放后颜色不变 (每项不满足时*failures加1)
+std::string benchmark_scaled_convert(int *failures = nullptr);
+
+// 颜色格式特化：BT.601/709/2020 x limited/full x 色度位置Center/Left各特化内核的1080p转换耗时 (相对旧版固定BT.601内核)，
+// 与系数运行时读取、像素循环内判断色度位置的对照实现比较，并校验三者逐位一致 (不一致时*failures加1)
+std::string benchmark_yuv_color_formats(int *failures = nullptr);
+
+// RGB565 输出：1080p/720p 下 RGB565 与 RGBA8888 的转换耗时、转换加一次整帧缓冲区拷贝 (模拟提交后合成器的读取) 的耗时和每帧字节数
+std::string benchmark_rgb565_output();
+
+// 显示阶段：1080p下转换器直接写入窗口缓冲区与先转换再拷贝 (旧版ANWRender、重绘缓存) 的每帧耗时，以及重绘缓存重新显示一帧的耗时
+std::string benchmark_present_modes();
+
+// 像素格式归一化：各常见源格式转换为YUV420P的耗时，快速路径同时与swscale的结果对比
+std::string benchmark_pixel_formats();
+
+// 显示节奏：模拟耗时不定的转换，对比逐帧usleep与绝对截止时刻两种方式的显示误差和抖动。
+// 绝对截止时刻的平均误差或抖动超出上限、或不优于usleep时*failures加1
+std::string benchmark_presentation_clock(int *failures = nullptr);
+
+// 音视频同步：模拟漂移的音频时钟，对比视频独立计时与以音频为主时钟时的A/V偏差。
+// 音频主时钟的平均或末帧偏差超过同步阈值、或不优于独立计时时*failures加1
+std::string benchmark_av_sync(int *failures = nullptr);
+
+// 帧队列：满载、消费慢、生产慢三种负载下无锁SPSC环 (futex等待) 与互斥锁队列的吞吐量、入队/出队耗时和交接延迟分位数，
+// 以及无锁环的等待次数和平均占用
+std::string benchmark_frame_queue();
+
+// 播放控制：模拟30fps渲染，对比命令队列+事件唤醒与轮询全局原子变量时暂停/恢复/跳转/停止从提交到生效的延迟，
+// 以及暂停期间渲染线程被唤醒的次数
+std::string benchmark_player_control();
+
+// 保持音调的变速：合成正弦信号在各相关度内核和0.25x~4x速度下每个输出采样的CPU周期数，以及输出长度和音高
+std::string benchmark_time_stretch();
+
+// 解码吞吐量 (帧/秒)：示例视频和合成的1080p/2160p视频分别在1~N个线程、帧级/片级多线程下的解码速度
+std::string benchmark_decode_threads(const char *input_path);
+
+// 帧缓冲池：示例视频和合成1080p视频使用FFmpeg默认分配与帧缓冲池时的解码速度，
+// 以及流式播放示例视频时预热后帧缓冲、AVPacket和operator new的分配次数 (应为0，否则*failures加1)
+std::string benchmark_frame_pool(const char *input_path, int *failures = nullptr);
+
+// 多实例播放：1/2/4/8个实例同时流式解码示例视频，对比各自使用帧缓冲池和单实例线程数与共用帧缓冲池、
+// 按实例数平分解码线程时的合计帧率、最慢实例的实时倍数、解码线程总数和缓冲区内存
+std::string benchmark_multi_instance(const char *input_path);
+
+// 音频解码管线：FFmpeg解码+重采样+变速写入环形缓冲区、空输出尽快取出时的吞吐量 (实时倍数)，以及各阶段耗时
+std::string benchmark_audio_pipeline(const char *input_path);
+
+// YUV缓存构建耗时：顺序解码与2~N个分段并行解码的对比
+std::string benchmark_cache_build(const char *input_path);
+
+// YUV缓存写入开销：仅解码、解码+异步写入、解码+同步写入、解码器直接写入帧槽 (零拷贝) 的帧率和每帧拷贝字节数，
+// 以及写入线程的I/O和等待耗时
+std::string benchmark_cache_write(const char *input_path);
+
+// 流式跳转耗时：使用关键帧索引与按帧率估算时间戳两种方式的平均/最大跳转耗时和落点准确率，以及索引的加载耗时
+std::string benchmark_seek(const char *input_path);
+
+// 运行全部基准测试，input_path为用于解码相关测试的媒体文件。failures非空时加上未通过的检查数
+std::string benchmark_run_all(const char *input_path, int *failures = nullptr);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef BOUNDEDQUEUE_H_
+#define BOUNDEDQUEUE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// 有界阻塞队列，用于解复用线程、解码线程与渲染线程之间传递数据包/帧。
+// 队列满时push阻塞（形成背压），队列空时pop阻塞；abort()唤醒所有等待者并使后续操作立即返回。
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+    // 入队，最多等待timeout_ms毫秒（<0表示一直等待）。成功返回true，超时或已abort返回false
+    bool push(T item, int timeout_ms = -1) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto ready = [this] { return aborted_ || items_.size() < capacity_; };
+        if (timeout_ms < 0) {
+            not_full_.wait(lock, ready);
+        } else if (!not_full_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) {
+            return false;
+        }
+        if (aborted_) return false;
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // 出队，最多等待timeout_ms毫秒（<0表示一直等待）。成功返回true，超时或已abort返回false
+    bool pop(T &out, int timeout_ms = -1) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto ready = [this] { return aborted_ || !items_.empty(); };
+        if (timeout_ms < 0) {
+            not_empty_.wait(lock, ready);
+        } else if (!not_empty_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) {
+            return false;
+        }
+        if (aborted_) return false;
+        out = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    // 清空队列，disposer用于释放队列中仍持有的元素（如AVPacket/AVFrame）
+    void clear(const std::function<void(T &)> &disposer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &item : items_) disposer(item);
+        items_.clear();
+        not_full_.notify_all();
+    }
+
+    // 终止队列：唤醒所有阻塞的push/pop
+    void abort() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        aborted_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+    // 重新启用队列（用于abort之后复用）
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        aborted_ = false;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+
+private:
+    std::deque<T> items_;
+    size_t capacity_;
+    bool aborted_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+#endif
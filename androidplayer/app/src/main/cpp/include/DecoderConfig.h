@@ -0,0 +1,53 @@
+#ifndef DECODERCONFIG_H_
+#define DECODERCONFIG_H_
+
+#include <functional>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+// 在avcodec_open2之前对解码器上下文的额外设置 (如安装get_buffer2回调)
+using DecoderSetup = std::function<void(AVCodecContext *)>;
+
+// 解码器线程配置。帧级多线程 (FF_THREAD_FRAME) 并行解码多帧，吞吐量高但每个线程会增加一帧延迟；
+// 片级多线程 (FF_THREAD_SLICE) 并行解码同一帧的多个slice，无额外延迟但依赖码流的slice划分。
+// 两者同时开启时由FFmpeg按解码器能力选择。
+struct DecoderThreadConfig {
+    int thread_count = 0;                                  // 0表示按分辨率和在线核心数自动选择
+    int thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+};
+
+// 全局默认配置，所有解码器实例 (流式播放、缓存解码) 打开时使用。Java层可通过JNI覆盖
+void decoder_set_default_thread_config(const DecoderThreadConfig &config);
+DecoderThreadConfig decoder_default_thread_config();
+
+// 当前在线的CPU核心数
+int decoder_online_cores();
+
+// 按分辨率选择线程数：小分辨率下每帧工作量小，线程过多只会增加同步开销和延迟。
+// 有多路视频同时解码 (多个播放器实例) 时在线核心数在各路之间平分，所有实例的解码线程总数不随实例数成倍增长
+int decoder_auto_thread_count(int width, int height);
+
+// 登记/注销一路正在解码的视频流 (StreamDecoder在打开解码器前登记，停止时注销)
+void decoder_stream_opened();
+void decoder_stream_closed();
+// 当前登记的视频流数
+int decoder_active_streams();
+
+// 将配置应用到解码器上下文，必须在avcodec_open2之前调用
+void decoder_apply_thread_config(AVCodecContext *codec_ctx, const DecoderThreadConfig &config);
+
+// 打开输入文件，按配置初始化最佳视频流的解码器。成功返回0，失败返回-1~-7，
+// 失败时已分配的上下文仍通过参数返回，由调用者释放。setup非空时在打开解码器之前调用
+int decoder_open_video(const char *path, const DecoderThreadConfig &config,
+                       AVFormatContext **fmt_ctx, AVCodecContext **codec_ctx, int *stream_idx,
+                       const DecoderSetup &setup = nullptr);
+
+// 在已打开的输入上按配置初始化最佳视频流的解码器 (如与音频共用的Demuxer)。成功返回0，失败返回-3~-7，
+// 失败时已分配的解码器上下文仍通过参数返回，由调用者释放。setup非空时在打开解码器之前调用
+int decoder_open_video_stream(AVFormatContext *fmt_ctx, const DecoderThreadConfig &config,
+                              AVCodecContext **codec_ctx, int *stream_idx, const DecoderSetup &setup = nullptr);
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef DEMUXER_H_
+#define DEMUXER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PacketQueue.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// 单一解复用器：一个线程只读取、解析一次输入文件，把各流的包分发到该流的包队列 (按字节数限制)，
+// 由视频 (StreamDecoder) 和音频 (AudioDecoder) 的解码线程分别取出。同一文件不再被音视频各打开一次。
+// 背压：某个流的队列达到上限时解复用线程等待，内存不会无限增长；但若此时另一个启用的流的队列已空
+// (其消费者即将饿死)，允许该队列临时超出上限 (最多kOverflowFactor倍) 继续读取，交错存储的文件中
+// 一个流积压不会让另一个流断粮。未启用的流的包直接丢弃。
+// 跳转是整个文件的操作：在解复用线程中执行，启用了视频流时按视频流定位 (落在关键帧上，音频随之定位到同一位置)，
+// 随后清空所有队列，之后的包带新的跳转序号。尚未执行的跳转请求被后来的请求覆盖。
+// 消费者之间的协调：收到别的消费者发起的跳转 (序号变化但不是自己请求的) 时应从已输出的位置继续，而不是重复输出。
+class Demuxer {
+public:
+    struct Stats {
+        long packets = 0;             // 分发到队列的包数
+        long dropped_packets = 0;     // 未启用的流被丢弃的包数
+        long overflow_packets = 0;    // 因其他流饿死而超出常规上限放入的包数
+        long seeks = 0;               // 执行的跳转次数 (合并后)
+        double blocked_ms = 0.0;      // 因队列满等待的时间
+    };
+
+    Demuxer();
+    ~Demuxer();
+
+    // 打开输入文件并读取流信息，成功返回0，失败返回-1 (无法打开) 或-2 (无法读取流信息)
+    int open(const char *path);
+    const std::string &path() const { return path_; }
+    // 只在start之前 (或仅用于读取流参数) 访问，运行中由解复用线程独占读取
+    AVFormatContext *formatContext() const { return fmt_ctx_; }
+    int videoStream() const { return video_idx_; }
+    int audioStream() const { return audio_idx_; }
+
+    // 启用流，返回其包队列 (由Demuxer持有，生命周期与Demuxer相同)。max_bytes为常规上限。运行中也可调用
+    PacketQueue *enableStream(int stream_index, size_t max_bytes);
+    // 停用流：之后该流的包被丢弃，队列清空并终止
+    void disableStream(int stream_index);
+
+    // 启动解复用线程 (已在运行时直接返回0)
+    int start();
+    bool running() const { return running_; }
+    // 停止解复用线程
+    void stop();
+
+    // 请求跳转到time_s (相对流起点的秒数)，异步执行，返回跳转后的包序号。
+    // video_ts/byte_pos为视频流中已知关键帧的时间戳和字节偏移 (来自关键帧索引)，可选
+    int seek(double time_s, int64_t video_ts = AV_NOPTS_VALUE, int64_t byte_pos = -1);
+    // 最近一次请求的跳转序号 (没有跳转过时为0)
+    int lastSerial() const;
+    // 序号为serial的跳转的目标时间 (秒)，该请求已被之后的请求取代时返回false
+    bool seekTime(int serial, double *time_s) const;
+
+    Stats stats() const;
+    // 包结构体的累计分配次数 (预热后应不再增长)
+    long packetAllocations() const { return packet_pool_.allocations(); }
+
+private:
+    struct SeekRequest {
+        int serial;
+        double time_s;
+        int64_t video_ts;
+        int64_t byte_pos;
+    };
+
+    void demuxLoop();
+    void performSeek(const SeekRequest &request);
+    PacketQueue *enabledQueue(int stream_index);
+    bool otherStreamStarving(int stream_index);
+    void clearQueues();
+
+    std::string path_;
+    AVFormatContext *fmt_ctx_ = nullptr;
+    int video_idx_ = -1;
+    int audio_idx_ = -1;
+
+    PacketPool packet_pool_;                         // 各队列共用的空包 (须在queues_之前声明，析构在其之后)
+    std::mutex streams_mutex_;                       // 保护下面两个数组中的启用状态
+    std::vector<std::unique_ptr<PacketQueue>> queues_;
+    std::vector<bool> enabled_;
+
+    std::mutex thread_mutex_;                        // start/stop可能由不同消费者的线程调用
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> abort_{false};
+
+    mutable std::mutex seek_mutex_;                  // 保护跳转请求
+    SeekRequest seek_request_ = {0, 0.0, AV_NOPTS_VALUE, -1};
+    bool seek_pending_ = false;
+    int next_serial_ = 0;
+
+    mutable std::mutex stats_mutex_;
+    Stats stats_;
+};
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef FRAMECACHE_H_
+#define FRAMECACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BoundedQueue.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+// 自描述的解码帧缓存文件格式 (版本2)，布局：
+//   [FrameCacheHeader，占kFrameCacheHeaderSize字节] [帧0] [帧1] ... [帧N-1]
+//   [FrameCacheIndexEntry × N] [FrameCacheFooter]
+// 文件头记录尺寸、行跨度、像素格式、色彩空间、时间基和源文件标识 (大小、修改时间、抽样内容哈希source_hash，
+// 版本2新增)；尾部索引记录每帧的偏移、PTS和关键帧标志，因此帧数、时长和跳转目标都可O(1)得到。
+// 源文件标识用于检测过期缓存。frame_count/index_offset和kFrameCacheFlagComplete在finish时写入，
+// 未完成的文件没有索引和文件尾。
+// 续写日志 "<缓存文件>.journal" 为顺序追加的FrameCacheIndexEntry数组 (无文件头)：每帧的数据写入文件后追加其索引项，
+// 解码中断后resume据此恢复已写入的帧并续写；finish后删除。
+
+static const char kFrameCacheMagic[8] = {'A', 'P', 'F', 'C', 'A', 'C', 'H', 'E'};
+static const char kFrameCacheFooterMagic[8] = {'A', 'P', 'F', 'C', 'I', 'N', 'D', 'X'};
+static const uint32_t kFrameCacheVersion = 2;
+static const uint32_t kFrameCacheHeaderSize = 4096;  // 文件头占满一页，使帧数据按页对齐
+static const uint32_t kFrameCacheFlagComplete = 1u;  // 索引和文件尾已写入
+static const uint32_t kFrameCacheFrameKey = 1u;      // 索引项标志：关键帧
+
+enum FrameCacheError {
+    kFrameCacheOk = 0,
+    kFrameCacheIoError = -1,       // 打开/读写/映射失败
+    kFrameCacheBadFormat = -2,     // 不是缓存文件或版本不兼容
+    kFrameCacheIncomplete = -3,    // 解码中断，缺少索引
+    kFrameCacheStale = -4,         // 源文件已变化
+};
+
+#pragma pack(push, 1)
+struct FrameCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t flags;
+    int32_t width;
+    int32_t height;
+    int32_t pix_fmt;               // AVPixelFormat
+    int32_t color_space;           // AVColorSpace
+    int32_t color_range;           // AVColorRange
+    int32_t color_primaries;       // AVColorPrimaries
+    int32_t color_trc;             // AVColorTransferCharacteristic
+    int32_t chroma_location;       // AVChromaLocation
+    int32_t time_base_num;
+    int32_t time_base_den;
+    int32_t frame_rate_num;
+    int32_t frame_rate_den;
+    int32_t plane_count;
+    int32_t strides[4];            // 各平面行跨度 (字节)
+    int32_t plane_heights[4];      // 各平面行数
+    uint64_t plane_offsets[4];     // 各平面相对帧起始的偏移
+    uint64_t frame_size;           // 每帧占用字节数
+    uint64_t source_size;          // 源文件大小
+    int64_t source_mtime_ns;       // 源文件修改时间
+    uint64_t frame_count;          // 完成后写入
+    uint64_t index_offset;         // 完成后写入
+    uint8_t source_hash[16];       // 源文件抽样内容哈希 (murmur3)
+};
+
+struct FrameCacheIndexEntry {
+    uint64_t offset;               // 帧数据的文件偏移
+    int64_t pts;                   // 以time_base为单位
+    uint32_t flags;                // kFrameCacheFrameKey
+    uint32_t reserved;
+};
+
+struct FrameCacheFooter {
+    uint64_t index_offset;
+    uint64_t frame_count;
+    int64_t first_pts;
+    int64_t duration;              // 以time_base为单位
+    char magic[8];
+};
+#pragma pack(pop)
+
+// 源文件标识：大小、修改时间和抽样内容哈希。内容哈希决定缓存文件名，
+// 修改时间仅作参考 (重新拷贝相同内容的文件只会改变修改时间，缓存仍然有效)
+struct FrameCacheSourceKey {
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    uint8_t hash[16] = {0};        // murmur3 (128位)，覆盖文件大小和均匀分布的若干采样块
+
+    std::string hex() const;       // 哈希的十六进制表示
+    bool sameContent(const FrameCacheHeader &header) const;
+};
+
+// 计算源文件标识，成功返回0
+int frame_cache_compute_source_key(const char *path, FrameCacheSourceKey *key);
+
+// 创建缓存所需的流描述
+struct FrameCacheFormat {
+    int width = 0;
+    int height = 0;
+    AVPixelFormat pix_fmt = AV_PIX_FMT_YUV420P;
+    AVColorSpace color_space = AVCOL_SPC_UNSPECIFIED;
+    AVColorRange color_range = AVCOL_RANGE_UNSPECIFIED;
+    AVColorPrimaries color_primaries = AVCOL_PRI_UNSPECIFIED;
+    AVColorTransferCharacteristic color_trc = AVCOL_TRC_UNSPECIFIED;
+    AVChromaLocation chroma_location = AVCHROMA_LOC_UNSPECIFIED;
+    AVRational time_base = {1, 1000};
+    AVRational frame_rate = {25, 1};
+    FrameCacheSourceKey source;
+
+    // 由视频流和已打开的解码器上下文填充。像素格式固定为YUV420P，取值范围为归一化后的范围 (yuvj420p等保持full range)，
+    // 写入的帧需先经FrameNormalizer归一化
+    static FrameCacheFormat fromStream(const AVStream *stream, const AVCodecContext *codec_ctx,
+                                       const FrameCacheSourceKey &source);
+};
+
+// 顺序写入缓存文件：open (或resume) -> writeFrame × N -> finish。
+// writeFrame只把帧紧密打包进大块对齐缓冲区 (每块容纳若干帧)，写满的缓冲区交给专用I/O线程
+// 用一次pwrite写入，解码线程不直接等待存储。缓冲区至少两块轮换使用，仅当I/O线程落后超过
+// 所有缓冲区时解码线程才会等待 (计入stats().stall_ms)。async为false时在调用线程中同步写入 (用于对比测试)。
+class FrameCacheWriter {
+public:
+    struct Stats {
+        uint64_t bytes_written = 0;
+        uint64_t bytes_copied = 0; // 解码后的拷贝量：打包进缓冲区 + pwrite拷贝到页缓存
+        long chunks_written = 0;
+        double io_ms = 0.0;        // I/O线程写入耗时
+        double stall_ms = 0.0;     // 调用线程等待空闲缓冲区的耗时
+    };
+
+    explicit FrameCacheWriter(bool async = true);
+    ~FrameCacheWriter();
+
+    int open(const char *path, const FrameCacheFormat &format);
+
+    // 续写未完成的缓存文件：按日志恢复已写入的帧 (丢弃不完整的末尾帧)，之后writeFrame继续追加。
+    // 文件不存在、已完成或格式与format不一致时返回错误，调用方应改用open重新写入
+    int resume(const char *path, const FrameCacheFormat &format);
+
+    // 追加一帧 (按文件头中的行跨度紧密排列各平面)，并记录索引项
+    int writeFrame(const AVFrame *frame);
+
+    // 等待所有缓冲区写完，写入索引和文件尾，并将文件头标记为完成
+    int finish();
+
+    // 等待已提交的缓冲区写完后关闭文件；未调用finish时缓存保持未完成状态，打开时会被识别
+    void close();
+
+    long frameCount() const { return (long) index_.size(); }
+    // 最后写入帧的PTS，尚未写入时返回AV_NOPTS_VALUE
+    int64_t lastPts() const { return index_.empty() ? AV_NOPTS_VALUE : index_.back().pts; }
+    const FrameCacheHeader &header() const { return header_; }
+    Stats stats() const;
+
+private:
+    struct Chunk;
+
+    int startIo();
+    void stopIo();
+    void ioLoop();
+    void submitChunk();
+    void writeChunk(Chunk *chunk);
+
+    int fd_ = -1;
+    FILE *journal_ = nullptr;      // 索引日志，用于中断后续写 (只记录数据已写入文件的帧)
+    std::string path_;
+    FrameCacheHeader header_ = {};
+    std::vector<FrameCacheIndexEntry> index_;
+    uint64_t next_offset_ = 0;
+
+    const bool async_;
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+    BoundedQueue<Chunk *> free_chunks_;
+    BoundedQueue<Chunk *> pending_chunks_;
+    Chunk *current_ = nullptr;     // 正在打包的缓冲区
+    std::thread io_thread_;
+    std::atomic<bool> io_error_{false};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<long> chunks_written_{0};
+    std::atomic<int64_t> io_ns_{0};
+    double stall_ms_ = 0.0;
+    uint64_t bytes_packed_ = 0;
+};
+
+// 按帧号随机写入缓存文件：open -> writeFrameAt × N (可多线程) -> finish。
+// 帧数预先已知 (来自包扫描)，每帧在文件中的位置固定，各线程用pwrite直接写入自己的帧，互不等待
+class FrameCacheSlotWriter {
+public:
+    FrameCacheSlotWriter() = default;
+    ~FrameCacheSlotWriter();
+
+    // 创建缓存文件并预留frame_count帧的空间
+    int open(const char *path, const FrameCacheFormat &format, long frame_count);
+
+    // 写入显示顺序为index的帧。不同线程可同时调用，但同一index只能由一个线程写入
+    int writeFrameAt(long index, const AVFrame *frame);
+
+    // 所有帧都已写入时写入索引和文件尾并标记完成，有帧缺失时返回kFrameCacheIncomplete
+    int finish();
+    void close();
+
+    long frameCount() const { return (long) index_.size(); }
+    long framesWritten() const { return frames_written_.load(); }
+    const FrameCacheHeader &header() const { return header_; }
+    // 解码后的拷贝量：打包进线程本地缓冲区 + pwrite拷贝到页缓存
+    uint64_t bytesCopied() const { return bytes_copied_.load(); }
+
+private:
+    int fd_ = -1;
+    FrameCacheHeader header_ = {};
+    std::vector<FrameCacheIndexEntry> index_;
+    std::vector<uint8_t> written_;             // 各帧是否已写入 (每项只由写该帧的线程修改)
+    std::atomic<long> frames_written_{0};
+    std::atomic<uint64_t> bytes_copied_{0};
+};
+
+// 零拷贝写入缓存文件：解码器通过get_buffer2回调直接把帧解码到缓存文件中按页对齐的帧槽 (每个槽单独mmap)，
+// 帧解码完成时已在页缓存中，不再逐行拷贝和pwrite。帧槽按解码器申请缓冲区的顺序依次分配，
+// 索引项按显示顺序记录各帧所在槽的偏移；解码器申请了但没有输出 (或不属于本分段) 的帧留下空槽。
+// 文件头中的行跨度和平面行数取解码器对齐后的尺寸 (大于可见尺寸)，读取方按文件头访问，无需特殊处理。
+// 只适用于输出已是缓存格式 (YUV420P，任意范围)、支持直接渲染 (DR1) 的软件解码器 (见supports)，
+// 其他情况使用FrameCacheWriter/FrameCacheSlotWriter的拷贝路径；输出帧不在本写入器的帧槽中时 (如被裁剪、
+// 尺寸超出帧槽而使用了默认分配) 拷贝到新的帧槽。不写续写日志，中断后重新解码。
+// 用法：attach (avcodec_open2之前，可装入多个解码器) -> open -> writeFrame × N 或 writeFrameAt × N -> finish。
+// 写入器需比装入它的解码器活得更久；帧槽的映射由缓冲区引用计数管理，最后一个引用释放时解除映射
+class FrameCacheDirectWriter {
+public:
+    struct Stats {
+        long direct_frames = 0;    // 解码器直接写入帧槽、无需拷贝的帧数
+        long copied_frames = 0;    // 拷贝到帧槽的帧数
+        uint64_t bytes_copied = 0;
+        long slots = 0;            // 分配的帧槽数 (含空槽)
+    };
+
+    FrameCacheDirectWriter();
+    ~FrameCacheDirectWriter();
+
+    // 已打开的解码器的输出能否直接作为缓存帧
+    static bool supports(const AVCodecContext *codec_ctx);
+    // 把写入器装入解码器 (设置get_buffer2和opaque)，必须在avcodec_open2之前调用。open之前的申请使用默认分配
+    void attach(AVCodecContext *codec_ctx);
+
+    // 按已打开的解码器codec_ctx的对齐尺寸创建缓存文件。frame_count > 0时按显示序号写入 (writeFrameAt)，否则顺序追加
+    int open(const char *path, const FrameCacheFormat &format, const AVCodecContext *codec_ctx, long frame_count = 0);
+    // 追加一帧
+    int writeFrame(const AVFrame *frame);
+    // 写入显示顺序为index的帧。不同线程可同时调用，但同一index只能由一个线程写入
+    int writeFrameAt(long index, const AVFrame *frame);
+    // 写入索引和文件尾并标记完成 (之后的缓冲区申请使用默认分配)。按序号写入且有帧缺失时返回kFrameCacheIncomplete
+    int finish();
+    void close();
+
+    long frameCount() const { return (long) index_.size(); }
+    const FrameCacheHeader &header() const { return header_; }
+    Stats stats() const;
+
+private:
+    struct Slot;
+
+    static int getBuffer2(AVCodecContext *codec_ctx, AVFrame *frame, int flags);
+    static void releaseSlot(void *opaque, uint8_t *data);
+    Slot *mapSlot();
+    int placeFrame(const AVFrame *frame, uint64_t *offset);
+
+    mutable std::mutex mutex_;     // 保护文件长度、帧槽分配和统计 (解码器的帧线程会并发申请缓冲区)
+    int fd_ = -1;
+    std::string path_;
+    FrameCacheHeader header_ = {};
+    std::vector<FrameCacheIndexEntry> index_;
+    std::vector<uint8_t> written_;  // 按序号写入时各帧是否已写入
+    std::atomic<long> frames_written_{0};
+    bool by_index_ = false;
+    long next_slot_ = 0;
+    uint64_t file_size_ = 0;        // 已扩展的文件长度
+    size_t page_size_ = 4096;
+    Stats stats_;
+};
+
+// 以内存映射方式只读访问缓存文件。转换器直接从页缓存读取各平面数据，
+// 跳转只是索引查找，映射建立后只读访问无需加锁。
+class FrameCacheReader {
+public:
+    FrameCacheReader();
+    ~FrameCacheReader();
+
+    // 映射并校验缓存文件，source非空时同时校验源文件内容。成功返回0，失败返回FrameCacheError
+    int open(const char *path, const FrameCacheSourceKey *source = nullptr);
+    void close();
+
+    const FrameCacheHeader &header() const { return header_; }
+    long frameCount() const { return frame_count_; }
+    int width() const { return header_.width; }
+    int height() const { return header_.height; }
+    int stride(int plane) const { return header_.strides[plane]; }
+    double frameRate() const;
+
+    // 指定帧的某个平面的起始地址，越界返回nullptr
+    const uint8_t *plane(long index, int plane) const;
+    int64_t framePts(long index) const;
+    // 帧相对第一帧的显示时间 (毫秒)，时间戳不可用时按帧率换算
+    double frameTimeMs(long index) const;
+    bool isKeyframe(long index) const;
+
+    // 总时长 (毫秒)
+    double durationMs() const;
+    // 时间点对应的帧号 (按帧率换算，结果限制在有效范围内)
+    long frameForTimeMs(double time_ms) const;
+
+    // 提示内核预读从index开始的count帧 (madvise WILLNEED)
+    void prefetch(long index, int count) const;
+
+private:
+    uint8_t *base_ = nullptr;
+    size_t length_ = 0;
+    FrameCacheHeader header_ = {};
+    const FrameCacheIndexEntry *index_ = nullptr;
+    const FrameCacheFooter *footer_ = nullptr;
+    long frame_count_ = 0;
+    size_t page_size_ = 4096;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef FRAMECACHEMANAGER_H_
+#define FRAMECACHEMANAGER_H_
+
+#include <string>
+#include "FrameCache.h"
+
+// 启动类型：冷启动需要完整解码，热启动直接复用已完成的缓存，续写从中断处继续解码
+enum class FrameCacheStartup { Cold, Warm, Resumed };
+
+const char *frame_cache_startup_name(FrameCacheStartup startup);
+
+// 一次缓存准备的结果和耗时统计
+struct FrameCacheStats {
+    FrameCacheStartup startup = FrameCacheStartup::Cold;
+    std::string cache_path;
+    int width = 0;
+    int height = 0;
+    double frame_rate = 25.0;
+    long frame_count = 0;
+    long resumed_frames = 0;      // 续写时已存在的帧数
+    int decode_workers = 1;       // 并行解码的分段数 (1表示顺序解码)
+    double scan_ms = 0.0;         // 并行解码前扫描关键帧的耗时
+    double hash_ms = 0.0;         // 计算源文件标识的耗时
+    double decode_ms = 0.0;       // 解码写入缓存的耗时 (热启动为0)
+    double total_ms = 0.0;        // 准备缓存的总耗时
+    bool zero_copy = false;       // 解码器直接解码到缓存文件的帧槽 (FrameCacheDirectWriter)
+    long direct_frames = 0;       // 零拷贝写入的帧数
+    uint64_t copied_bytes = 0;    // 解码后为写入缓存拷贝的字节数 (含pwrite拷贝到页缓存)
+
+    // 平均每帧拷贝的字节数
+    double copiedBytesPerFrame() const { return frame_count > 0 ? (double) copied_bytes / frame_count : 0.0; }
+};
+
+// 解码source_path的视频流并写入cache_path。resume为true时优先续写未完成的缓存，
+// 无法续写时从头写入。zero_copy为true且解码器支持时从头写入改为解码器直接解码到缓存文件 (续写仍使用拷贝路径)。
+// 成功返回0，失败返回负值
+int frame_cache_decode(const char *source_path, const char *cache_path, const FrameCacheSourceKey &source,
+                       bool resume, FrameCacheStats *stats, bool zero_copy = false);
+
+// 按关键帧把视频流切分为若干GOP对齐的分段，由workers个独立的解码器在共用的工作线程池 (WorkerPool::shared) 上并行解码，
+// 每帧按其显示序号用pwrite直接写入缓存文件中的固定位置。workers为0时自动选择。
+// index_path非空时复用 (或保存) 该位置的关键帧索引。
+// zero_copy为true且解码器支持时各分段的解码器直接解码到缓存文件的帧槽。
+// 成功返回0；视频不适合分段 (过短、时间戳缺失或重复) 时返回kParallelDecodeUnsupported，调用方应改用顺序解码
+static const int kParallelDecodeUnsupported = -12;
+int frame_cache_decode_parallel(const char *source_path, const char *cache_path, const FrameCacheSourceKey &source,
+                                int workers, FrameCacheStats *stats, const char *index_path = nullptr,
+                                bool zero_copy = false);
+
+// 按源文件内容管理解码缓存：缓存文件以源文件抽样哈希命名，
+// 内容相同的源文件 (即使重新拷贝过) 在下次启动时直接复用，未完成的缓存从中断处续写
+class FrameCacheManager {
+public:
+    explicit FrameCacheManager(const std::string &cache_dir);
+
+    // 为源文件准备可播放的缓存，成功返回0并填充stats
+    int prepare(const char *source_path, FrameCacheStats *stats);
+
+    std::string cachePathFor(const FrameCacheSourceKey &source) const;
+    // 源文件的关键帧索引 (KeyframeIndex) 保存在缓存文件旁，随缓存一起清理
+    std::string indexPathFor(const FrameCacheSourceKey &source) const;
+
+    // 冷启动时并行解码的分段数：0为自动，1为顺序解码
+    void setDecodeWorkers(int workers) { decode_workers_ = workers; }
+    // 冷启动时解码器直接解码到缓存文件 (不支持时自动使用拷贝写入)
+    void setZeroCopy(bool zero_copy) { zero_copy_ = zero_copy; }
+
+private:
+    // 删除目录中不属于当前源文件的旧缓存
+    void removeOtherCaches(const std::string &keep_path) const;
+
+    std::string cache_dir_;
+    int decode_workers_ = 0;
+    bool zero_copy_ = false;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef FRAMENORMALIZER_H_
+#define FRAMENORMALIZER_H_
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+struct SwsContext;
+class FramePool;
+
+// 像素格式归一化：缓存文件和渲染只处理YUV420P布局，其余格式在此转换。
+// YUV420P/yuvj420p原样使用 (full range由YuvConverter的full range内核直接转换，不做有损的范围映射)，
+// NV12/NV21走手写的色度解交错快速路径并保持源范围，
+// 其余格式 (4:2:2、4:4:4、10位等) 使用复用的SwsContext并输出limited range。每个实例只能由一个线程使用。
+class FrameNormalizer {
+public:
+    enum class Path {
+        Passthrough,  // 已是目标格式，不拷贝
+        FastPath,     // 手写快速路径
+        Swscale,      // libswscale
+    };
+
+    FrameNormalizer();
+    ~FrameNormalizer();
+
+    // 返回YUV420P布局的帧：源帧已是目标格式时直接返回src，否则转换到内部复用的帧并返回其指针。
+    // 返回的帧在下一次调用前有效，失败返回nullptr
+    const AVFrame *normalize(const AVFrame *src);
+
+    // 转换到dst (dst需为空帧，缓冲区由此函数分配，pool非空时从池中分配)，成功返回0
+    int convert(const AVFrame *src, AVFrame *dst, FramePool *pool = nullptr);
+
+    // 源帧是否已是目标格式
+    static bool isNative(const AVFrame *frame);
+    // 源格式将使用的转换路径
+    static Path pathFor(AVPixelFormat format);
+    // 归一化后帧的取值范围 (JPEG或MPEG)，渲染时据此选择转换内核
+    static AVColorRange outputRange(AVPixelFormat format, AVColorRange range);
+    static const char *pathName(Path path);
+
+private:
+    int convertInto(const AVFrame *src, AVFrame *dst);
+
+    SwsContext *sws_ = nullptr;
+    AVFrame *out_ = nullptr;
+};
+
+#endif
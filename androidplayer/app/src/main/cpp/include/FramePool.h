@@ -0,0 +1,78 @@
+#ifndef FRAMEPOOL_H_
+#define FRAMEPOOL_H_
+
+#include <stddef.h>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+}
+
+// 解码帧缓冲池：通过解码器的get_buffer2回调，让libavcodec把帧解码到池中复用的缓冲区，而不是每帧重新分配。
+// 缓冲区按 (像素格式, 对齐后的宽高) 分组，每组一个AVBufferPool；一帧的所有平面放在一块缓冲区中，
+// 起始地址和每个平面的行跨度都按64字节对齐。缓冲区由AVBufferRef引用计数：解码器内部的参考帧、帧队列、
+// 渲染线程各持有引用，最后一个引用释放时回到池中；池被销毁后尚未归还的缓冲区在归还时直接释放。
+// AVFrame本身也由acquireFrame/releaseFrame循环使用。稳态 (同一分辨率，在途帧数不再增长) 下每帧没有新的缓冲区分配，
+// stats()中的分配计数用于验证这一点。不支持的格式 (调色板、硬件帧) 和不支持直接渲染 (DR1) 的解码器使用FFmpeg默认分配。
+// 池需比装入它的解码器上下文活得更久。
+class FramePool {
+public:
+    struct Stats {
+        long buffer_allocs = 0;     // 新分配的帧缓冲区 (池中没有空闲的)
+        long buffer_reuses = 0;     // 从池中复用的帧缓冲区
+        long frame_allocs = 0;      // 新分配的AVFrame
+        long frame_reuses = 0;      // 复用的AVFrame
+        long fallback_buffers = 0;  // 交给FFmpeg默认分配的帧
+        size_t allocated_bytes = 0; // 新分配的缓冲区总字节数
+
+        // 堆分配次数 (缓冲区 + AVFrame)
+        long allocations() const { return buffer_allocs + frame_allocs; }
+    };
+
+    FramePool();
+    ~FramePool();
+
+    // 把池装入解码器上下文 (设置get_buffer2和opaque)，必须在avcodec_open2之前调用
+    void attach(AVCodecContext *codec_ctx);
+
+    // 为已设置format/width/height的空帧从池中分配缓冲区 (不经过解码器，如格式转换的输出)，成功返回0
+    int getBuffer(AVFrame *frame);
+
+    // 取得一个空的AVFrame，用完后通过releaseFrame归还
+    AVFrame *acquireFrame();
+    // 释放帧的缓冲区引用并归还AVFrame，*frame置空
+    void releaseFrame(AVFrame **frame);
+
+    Stats stats() const;
+
+private:
+    // 同一格式和尺寸的帧共用的缓冲区布局
+    struct Entry {
+        int format;
+        int width;
+        int height;
+        int linesize[4];
+        size_t offset[4];
+        size_t size;
+        AVBufferPool *pool;
+    };
+
+    static int getBuffer2(AVCodecContext *codec_ctx, AVFrame *frame, int flags);
+#if FF_API_BUFFER_SIZE_T
+    static AVBufferRef *allocBuffer(void *opaque, int size);
+#else
+    static AVBufferRef *allocBuffer(void *opaque, size_t size);
+#endif
+    int fillFrame(AVFrame *frame, int width, int height);
+    Entry *findOrCreate(int format, int width, int height);
+
+    mutable std::mutex mutex_;          // 帧线程会并发调用get_buffer2
+    std::vector<Entry> entries_;        // 最近使用的在前
+    std::vector<AVFrame *> free_frames_;
+    Stats stats_;
+};
+
+#endif
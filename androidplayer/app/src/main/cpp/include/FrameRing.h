@@ -0,0 +1,322 @@
+#ifndef FRAMERING_H_
+#define FRAMERING_H_
+
+#include <linux/futex.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+// futex等待：*word仍等于expected时睡眠，最多timeout_ns纳秒 (<0表示一直等待)。被唤醒、值已改变、超时或被信号中断时返回
+inline void futex_wait(std::atomic<uint32_t> *word, uint32_t expected, int64_t timeout_ns) {
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex字必须是32位");
+    struct timespec ts;
+    ts.tv_sec = timeout_ns / 1000000000;
+    ts.tv_nsec = timeout_ns % 1000000000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT_PRIVATE, expected,
+            timeout_ns >= 0 ? &ts : nullptr, nullptr, 0);
+}
+
+// 唤醒最多count个在word上等待的线程
+inline void futex_wake(std::atomic<uint32_t> *word, int count) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+// FrameRing的竞争和占用统计
+struct FrameRingStats {
+    long pushes = 0;
+    long pops = 0;
+    long producer_waits = 0;      // 生产者因队列满或超出内存预算而睡眠的入队次数
+    long budget_waits = 0;        // 其中因内存预算 (深度未满) 而睡眠的次数
+    long consumer_waits = 0;      // 消费者因队列空而睡眠的出队次数
+    long wakeups = 0;             // 发出的futex唤醒次数 (对端每次睡眠最多唤醒一次)
+    double producer_wait_ms = 0.0;
+    double consumer_wait_ms = 0.0;
+    size_t max_occupancy = 0;     // 入队后的最大元素数
+    size_t max_bytes = 0;         // 队列中元素的最大总字节数
+    double mean_occupancy = 0.0;  // 出队时队列中的平均元素数
+};
+
+// 单生产者单消费者的有界阻塞环形队列，用于解码线程向渲染线程传递帧引用 (AVFrame*等)。
+// 与SpscRing相同，读写位置位于独立的缓存行，入队出队本身无锁；不同的是队列满/空时不轮询，
+// 短暂自旋 (仅多核) 后在futex上睡眠，对端只在确有等待者时才发出唤醒系统调用，常态下入队出队不进入内核。
+// 深度depth为最多容纳的元素数；byte_budget > 0时队列中元素的总字节数 (入队时给出) 也不超过预算，
+// 但空队列总能放入一个元素，避免单个大帧永远无法入队。
+// push/pop只能分别由一个线程调用；clear由消费者调用，或在两端都未访问时调用。
+template <typename T>
+class FrameRing {
+    static_assert(std::is_trivially_copyable<T>::value, "FrameRing只能存放可按字节拷贝的类型 (如帧指针)");
+
+public:
+    explicit FrameRing(size_t depth, size_t byte_budget = 0)
+        : depth_(depth > 0 ? depth : 1), byte_budget_(byte_budget),
+          spin_count_(std::thread::hardware_concurrency() > 1 ? kSpinCount : 0) { // 单核上自旋只会推迟对端运行
+        size_t size = 1;
+        while (size < depth_) size <<= 1;
+        mask_ = size - 1;
+        slots_.reset(new Slot[size]);
+    }
+
+    size_t depth() const { return depth_; }
+    size_t byteBudget() const { return byte_budget_; }
+
+    // 生产者：入队，最多等待timeout_ms毫秒 (<0表示一直等待)。成功返回true，超时或已abort返回false
+    bool push(const T &item, size_t bytes, int timeout_ms = -1) {
+        auto wait_start = std::chrono::steady_clock::now();
+        bool waited = false;
+        bool ok = false;
+        int spins = timeout_ms == 0 ? spin_count_ : 0;
+        while (true) {
+            if (aborted_.load(std::memory_order_acquire)) break;
+            Space space = tryPush(item, bytes);
+            if (space == Space::Ok) {
+                ok = true;
+                break;
+            }
+            if (spins++ < spin_count_) { // 对端通常很快就会出队，先短暂自旋避免睡眠和唤醒的系统调用
+                cpuRelax();
+                continue;
+            }
+            int64_t remaining = remainingNs(wait_start, timeout_ms);
+            if (remaining == 0) break;
+            uint32_t seq = space_seq_.load(std::memory_order_acquire);
+            producer_waiting_.store(true, std::memory_order_seq_cst);
+            // 登记等待后再检查一次：消费者在登记前出队则此处可见，在登记后出队则会唤醒
+            if (canPush(bytes) == Space::Ok || aborted_.load(std::memory_order_acquire)) {
+                producer_waiting_.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            if (!waited) {
+                waited = true;
+                bump(producer_waits_);
+                if (space == Space::OverBudget) bump(budget_waits_);
+            }
+            futex_wait(&space_seq_, seq, remaining);
+            producer_waiting_.store(false, std::memory_order_relaxed);
+        }
+        if (waited) bump(producer_wait_ns_, elapsedNs(wait_start));
+        return ok;
+    }
+
+    // 消费者：出队，最多等待timeout_ms毫秒 (<0表示一直等待)。成功返回true，超时、被interrupt或已abort返回false
+    bool pop(T &out, int timeout_ms = -1) {
+        auto wait_start = std::chrono::steady_clock::now();
+        bool waited = false;
+        bool ok = false;
+        int spins = timeout_ms == 0 ? spin_count_ : 0;
+        while (true) {
+            if (aborted_.load(std::memory_order_acquire)) break;
+            if (tryPop(out)) {
+                ok = true;
+                break;
+            }
+            if (interrupted_.exchange(false, std::memory_order_acq_rel)) break;
+            if (spins++ < spin_count_) {
+                cpuRelax();
+                continue;
+            }
+            int64_t remaining = remainingNs(wait_start, timeout_ms);
+            if (remaining == 0) break;
+            uint32_t seq = item_seq_.load(std::memory_order_acquire);
+            consumer_waiting_.store(true, std::memory_order_seq_cst);
+            if (size() > 0 || aborted_.load(std::memory_order_acquire) ||
+                interrupted_.load(std::memory_order_acquire)) {
+                consumer_waiting_.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            if (!waited) {
+                waited = true;
+                bump(consumer_waits_);
+            }
+            futex_wait(&item_seq_, seq, remaining);
+            consumer_waiting_.store(false, std::memory_order_relaxed);
+        }
+        if (waited) bump(consumer_wait_ns_, elapsedNs(wait_start));
+        return ok;
+    }
+
+    // 消费者：取出并用disposer释放队列中的全部元素 (如AVFrame)
+    void clear(const std::function<void(T &)> &disposer) {
+        T item;
+        while (tryPop(item)) disposer(item);
+    }
+
+    // 终止队列：唤醒所有阻塞的push/pop，之后的push/pop立即返回false
+    void abort() {
+        aborted_.store(true, std::memory_order_seq_cst);
+        item_seq_.fetch_add(1, std::memory_order_seq_cst);
+        space_seq_.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake(&item_seq_, INT32_MAX);
+        futex_wake(&space_seq_, INT32_MAX);
+    }
+
+    // 让消费者正在进行 (或下一次需要等待) 的pop立即返回false，用于让消费者及时处理队列之外的事件。任意线程可调用
+    void interrupt() {
+        interrupted_.store(true, std::memory_order_seq_cst);
+        item_seq_.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake(&item_seq_, 1);
+    }
+
+    // 重新启用队列 (用于abort之后复用)，两端都未访问时调用
+    void reset() {
+        aborted_.store(false, std::memory_order_release);
+        interrupted_.store(false, std::memory_order_release);
+    }
+
+    // 队列中的元素数和总字节数 (另一端同时访问时为近似值)
+    size_t size() const {
+        return write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_acquire);
+    }
+    size_t bytes() const {
+        return bytes_pushed_.load(std::memory_order_acquire) - bytes_popped_.load(std::memory_order_acquire);
+    }
+
+    FrameRingStats stats() const {
+        FrameRingStats stats;
+        stats.pushes = pushes_.load(std::memory_order_relaxed);
+        stats.pops = pops_.load(std::memory_order_relaxed);
+        stats.producer_waits = producer_waits_.load(std::memory_order_relaxed);
+        stats.budget_waits = budget_waits_.load(std::memory_order_relaxed);
+        stats.consumer_waits = consumer_waits_.load(std::memory_order_relaxed);
+        stats.wakeups = producer_wakeups_.load(std::memory_order_relaxed) +
+                        consumer_wakeups_.load(std::memory_order_relaxed);
+        stats.producer_wait_ms = producer_wait_ns_.load(std::memory_order_relaxed) / 1e6;
+        stats.consumer_wait_ms = consumer_wait_ns_.load(std::memory_order_relaxed) / 1e6;
+        stats.max_occupancy = (size_t) max_occupancy_.load(std::memory_order_relaxed);
+        stats.max_bytes = (size_t) max_bytes_.load(std::memory_order_relaxed);
+        int64_t occupancy_sum = occupancy_sum_.load(std::memory_order_relaxed);
+        stats.mean_occupancy = stats.pops > 0 ? (double) occupancy_sum / stats.pops : 0.0;
+        return stats;
+    }
+
+private:
+    struct Slot {
+        T item;
+        size_t bytes;
+    };
+    enum class Space { Ok, Full, OverBudget };
+    static const int kSpinCount = 100; // 睡眠前自旋检查的次数 (约数微秒)
+
+    static void cpuRelax() {
+#if defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#elif defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    // 统计计数只由一端写入，不需要原子的读-改-写
+    template <typename C>
+    static void bump(std::atomic<C> &counter, C n = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    static int64_t elapsedNs(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count();
+    }
+    // 距超时的剩余纳秒数，0表示已超时，-1表示一直等待
+    static int64_t remainingNs(std::chrono::steady_clock::time_point since, int timeout_ms) {
+        if (timeout_ms < 0) return -1;
+        int64_t remaining = (int64_t) timeout_ms * 1000000 - elapsedNs(since);
+        return remaining > 0 ? remaining : 0;
+    }
+
+    Space canPush(size_t bytes) const {
+        size_t count = write_pos_.load(std::memory_order_relaxed) - read_pos_.load(std::memory_order_acquire);
+        if (count >= depth_) return Space::Full;
+        size_t queued = bytes_pushed_.load(std::memory_order_relaxed) - bytes_popped_.load(std::memory_order_acquire);
+        if (byte_budget_ > 0 && count > 0 && queued + bytes > byte_budget_) return Space::OverBudget;
+        return Space::Ok;
+    }
+
+    Space tryPush(const T &item, size_t bytes) {
+        Space space = canPush(bytes);
+        if (space != Space::Ok) return space;
+        size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+        size_t occupancy = write_pos + 1 - read_pos_.load(std::memory_order_acquire);
+        size_t queued = bytes_pushed_.load(std::memory_order_relaxed) + bytes -
+                        bytes_popped_.load(std::memory_order_acquire);
+        Slot &slot = slots_[write_pos & mask_];
+        slot.item = item;
+        slot.bytes = bytes;
+        bytes_pushed_.store(bytes_pushed_.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+        write_pos_.store(write_pos + 1, std::memory_order_release);
+
+        bump(pushes_);
+        if ((long) occupancy > max_occupancy_.load(std::memory_order_relaxed)) {
+            max_occupancy_.store((long) occupancy, std::memory_order_relaxed);
+        }
+        if ((long) queued > max_bytes_.load(std::memory_order_relaxed)) {
+            max_bytes_.store((long) queued, std::memory_order_relaxed);
+        }
+        item_seq_.fetch_add(1, std::memory_order_seq_cst);
+        // 先只读对端的等待标志 (不写共享缓存行)，有人登记等待时才用exchange认领唤醒，每次睡眠只唤醒一次。
+        // 读到false而对端随后登记时，对端的再检查能看到本次入队，或futex_wait因序号已变立即返回
+        if (consumer_waiting_.load(std::memory_order_seq_cst) &&
+            consumer_waiting_.exchange(false, std::memory_order_seq_cst)) {
+            futex_wake(&item_seq_, 1);
+            bump(producer_wakeups_);
+        }
+        return Space::Ok;
+    }
+
+    bool tryPop(T &out) {
+        size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+        size_t write_pos = write_pos_.load(std::memory_order_acquire);
+        if (write_pos == read_pos) return false;
+        const Slot &slot = slots_[read_pos & mask_];
+        out = slot.item;
+        bytes_popped_.store(bytes_popped_.load(std::memory_order_relaxed) + slot.bytes, std::memory_order_release);
+        read_pos_.store(read_pos + 1, std::memory_order_release);
+
+        bump(pops_);
+        bump(occupancy_sum_, (int64_t) (write_pos - read_pos));
+        space_seq_.fetch_add(1, std::memory_order_seq_cst);
+        if (producer_waiting_.load(std::memory_order_seq_cst) &&
+            producer_waiting_.exchange(false, std::memory_order_seq_cst)) { // 同tryPush
+            futex_wake(&space_seq_, 1);
+            bump(consumer_wakeups_);
+        }
+        return true;
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    size_t depth_;
+    size_t byte_budget_;
+    int spin_count_;
+    std::atomic<bool> aborted_{false};
+    std::atomic<bool> interrupted_{false};
+
+    // 生产者写入的字段
+    alignas(64) std::atomic<size_t> write_pos_{0};
+    std::atomic<size_t> bytes_pushed_{0};
+    std::atomic<uint32_t> item_seq_{0};           // 每次入队加一，消费者在其上睡眠
+    std::atomic<bool> producer_waiting_{false};
+    std::atomic<long> pushes_{0};
+    std::atomic<long> producer_waits_{0};
+    std::atomic<long> budget_waits_{0};
+    std::atomic<long> producer_wakeups_{0};
+    std::atomic<long> max_occupancy_{0};
+    std::atomic<long> max_bytes_{0};
+    std::atomic<int64_t> producer_wait_ns_{0};
+
+    // 消费者写入的字段
+    alignas(64) std::atomic<size_t> read_pos_{0};
+    std::atomic<size_t> bytes_popped_{0};
+    std::atomic<uint32_t> space_seq_{0};          // 每次出队加一，生产者在其上睡眠
+    std::atomic<bool> consumer_waiting_{false};
+    std::atomic<long> pops_{0};
+    std::atomic<long> consumer_waits_{0};
+    std::atomic<long> consumer_wakeups_{0};
+    std::atomic<int64_t> occupancy_sum_{0};
+    std::atomic<int64_t> consumer_wait_ns_{0};
+};
+
+#endif
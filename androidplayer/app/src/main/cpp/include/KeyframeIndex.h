@@ -0,0 +1,68 @@
+#ifndef KEYFRAMEINDEX_H_
+#define KEYFRAMEINDEX_H_
+
+#include <stdint.h>
+#include <vector>
+#include "FrameCache.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// 视频包信息 (解码顺序)
+struct VideoPacketInfo {
+    int64_t pts;
+    int64_t dts;
+    int64_t pos;       // 包在文件中的字节偏移
+    bool key;
+};
+
+// 只读取视频包、不解码地扫描整个文件，得到每个包的时间戳和关键帧位置。
+// 每个包对应一帧，因此扫描结果同时给出总帧数和每帧的显示序号 (PTS在所有帧中的排名)。
+// 扫描结果可保存到缓存目录 (与YUV缓存同名加 ".kfi" 后缀)，按源文件标识校验后直接加载，省去再次扫描。
+class KeyframeIndex {
+public:
+    // 扫描文件，成功返回0
+    int build(const char *path);
+
+    // 保存到index_path / 从index_path加载 (源文件标识不一致时返回kFrameCacheStale)，成功返回0
+    int save(const char *index_path, const FrameCacheSourceKey &source) const;
+    int load(const char *index_path, const FrameCacheSourceKey &source);
+    // 优先加载index_path，不存在或已过期时扫描media_path并保存，成功返回0
+    int loadOrBuild(const char *media_path, const FrameCacheSourceKey &source, const char *index_path);
+
+    const std::vector<VideoPacketInfo> &packets() const { return packets_; }
+    // 关键帧在packets()中的下标 (升序)
+    const std::vector<long> &keyframes() const { return keyframes_; }
+    AVRational timeBase() const { return time_base_; }
+    long frameCount() const { return (long) packets_.size(); }
+
+    // 所有包都有PTS且互不相同时才能按PTS确定显示序号
+    bool hasUniquePts() const { return unique_pts_; }
+    // PTS对应的显示序号，不存在时返回-1
+    long displayIndexOf(int64_t pts) const;
+    // PTS在[begin, end)内的帧数
+    long countPtsInRange(int64_t begin, int64_t end) const;
+    // 显示序号对应的PTS，超出范围时返回AV_NOPTS_VALUE
+    int64_t ptsOfDisplayIndex(long display_index) const;
+    // 显示时间不晚于target_pts的最近关键帧在packets()中的下标，目标早于所有关键帧时返回第一个关键帧，没有关键帧返回-1
+    long keyframeBefore(int64_t target_pts) const;
+
+    double scanMs() const { return scan_ms_; }
+    // 最近一次build/loadOrBuild是否直接加载了已保存的索引
+    bool loadedFromFile() const { return loaded_; }
+
+private:
+    // 由packets_生成关键帧列表和显示顺序
+    void finalize();
+
+    std::vector<VideoPacketInfo> packets_;
+    std::vector<long> keyframes_;
+    std::vector<int64_t> sorted_pts_;  // 显示顺序
+    AVRational time_base_ = {1, 1000};
+    bool unique_pts_ = false;
+    double scan_ms_ = 0.0;
+    bool loaded_ = false;
+};
+
+#endif
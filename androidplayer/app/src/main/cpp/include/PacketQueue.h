@@ -0,0 +1,187 @@
+#ifndef PACKETQUEUE_H_
+#define PACKETQUEUE_H_
+
+#include <stddef.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// AVPacket结构体的空闲链表：解复用线程取出空包读取，解码线程用完后 (unref) 放回，
+// 预热后每个包不再调用av_packet_alloc/av_packet_free。包的数据缓冲区仍由FFmpeg的解复用器按包分配
+class PacketPool {
+public:
+    PacketPool() { free_.reserve(kMaxFree); }
+    ~PacketPool() {
+        for (AVPacket *pkt : free_) av_packet_free(&pkt);
+    }
+    PacketPool(const PacketPool &) = delete;
+    PacketPool &operator=(const PacketPool &) = delete;
+
+    AVPacket *acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_.empty()) {
+                AVPacket *pkt = free_.back();
+                free_.pop_back();
+                return pkt;
+            }
+            allocations_++;
+        }
+        return av_packet_alloc();
+    }
+
+    // 放回空闲链表 (*pkt置空)；空闲的包超过kMaxFree时直接释放
+    void release(AVPacket **pkt) {
+        if (!*pkt) return;
+        av_packet_unref(*pkt);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (free_.size() < kMaxFree) {
+                free_.push_back(*pkt);
+                *pkt = nullptr;
+                return;
+            }
+        }
+        av_packet_free(pkt);
+    }
+
+    // 调用av_packet_alloc的累计次数
+    long allocations() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return allocations_;
+    }
+
+private:
+    static const size_t kMaxFree = 1024;
+    std::vector<AVPacket *> free_;
+    long allocations_ = 0;
+    mutable std::mutex mutex_;
+};
+
+// 按字节数限制的包队列，由Demuxer为每个启用的流创建，解复用线程写入、对应流的解码线程取出。
+// 与BoundedQueue不同，容量按包的字节数计算 (视频关键帧可能是普通帧的几十倍)，上限在push时由调用者给出，
+// 使解复用线程可以在其他流即将饿死时临时放宽限制。队列持有包的所有权，clear时放回pool (没有pool时释放)。
+// 包存放在只增长不收缩的环形数组中，达到稳定的包数后入队/出队没有堆分配
+class PacketQueue {
+public:
+    struct Item {
+        AVPacket *pkt;    // nullptr表示流结束
+        int serial;       // 跳转序号，跳转后之前序号的包全部作废
+    };
+
+    explicit PacketQueue(size_t max_bytes, PacketPool *pool = nullptr)
+        : max_bytes_(max_bytes > 0 ? max_bytes : 1), pool_(pool) {}
+    ~PacketQueue() { clear(); }
+
+    // 消费者用完出队的包后调用：放回空闲链表 (*pkt置空)
+    void recycle(AVPacket **pkt) {
+        if (pool_) pool_->release(pkt);
+        else av_packet_free(pkt);
+    }
+
+    // 常规的字节上限
+    size_t maxBytes() const { return max_bytes_; }
+
+    // 入队，队列中已有数据且加入后超过limit_bytes时最多等待timeout_ms毫秒。成功返回true，超时或已abort返回false。
+    // 队列为空时总能放入一个包，超过上限的单个大包也不会卡住
+    bool push(const Item &item, size_t limit_bytes, int timeout_ms) {
+        size_t size = item.pkt ? (size_t) item.pkt->size : 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto ready = [&] { return aborted_ || items_.empty() || bytes_ + size <= limit_bytes; };
+        if (!not_full_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) return false;
+        if (aborted_) return false;
+        if (count_ == items_.size()) grow();
+        items_[(head_ + count_) % items_.size()] = item;
+        count_++;
+        bytes_ += size;
+        if (bytes_ > peak_bytes_) peak_bytes_ = bytes_;
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // 出队，最多等待timeout_ms毫秒。成功返回true (调用者负责释放item.pkt)，超时或已abort返回false
+    bool pop(Item &out, int timeout_ms) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto ready = [this] { return aborted_ || count_ > 0; };
+        if (!not_empty_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) return false;
+        if (aborted_) return false;
+        out = items_[head_];
+        head_ = (head_ + 1) % items_.size();
+        count_--;
+        if (out.pkt) bytes_ -= (size_t) out.pkt->size;
+        not_full_.notify_one();
+        return true;
+    }
+
+    // 清空队列并回收其中的包
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < count_; i++) {
+            Item &item = items_[(head_ + i) % items_.size()];
+            if (item.pkt) recycle(&item.pkt);
+        }
+        head_ = 0;
+        count_ = 0;
+        bytes_ = 0;
+        not_full_.notify_all();
+    }
+
+    // 终止队列：唤醒所有阻塞的push/pop
+    void abort() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        aborted_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+    // 重新启用队列（用于abort之后复用）
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        aborted_ = false;
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_ == 0;
+    }
+
+    size_t bytes() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+    }
+
+    // 队列曾经达到的最大字节数
+    size_t peakBytes() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return peak_bytes_;
+    }
+
+private:
+    // 环形数组已满时容量加倍，按出队顺序搬到新数组的开头
+    void grow() {
+        std::vector<Item> grown(items_.empty() ? kInitialCapacity : items_.size() * 2);
+        for (size_t i = 0; i < count_; i++) grown[i] = items_[(head_ + i) % items_.size()];
+        items_.swap(grown);
+        head_ = 0;
+    }
+
+    static const size_t kInitialCapacity = 64;
+    std::vector<Item> items_;    // 环形数组，从head_开始的count_个有效
+    size_t head_ = 0;
+    size_t count_ = 0;
+    size_t max_bytes_;
+    PacketPool *pool_;
+    size_t bytes_ = 0;
+    size_t peak_bytes_ = 0;
+    bool aborted_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef PLAYER_H_
+#define PLAYER_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <SLES/OpenSLES.h>
+#include <android/native_window.h>
+#include "AudioDecoder.h"
+#include "AvSync.h"
+#include "FrameCacheManager.h"
+#include "FramePool.h"
+#include "PlayerControl.h"
+#include "PresentationClock.h"
+#include "StreamDecoder.h"
+#include "YuvScaler.h"
+
+struct NativeAudioPlayer;
+
+// 一个播放器实例：视频来源 (流式解码器或YUV缓存)、渲染线程、音频输出 (原生音频或OpenSL ES) 和音视频同步。
+// 所有播放状态都属于实例，多个实例 (信息流、预览、多画面) 可以同时播放而互不影响；
+// JNI层以Player指针作为不透明的jlong句柄 (nativeCreatePlayer/nativeReleasePlayer)。
+// 各实例共用进程级的资源：流式解码的帧缓冲池 (sharedFramePool)、按实例数平分的解码线程
+// (decoder_auto_thread_count)、冷启动分段解码的工作线程池 (WorkerPool::shared) 和OpenSL ES引擎。
+// 除渲染线程外，各方法由同一个控制线程 (Java主线程或其工作线程) 调用。
+class Player {
+public:
+    Player();
+    // 停止视频和音频并释放资源
+    ~Player();
+
+    Player(const Player &) = delete;
+    Player &operator=(const Player &) = delete;
+
+    // --- 视频来源 ---
+    // 解码视频文件到YUV文件 (总是完整重新解码)，成功返回0
+    int decodeToFile(const char *input_path, const char *output_path);
+    // 按源文件内容准备YUV缓存，返回缓存文件路径，失败返回空字符串
+    std::string prepareFrameCache(const char *input_path, const char *cache_dir, int decode_workers, bool zero_copy);
+    // YUV缓存文件的总帧数，失败返回0
+    long cacheFrameCount(const char *yuv_path);
+    // 探测视频参数并建立 (或加载) 关键帧索引，返回总帧数，失败返回<0
+    long probe(const char *input_path, const char *cache_dir);
+
+    // --- 视频播放 (window的引用由Player接管) ---
+    void startCachePlayback(const char *yuv_path, ANativeWindow *window);
+    void startStreamingPlayback(const char *input_path, ANativeWindow *window);
+    void stopVideo();
+    void pauseVideo();
+    void resumeVideo();
+    void setSpeed(float speed);
+    void seekToFrame(long frame);
+    // 窗口需要重绘 (expose、尺寸变化) 时调用：暂停中重新显示当前画面
+    void redrawVideo();
+    long currentFrame() const { return current_rendered_frame_.load(); }
+    double frameRate() const { return avg_frame_rate_.load(); }
+    double timeToFirstFrameMs() const { return time_to_first_frame_ms_.load(); }
+    // 选择窗口缓冲区格式 (true为RGB565+有序抖动，每像素2字节，转换写入量和缓冲区内存减半；false为RGBA8888)，
+    // 下次开始播放时生效
+    void setRgb565Output(bool rgb565) { rgb565_output_ = rgb565; }
+    // 重绘缓存：转换到保留的环形缓冲后再拷贝到窗口，重绘时直接重新提交最近显示的画面而不重新解码和转换；
+    // 关闭时 (默认) 转换器直接写入窗口缓冲区，每帧只写一遍。下次开始播放时生效
+    void setRedrawCache(bool retain) { redraw_cache_ = retain; }
+
+    // --- 音频 ---
+    // 确保进程共用的OpenSL ES引擎已创建 (已存在时直接返回)，成功返回0
+    static int initAudioEngine();
+    // 选择音频输出路径 (true为FFmpeg解码+AAudio，false为OpenSL ES)，下次startAudio时生效
+    void setNativeAudio(bool use_native) { use_native_audio_ = use_native; }
+    // 从start_offset_ms开始播放音频，<0表示使用之前记录的跳转位置
+    void startAudio(const char *path, long start_offset_ms);
+    void stopAudio();
+    void pauseAudio(bool pause);
+    void seekAudio(long time_ms);
+    void setAudioRate(float rate);
+
+    // --- 统计 (文本格式与JNI返回值一致) ---
+    void setAvSyncThresholdMs(double threshold_ms) { av_sync_.setThresholdMs(threshold_ms); }
+    std::string startupMetrics() const;
+    std::string seekMetrics() const;
+    std::string controlMetrics() const;
+    std::string pacingMetrics() const;
+    std::string avSyncMetrics() const;
+    std::string audioMetrics() const;
+
+    // 流式解码共用的帧缓冲池：正在流式播放的实例持有它，全部停止后释放
+    static std::shared_ptr<FramePool> sharedFramePool();
+    // 当前存在的实例数
+    static int liveInstances();
+
+private:
+    void renderLoop(long initial_seek_frame);
+    void seekAudioDecoder(AudioDecoder *decoder, double time_s);
+    // 按窗口实际尺寸计算画面布局并设置缓冲区几何属性，失败时释放窗口并返回false
+    bool attachWindow(ANativeWindow *window);
+    void applyCacheStats(const FrameCacheStats &stats);
+    void recordTimeToFirstFrame(bool streaming);
+    void publishPacingStats(const PresentationClock::Stats &stats);
+    std::shared_ptr<Demuxer> acquireDemuxer(const char *path);
+    bool audioOutputPosition(double *media_time_s);
+    bool startNativeAudio(const char *path, long start_offset_ms);
+    void destroyNativeAudio();
+    std::shared_ptr<NativeAudioPlayer> nativeAudio() const;
+    void destroyAudioPlayer();
+
+    // --- 播放控制 ---
+    std::atomic<bool> video_playing_{false};             // 视频是否正在播放
+    PlayerControl control_;                              // 暂停/恢复/跳转/停止命令队列和状态机
+    std::atomic<float> playback_speed_{1.0f};            // 播放速度 (影响视频帧延迟和期望的音频速率)
+    std::atomic<long> current_rendered_frame_{0};        // 当前已渲染的视频帧号
+
+    // --- 视频参数 ---
+    int video_width_ = 0;
+    int video_height_ = 0;
+    std::atomic<double> avg_frame_rate_{25.0};
+
+    // --- 渲染线程与资源 ---
+    std::thread render_thread_;
+    ANativeWindow *window_ = nullptr;
+    LetterboxLayout layout_;                             // 画面在窗口缓冲区中的位置和缩放后的尺寸
+    std::atomic<bool> rgb565_output_{false};             // 下次播放使用RGB565窗口缓冲区
+    YuvOutput window_output_ = YuvOutput::Rgba8888;      // 本次播放的窗口缓冲区格式 (attachWindow时确定)
+    std::atomic<bool> redraw_cache_{false};              // 下次播放保留已转换的帧用于重绘
+    std::string yuv_path_;                               // YUV缓存文件路径 (缓存模式)
+    std::mutex cache_info_mutex_;                        // 保护下面的缓存信息
+    std::string cache_info_path_;                        // 已读取信息的缓存文件路径
+    long cache_info_frames_ = 0;                         // 该缓存文件的总帧数
+
+    // --- 流式播放 ---
+    bool streaming_ = false;                             // 当前是否为流式模式
+    std::unique_ptr<StreamDecoder> stream_decoder_;
+    std::atomic<int> video_seek_serial_{-1};             // 控制端最近一次流式跳转的解复用器序号，供音频跟随
+    std::string keyframe_index_path_;                    // 探测时确定的关键帧索引路径 (空表示不使用索引)
+    StreamDecoder::SeekStats last_seek_stats_;           // 上一个流式解码器的跳转统计
+    std::mutex demuxer_mutex_;                           // 保护demuxer_
+    std::weak_ptr<Demuxer> demuxer_;                     // 本实例的流式视频和原生音频共用的解复用器
+
+    // --- 统计 ---
+    mutable std::mutex pacing_stats_mutex_;
+    PresentationClock::Stats pacing_stats_;              // 当前 (或上一次) 播放的显示误差和丢帧统计
+    std::chrono::steady_clock::time_point playback_start_time_;
+    std::atomic<double> time_to_first_frame_ms_{-1.0};   // 首帧耗时 (毫秒)，-1表示尚未显示首帧
+    std::atomic<double> cache_decode_ms_{0.0};           // 最近一次准备YUV缓存的耗时
+    mutable std::mutex startup_stats_mutex_;
+    FrameCacheStats startup_stats_;                      // 最近一次准备YUV缓存的统计
+
+    // --- 音频 ---
+    mutable std::mutex audio_player_mutex_;              // 保护播放器的发布和销毁 (渲染线程会读取播放位置)
+    SLObjectItf sl_player_ = nullptr;                    // OpenSL ES播放器对象
+    SLPlayItf sl_play_ = nullptr;
+    SLSeekItf sl_seek_ = nullptr;
+    SLPlaybackRateItf sl_rate_ = nullptr;
+    std::atomic<bool> use_native_audio_{true};           // 优先使用原生音频，不可用时回退到OpenSL ES
+    // 发布和销毁受audio_player_mutex_保护；控制端在锁内复制一份后在锁外操作 (AAudio状态切换、解码线程重启较慢)
+    std::shared_ptr<NativeAudioPlayer> native_audio_;
+    mutable std::mutex audio_stats_mutex_;
+    AudioDecoder::Stats last_audio_stats_;               // 上一个原生音频播放器的统计
+    std::atomic<long> audio_start_offset_ms_{-1};        // 音频开始播放的偏移量，-1表示从头播放
+
+    AvSync av_sync_;                                     // 以音频播放位置为主时钟校正视频显示时钟
+};
+
+#endif
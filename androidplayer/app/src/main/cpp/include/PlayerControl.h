@@ -0,0 +1,96 @@
+#ifndef PLAYERCONTROL_H_
+#define PLAYERCONTROL_H_
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// 播放控制命令 (Redraw：窗口需要重绘时重新显示当前画面)
+enum class PlayerCommandType { Pause, Resume, Seek, Stop, Redraw };
+
+// 渲染线程所处的播放状态
+enum class PlayerState { Stopped, Playing, Paused };
+
+const char *player_state_name(PlayerState state);
+
+struct PlayerCommand {
+    PlayerCommandType type = PlayerCommandType::Pause;
+    long frame = -1;          // Seek的目标帧号
+    bool decoder_seeked = false; // Seek：控制端已让解码器跳转，渲染线程只重置显示位置和时钟
+    int64_t issued_ns = 0;    // 提交时刻 (CLOCK_MONOTONIC)，用于统计命令生效延迟
+};
+
+// 播放器的命令队列和状态机：控制端 (JNI线程) 提交暂停/恢复/跳转/停止命令，渲染线程在帧之间取出并执行。
+// 渲染线程的所有等待 (暂停、等待帧的显示时刻) 都通过waitFor进行，新命令到达时立即唤醒，
+// 因此命令在一帧之内生效，暂停时渲染线程一直睡眠，不占用CPU。等待帧队列等其他阻塞可通过setWakeHook中断。
+// 状态转换：Playing --Pause--> Paused --Resume--> Playing，任意状态 --Stop--> Stopped，Seek和Redraw不改变状态。
+// 命令生效时 (暂停：停止显示；恢复/跳转：之后的第一帧显示；停止：渲染循环退出) 渲染线程调用effectDone记录延迟。
+// 只依赖C++标准库，可在Linux主机上运行。
+class PlayerControl {
+public:
+    // 一类命令从提交到生效的延迟
+    struct Latency {
+        long count = 0;
+        double last_ms = 0.0;
+        double avg_ms = 0.0;
+        double max_ms = 0.0;
+    };
+
+    struct Stats {
+        Latency pause;
+        Latency resume;
+        Latency seek;
+        Latency stop;
+        Latency redraw;
+        long commands = 0;          // 提交的命令数
+        long coalesced_seeks = 0;   // 尚未执行就被之后的跳转取代的跳转数
+        long paused_wakeups = 0;    // 暂停期间渲染线程被唤醒的次数 (只应由命令引起)
+    };
+
+    // --- 控制端 ---
+    // 提交命令，连续的跳转只保留最后一个
+    void post(PlayerCommandType type, long frame = -1, bool decoder_seeked = false);
+    void pause() { post(PlayerCommandType::Pause); }
+    void resume() { post(PlayerCommandType::Resume); }
+    void seek(long frame) { post(PlayerCommandType::Seek, frame); }
+    void stop() { post(PlayerCommandType::Stop); }
+    void redraw() { post(PlayerCommandType::Redraw); }
+
+    // 新一次播放开始时调用：丢弃上一次播放残留的命令并清零统计，取出未播放时设置的跳转目标 (没有时返回-1)，
+    // 状态变为Playing
+    long begin();
+    // 播放结束 (渲染线程已退出) 时调用：丢弃未执行的命令，状态变为Stopped
+    void end();
+
+    // 提交命令后在锁内调用hook，用于唤醒渲染线程的其他阻塞等待 (如帧队列)；传入空函数取消
+    void setWakeHook(std::function<void()> hook);
+
+    PlayerState state() const;
+
+    // --- 渲染线程 ---
+    // 取出下一条命令，没有时返回false
+    bool next(PlayerCommand *command);
+    // 睡眠到CLOCK_MONOTONIC上的绝对时刻deadline_ns (<0表示一直等待) 或有待执行的命令。有命令时返回true
+    bool waitFor(int64_t deadline_ns);
+    // 暂停时等待下一条命令 (不占用CPU)
+    void waitWhilePaused();
+    // 按状态机执行命令后的新状态 (命令在当前状态下无效时不变)
+    PlayerState apply(const PlayerCommand &command);
+    // 命令生效，记录延迟
+    void effectDone(const PlayerCommand &command);
+
+    Stats stats() const;
+    void resetStats();
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<PlayerCommand> commands_;
+    std::function<void()> wake_hook_;
+    PlayerState state_ = PlayerState::Stopped;
+    Stats stats_;
+};
+
+#endif
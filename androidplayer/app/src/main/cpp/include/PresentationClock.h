@@ -0,0 +1,86 @@
+#ifndef PRESENTATIONCLOCK_H_
+#define PRESENTATIONCLOCK_H_
+
+#include <stdint.h>
+#include <mutex>
+
+// 视频显示时钟：把帧的媒体时间 (相对起点的秒数) 按播放速度映射为单调时钟上的绝对截止时刻，
+// 渲染线程通过PlayerControl::waitFor按绝对截止时刻等待 (条件变量wait_until，有命令时提前唤醒) 后再提交，
+// 读取/转换的耗时不会逐帧累积成误差；waitUntil用clock_nanosleep(TIMER_ABSTIME)睡眠，不响应命令。
+// 落后超过丢帧阈值的帧直接丢弃；落后过多 (如解码卡顿) 时以当前帧重新对齐时钟。
+// 只依赖POSIX，可在Linux主机上运行。除stats()外只应由渲染线程调用。
+class PresentationClock {
+public:
+    struct Config {
+        double drop_threshold_ms = 50.0;     // 落后超过此值的帧丢弃
+        double resync_threshold_ms = 500.0;  // 落后超过此值时重新对齐时钟而不是连续丢帧
+        int max_consecutive_drops = 4;       // 连续丢帧上限，之后的帧即使落后也显示，避免画面停住
+    };
+
+    // 显示误差统计 (误差 = 实际提交时刻 - 截止时刻，正值表示晚于截止时刻)
+    struct Stats {
+        long presented = 0;
+        long dropped = 0;
+        long resyncs = 0;
+        double drift_mean_ms = 0.0;
+        double drift_max_ms = 0.0;        // 绝对值最大的误差
+        double jitter_ms = 0.0;           // 误差的标准差
+        double last_drift_ms = 0.0;
+    };
+
+    PresentationClock() = default;
+    explicit PresentationClock(const Config &config) : config_(config) {}
+
+    // 以media_time为起点开始计时，该帧的截止时刻为当前时刻
+    void start(double media_time_s, double speed);
+    // 停止计时 (跳转后调用，下一帧重新start)
+    void reset();
+    bool running() const { return running_; }
+
+    // 暂停期间媒体时间不前进
+    void pause();
+    void resume();
+    bool paused() const { return paused_; }
+    // 改变播放速度：以当前媒体时间为锚点重新换算，之后的截止时刻按新速度推进
+    void setSpeed(double speed);
+    double speed() const { return speed_; }
+    // 把当前时刻对应的媒体时间校正为media_time_s (以外部主时钟为准时调用)，之后的截止时刻随之平移
+    void retime(double media_time_s);
+
+    // 当前时钟对应的媒体时间 (秒)
+    double mediaTime() const;
+    // 媒体时间对应的截止时刻 (CLOCK_MONOTONIC纳秒)
+    int64_t deadlineNs(double media_time_s) const;
+
+    // 判断帧是否因落后过多而应丢弃 (丢弃时计入统计)；严重落后时重新对齐时钟并返回false
+    bool shouldDrop(double media_time_s);
+    // 睡眠到帧的截止时刻，已过截止时刻时立即返回
+    void waitUntil(double media_time_s) const;
+    // 帧已提交显示，记录误差
+    void framePresented(double media_time_s);
+
+    Stats stats() const;
+    void resetStats();
+
+    static int64_t nowNs();
+    // 睡眠到CLOCK_MONOTONIC上的绝对时刻
+    static void sleepUntilNs(int64_t deadline_ns);
+
+private:
+    void anchor(double media_time_s, int64_t now_ns);
+
+    Config config_;
+    bool running_ = false;
+    bool paused_ = false;
+    double speed_ = 1.0;
+    double anchor_media_s_ = 0.0;   // 锚点的媒体时间
+    int64_t anchor_ns_ = 0;         // 锚点对应的单调时钟时刻
+    double paused_media_s_ = 0.0;   // 暂停时的媒体时间
+    int consecutive_drops_ = 0;
+
+    mutable std::mutex stats_mutex_;
+    Stats stats_;
+    double drift_m2_ = 0.0;         // Welford算法的平方差累计
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SPSCRING_H_
+#define SPSCRING_H_
+
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+// 单生产者单消费者的无锁环形缓冲区，用于解码线程向音频回调传递PCM采样等实时数据。
+// 读写两端各自只修改自己的位置，读写都不加锁、不分配内存、不等待 (wait-free)，可在AAudio回调中使用。
+// 读位置和写位置分别位于独立的缓存行，避免两个线程互相使对方的缓存行失效。
+// 容量向上取整为2的幂。reset()只能在两端都未访问时调用。
+template <typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing只能存放可按字节拷贝的类型");
+
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        buffer_.reset(new T[size]);
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // 生产者：写入最多count个元素，返回实际写入的个数 (空间不足时只写入一部分)
+    size_t write(const T *data, size_t count) {
+        size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+        size_t read_pos = read_pos_.load(std::memory_order_acquire);
+        size_t n = count < capacity() - (write_pos - read_pos) ? count : capacity() - (write_pos - read_pos);
+        size_t offset = write_pos & mask_;
+        size_t first = n < capacity() - offset ? n : capacity() - offset; // 回绕时分两段拷贝
+        memcpy(&buffer_[offset], data, first * sizeof(T));
+        memcpy(&buffer_[0], data + first, (n - first) * sizeof(T));
+        write_pos_.store(write_pos + n, std::memory_order_release);
+        return n;
+    }
+
+    bool push(const T &item) { return write(&item, 1) == 1; }
+
+    // 消费者：读出最多count个元素，返回实际读出的个数
+    size_t read(T *out, size_t count) {
+        size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+        size_t write_pos = write_pos_.load(std::memory_order_acquire);
+        size_t n = count < write_pos - read_pos ? count : write_pos - read_pos;
+        size_t offset = read_pos & mask_;
+        size_t first = n < capacity() - offset ? n : capacity() - offset;
+        memcpy(out, &buffer_[offset], first * sizeof(T));
+        memcpy(out + first, &buffer_[0], (n - first) * sizeof(T));
+        read_pos_.store(read_pos + n, std::memory_order_release);
+        return n;
+    }
+
+    bool pop(T &out) { return read(&out, 1) == 1; }
+
+    // 消费者：查看下一个元素但不取出，为空时返回false
+    bool peek(T &out) const {
+        size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+        if (write_pos_.load(std::memory_order_acquire) == read_pos) return false;
+        out = buffer_[read_pos & mask_];
+        return true;
+    }
+
+    // 可读元素数 (消费者调用时为下限，生产者调用时为上限)
+    size_t readAvailable() const {
+        return write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_acquire);
+    }
+    size_t writeAvailable() const { return capacity() - readAvailable(); }
+
+    // 清空缓冲区，调用时两端都不能在访问
+    void reset() {
+        read_pos_.store(0, std::memory_order_relaxed);
+        write_pos_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::unique_ptr<T[]> buffer_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> write_pos_{0}; // 只由生产者修改
+    alignas(64) std::atomic<size_t> read_pos_{0};  // 只由消费者修改
+};
+
+#endif
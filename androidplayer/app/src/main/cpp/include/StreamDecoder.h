@@ -0,0 +1,140 @@
+#ifndef STREAMDECODER_H_
+#define STREAMDECODER_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Demuxer.h"
+#include "FramePool.h"
+#include "FrameRing.h"
+#include "KeyframeIndex.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+// 边解码边播放的流式解码器：
+// Demuxer的解复用线程把视频包放入视频流的包队列，解码线程解码后放入无锁的有界帧队列 (FrameRing)，
+// 渲染线程通过popFrame直接取帧。帧队列同时受深度和内存预算限制，两端在队列满/空时在futex上睡眠。
+// 这样首帧只需等待第一个关键帧解码完成，而不必先把整个文件解码到YUV文件。
+// Demuxer可与AudioDecoder共用 (文件只读取一次)，也可由open(path)单独创建。
+// 打开时提供关键帧索引路径则使用KeyframeIndex精确跳转：定位到目标之前最近的关键帧，再向前解码到目标帧。
+// 解码器从FramePool分配帧缓冲区，送往渲染线程的AVFrame也由池循环使用，稳态下每帧没有堆分配。
+// 帧缓冲池可由多个实例共用 (多个播放器同时播放时同尺寸的缓冲区互相复用)。
+// 打开后登记为一路正在解码的视频流，自动线程数与其他实例平分核心 (decoder_auto_thread_count)。
+class StreamDecoder {
+public:
+    // 跳转耗时统计：从请求跳转到目标帧可被渲染线程取出
+    struct SeekStats {
+        long count = 0;
+        double last_ms = 0.0;
+        double avg_ms = 0.0;
+        double max_ms = 0.0;
+        long last_decoded_forward = 0;   // 最近一次跳转从关键帧向前解码后丢弃的帧数
+    };
+
+    // frame_queue_depth/frame_queue_bytes为帧队列的深度和内存预算，0表示使用默认值。
+    // frame_pool为与其他实例共用的帧缓冲池，为空时使用自己的池
+    explicit StreamDecoder(size_t frame_queue_depth = 0, size_t frame_queue_bytes = 0,
+                           std::shared_ptr<FramePool> frame_pool = nullptr);
+    ~StreamDecoder();
+
+    // 打开输入文件并初始化视频解码器，成功返回0，失败返回<0。
+    // index_path非空时加载该位置保存的关键帧索引，不存在或已过期时扫描文件并保存
+    int open(const char *path, const char *index_path = nullptr);
+    // 在 (可能与音频共用的) 解复用器上初始化视频解码器，必须在demuxer->start之前调用或随后跳转一次
+    int open(const std::shared_ptr<Demuxer> &demuxer, const char *index_path = nullptr);
+
+    // 启动解码线程 (解复用线程尚未运行时一并启动)，成功返回0
+    int start();
+
+    // 停止解码线程，停用解复用器中的视频流并释放资源
+    void stop();
+
+    // 请求跳转到指定帧（异步执行，跳转后的第一帧为目标帧或其之后最近的帧），返回解复用器上的跳转序号，未打开时返回-1。
+    // 共用的解复用器上音频也随之跳转 (音频可用AudioDecoder::follow按该序号定位到目标时间，不必再次跳转)
+    int seekToFrame(long frameNum);
+
+    // 取出下一帧。返回1表示成功（*frame需由调用者通过releaseFrame归还），0表示超时或被中断，-1表示流结束或已停止
+    int popFrame(AVFrame **frame, int timeoutMs);
+    // 让渲染线程正在等待的popFrame立即返回0 (如有播放控制命令需要处理)，任意线程可调用
+    void interruptPop() { frame_queue_.interrupt(); }
+
+    // 根据帧的时间戳计算其帧号
+    long frameIndexOf(const AVFrame *frame) const;
+    // 帧相对起始时间的显示时间 (毫秒)，时间戳不可用时按帧号换算
+    double frameTimeMs(const AVFrame *frame) const;
+
+    // 归还popFrame取出的帧 (缓冲区回到帧缓冲池)，必须在stop之前调用
+    void releaseFrame(AVFrame **frame) { frame_pool_->releaseFrame(frame); }
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    double frameRate() const { return frame_rate_; }
+    // 送出帧的颜色标记 (取值范围为FrameNormalizer归一化后的范围)，渲染线程据此选择一次转换内核
+    AVColorSpace colorSpace() const { return color_space_; }
+    AVColorRange colorRange() const { return color_range_; }
+    AVChromaLocation chromaLocation() const { return chroma_location_; }
+    long estimatedTotalFrames() const { return total_frames_; }
+    // 是否使用关键帧索引 (总帧数和帧号为精确值)
+    bool hasIndex() const { return use_index_; }
+    SeekStats seekStats() const;
+    // 帧缓冲池的分配统计 (共用的池包含其他实例的分配)
+    FramePool::Stats framePoolStats() const { return frame_pool_->stats(); }
+    // 解复用器的包结构体累计分配次数 (未打开时为0)
+    long packetAllocations() const { return demuxer_ ? demuxer_->packetAllocations() : 0; }
+    Demuxer *demuxer() const { return demuxer_.get(); }
+    // 帧队列的等待和占用统计
+    FrameRingStats frameQueueStats() const { return frame_queue_.stats(); }
+
+private:
+    struct FrameItem {
+        AVFrame *frame;   // nullptr表示流结束
+        int serial;
+    };
+
+    void decodeLoop();
+    int64_t frameToPts(long frameNum) const;
+    void releaseQueues();
+    void recordSeekLatency();
+
+    std::shared_ptr<FramePool> frame_pool_;  // 比解码器上下文和帧队列中的帧活得更久
+    bool stream_counted_ = false;            // 是否已登记为正在解码的视频流
+    std::shared_ptr<Demuxer> demuxer_;
+    PacketQueue *packet_queue_ = nullptr;    // 由demuxer_持有
+    AVCodecContext *codec_ctx_ = nullptr;
+    int stream_idx_ = -1;
+    int width_ = 0;
+    int height_ = 0;
+    double frame_rate_ = 25.0;
+    AVRational frame_rate_q_ = {25, 1};
+    AVColorSpace color_space_ = AVCOL_SPC_UNSPECIFIED;
+    AVColorRange color_range_ = AVCOL_RANGE_UNSPECIFIED;
+    AVChromaLocation chroma_location_ = AVCHROMA_LOC_UNSPECIFIED;
+    AVRational time_base_ = {1, 1000};
+    int64_t start_pts_ = 0;
+    long total_frames_ = 0;
+    KeyframeIndex index_;
+    bool use_index_ = false;
+
+    FrameRing<FrameItem> frame_queue_;       // 解码线程入队，渲染线程出队
+    std::thread decode_thread_;
+
+    std::atomic<bool> abort_{false};
+    std::atomic<int> serial_{0};             // 最近一次自己发起的跳转序号，更早序号的包和帧全部作废
+    std::atomic<long> dropped_since_seek_{0};                // 跳转后向前解码丢弃的帧数
+
+    mutable std::mutex seek_mutex_;                          // 保护下面的跳转目标和计时
+    int seek_target_serial_ = -1;                            // 尚未生效的跳转的序号，-1表示无
+    int64_t seek_target_pts_ = AV_NOPTS_VALUE;               // 跳转后丢弃早于此时间戳的帧
+    std::chrono::steady_clock::time_point seek_requested_at_;
+    std::atomic<int> measure_serial_{-1};                    // 待计时跳转的序号，-1表示无
+    long measure_target_ = -1;
+    SeekStats seek_stats_;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef TIMESTRETCHER_H_
+#define TIMESTRETCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// 相关度搜索内核类型
+enum class CorrelationKernel {
+    Scalar,   // 标量实现，所有平台可用
+    Neon,     // armeabi-v7a / arm64-v8a，每次迭代处理8个采样
+    Sse,      // x86 / x86_64，每次迭代处理8个采样
+    Avx,      // x86 / x86_64，每次迭代处理16个采样
+};
+
+// 计算模板a与候选b的互相关 (sum a*b) 和候选能量 (sum b*b)，n为采样数
+using CorrelationFunc = void (*)(const float *a, const float *b, int n, float *corr, float *energy);
+
+// 保持音调的变速 (WSOLA，波形相似叠加)：按播放速度以analysis hop = synthesis hop × speed的步长在输入中前进，
+// 每个输出hop在理想位置附近的搜索范围内找与上一段自然延续最相似的输入片段，再与上一段交叉淡化拼接。
+// 窗长、搜索范围固定，搜索先粗后细，每个输出采样的计算量与速度无关，CPU开销可预测。
+// 输入输出均为交错float PCM。支持0.25x~4x；速度为1时不搜索，输出与输入逐采样一致。
+// 生成一个hop的输出需要其后约一个hop加搜索范围的输入，flush()前输出比输入滞后约两个hop。
+// 只依赖标准库，可在Linux主机上运行。非线程安全。
+class TimeStretcher {
+public:
+    static constexpr double kMinSpeed = 0.25;
+    static constexpr double kMaxSpeed = 4.0;
+
+    TimeStretcher();
+    explicit TimeStretcher(CorrelationKernel kernel);
+
+    // 设置采样率和声道数并清空状态
+    void configure(int sample_rate, int channels);
+    void setSpeed(double speed);
+    double speed() const { return speed_; }
+    // 清空缓冲的输入输出 (跳转时调用)，之后的输入视为新的起点
+    void reset();
+
+    // 追加frames个输入采样帧，并生成所有可生成的输出
+    void putInput(const float *in, int frames);
+    // 输入结束：用静音补齐，使剩余的输入全部生成输出
+    void flush();
+    // 取出最多max_frames个输出采样帧，返回实际取出的帧数
+    int receiveOutput(float *out, int max_frames);
+    int pendingOutput() const;
+
+    // 下一个输出采样帧对应的输入位置 (自reset以来的输入帧数)
+    double inputPosition() const;
+    // 每次拼接输出的采样帧数 (约10ms)
+    int hopFrames() const { return hop_; }
+
+    CorrelationKernel kernel() const { return kernel_; }
+    static CorrelationKernel detectBestKernel();
+    static bool isKernelSupported(CorrelationKernel kernel);
+    static const char *kernelName(CorrelationKernel kernel);
+
+private:
+    void process();
+    int64_t search(int64_t lo, int64_t hi) const;
+
+    CorrelationKernel kernel_;
+    CorrelationFunc corr_func_;
+
+    int sample_rate_ = 48000;
+    int channels_ = 2;
+    int hop_ = 480;                 // 输出hop (交叉淡化长度)
+    int search_ = 288;              // 在理想位置前后搜索的范围
+    double speed_ = 1.0;
+
+    std::vector<float> input_;      // 交错输入，input_[0]为第input_base_帧
+    std::vector<float> mono_;       // 与input_对应的单声道混合，用于相关度搜索
+    int64_t input_base_ = 0;
+    double ideal_pos_ = 0.0;        // 下一个输出hop在输入中的理想位置
+    bool started_ = false;
+    std::vector<float> tail_;       // 上一段的自然延续 (交错)，与下一段交叉淡化
+    std::vector<float> tail_mono_;  // tail_的单声道混合，作为搜索模板
+    std::vector<float> fade_in_;    // 交叉淡化曲线 (升余弦)
+    std::vector<float> output_;
+    size_t output_read_ = 0;        // output_中已取出的采样帧数
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef WORKERPOOL_H_
+#define WORKERPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 常驻的工作线程池。多个播放器实例的CPU密集任务 (如冷启动时的分段并行解码) 都交给同一个池，
+// 池中线程数等于在线核心数，实例增多时任务排队而不是成倍创建线程。
+// run()把一批任务放入队列并等待全部完成，调用线程在等待期间也执行自己的任务，
+// 因此任务中再调用run()不会因池中线程全部占用而死锁；同时运行的任务数最多为池中线程数加上
+// 正在run()中的调用线程数 (如N个实例的渲染线程同时并行转换时最多比核心数多N个)。只依赖C++标准库，可在Linux主机上运行。
+class WorkerPool {
+public:
+    // threads为0时按在线核心数创建
+    explicit WorkerPool(int threads = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // 对i = 0..count-1执行fn(i)，全部完成后返回
+    void run(int count, const std::function<void(int)> &fn);
+
+    int threadCount() const { return (int) threads_.size(); }
+
+    // 进程内所有播放器实例共用的线程池 (首次调用时创建)
+    static WorkerPool &shared();
+
+private:
+    // 一次run()调用：任务按序号领取，完成数达到count时唤醒调用者
+    struct Batch {
+        const std::function<void(int)> *fn;
+        int count;
+        int next = 0;
+        int done = 0;
+    };
+
+    void workerLoop();
+    // 领取并执行batch中的一个任务，没有剩余任务时返回false。调用时持有mutex_
+    bool runOne(Batch *batch, std::unique_lock<std::mutex> &lock);
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;   // 有新任务或退出
+    std::condition_variable done_cv_;   // 某个batch的任务全部完成
+    std::deque<Batch *> batches_;       // 仍有未领取任务的batch
+    std::vector<std::thread> threads_;
+    bool stop_ = false;
+};
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef YUVCONVERTER_H_
+#define YUVCONVERTER_H_
+
+#include <stdint.h>
+#include <string>
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+class WorkerPool;
+
+// YUV->RGB 颜色矩阵 (按Kr/Kb推导转换系数)
+enum class YuvMatrix {
+    Bt601,    // SD (BT.470BG / SMPTE 170M)
+    Bt709,    // HD
+    Bt2020,   // UHD (非恒定亮度)
+};
+
+// 分量取值范围
+enum class YuvRange {
+    Limited,  // Y: 16~235, UV: 16~240 (MPEG)
+    Full,     // 0~255 (JPEG)
+};
+
+// 4:2:0色度样本的水平位置，决定色度如何上采样到每个像素
+enum class ChromaSiting {
+    Left,     // 与偶数列亮度对齐 (MPEG-2/H.264/HEVC)：偶数列直接取色度，奇数列取左右两个样本的平均
+    Center,   // 位于两列亮度中间 (MPEG-1/JPEG)：每个色度样本复用于两个像素
+};
+
+// 输出像素格式 (与ANativeWindow的缓冲区格式对应)
+enum class YuvOutput {
+    Rgba8888,   // WINDOW_FORMAT_RGBA_8888，每像素4字节
+    Rgb565,     // WINDOW_FORMAT_RGB_565，每像素2字节 (R在高5位)，量化前叠加4x4有序抖动，窗口缓冲区带宽和内存减半
+};
+
+// 转换的颜色格式。每种组合对应一组编译期特化的内核 (系数为常量表中的立即数，色度位置和输出格式在编译期确定)，
+// 每个流只在开始时选择一次，像素循环内没有按格式的分支。默认值为BT.601 limited range、Center (旧版转换器的行为)
+struct YuvColorFormat {
+    YuvMatrix matrix = YuvMatrix::Bt601;
+    YuvRange range = YuvRange::Limited;
+    ChromaSiting siting = ChromaSiting::Center;
+    YuvOutput output = YuvOutput::Rgba8888;
+
+    // 由流的颜色标记 (AVCodecContext的colorspace、color_range、chroma_sample_location) 选择。
+    // 未标记时按常见做法推断：矩阵按分辨率 (720p及以上为BT.709)，范围为limited，
+    // 色度位置full range (JPEG/MJPEG) 为Center、其余为Left
+    static YuvColorFormat forStream(AVColorSpace space, AVColorRange range, AVChromaLocation location,
+                                    int width, int height);
+    std::string name() const;   // 例如 "bt709/limited/left/rgba"
+    int bytesPerPixel() const { return output == YuvOutput::Rgb565 ? 2 : 4; }
+};
+
+// Q8定点转换系数，由矩阵和范围在编译期计算：
+// R = (y*(Y-y_offset) + rv*(V-128) + 128) >> 8
+// G = (y*(Y-y_offset) - gu*(U-128) - gv*(V-128) + 128) >> 8
+// B = (y*(Y-y_offset) + bu*(U-128) + 128) >> 8
+struct YuvCoefficients {
+    int y_offset;
+    int y;
+    int rv;
+    int gu;
+    int gv;
+    int bu;
+};
+
+// YUV420p -> RGB 转换内核类型
+enum class YuvKernel {
+    Scalar,   // 标量实现，所有平台可用，其余内核的结果与之逐位一致
+    Neon,     // armeabi-v7a / arm64-v8a，每次迭代处理16像素
+    Sse41,    // x86 / x86_64，每次迭代处理16像素
+    Avx2,     // x86 / x86_64，每次迭代处理32像素
+};
+
+// 单行转换函数：y/u/v为该行对应的平面行指针，dst为输出行，width为像素数，
+// row为该行在画面中的行号 (决定RGB565有序抖动的相位，RGBA输出忽略)
+using YuvRowFunc = void (*)(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width, int row);
+
+// YUV420p转RGB转换器。
+// 构造时根据运行时检测到的CPU特性选择最快的内核，也可指定内核 (用于基准测试与校验)；
+// 颜色格式在构造时选定，对应的特化行函数此后不变。
+class YuvConverter {
+public:
+    YuvConverter();
+    explicit YuvConverter(YuvKernel kernel);
+    explicit YuvConverter(const YuvColorFormat &format);
+    YuvConverter(const YuvColorFormat &format, YuvKernel kernel);
+
+    // 转换整帧，各平面按各自的行跨度访问
+    void convert(const uint8_t *src_y, int stride_y,
+                 const uint8_t *src_u, int stride_u,
+                 const uint8_t *src_v, int stride_v,
+                 uint8_t *dst, int dst_stride, int width, int height) const;
+
+    // 按水平条带并行转换整帧：帧切分为stripes个条带 (起始行为偶数，与色度行对齐)，由pool中的线程和
+    // 调用线程共同执行，各条带写入dst中互不重叠的行 (可直接写入锁定的窗口缓冲区)，结果与单线程转换逐位一致。
+    // stripes<=1时在调用线程上转换
+    void convert(const uint8_t *src_y, int stride_y,
+                 const uint8_t *src_u, int stride_u,
+                 const uint8_t *src_v, int stride_v,
+                 uint8_t *dst, int dst_stride, int width, int height,
+                 WorkerPool &pool, int stripes) const;
+
+    // 转换一行，row为该行在画面中的行号
+    void convertRow(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width, int row) const {
+        row_func_(y, u, v, dst, width, row);
+    }
+
+    // 按帧大小选择条带数：每个条带至少约kMinStripePixels个像素 (过小时分发开销超过转换本身)，
+    // 且不超过workers (参与转换的线程数)
+    static int autoStripeCount(int width, int height, int workers);
+
+    YuvKernel kernel() const { return kernel_; }
+    const YuvColorFormat &format() const { return format_; }
+
+    // 运行时检测当前CPU支持的最快内核
+    static YuvKernel detectBestKernel();
+    // 当前CPU是否支持指定内核 (同时要求编译时已包含该内核)
+    static bool isKernelSupported(YuvKernel kernel);
+    static const char *kernelName(YuvKernel kernel);
+    // 编译期系数表中的值 (供校验和对照实现使用)
+    static YuvCoefficients coefficients(YuvMatrix matrix, YuvRange range);
+
+private:
+    // 转换 [first_row, last_row) 行，各指针为整帧的起始地址
+    void convertRows(const uint8_t *src_y, int stride_y,
+                     const uint8_t *src_u, int stride_u,
+                     const uint8_t *src_v, int stride_v,
+                     uint8_t *dst, int dst_stride, int width, int first_row, int last_row) const;
+
+    YuvColorFormat format_;
+    YuvKernel kernel_;
+    YuvRowFunc row_func_;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef YUVSCALER_H_
+#define YUVSCALER_H_
+
+#include <stdint.h>
+#include <vector>
+#include "YuvConverter.h"
+
+class WorkerPool;
+
+// 视频画面在窗口缓冲区中的布局：缓冲区与窗口宽高比相同，画面按原宽高比居中，其余部分为黑边。
+// 画面只缩小不放大 (窗口大于视频时缓冲区取视频分辨率，由合成器放大到窗口)，
+// 因此转换和提交的像素数只取决于屏幕上实际显示的大小
+struct LetterboxLayout {
+    int buffer_width = 0;   // 窗口缓冲区尺寸 (ANativeWindow_setBuffersGeometry)
+    int buffer_height = 0;
+    int x = 0;              // 画面左上角在缓冲区中的位置
+    int y = 0;
+    int width = 0;          // 画面尺寸 (缩小时取偶数)
+    int height = 0;
+};
+
+// 计算window_width x window_height的窗口中显示video_width x video_height视频的布局。
+// 窗口尺寸未知 (<=0) 时缓冲区即为视频尺寸
+LetterboxLayout letterbox_layout(int video_width, int video_height, int window_width, int window_height);
+
+// 将窗口缓冲区中画面以外的部分填充为 (不透明) 黑色。dst为缓冲区起始地址，dst_stride为每行字节数，output为缓冲区格式
+void letterbox_fill_bars(uint8_t *dst, int dst_stride, const LetterboxLayout &layout,
+                         YuvOutput output = YuvOutput::Rgba8888);
+
+// 缩放与YUV420p->RGB转换合为一遍：逐对输出行先在源平面上做可分离的面积滤波 (缩小时为面积平均，
+// 放大时退化为双线性)，结果只写入每个条带的几行暂存 (常驻L1/L2)，再由YuvConverter的SIMD内核转换为RGBA/RGB565，
+// 不产生缩放后的整帧中间结果。垂直累加和水平2:1预缩小 (第一次与垂直累加合并) 用编译器向量扩展 (NEON/SSE2) 实现，
+// 水平方向剩余不到2倍的缩放按滤波表逐像素计算。
+// configure在尺寸改变时重建滤波表和暂存区，之后每帧转换没有堆分配
+class YuvScaler {
+public:
+    YuvScaler();
+    explicit YuvScaler(YuvKernel kernel);
+    YuvScaler(const YuvColorFormat &format, YuvKernel kernel);
+
+    // 设置源和目标尺寸，max_stripes为并行转换时最多的条带数 (决定暂存区份数)。尺寸未变时直接返回
+    void configure(int src_width, int src_height, int dst_width, int dst_height, int max_stripes = 1);
+
+    // 缩放并转换整帧到dst (dst_width x dst_height，每行dst_stride字节)。
+    // pool非空且stripes>1时按输出行对切分条带并行执行，结果与单线程逐位一致
+    void convert(const uint8_t *src_y, int stride_y,
+                 const uint8_t *src_u, int stride_u,
+                 const uint8_t *src_v, int stride_v,
+                 uint8_t *dst, int dst_stride, WorkerPool *pool = nullptr, int stripes = 1) const;
+
+    int srcWidth() const { return src_width_; }
+    int srcHeight() const { return src_height_; }
+    int dstWidth() const { return dst_width_; }
+    int dstHeight() const { return dst_height_; }
+    YuvKernel kernel() const { return converter_.kernel(); }
+    const YuvColorFormat &format() const { return converter_.format(); }
+
+private:
+    // 一个方向上的滤波表：每个输出位置从start起连续taps个源像素的定点权重 (权重和为one，不足的补0)
+    struct Taps {
+        int halvings = 0;            // 查表之前先做几次2:1预缩小 (仅水平方向)
+        bool identity = false;       // 预缩小后已是目标尺寸，不需要查表 (仅水平方向)
+        int taps = 0;
+        std::vector<int> start;
+        std::vector<uint16_t> weight;
+    };
+    // 一个条带的暂存：垂直滤波的累加行和两行亮度/一行色度的输出
+    struct Scratch {
+        std::vector<uint16_t> acc;
+        std::vector<uint8_t> y;
+        std::vector<uint8_t> u;
+        std::vector<uint8_t> v;
+    };
+
+    static void buildTaps(int src, int dst, Taps *taps, int one = 256);
+    // 水平方向：缩小2倍以上的部分由2:1预缩小完成，剩余的缩放比不到2
+    static void buildHorizontalTaps(int src, int dst, Taps *taps);
+    // 按垂直滤波表累加out_row对应的源行，再按水平滤波表输出一行
+    static void scaleRow(const uint8_t *src, int stride, int src_width, const Taps &vertical, int out_row,
+                         const Taps &horizontal, int dst_width, uint16_t *acc, uint8_t *dst);
+    void convertRows(const uint8_t *src_y, int stride_y, const uint8_t *src_u, int stride_u,
+                     const uint8_t *src_v, int stride_v, uint8_t *dst, int dst_stride,
+                     int first_pair, int last_pair, Scratch *scratch) const;
+
+    YuvConverter converter_;
+    int src_width_ = 0;
+    int src_height_ = 0;
+    int dst_width_ = 0;
+    int dst_height_ = 0;
+    Taps luma_x_, luma_y_, chroma_x_, chroma_y_;
+    mutable std::vector<Scratch> scratch_;   // 每个条带一份
+};
+
+#endif
@@ -1,7 +1,9 @@
 package com.example.androidplayer;
 
 import androidx.appcompat.app.AppCompatActivity;
+import android.content.res.AssetFileDescriptor;
 import android.os.Bundle;
+import android.os.SystemClock;
 import android.os.Handler;
 import android.os.Looper;
 import android.util.Log;
@@ -23,12 +25,33 @@ import java.util.concurrent.ExecutorService;
 import java.util.concurrent.Executors;
 import java.util.concurrent.atomic.AtomicBoolean;
 
-// 主活动类，实现SurfaceHolder.Callback接口以处理SurfaceView的生命周期事件
-public class MainActivity extends AppCompatActivity implements SurfaceHolder.Callback {
+// 主活动类，实现SurfaceHolder.Callback2接口以处理SurfaceView的生命周期和重绘事件
+public class MainActivity extends AppCompatActivity implements SurfaceHolder.Callback2 {
 
     private static final String TAG = "MainActivity"; // 日志标签
     private static final String INPUT_FILE_NAME = "1.mp4"; // 输入视频文件名 (assets目录)
-    private static final String YUV_FILE_NAME = "output.yuv"; // 解码后的YUV文件名
+    private static final String LEGACY_YUV_FILE_NAME = "output.yuv"; // 旧版本的YUV文件名 (已由按内容命名的缓存取代)
+    // true: 流式模式，边解码边播放; false: YUV缓存模式，先完整解码到YUV文件再播放
+    private static final boolean USE_STREAMING_MODE = true;
+    // true: 媒体准备完成后在后台运行Native性能基准测试并输出到logcat
+    private static final boolean RUN_NATIVE_BENCHMARKS = false;
+    // 解码线程数，0表示按分辨率和CPU核心数自动选择；以及是否启用帧级/片级多线程
+    private static final int DECODER_THREAD_COUNT = 0;
+    private static final boolean DECODER_FRAME_THREADS = true;
+    private static final boolean DECODER_SLICE_THREADS = true;
+    // YUV缓存模式冷启动时并行解码的分段数，0表示自动，1表示顺序解码
+    private static final int CACHE_DECODE_WORKERS = 0;
+    // 冷启动时解码器直接解码到缓存文件 (mmap的帧槽)，省去每帧的拷贝；解码器不支持时自动使用拷贝写入
+    private static final boolean CACHE_ZERO_COPY = true;
+    // 音视频同步允许的最大偏差 (毫秒)，视频时钟偏离音频位置超过此值时校正 (丢帧或重复帧)
+    private static final double AV_SYNC_THRESHOLD_MS = 40.0;
+    // true: 音频由FFmpeg解码、重采样后经AAudio低延迟回调输出 (不可用时回退到OpenSL ES); false: OpenSL ES按URI解码播放
+    private static final boolean USE_NATIVE_AUDIO = true;
+    // true: 窗口缓冲区使用RGB565 (有序抖动)，每像素2字节，转换写入量和缓冲区内存减半，适合低端设备和多画面; false: RGBA8888
+    private static final boolean USE_RGB565_OUTPUT = false;
+    // true: 保留最近转换的帧，Surface重绘 (尺寸变化等) 时直接重新显示而不重新转换，每帧多一次拷贝;
+    // false: 转换结果直接写入窗口缓冲区，暂停中重绘时重新解码并转换当前帧
+    private static final boolean USE_REDRAW_CACHE = false;
 
     private SurfaceView surfaceView; // 用于显示视频的视图
     private SurfaceHolder surfaceHolder; // SurfaceView的控制器
@@ -41,17 +64,20 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
 
     private String mp4FilePath; // MP4文件在缓存中的绝对路径
     private String yuvFilePath; // YUV文件在缓存中的绝对路径
+    private volatile long nativePlayer; // 本Activity的播放器实例句柄 (onCreate创建，onDestroy提交到后台线程释放)
 
     // 播放器状态枚举
     private enum PlayerState { IDLE, PREPARING, PLAYING, PAUSED, STOPPED, ERROR }
     private PlayerState currentPlayerState = PlayerState.IDLE; // 当前播放器状态
     private float currentSpeed = 1.0f; // 当前播放速度
     private boolean isSurfaceReady = false; // Surface是否已准备好
-    private boolean isYuvDecoded = false; // YUV文件是否已解码完成
+    private boolean playbackSurfaceLost = false; // 播放所用的Surface是否已销毁 (之后重建的Surface不能由Native层重绘)
+    private boolean isMediaReady = false; // 媒体是否已准备好 (流式模式: 已探测视频参数; 缓存模式: YUV文件已解码完成)
     private AtomicBoolean isSeekingFromUser = new AtomicBoolean(false); // 用户是否正在拖动进度条
 
     private double videoFrameRate = 25.0; // 视频帧率
     private long pendingAudioSeekMs = -1; // 待处理的音频跳转时间点 (毫秒)
+    private boolean firstFrameTimeLogged = false; // 本次播放的首帧耗时是否已记录
 
     private static final int PROGRESS_UPDATE_INTERVAL_MS = 200; // 进度条更新间隔 (毫秒)
 
@@ -66,23 +92,43 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
     }
 
     // --- JNI本地方法声明 ---
-    private native int decodeVideoToFile(String inputFilePath, String outputFilePath); // 解码视频到YUV文件
-    private native void nativeStartVideoPlayback(String yuvFilePath, Surface surface); // 开始本地视频播放
-    private native void nativeStopVideoPlayback(); // 停止本地视频播放
-    private native void nativePauseVideo(); // 暂停本地视频
-    private native void nativeResumeVideo(); // 恢复本地视频
-    private native void nativeSetSpeed(float speed); // 设置视频播放速度 (影响帧延迟)
-    private native void nativeSeekToFrame(int frameNum); // 视频跳转到指定帧
-    private native int nativeGetTotalFrames(String yuvFilePath); // 获取视频总帧数
-    private native int nativeGetCurrentFrame(); // 获取当前视频帧
-    private native double nativeGetFrameRate(); // 获取视频帧率
+    // 播放器实例由nativeCreatePlayer创建，以不透明句柄传给各播放器方法，nativeReleasePlayer释放
+    private native long nativeCreatePlayer(); // 创建播放器实例，返回句柄
+    private native void nativeReleasePlayer(long handle); // 停止并释放播放器实例
+    private native int decodeVideoToFile(long handle, String inputFilePath, String outputFilePath); // 解码视频到YUV文件
+    private native void nativeStartVideoPlayback(long handle, String yuvFilePath, Surface surface); // 开始本地视频播放
+    private native void nativeStopVideoPlayback(long handle); // 停止本地视频播放
+    private native void nativePauseVideo(long handle); // 暂停本地视频
+    private native void nativeResumeVideo(long handle); // 恢复本地视频
+    private native void nativeSetSpeed(long handle, float speed); // 设置视频播放速度 (影响帧延迟)
+    private native void nativeSeekToFrame(long handle, int frameNum); // 视频跳转到指定帧
+    private native int nativeGetTotalFrames(long handle, String yuvFilePath); // 获取视频总帧数
+    private native int nativeGetCurrentFrame(long handle); // 获取当前视频帧
+    private native double nativeGetFrameRate(long handle); // 获取视频帧率
+    private native int nativeProbeVideo(long handle, String inputFilePath, String cacheDir); // 探测视频参数并建立关键帧索引，返回总帧数
+    private native void nativeStartStreamingPlayback(long handle, String inputFilePath, Surface surface); // 以流式模式开始播放
+    private native double nativeGetTimeToFirstFrameMs(long handle); // 获取首帧耗时 (毫秒)
+    private native String nativeRunBenchmarks(String inputFilePath); // 运行性能基准测试，返回文本报告
+    private native String nativePrepareFrameCache(long handle, String inputFilePath, String cacheDir, int decodeWorkers, boolean zeroCopy); // 准备YUV缓存 (可复用/续写)，返回缓存文件路径
+    private native String nativeGetStartupMetrics(long handle); // 获取最近一次缓存准备的冷/热启动指标
+    private native String nativeGetSeekMetrics(long handle); // 获取流式播放的跳转耗时统计
+    private native String nativeGetPacingMetrics(long handle); // 获取显示节奏统计 (丢帧数、显示误差和抖动)
+    private native String nativeGetControlMetrics(long handle); // 获取暂停/恢复/跳转/停止命令的生效延迟
+    private native void nativeSetAvSyncThresholdMs(long handle, double thresholdMs); // 设置音视频同步允许的最大偏差
+    private native String nativeGetAvSyncMetrics(long handle); // 获取A/V偏差统计及其随时间的采样
+    private native void nativeSetDecoderThreading(int threadCount, boolean frameThreads, boolean sliceThreads); // 设置解码线程配置
 
     private native int initAudio(String inputFilePath); // 初始化音频
-    private native void startAudio(String inputFilePath, long startOffsetMs); // 开始播放音频
-    private native void stopAudio(); // 停止播放音频
-    private native void pauseAudio(boolean pause); // 暂停/恢复音频
-    private native void nativeSeekAudioToTimestamp(long timeMs); // 音频跳转到指定时间戳
-    private native void nativeSetAudioPlaybackRate(float rate); // 设置音频播放速率
+    private native void startAudio(long handle, String inputFilePath, long startOffsetMs); // 开始播放音频
+    private native void stopAudio(long handle); // 停止播放音频
+    private native void pauseAudio(long handle, boolean pause); // 暂停/恢复音频
+    private native void nativeSeekAudioToTimestamp(long handle, long timeMs); // 音频跳转到指定时间戳
+    private native void nativeSetAudioPlaybackRate(long handle, float rate); // 设置音频播放速率
+    private native void nativeSetAudioOutput(long handle, boolean useNative); // 选择音频输出路径 (原生解码+AAudio或OpenSL ES)
+    private native void nativeSetVideoOutput(long handle, boolean rgb565); // 选择窗口缓冲区格式 (RGB565或RGBA8888)
+    private native void nativeSetRedrawCache(long handle, boolean retain); // 开启或关闭重绘缓存
+    private native void nativeRedrawVideo(long handle); // 窗口需要重绘时重新显示当前画面
+    private native String nativeGetAudioMetrics(long handle); // 获取原生音频管线的统计 (欠载次数、解码/重采样耗时、输出延迟)
 
     // 更新播放进度的Runnable
     private final Runnable progressUpdater = new Runnable() {
@@ -90,7 +136,15 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
         public void run() {
             // 仅在播放或暂停状态且用户未拖动进度条时更新
             if ((currentPlayerState == PlayerState.PLAYING || currentPlayerState == PlayerState.PAUSED) && !isSeekingFromUser.get()) {
-                int currentFrame = nativeGetCurrentFrame(); // 获取当前帧
+                int currentFrame = nativeGetCurrentFrame(nativePlayer); // 获取当前帧
+                if (!firstFrameTimeLogged) { // 首帧显示后记录一次首帧耗时
+                    double ttffMs = nativeGetTimeToFirstFrameMs(nativePlayer);
+                    if (ttffMs >= 0) {
+                        firstFrameTimeLogged = true;
+                        Log.i(TAG, String.format(Locale.US, "Time to first frame (%s): %.1f ms",
+                                USE_STREAMING_MODE ? "streaming" : "yuv cache", ttffMs));
+                    }
+                }
                 if (seekBar != null) {
                     int totalFrames = seekBar.getMax(); // 获取总帧数
                     if (totalFrames > 0) {
@@ -116,6 +170,7 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
     @Override
     protected void onCreate(Bundle savedInstanceState) {
         super.onCreate(savedInstanceState);
+        nativePlayer = nativeCreatePlayer(); // 每个Activity一个独立的播放器实例
 
         String packageName = getPackageName(); // 获取包名
         // 通过资源名动态获取布局ID
@@ -166,8 +221,8 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
             }
             @Override
             public void onStartTrackingTouch(SeekBar seekBarParam) { // 开始拖动进度条
-                // 仅当YUV解码完成且播放器处于可跳转状态时
-                if (isYuvDecoded && (currentPlayerState == PlayerState.PLAYING || currentPlayerState == PlayerState.PAUSED || currentPlayerState == PlayerState.IDLE || currentPlayerState == PlayerState.STOPPED)) {
+                // 仅当媒体准备好且播放器处于可跳转状态时
+                if (isMediaReady && (currentPlayerState == PlayerState.PLAYING || currentPlayerState == PlayerState.PAUSED || currentPlayerState == PlayerState.IDLE || currentPlayerState == PlayerState.STOPPED)) {
                     isSeekingFromUser.set(true); // 标记用户正在拖动
                     if (currentPlayerState == PlayerState.PLAYING || currentPlayerState == PlayerState.PAUSED) {
                         mainUIHandler.removeCallbacks(progressUpdater); // 暂停进度更新
@@ -176,7 +231,7 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
             }
             @Override
             public void onStopTrackingTouch(SeekBar seekBarParam) { // 停止拖动进度条
-                if (!isYuvDecoded) { // 如果YUV未解码，则不处理
+                if (!isMediaReady) { // 如果媒体未准备好，则不处理
                     isSeekingFromUser.set(false);
                     return;
                 }
@@ -198,13 +253,13 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
                     boolean wasPlaying = (currentPlayerState == PlayerState.PLAYING); // 记录跳转前是否在播放
 
                     if (wasPlaying) { // 如果在播放，先暂停
-                        nativePauseVideo();
-                        pauseAudio(true);
+                        nativePauseVideo(nativePlayer);
+                        pauseAudio(nativePlayer, true);
                     }
 
-                    nativeSeekToFrame(targetFrameOnSeek); // 跳转视频帧
+                    nativeSeekToFrame(nativePlayer, targetFrameOnSeek); // 跳转视频帧
                     if (targetTimeMs >= 0) {
-                        nativeSeekAudioToTimestamp(targetTimeMs); // 跳转音频时间
+                        nativeSeekAudioToTimestamp(nativePlayer, targetTimeMs); // 跳转音频时间
                     } else {
                         Log.w(TAG, "Skipping audio seek due to invalid targetTimeMs.");
                     }
@@ -214,11 +269,11 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
                     }
 
                     if (wasPlaying) { // 如果之前在播放，则恢复播放
-                        nativeResumeVideo();
-                        pauseAudio(false);
+                        nativeResumeVideo(nativePlayer);
+                        pauseAudio(nativePlayer, false);
                     }
                 } else { // 如果是IDLE或STOPPED状态，则只记录跳转位置供下次播放使用
-                    nativeSeekToFrame(targetFrameOnSeek);
+                    nativeSeekToFrame(nativePlayer, targetFrameOnSeek);
                     pendingAudioSeekMs = targetTimeMs; // 记录音频待跳转时间
                     if (MainActivity.this.seekBar != null) {
                         MainActivity.this.seekBar.setProgress(targetFrameOnSeek);
@@ -236,42 +291,61 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
         prepareMediaInBackground(); // 在后台准备媒体文件 (拷贝和解码)
     }
 
-    // 在后台准备媒体文件 (拷贝assets中的MP4到缓存，然后解码为YUV)
+    // 在后台准备媒体文件 (拷贝assets中的MP4到缓存；流式模式下仅探测视频参数，缓存模式下解码为YUV)
     private void prepareMediaInBackground() {
         updateUIForState(PlayerState.PREPARING); // 更新UI为准备状态
         backgroundExecutor.submit(() -> { // 提交到后台线程执行
             try {
-                File copiedMp4File = copyAssetToCacheDir(INPUT_FILE_NAME); // 拷贝MP4
+                long prepareStartMs = SystemClock.elapsedRealtime(); // 启动耗时计时起点
+                nativeSetDecoderThreading(DECODER_THREAD_COUNT, DECODER_FRAME_THREADS, DECODER_SLICE_THREADS);
+                nativeSetAvSyncThresholdMs(nativePlayer, AV_SYNC_THRESHOLD_MS);
+                nativeSetAudioOutput(nativePlayer, USE_NATIVE_AUDIO);
+                nativeSetVideoOutput(nativePlayer, USE_RGB565_OUTPUT);
+                nativeSetRedrawCache(nativePlayer, USE_REDRAW_CACHE);
+                File copiedMp4File = copyAssetToCacheDir(INPUT_FILE_NAME); // 拷贝MP4 (内容未变时跳过)
                 mp4FilePath = copiedMp4File.getAbsolutePath();
 
-                File yuvOutputFile = new File(getCacheDir(), YUV_FILE_NAME); // 创建YUV输出文件对象
-                yuvFilePath = yuvOutputFile.getAbsolutePath();
-
-                Log.i(TAG, "Starting YUV decoding from " + mp4FilePath + " to " + yuvFilePath);
-                int decodeResult = decodeVideoToFile(mp4FilePath, yuvFilePath); // 调用JNI解码
+                int totalFramesResult; // 总帧数 (<0 表示失败)
+                if (USE_STREAMING_MODE) {
+                    Log.i(TAG, "Probing " + mp4FilePath + " for streaming playback");
+                    totalFramesResult = nativeProbeVideo(nativePlayer, mp4FilePath, getCacheDir().getAbsolutePath()); // 仅探测并建立关键帧索引，不预解码
+                } else {
+                    new File(getCacheDir(), LEGACY_YUV_FILE_NAME).delete(); // 清理旧版本的YUV文件
+                    Log.i(TAG, "Preparing YUV cache for " + mp4FilePath);
+                    yuvFilePath = nativePrepareFrameCache(nativePlayer, mp4FilePath, getCacheDir().getAbsolutePath(), CACHE_DECODE_WORKERS,
+                            CACHE_ZERO_COPY); // 复用、续写或完整解码
+                    totalFramesResult = yuvFilePath != null ? nativeGetTotalFrames(nativePlayer, yuvFilePath) : -1;
+                    if (yuvFilePath != null) {
+                        Log.i(TAG, String.format(Locale.US, "Startup: %.0f ms total, %s",
+                                (double) (SystemClock.elapsedRealtime() - prepareStartMs), nativeGetStartupMetrics(nativePlayer)));
+                    }
+                }
 
-                if (decodeResult == 0) { // 解码成功
-                    isYuvDecoded = true;
-                    videoFrameRate = nativeGetFrameRate(); // 获取视频帧率
+                if (totalFramesResult >= 0) { // 准备成功
+                    isMediaReady = true;
+                    videoFrameRate = nativeGetFrameRate(nativePlayer); // 获取视频帧率
                     if (videoFrameRate <= 0.001) { // 帧率无效则使用默认值
                         Log.w(TAG, "Invalid frame rate from native: " + videoFrameRate + ", using default 25.0");
                         videoFrameRate = 25.0;
                     }
-                    Log.i(TAG, "YUV decoding successful. Video Frame Rate: " + videoFrameRate);
+                    Log.i(TAG, "Media prepared. Video Frame Rate: " + videoFrameRate + ", total frames: " + totalFramesResult);
+                    if (RUN_NATIVE_BENCHMARKS && !backgroundExecutor.isShutdown()) { // Activity已销毁时不再提交
+                        backgroundExecutor.submit(this::runNativeBenchmarks);
+                    }
+                    final int totalFrames = totalFramesResult;
                     mainUIHandler.post(() -> { // 在主线程更新UI
                         if (seekBar != null) {
-                            int totalFrames = nativeGetTotalFrames(yuvFilePath); // 获取总帧数
                             seekBar.setMax(totalFrames > 0 ? totalFrames : 1); // 设置进度条最大值
                             seekBar.setProgress(0); // 设置进度条初始值为0
                         }
                         if (isSurfaceReady) { // 如果Surface已准备好
                             updateUIForState(PlayerState.IDLE); // 更新UI为IDLE状态
                         } else {
-                            Toast.makeText(this, "Video decoded, waiting for surface...", Toast.LENGTH_SHORT).show();
+                            Toast.makeText(this, "Video ready, waiting for surface...", Toast.LENGTH_SHORT).show();
                         }
                     });
-                } else { // 解码失败
-                    Log.e(TAG, "YUV decoding failed, code: " + decodeResult);
+                } else { // 准备失败
+                    Log.e(TAG, "Media preparation failed, code: " + totalFramesResult);
                     mainUIHandler.post(() -> updateUIForState(PlayerState.ERROR)); // 更新UI为错误状态
                 }
             } catch (IOException e) { // 文件操作异常
@@ -281,10 +355,18 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
         });
     }
 
+    // 运行Native基准测试，逐行输出报告 (logcat单条日志长度有限)
+    private void runNativeBenchmarks() {
+        String report = nativeRunBenchmarks(mp4FilePath);
+        for (String line : report.split("\n")) {
+            Log.i(TAG, "[Benchmark] " + line);
+        }
+    }
+
     // 处理播放/暂停按钮点击事件
     private void handlePlayPause() {
-        if (!isYuvDecoded) { // 如果YUV未解码
-            Toast.makeText(this, "Video not yet decoded.", Toast.LENGTH_SHORT).show();
+        if (!isMediaReady) { // 如果媒体未准备好
+            Toast.makeText(this, "Video not yet prepared.", Toast.LENGTH_SHORT).show();
             if(currentPlayerState != PlayerState.PREPARING) prepareMediaInBackground(); // 重新准备
             return;
         }
@@ -321,7 +403,7 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
     private void startNewPlayback() {
         Log.i(TAG, "Starting new playback...");
         if (initAudio(mp4FilePath) == 0) { // 初始化音频
-            startAudio(mp4FilePath, pendingAudioSeekMs); // 开始播放音频 (如有待处理的跳转)
+            startAudio(nativePlayer, mp4FilePath, pendingAudioSeekMs); // 开始播放音频 (如有待处理的跳转)
             pendingAudioSeekMs = -1; // 清除待处理的音频跳转
         } else {
             Log.e(TAG, "Failed to initialize audio.");
@@ -330,9 +412,15 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
 
         // 确保Surface有效
         if (surfaceHolder != null && surfaceHolder.getSurface() != null && surfaceHolder.getSurface().isValid()) {
-            nativeStartVideoPlayback(yuvFilePath, surfaceHolder.getSurface()); // 开始视频播放
-            nativeSetSpeed(currentSpeed); // 应用当前速度到视频
-            nativeSetAudioPlaybackRate(currentSpeed); // 应用当前速度到音频
+            if (USE_STREAMING_MODE) {
+                nativeStartStreamingPlayback(nativePlayer, mp4FilePath, surfaceHolder.getSurface()); // 边解码边播放
+            } else {
+                nativeStartVideoPlayback(nativePlayer, yuvFilePath, surfaceHolder.getSurface()); // 从YUV缓存文件播放
+            }
+            firstFrameTimeLogged = false;
+            playbackSurfaceLost = false;
+            nativeSetSpeed(nativePlayer, currentSpeed); // 应用当前速度到视频
+            nativeSetAudioPlaybackRate(nativePlayer, currentSpeed); // 应用当前速度到音频
 
             updateUIForState(PlayerState.PLAYING); // 更新UI为播放状态
             mainUIHandler.removeCallbacks(progressUpdater); // 开始进度更新
@@ -347,8 +435,8 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
     // 暂停当前播放
     private void pauseCurrentPlayback() {
         if (currentPlayerState == PlayerState.PLAYING) {
-            nativePauseVideo(); // 暂停视频
-            pauseAudio(true);  // 暂停音频
+            nativePauseVideo(nativePlayer); // 暂停视频
+            pauseAudio(nativePlayer, true);  // 暂停音频
             updateUIForState(PlayerState.PAUSED); // 更新UI为暂停状态
             mainUIHandler.removeCallbacks(progressUpdater); // 停止进度更新
         }
@@ -359,8 +447,8 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
         if (currentPlayerState == PlayerState.PAUSED) {
             // 确保Surface有效
             if (isSurfaceReady && surfaceHolder != null && surfaceHolder.getSurface() != null && surfaceHolder.getSurface().isValid()) {
-                nativeResumeVideo(); // 恢复视频
-                pauseAudio(false); // 恢复音频
+                nativeResumeVideo(nativePlayer); // 恢复视频
+                pauseAudio(nativePlayer, false); // 恢复音频
                 updateUIForState(PlayerState.PLAYING); // 更新UI为播放状态
                 mainUIHandler.removeCallbacks(progressUpdater); // 重新开始进度更新
                 mainUIHandler.post(progressUpdater);
@@ -375,8 +463,17 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
     // 处理停止按钮点击事件
     private void handleStop() {
         Log.i(TAG, "Stopping playback...");
-        nativeStopVideoPlayback(); // 停止视频
-        stopAudio(); // 停止音频
+        nativeStopVideoPlayback(nativePlayer); // 停止视频
+        Log.i(TAG, "Pacing metrics: " + nativeGetPacingMetrics(nativePlayer));
+        Log.i(TAG, "Control metrics: " + nativeGetControlMetrics(nativePlayer));
+        Log.i(TAG, "A/V sync metrics: " + nativeGetAvSyncMetrics(nativePlayer));
+        if (USE_STREAMING_MODE) {
+            Log.i(TAG, "Seek metrics: " + nativeGetSeekMetrics(nativePlayer));
+        }
+        stopAudio(nativePlayer); // 停止音频
+        if (USE_NATIVE_AUDIO) {
+            Log.i(TAG, "Audio metrics: " + nativeGetAudioMetrics(nativePlayer));
+        }
         currentSpeed = 1.0f; // 停止时重置速度为1.0x
 
         updateUIForState(PlayerState.STOPPED); // 更新UI为停止状态
@@ -385,13 +482,13 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
             seekBar.setProgress(0); // 重置进度条
         }
         pendingAudioSeekMs = -1; // 清除待处理的音频跳转
-        nativeSeekToFrame(0); // 视频跳转回第0帧
+        nativeSeekToFrame(nativePlayer, 0); // 视频跳转回第0帧
     }
 
     // 处理速度切换按钮点击事件
     private void handleSpeedToggle() {
         // 仅在播放或暂停状态下允许改变速度
-        if (!isYuvDecoded || (currentPlayerState != PlayerState.PLAYING && currentPlayerState != PlayerState.PAUSED)) {
+        if (!isMediaReady || (currentPlayerState != PlayerState.PLAYING && currentPlayerState != PlayerState.PAUSED)) {
             Toast.makeText(this, "Please start playback first to change speed.", Toast.LENGTH_SHORT).show();
             return;
         }
@@ -403,8 +500,8 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
 
         currentSpeed = newSpeed;
 
-        nativeSetSpeed(currentSpeed); // 设置视频速度
-        nativeSetAudioPlaybackRate(currentSpeed); // 设置音频速度
+        nativeSetSpeed(nativePlayer, currentSpeed); // 设置视频速度
+        nativeSetAudioPlaybackRate(nativePlayer, currentSpeed); // 设置音频速度
 
         if (speedTextView != null) { // 更新速度显示文本
             mainUIHandler.post(() -> speedTextView.setText(String.format(Locale.US, "Speed: %.1fx", currentSpeed)));
@@ -430,10 +527,10 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
         switch (state) {
             case IDLE:
                 playPauseButton.setText("Play");
-                playPauseButton.setEnabled(isYuvDecoded && isSurfaceReady); // 仅当YUV解码且Surface准备好时可用
+                playPauseButton.setEnabled(isMediaReady && isSurfaceReady); // 仅当媒体准备好且Surface准备好时可用
                 stopButton.setEnabled(false);
                 speedButton.setEnabled(false);
-                seekBar.setEnabled(isYuvDecoded);
+                seekBar.setEnabled(isMediaReady);
                 break;
             case PREPARING:
                 playPauseButton.setText("Preparing...");
@@ -458,10 +555,10 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
                 break;
             case STOPPED:
                 playPauseButton.setText("Play");
-                playPauseButton.setEnabled(isYuvDecoded && isSurfaceReady);
+                playPauseButton.setEnabled(isMediaReady && isSurfaceReady);
                 stopButton.setEnabled(false);
                 speedButton.setEnabled(false);
-                seekBar.setEnabled(isYuvDecoded);
+                seekBar.setEnabled(isMediaReady);
                 if (seekBar != null) seekBar.setProgress(0); // 重置进度条
                 break;
             case ERROR:
@@ -478,15 +575,15 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
         }
     }
 
-    // --- SurfaceHolder.Callback 实现 ---
+    // --- SurfaceHolder.Callback2 实现 ---
     @Override
     public void surfaceCreated(SurfaceHolder holder) { // Surface创建时调用
         Log.i(TAG, "Surface created.");
         this.surfaceHolder = holder;
         isSurfaceReady = true; // 标记Surface已准备好
-        // 如果YUV已解码且播放器处于可播放状态，则更新UI
-        if (isYuvDecoded && (currentPlayerState == PlayerState.IDLE || currentPlayerState == PlayerState.STOPPED || currentPlayerState == PlayerState.ERROR || currentPlayerState == PlayerState.PREPARING ) ) {
-            if (currentPlayerState == PlayerState.PREPARING && isYuvDecoded) { // 如果在准备中且YUV解码完成
+        // 如果媒体已准备好且播放器处于可播放状态，则更新UI
+        if (isMediaReady && (currentPlayerState == PlayerState.IDLE || currentPlayerState == PlayerState.STOPPED || currentPlayerState == PlayerState.ERROR || currentPlayerState == PlayerState.PREPARING ) ) {
+            if (currentPlayerState == PlayerState.PREPARING && isMediaReady) { // 如果在准备中且媒体已准备好
                 updateUIForState(PlayerState.IDLE);
             } else {
                 updateUIForState(currentPlayerState);
@@ -503,14 +600,23 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
         this.surfaceHolder = holder; // 更新SurfaceHolder引用
     }
 
+    @Override
+    public void surfaceRedrawNeeded(SurfaceHolder holder) { // Surface内容需要重绘时调用 (尺寸变化、重新显示等)
+        // 播放中下一帧会自然覆盖，暂停时需要重新显示当前画面
+        if (currentPlayerState == PlayerState.PAUSED && !playbackSurfaceLost) {
+            nativeRedrawVideo(nativePlayer);
+        }
+    }
+
     @Override
     public void surfaceDestroyed(SurfaceHolder holder) { // Surface销毁时调用
         Log.i(TAG, "Surface destroyed.");
         isSurfaceReady = false; // 标记Surface未准备好
         if (currentPlayerState == PlayerState.PLAYING || currentPlayerState == PlayerState.PAUSED) { // 如果在播放或暂停时销毁
             Log.w(TAG, "Surface destroyed during playback/pause. Pausing playback.");
-            nativePauseVideo(); // 暂停视频
-            pauseAudio(true);  // 暂停音频
+            playbackSurfaceLost = true;
+            nativePauseVideo(nativePlayer); // 暂停视频
+            pauseAudio(nativePlayer, true);  // 暂停音频
             updateUIForState(PlayerState.PAUSED); // 更新UI为暂停状态
             mainUIHandler.removeCallbacks(progressUpdater); // 停止进度更新
         }
@@ -521,6 +627,13 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
     private File copyAssetToCacheDir(String filename) throws IOException {
         File cacheDir = getCacheDir(); // 获取缓存目录
         File outFile = new File(cacheDir, filename); // 创建输出文件对象
+        long assetLength = getAssetLength(filename);
+        if (assetLength >= 0 && outFile.isFile() && outFile.length() == assetLength
+                && outFile.lastModified() >= getPackageUpdateTime()) {
+            // 应用更新后已拷贝过且大小一致则不再覆盖，保持文件修改时间不变，解码缓存可以直接复用
+            Log.i(TAG, "Asset '" + filename + "' already in cache: " + outFile.getAbsolutePath());
+            return outFile;
+        }
         try (InputStream in = getAssets().open(filename); // 打开assets输入流
              OutputStream out = new FileOutputStream(outFile)) { // 打开文件输出流
             byte[] buffer = new byte[4096]; // 缓冲区
@@ -533,6 +646,24 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
         return outFile; // 返回拷贝后的文件对象
     }
 
+    // 获取应用最近一次安装/更新的时间，assets只可能在此时变化
+    private long getPackageUpdateTime() {
+        try {
+            return getPackageManager().getPackageInfo(getPackageName(), 0).lastUpdateTime;
+        } catch (android.content.pm.PackageManager.NameNotFoundException e) {
+            return Long.MAX_VALUE;
+        }
+    }
+
+    // 获取assets中文件的大小，文件被压缩存储时无法直接获取，返回-1
+    private long getAssetLength(String filename) {
+        try (AssetFileDescriptor fd = getAssets().openFd(filename)) {
+            return fd.getLength();
+        } catch (IOException e) {
+            return -1;
+        }
+    }
+
     @Override
     protected void onPause() { // Activity暂停时调用
         super.onPause();
@@ -546,11 +677,16 @@ public class MainActivity extends AppCompatActivity implements SurfaceHolder.Cal
         super.onDestroy();
         Log.i(TAG, "onDestroy: Cleaning up resources.");
         handleStop(); // 停止播放并释放资源
-        if (backgroundExecutor != null && !backgroundExecutor.isShutdown()) { // 关闭后台线程池
-            backgroundExecutor.shutdownNow();
-        }
         if (mainUIHandler != null) { // 移除Handler中的所有回调和消息
             mainUIHandler.removeCallbacksAndMessages(null);
         }
+        // 后台任务 (准备缓存、基准测试) 可能仍在使用播放器实例，且原生调用无法中断：
+        // 释放作为后台线程池的最后一个任务，在它们结束后执行，主线程不等待
+        final long player = nativePlayer;
+        backgroundExecutor.execute(() -> {
+            nativePlayer = 0;
+            nativeReleasePlayer(player); // 释放播放器实例
+        });
+        backgroundExecutor.shutdown(); // 已提交的任务照常执行，不再接受新任务
     }
 }
\ No newline at end of file